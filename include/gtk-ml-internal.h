@@ -7,37 +7,71 @@
 
 #include "gtk-ml.h"
 
+// a page of s-objects, aligned to `GTKML_SLAB_SIZE` so a cell can find its page
+typedef struct GtkMl_Slab {
+    GtkMl_Gc *gc;
+    struct GtkMl_Slab *next;
+    struct GtkMl_Slab *prev;
+    struct GtkMl_Slab *next_partial;
+    gboolean in_partial;
+    gboolean unswept; // still holds the marks of the last full collection
+    GtkMl_SObj free; // freed cells, linked through `GtkMl_S::next`
+    size_t bump; // cells below `bump` have been handed out before
+    size_t used;
+    GtkMl_S cells[];
+} GtkMl_Slab;
+
+#define GTKML_SLAB_CELLS ((GTKML_SLAB_SIZE - offsetof(GtkMl_Slab, cells)) / sizeof(GtkMl_S))
+
 struct GtkMl_Gc {
     int rc;
 
     gboolean gc_enabled;
     size_t n_values;
     size_t m_values;
-    GtkMl_SObj first;
-
-    GtkMl_SObj *stack;
-    size_t stack_len;
-    size_t stack_cap;
 
-    GtkMl_SObj *local;
-    size_t local_len;
-    size_t local_cap;
-    size_t local_base;
-
-    uint64_t *base_stack;
-    size_t base_stack_ptr;
-    size_t base_stack_cap;
+    GtkMl_Slab *slabs; // every page
+    GtkMl_Slab *partial; // swept pages with free cells
+    GtkMl_Slab *slab; // the page cells are allocated from
+
+    // objects allocated since the last collection, promoted to old if they survive one
+    GtkMl_SObj *nursery;
+    size_t nursery_len;
+    size_t nursery_cap;
+
+    // old objects written to since the last collection, see `gtk_ml_write_barrier`
+    GtkMl_SObj *remembered;
+    size_t remembered_len;
+    size_t remembered_cap;
+
+    // full collections are incremental, objects are marked gray and then scanned a few at a time
+    gboolean marking;
+    unsigned int mark_stop;
+    size_t mark_budget;
+    GtkMl_SObj *gray;
+    size_t gray_len;
+    size_t gray_cap;
+
+    // after marking, pages are swept a few at a time starting here
+    gboolean sweeping;
+    GtkMl_Slab *sweep_slab;
+
+    // the stacks and locals of these vms are roots, every context sharing the gc adds its vm
+    GtkMl_Vm **vms;
+    size_t vm_len;
+    size_t vm_cap;
 
     GtkMl_Program **programs;
     size_t program_len;
     size_t program_cap;
 
+    // one symbol or keyword per name, open addressed, entries leave when the gc frees them
+    GtkMl_SObj *interned;
+    size_t interned_len;
+    size_t interned_cap;
+
     GtkMl_SObj static_stack;
     GtkMl_Builder *builder;
-
-    GtkMl_SObj *free_all;
-    size_t free_len;
-    size_t free_cap;
 };
 
 struct GtkMl_Context {
@@ -48,6 +82,7 @@ struct GtkMl_Context {
     GtkMl_Parser parser;
 
     gboolean is_debugger;
+    gboolean is_debuggee; // a debugger is attached, the vm runs its instrumented loop
     gboolean enable_breakpoint;
     gboolean dbg_done;
 #ifdef GTKML_ENABLE_POSIX
@@ -56,6 +91,26 @@ struct GtkMl_Context {
 #endif /* GTKML_ENABLE_POSIX */
 };
 
+// an instruction handler, takes the operand already resolved from the data section
+typedef gboolean (*GtkMl_Handler)(GtkMl_Vm *, GtkMl_SObj *, GtkMl_TaggedValue);
+
+// an instruction decoded by `gtk_ml_vm_load_program`
+// `handler` is never NULL, exports and invalid instructions get handlers of their own
+typedef struct GtkMl_Decoded {
+    GtkMl_Handler handler;
+    GtkMl_TaggedValue operand;
+    uint32_t cond;
+    uint16_t opcode; // the threaded dispatch slot, `GTKML_I_INDIRECT` for anything not in `GTKML_OPCODE_LIST`
+    uint16_t deopts; // how often a quickened form of this instruction fell back to the generic one
+} GtkMl_Decoded;
+
+// the operand types a generic instruction can be quickened for
+typedef enum GtkMl_Quicken {
+    GTKML_QUICKEN_INT,
+    GTKML_QUICKEN_FLOAT,
+    GTKML_N_QUICKEN,
+} GtkMl_Quicken;
+
 struct GtkMl_Vm {
     uint32_t pc;
     uint32_t flags;
@@ -78,8 +133,13 @@ struct GtkMl_Vm {
     size_t call_stack_cap;
 
     GtkMl_Program *program;
+    GtkMl_Decoded *decoded;
+    size_t n_decoded;
     GtkMl_TaggedValue (**core)(GtkMl_Context *, GtkMl_SObj *, GtkMl_TaggedValue);
 
+    GtkMl_Dispatch dispatch;
+    uint64_t n_executed;
+
     GtkMl_Context *ctx;
 };
 
@@ -127,13 +187,14 @@ GTKML_PUBLIC GtkMl_Context *gtk_ml_new_context_with_gc(GtkMl_Gc *gc) GTKML_MUST_
 GTKML_PUBLIC GtkMl_Gc *gtk_ml_new_gc() GTKML_MUST_USE;
 GTKML_PUBLIC GtkMl_Gc *gtk_ml_gc_copy(GtkMl_Gc *gc) GTKML_MUST_USE;
 GTKML_PUBLIC void gtk_ml_del_gc(GtkMl_Context *ctx, GtkMl_Gc *gc);
-
-// pushes an expression to the stack
-GTKML_PUBLIC void gtk_ml_gc_push(GtkMl_Gc *gc, GtkMl_SObj value);
-// pops an expression from the stack
-GTKML_PUBLIC GtkMl_SObj gtk_ml_gc_pop(GtkMl_Gc *gc);
-// peeks an expression at the top of the stack
-GTKML_PUBLIC GtkMl_SObj gtk_ml_gc_peek(GtkMl_Context *gc);
+// hands out an uninitialized s-object cell, only its flags are set
+GTKML_PUBLIC GtkMl_SObj gtk_ml_gc_alloc(GtkMl_Gc *gc) GTKML_MUST_USE;
+// returns the one symbol or keyword with this name, frees `ptr` if it's owned and the name already exists
+GTKML_PUBLIC GtkMl_SObj gtk_ml_intern(GtkMl_Context *ctx, GtkMl_SKind kind, gboolean owned, const char *ptr, size_t len) GTKML_MUST_USE;
+// whether the last of a parameter list is a vararg
+GTKML_PUBLIC gboolean gtk_ml_params_variadic(GtkMl_SObj params) GTKML_MUST_USE;
+// fills the export table of a linked program
+GTKML_PUBLIC void gtk_ml_index_exports(GtkMl_Program *program);
 
 // early-builds the program's intrinsics
 GTKML_PUBLIC GtkMl_Program *gtk_ml_build_intr_apply(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Builder *b) GTKML_MUST_USE;
@@ -203,6 +264,12 @@ GTKML_PUBLIC gboolean gtk_ml_builder_index(GtkMl_Context *ctx, GtkMl_Builder *b,
 GTKML_PUBLIC gboolean gtk_ml_builder_push(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) GTKML_MUST_USE;
 GTKML_PUBLIC gboolean gtk_ml_builder_pop(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) GTKML_MUST_USE;
 GTKML_PUBLIC gboolean gtk_ml_builder_concat(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_builder_slice(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_builder_table(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_builder_table_to_map(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_builder_table_get(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_builder_table_insert(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_builder_table_delete(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) GTKML_MUST_USE;
 GTKML_PUBLIC gboolean gtk_ml_builder_add(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) GTKML_MUST_USE;
 GTKML_PUBLIC gboolean gtk_ml_builder_sub(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) GTKML_MUST_USE;
 GTKML_PUBLIC gboolean gtk_ml_builder_mul(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) GTKML_MUST_USE;
@@ -228,75 +295,235 @@ GTKML_PUBLIC void gtk_ml_object_unref(GtkMl_Context *ctx, void *obj);
 // runs a program previously loaded with `gtk_ml_load_program`
 GTKML_PUBLIC gboolean gtk_ml_run_program_internal(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_SObj program, GtkMl_SObj args, gboolean brk) GTKML_MUST_USE;
 
+// decodes `program` and makes it the program executed by `vm`
+GTKML_PUBLIC void gtk_ml_vm_load_program(GtkMl_Vm *vm, GtkMl_Program *program);
 GTKML_PUBLIC gboolean gtk_ml_vm_run(GtkMl_Vm *vm, GtkMl_SObj *err, gboolean brk) GTKML_MUST_USE;
+// rewrites the instruction at `vm->pc` into its quickened form for `kind`, if it has one
+GTKML_PUBLIC void gtk_ml_vm_quicken(GtkMl_Vm *vm, GtkMl_Quicken kind);
+// turns the quickened instruction at `vm->pc` back into its generic form and executes that
+GTKML_PUBLIC gboolean gtk_ml_vm_deoptimize(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
 GTKML_PUBLIC void gtk_ml_vm_push(GtkMl_Vm *vm, GtkMl_TaggedValue value);
 GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_vm_pop(GtkMl_Vm *vm);
 
-GTKML_PUBLIC gboolean gtk_ml_i_nop(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_halt(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_signed_add(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_signed_subtract(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_signed_multiply(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_unsigned_multiply(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_signed_divide(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_unsigned_divide(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_signed_modulo(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_unsigned_modulo(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_bit_and(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_bit_or(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_bit_xor(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_bit_nand(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_bit_nor(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_bit_xnor(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_cmp_imm(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_car(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_cdr(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_bind(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_enter_bind_args(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_define(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_list(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_enter(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_leave(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_unwrap(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_typeof(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_to_sobj(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_to_prim(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-
-GTKML_PUBLIC gboolean gtk_ml_i_push_imm(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_pop(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_setf_imm(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_popf(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_get_imm(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_local_imm(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_list_imm(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_map_imm(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_set_imm(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_array_imm(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_setmm_imm(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_getmm_imm(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_var(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_getvar(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_assignvar(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_len(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_array_index(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_array_push(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_array_pop(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_array_concat(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_map_get(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_map_insert(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_map_delete(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_set_contains(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_set_insert(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_set_delete(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-
-GTKML_PUBLIC gboolean gtk_ml_i_call(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_leave_ret(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_call_core(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_branch_absolute(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-GTKML_PUBLIC gboolean gtk_ml_i_branch_relative(GtkMl_Vm *vm, GtkMl_SObj *err, uint64_t data) GTKML_MUST_USE;
-
-GTKML_PUBLIC void gtk_ml_set_local_internal(GtkMl_Vm *vm, GtkMl_Gc *gc, GtkMl_TaggedValue value);
-GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_get_local_internal(GtkMl_Vm *vm, GtkMl_Gc *gc, int64_t offset) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_nop(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_halt(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_add(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_subtract(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_multiply(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_unsigned_multiply(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_divide(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_unsigned_divide(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_modulo(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_unsigned_modulo(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_bit_and(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_bit_or(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_bit_xor(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_bit_nand(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_bit_nor(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_bit_xnor(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_cmp_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_car(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_cdr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_bind(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_enter_bind_args(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_define(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_list(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_enter(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_leave(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_unwrap(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_typeof(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_to_sobj(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_to_prim(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+
+GTKML_PUBLIC gboolean gtk_ml_i_push_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_pop(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_setf_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_popf(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_get_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_local_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_list_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_map_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_set_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_array_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_setmm_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_getmm_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_var(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_getvar(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_assignvar(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_len(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_array_index(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_array_push(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_array_pop(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_array_concat(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_array_slice(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_map_get(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_map_insert(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_map_delete(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_set_contains(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_set_insert(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_set_delete(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_map_to_table(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_table_to_map(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_table_get(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_table_insert(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_table_delete(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+
+GTKML_PUBLIC gboolean gtk_ml_i_call(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_leave_ret(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_call_core(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_branch_absolute(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_branch_relative(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+
+GTKML_PUBLIC gboolean gtk_ml_i_signed_add_rr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_subtract_rr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_multiply_rr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_divide_rr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_modulo_rr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_bit_and_rr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_bit_or_rr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_bit_xor_rr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_bit_nand_rr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_bit_nor_rr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_bit_xnor_rr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_add_int(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_add_float(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_subtract_int(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_subtract_float(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_multiply_int(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_multiply_float(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_add_rr_int(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_add_rr_float(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_subtract_rr_int(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_subtract_rr_float(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_multiply_rr_int(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_signed_multiply_rr_float(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_cmp_imm_int(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_i_cmp_imm_float(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) GTKML_MUST_USE;
+
+// the dispatch slot of decoded instructions that call their handler indirectly
+#define GTKML_I_INDIRECT 255
+
+// every opcode the vm can execute, as X(opcode, handler)
+// expanded into both the `OPCODES` table and the threaded dispatch loop
+#define GTKML_OPCODE_LIST(X) \
+    X(GTKML_I_NOP, gtk_ml_i_nop) \
+    X(GTKML_I_HALT, gtk_ml_i_halt) \
+    X(GTKML_I_ADD, gtk_ml_i_signed_add) \
+    X(GTKML_I_SUBTRACT, gtk_ml_i_signed_subtract) \
+    X(GTKML_I_SIGNED_MULTIPLY, gtk_ml_i_signed_multiply) \
+    X(GTKML_I_UNSIGNED_MULTIPLY, gtk_ml_i_unsigned_multiply) \
+    X(GTKML_I_SIGNED_DIVIDE, gtk_ml_i_signed_divide) \
+    X(GTKML_I_UNSIGNED_DIVIDE, gtk_ml_i_unsigned_divide) \
+    X(GTKML_I_SIGNED_MODULO, gtk_ml_i_signed_modulo) \
+    X(GTKML_I_UNSIGNED_MODULO, gtk_ml_i_unsigned_modulo) \
+    X(GTKML_I_BIT_AND, gtk_ml_i_bit_and) \
+    X(GTKML_I_BIT_OR, gtk_ml_i_bit_or) \
+    X(GTKML_I_BIT_XOR, gtk_ml_i_bit_xor) \
+    X(GTKML_I_BIT_NAND, gtk_ml_i_bit_nand) \
+    X(GTKML_I_BIT_NOR, gtk_ml_i_bit_nor) \
+    X(GTKML_I_BIT_XNOR, gtk_ml_i_bit_xnor) \
+    X(GTKML_I_CMP_IMM, gtk_ml_i_cmp_imm) \
+    X(GTKML_I_CAR, gtk_ml_i_car) \
+    X(GTKML_I_CDR, gtk_ml_i_cdr) \
+    X(GTKML_I_DEFINE, gtk_ml_i_define) \
+    X(GTKML_I_LIST, gtk_ml_i_list) \
+    X(GTKML_I_BIND, gtk_ml_i_bind) \
+    X(GTKML_I_ENTER_BIND_ARGS, gtk_ml_i_enter_bind_args) \
+    X(GTKML_I_LOCAL_IMM, gtk_ml_i_local_imm) \
+    X(GTKML_I_ENTER, gtk_ml_i_enter) \
+    X(GTKML_I_LEAVE, gtk_ml_i_leave) \
+    X(GTKML_I_UNWRAP, gtk_ml_i_unwrap) \
+    X(GTKML_I_TYPEOF, gtk_ml_i_typeof) \
+    X(GTKML_I_TO_SOBJ, gtk_ml_i_to_sobj) \
+    X(GTKML_I_TO_PRIM, gtk_ml_i_to_prim) \
+    X(GTKML_I_PUSH_IMM, gtk_ml_i_push_imm) \
+    X(GTKML_I_POP, gtk_ml_i_pop) \
+    X(GTKML_I_SETF_IMM, gtk_ml_i_setf_imm) \
+    X(GTKML_I_POPF, gtk_ml_i_popf) \
+    X(GTKML_I_GET_IMM, gtk_ml_i_get_imm) \
+    X(GTKML_I_LIST_IMM, gtk_ml_i_list_imm) \
+    X(GTKML_I_MAP_IMM, gtk_ml_i_map_imm) \
+    X(GTKML_I_SET_IMM, gtk_ml_i_set_imm) \
+    X(GTKML_I_ARRAY_IMM, gtk_ml_i_array_imm) \
+    X(GTKML_I_SETMM_IMM, gtk_ml_i_setmm_imm) \
+    X(GTKML_I_GETMM_IMM, gtk_ml_i_getmm_imm) \
+    X(GTKML_I_VAR, gtk_ml_i_var) \
+    X(GTKML_I_GETVAR, gtk_ml_i_getvar) \
+    X(GTKML_I_ASSIGNVAR, gtk_ml_i_assignvar) \
+    X(GTKML_I_LEN, gtk_ml_i_len) \
+    X(GTKML_I_ARRAY_INDEX, gtk_ml_i_array_index) \
+    X(GTKML_I_ARRAY_PUSH, gtk_ml_i_array_push) \
+    X(GTKML_I_ARRAY_POP, gtk_ml_i_array_pop) \
+    X(GTKML_I_ARRAY_CONCAT, gtk_ml_i_array_concat) \
+    X(GTKML_I_MAP_GET, gtk_ml_i_map_get) \
+    X(GTKML_I_MAP_INSERT, gtk_ml_i_map_insert) \
+    X(GTKML_I_MAP_DELETE, gtk_ml_i_map_delete) \
+    X(GTKML_I_SET_CONTAINS, gtk_ml_i_set_contains) \
+    X(GTKML_I_SET_INSERT, gtk_ml_i_set_insert) \
+    X(GTKML_I_SET_DELETE, gtk_ml_i_set_delete) \
+    X(GTKML_I_CALL, gtk_ml_i_call) \
+    X(GTKML_I_LEAVE_RET, gtk_ml_i_leave_ret) \
+    X(GTKML_I_CALL_CORE, gtk_ml_i_call_core) \
+    X(GTKML_I_BRANCH_ABSOLUTE, gtk_ml_i_branch_absolute) \
+    X(GTKML_I_BRANCH_RELATIVE, gtk_ml_i_branch_relative) \
+    X(GTKML_I_ADD_RR, gtk_ml_i_signed_add_rr) \
+    X(GTKML_I_SUBTRACT_RR, gtk_ml_i_signed_subtract_rr) \
+    X(GTKML_I_SIGNED_MULTIPLY_RR, gtk_ml_i_signed_multiply_rr) \
+    X(GTKML_I_SIGNED_DIVIDE_RR, gtk_ml_i_signed_divide_rr) \
+    X(GTKML_I_SIGNED_MODULO_RR, gtk_ml_i_signed_modulo_rr) \
+    X(GTKML_I_BIT_AND_RR, gtk_ml_i_bit_and_rr) \
+    X(GTKML_I_BIT_OR_RR, gtk_ml_i_bit_or_rr) \
+    X(GTKML_I_BIT_XOR_RR, gtk_ml_i_bit_xor_rr) \
+    X(GTKML_I_BIT_NAND_RR, gtk_ml_i_bit_nand_rr) \
+    X(GTKML_I_BIT_NOR_RR, gtk_ml_i_bit_nor_rr) \
+    X(GTKML_I_BIT_XNOR_RR, gtk_ml_i_bit_xnor_rr) \
+    X(GTKML_I_ARRAY_SLICE, gtk_ml_i_array_slice) \
+    X(GTKML_I_MAP_TO_TABLE, gtk_ml_i_map_to_table) \
+    X(GTKML_I_TABLE_TO_MAP, gtk_ml_i_table_to_map) \
+    X(GTKML_I_TABLE_GET, gtk_ml_i_table_get) \
+    X(GTKML_I_TABLE_INSERT, gtk_ml_i_table_insert) \
+    X(GTKML_I_TABLE_DELETE, gtk_ml_i_table_delete)
+
+// dispatch slots of the quickened instructions, they only ever exist in `GtkMl_Vm::decoded`
+typedef enum GtkMl_QuickenedOpcode {
+    GTKML_QI_ADD_INT = 128,
+    GTKML_QI_ADD_FLOAT,
+    GTKML_QI_SUBTRACT_INT,
+    GTKML_QI_SUBTRACT_FLOAT,
+    GTKML_QI_SIGNED_MULTIPLY_INT,
+    GTKML_QI_SIGNED_MULTIPLY_FLOAT,
+    GTKML_QI_ADD_RR_INT,
+    GTKML_QI_ADD_RR_FLOAT,
+    GTKML_QI_SUBTRACT_RR_INT,
+    GTKML_QI_SUBTRACT_RR_FLOAT,
+    GTKML_QI_SIGNED_MULTIPLY_RR_INT,
+    GTKML_QI_SIGNED_MULTIPLY_RR_FLOAT,
+    GTKML_QI_CMP_IMM_INT,
+    GTKML_QI_CMP_IMM_FLOAT,
+} GtkMl_QuickenedOpcode;
+
+// a quickened instruction stops being quickened after deoptimizing this often
+#define GTKML_QUICKEN_LIMIT 4
+
+// every quickened instruction, as X(slot, handler, generic opcode, operand types)
+#define GTKML_QUICKENED_LIST(X) \
+    X(GTKML_QI_ADD_INT, gtk_ml_i_signed_add_int, GTKML_I_ADD, GTKML_QUICKEN_INT) \
+    X(GTKML_QI_ADD_FLOAT, gtk_ml_i_signed_add_float, GTKML_I_ADD, GTKML_QUICKEN_FLOAT) \
+    X(GTKML_QI_SUBTRACT_INT, gtk_ml_i_signed_subtract_int, GTKML_I_SUBTRACT, GTKML_QUICKEN_INT) \
+    X(GTKML_QI_SUBTRACT_FLOAT, gtk_ml_i_signed_subtract_float, GTKML_I_SUBTRACT, GTKML_QUICKEN_FLOAT) \
+    X(GTKML_QI_SIGNED_MULTIPLY_INT, gtk_ml_i_signed_multiply_int, GTKML_I_SIGNED_MULTIPLY, GTKML_QUICKEN_INT) \
+    X(GTKML_QI_SIGNED_MULTIPLY_FLOAT, gtk_ml_i_signed_multiply_float, GTKML_I_SIGNED_MULTIPLY, GTKML_QUICKEN_FLOAT) \
+    X(GTKML_QI_ADD_RR_INT, gtk_ml_i_signed_add_rr_int, GTKML_I_ADD_RR, GTKML_QUICKEN_INT) \
+    X(GTKML_QI_ADD_RR_FLOAT, gtk_ml_i_signed_add_rr_float, GTKML_I_ADD_RR, GTKML_QUICKEN_FLOAT) \
+    X(GTKML_QI_SUBTRACT_RR_INT, gtk_ml_i_signed_subtract_rr_int, GTKML_I_SUBTRACT_RR, GTKML_QUICKEN_INT) \
+    X(GTKML_QI_SUBTRACT_RR_FLOAT, gtk_ml_i_signed_subtract_rr_float, GTKML_I_SUBTRACT_RR, GTKML_QUICKEN_FLOAT) \
+    X(GTKML_QI_SIGNED_MULTIPLY_RR_INT, gtk_ml_i_signed_multiply_rr_int, GTKML_I_SIGNED_MULTIPLY_RR, GTKML_QUICKEN_INT) \
+    X(GTKML_QI_SIGNED_MULTIPLY_RR_FLOAT, gtk_ml_i_signed_multiply_rr_float, GTKML_I_SIGNED_MULTIPLY_RR, GTKML_QUICKEN_FLOAT) \
+    X(GTKML_QI_CMP_IMM_INT, gtk_ml_i_cmp_imm_int, GTKML_I_CMP_IMM, GTKML_QUICKEN_INT) \
+    X(GTKML_QI_CMP_IMM_FLOAT, gtk_ml_i_cmp_imm_float, GTKML_I_CMP_IMM, GTKML_QUICKEN_FLOAT)
+
+GTKML_PUBLIC void gtk_ml_set_local_internal(GtkMl_Vm *vm, GtkMl_TaggedValue value);
+GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_get_local_internal(GtkMl_Vm *vm, int64_t offset) GTKML_MUST_USE;
 
 // creates a new virtual machine on the heap
 // must be deleted with `gtk_ml_del_vm`
@@ -317,6 +544,69 @@ GTKML_PUBLIC gboolean gtk_ml_compile_macros(GtkMl_Builder *b, GtkMl_BasicBlock *
 // compile a lambda expression to bytecode
 GTKML_PUBLIC gboolean gtk_ml_compile(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_SObj *err, GtkMl_SObj lambda) GTKML_MUST_USE;
 
+/* the rope behind strings, `gtk_ml_array_trie_*` forward here when `array->string` is set */
+
+GTKML_PUBLIC void gtk_ml_string_del(GtkMl_Array *array);
+GTKML_PUBLIC void gtk_ml_string_copy(GtkMl_Array *out, GtkMl_Array *array);
+GTKML_PUBLIC void gtk_ml_string_concat(GtkMl_Array *out, GtkMl_Array *lhs, GtkMl_Array *rhs);
+GTKML_PUBLIC void gtk_ml_string_slice(GtkMl_Array *out, GtkMl_Array *array, size_t start, size_t end);
+// pushes a char, anything else is pushed as U+FFFD
+GTKML_PUBLIC void gtk_ml_string_push(GtkMl_Array *array, GtkMl_TaggedValue value);
+GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_string_pop(GtkMl_Array *array);
+GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_string_get(GtkMl_Array *array, size_t index) GTKML_MUST_USE;
+GTKML_PUBLIC void gtk_ml_string_foreach(GtkMl_Array *array, GtkMl_ArrayFn fn, GtkMl_TaggedValue data);
+GTKML_PUBLIC void gtk_ml_string_foreach_rev(GtkMl_Array *array, GtkMl_ArrayFn fn, GtkMl_TaggedValue data);
+GTKML_PUBLIC gboolean gtk_ml_string_equal(GtkMl_Array *lhs, GtkMl_Array *rhs) GTKML_MUST_USE;
+
+/* program images, written by `gtk_ml_serf_image` and read by `gtk_ml_map_image` */
+
+// a static that is made on the heap when the image is mapped
+typedef struct GtkMl_ImageHeap {
+    uint32_t kind;
+    uint64_t len; // of the name, or the number of elements or entries
+    // the name of a symbol or keyword, otherwise `len` pointers to the elements
+    // maps have a key and a value per entry and their metamap last
+    uint64_t items;
+} GtkMl_ImageHeap;
+
+// a pointer in the image to the static made for `heap`
+typedef struct GtkMl_ImageHeapReloc {
+    uint64_t at;
+    uint64_t heap;
+} GtkMl_ImageHeapReloc;
+
+// an image while it is being written, everything in it is addressed by its offset from the start
+typedef struct GtkMl_ImageWriter {
+    char *bytes;
+    size_t len;
+    size_t cap;
+
+    // pointers to other parts of the image, written as offsets and fixed up when it is mapped
+    uint64_t *relocs;
+    size_t n_relocs;
+    size_t cap_relocs;
+
+    GtkMl_ImageHeap *heap;
+    size_t n_heap;
+    size_t cap_heap;
+
+    GtkMl_ImageHeapReloc *heap_relocs;
+    size_t n_heap_relocs;
+    size_t cap_heap_relocs;
+
+    // every object written so far, to where it was written
+    GtkMl_HashTable refs;
+} GtkMl_ImageWriter;
+
+// reserves `size` zeroed bytes aligned to 16, returns their offset
+GTKML_PUBLIC uint64_t gtk_ml_image_alloc(GtkMl_ImageWriter *w, size_t size) GTKML_MUST_USE;
+// makes the pointer at `at` point to `target` once the image is mapped
+GTKML_PUBLIC void gtk_ml_image_pointer(GtkMl_ImageWriter *w, uint64_t at, uint64_t target);
+// copies the rope of a string into an image, returns its offset or 0 if the string is empty
+GTKML_PUBLIC uint64_t gtk_ml_string_image(GtkMl_ImageWriter *w, GtkMl_Array *array) GTKML_MUST_USE;
+// gives back the memory of a program made by `gtk_ml_map_image`
+GTKML_PUBLIC void gtk_ml_unmap_image(GtkMl_Program *program);
+
 #ifdef GTKML_ENABLE_POSIX
 /* debug versions of container and other operations */
 
@@ -358,6 +648,9 @@ GTKML_PUBLIC gboolean gtk_ml_array_trie_contains_debug(GtkMl_Context *ctx, GtkMl
 GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_array_trie_delete_debug(GtkMl_Context *ctx, GtkMl_Array *out, GtkMl_Array *array, size_t index);
 GTKML_PUBLIC gboolean gtk_ml_array_trie_foreach_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *ht, GtkMl_ArrayDebugFn fn, GtkMl_TaggedValue data) GTKML_MUST_USE;
 GTKML_PUBLIC gboolean gtk_ml_array_trie_equal_debug(GtkMl_Context *ctx, GtkMl_Array *lhs, GtkMl_Array *rhs) GTKML_MUST_USE;
+
+GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_string_get_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, size_t index) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_string_foreach_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, GtkMl_ArrayDebugFn fn, GtkMl_TaggedValue data) GTKML_MUST_USE;
 #endif /* GTKML_ENABLE_POSIX */
 
 #endif /* ifndef GTK_ML_INTERNAL_H */
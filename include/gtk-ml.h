@@ -54,13 +54,26 @@ typedef int gboolean;
 #define GTKML_PRIVATE static
 
 #define GTKML_VERSION "libgtkml ver. 0.0.0"
+// bump whenever compiled programs change shape, it invalidates cached bytecode
+#define GTKML_BYTECODE_VERSION 1
 
 #define GTKML_FLAG_NONE 0x0
 #define GTKML_FLAG_REACHABLE 0x1
 #define GTKML_FLAG_DELETE 0x2
+#define GTKML_FLAG_FREE 0x4
+#define GTKML_FLAG_OLD 0x8
+#define GTKML_FLAG_REMEMBERED 0x10
+#define GTKML_FLAG_GRAY 0x20
+// lives in a mapped program image instead of a slab, see `gtk_ml_map_image`
+#define GTKML_FLAG_IMAGE 0x40
+
+#define GTKML_SLAB_SIZE (16 * 1024)
 
 #define GTKML_GC_COUNT_THRESHOLD 1024
 #define GTKML_GC_STEP_THRESHOLD 256
+#define GTKML_GC_NURSERY_THRESHOLD 4096
+#define GTKML_GC_MARK_BUDGET 1024
+#define GTKML_GC_SWEEP_BUDGET 16
 
 #define GTKML_GC_STACK (GTKML_STACK_SIZE)
 #define GTKML_VM_STACK (GTKML_STACK_SIZE)
@@ -183,6 +196,27 @@ typedef enum GtkMl_Opcode {
     GTKML_I_CALL_CORE,
     GTKML_I_BRANCH_ABSOLUTE,
     GTKML_I_BRANCH_RELATIVE,
+
+    // register forms, operating on slots of the local frame
+    GTKML_I_ADD_RR,
+    GTKML_I_SUBTRACT_RR,
+    GTKML_I_SIGNED_MULTIPLY_RR,
+    GTKML_I_SIGNED_DIVIDE_RR,
+    GTKML_I_SIGNED_MODULO_RR,
+    GTKML_I_BIT_AND_RR,
+    GTKML_I_BIT_OR_RR,
+    GTKML_I_BIT_XOR_RR,
+    GTKML_I_BIT_NAND_RR,
+    GTKML_I_BIT_NOR_RR,
+    GTKML_I_BIT_XNOR_RR,
+    GTKML_I_ARRAY_SLICE,
+
+    // mutable tables, changed in place instead of copied
+    GTKML_I_MAP_TO_TABLE,
+    GTKML_I_TABLE_TO_MAP,
+    GTKML_I_TABLE_GET,
+    GTKML_I_TABLE_INSERT,
+    GTKML_I_TABLE_DELETE,
 } GtkMl_Opcode;
 
 #define GTKML_SI_NOP "nop"
@@ -251,6 +285,25 @@ typedef enum GtkMl_Opcode {
 #define GTKML_SI_BRANCH_ABSOLUTE "branch-absolute"
 #define GTKML_SI_BRANCH_RELATIVE "branch-relative"
 
+#define GTKML_SI_ADD_RR "add-rr"
+#define GTKML_SI_SUBTRACT_RR "subtract-rr"
+#define GTKML_SI_SIGNED_MULTIPLY_RR "signed-multiply-rr"
+#define GTKML_SI_SIGNED_DIVIDE_RR "signed-divide-rr"
+#define GTKML_SI_SIGNED_MODULO_RR "signed-modulo-rr"
+#define GTKML_SI_BIT_AND_RR "bit-and-rr"
+#define GTKML_SI_BIT_OR_RR "bit-or-rr"
+#define GTKML_SI_BIT_XOR_RR "bit-xor-rr"
+#define GTKML_SI_BIT_NAND_RR "bit-nand-rr"
+#define GTKML_SI_BIT_NOR_RR "bit-nor-rr"
+#define GTKML_SI_BIT_XNOR_RR "bit-xnor-rr"
+#define GTKML_SI_ARRAY_SLICE "array-slice"
+
+#define GTKML_SI_MAP_TO_TABLE "map->table"
+#define GTKML_SI_TABLE_TO_MAP "table->map"
+#define GTKML_SI_TABLE_GET "table-get"
+#define GTKML_SI_TABLE_INSERT "table-insert"
+#define GTKML_SI_TABLE_DELETE "table-delete"
+
 #define GTKML_R_ZERO 0
 #define GTKML_R_FLAGS 1
 #define GTKML_R_BP 3
@@ -305,6 +358,8 @@ typedef enum GtkMl_Opcode {
 #define gtk_ml_cdddar(x) ((x)->value.s_list.cdr->value.s_list.cdr->value.s_list.cdr->value.s_list.car)
 #define gtk_ml_cddddar(x) ((x)->value.s_list.cdr->value.s_list.cdr->value.s_list.cdr->value.s_list.cdr->value.s_list.car)
 #define gtk_ml_cdddddar(x) ((x)->value.s_list.cdr->value.s_list.cdr->value.s_list.cdr->value.s_list.cdr->value.s_list.cdr->value.s_list.car)
+// the number of cells in a list, 0 for #nil
+#define gtk_ml_list_len(x) ((x)->kind == GTKML_S_LIST? (x)->value.s_list.len : 0)
 
 typedef union GtkMl_Value GtkMl_Value;
 typedef struct GtkMl_TaggedValue GtkMl_TaggedValue;
@@ -317,7 +372,13 @@ typedef struct GtkMl_Builder GtkMl_Builder;
 typedef uint64_t uint48_t;
 typedef uint48_t GtkMl_Data;
 typedef uint48_t GtkMl_Static;
-typedef uint32_t GtkMl_Hash;
+typedef uint64_t GtkMl_Hash;
+
+// the instruction dispatch engine of a virtual machine
+typedef enum GtkMl_Dispatch {
+    GTKML_DISPATCH_TABLE, // indirect call through the opcode table
+    GTKML_DISPATCH_THREADED, // computed goto, requires GTKML_ENABLE_THREADED
+} GtkMl_Dispatch;
 
 typedef enum GtkMl_Stage {
     GTKML_STAGE_INTR,
@@ -381,6 +442,7 @@ typedef struct GtkMl_HashTrie {
     GtkMl_Hasher *hasher;
     GtkMl_HashTrieNode *root;
     size_t len;
+    GtkMl_Hash hash; // of the contents, 0 until it is first needed
 } GtkMl_HashTrie;
 
 typedef struct GtkMl_HashSetNode GtkMl_HashSetNode;
@@ -389,13 +451,37 @@ typedef struct GtkMl_HashSet {
     GtkMl_Hasher *hasher;
     GtkMl_HashSetNode *root;
     size_t len;
+    GtkMl_Hash hash; // of the contents, 0 until it is first needed
 } GtkMl_HashSet;
 
+typedef struct GtkMl_HashTableSlot GtkMl_HashTableSlot;
+
+// a mutable hash table, open addressed and probed one group of control bytes at a time
+typedef struct GtkMl_HashTable {
+    GtkMl_Hasher *hasher;
+    uint8_t *ctrl; // a byte per slot, empty, deleted, or the low 7 bits of the hash of its key
+    GtkMl_HashTableSlot *slots;
+    size_t len;
+    size_t cap; // 0 or a power of two, never less than a group
+    size_t growth_left; // inserts into empty slots until the table has to grow
+} GtkMl_HashTable;
+
 typedef struct GtkMl_ArrayNode GtkMl_ArrayNode;
+typedef struct GtkMl_StringNode GtkMl_StringNode;
 
 typedef struct GtkMl_Array {
-    GtkMl_ArrayNode *root;
-    size_t len;
+    union {
+        struct {
+            GtkMl_ArrayNode *root;
+            GtkMl_ArrayNode *tail; // the last 1 to 32 elements, kept out of `root`
+            uint32_t shift; // the level of `root`, 0 if `root` is a single leaf
+            uint32_t tail_len; // how many of the elements in `tail` belong to this array
+        };
+        // strings keep their characters as utf-8 bytes in a rope instead
+        GtkMl_StringNode *rope; // NULL if the string is empty
+    };
+    GtkMl_Hash hash; // of the contents, 0 until it is first needed
+    size_t len; // in characters for strings
     int string;
 } GtkMl_Array;
 
@@ -424,6 +510,7 @@ typedef enum GtkMl_SKind {
     GTKML_S_MACRO,
     GTKML_S_LIGHTDATA,
     GTKML_S_USERDATA,
+    GTKML_S_TABLE,
 } GtkMl_SKind;
 
 // a 64-bit signed integer
@@ -446,6 +533,8 @@ typedef struct GtkMl_SSymbol {
     gboolean owned;
     const char *ptr; // reference or heap allocated
     size_t len;
+    GtkMl_Hash hash; // of the name
+    GtkMl_SObj interned; // the one symbol with this name, equal symbols share it
 } GtkMl_SSymbol;
 
 // a keyword like :x, :width, :height
@@ -453,12 +542,16 @@ typedef struct GtkMl_SKeyword {
     gboolean owned;
     const char *ptr; // reference or heap allocated
     size_t len;
+    GtkMl_Hash hash; // of the name
+    GtkMl_SObj interned; // the one keyword with this name, equal keywords share it
 } GtkMl_SKeyword;
 
 // a list like (1 2), (1 (2 3)), (1 "2" 3.0)
+// cells are never changed once made, so every cell knows the length of the list it starts
 typedef struct GtkMl_SList {
     GtkMl_SObj car;
     GtkMl_SObj cdr;
+    size_t len;
 } GtkMl_SList;
 
 // a map like {:width 640 :height 480}
@@ -477,6 +570,11 @@ typedef struct GtkMl_SArray {
     GtkMl_Array array;
 } GtkMl_SArray;
 
+// a mutable map, made from a map with (table {:a 1})
+typedef struct GtkMl_STable {
+    GtkMl_HashTable table;
+} GtkMl_STable;
+
 typedef struct GtkMl_SVar {
     GtkMl_SObj expr;
 } GtkMl_SVar;
@@ -518,6 +616,7 @@ typedef struct GtkMl_SProgram {
     GtkMl_SObj body;
     GtkMl_SObj capture;
     GtkMl_ProgramKind kind;
+    gboolean variadic; // the last of args is a vararg, so calls check arity without walking args
 } GtkMl_SProgram;
 
 // a compiled closure
@@ -564,6 +663,7 @@ typedef union GtkMl_SUnion {
     GtkMl_SMacro s_macro;
     GtkMl_SLightdata s_lightdata;
     GtkMl_SUserdata s_userdata;
+    GtkMl_STable s_table;
 } GtkMl_SUnion;
 
 // a grammar level s expression
@@ -638,10 +738,12 @@ struct GtkMl_Builder {
     GtkMl_TaggedValue *data;
     size_t len_data;
     size_t cap_data;
+    GtkMl_HashTable data_index; // data value to its handle
 
     GtkMl_SObj *statics;
     size_t len_static;
     size_t cap_static;
+    GtkMl_HashTable static_index; // static pointer to its handle
 
     GtkMl_SObj counter; // (var 0)
     unsigned int flags;
@@ -674,6 +776,15 @@ typedef struct GtkMl_Program {
 
     GtkMl_SObj *statics;
     size_t n_static;
+
+    GtkMl_HashTable exports; // linkage name, as a c string, to the program or address it exports
+
+    // the image `start`, `text`, `data` and `statics` point into, NULL if they are allocated on their own
+    void *image;
+    size_t n_image;
+    // statics of the image that had to be made on the heap, like symbols, they are marked with the program
+    GtkMl_SObj *pinned;
+    size_t n_pinned;
 } GtkMl_Program;
 
 typedef GtkMl_SObj (*GtkMl_ReaderFn)(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Token **tokenv, size_t *tokenc);
@@ -701,6 +812,10 @@ typedef struct GtkMl_Deserializer {
 
 GTKML_PUBLIC GtkMl_Hasher GTKML_DEFAULT_HASHER;
 GTKML_PUBLIC GtkMl_Hasher GTKML_VALUE_HASHER;
+// hashes and compares values by their tag and bits only, never looking into an sobject
+GTKML_PUBLIC GtkMl_Hasher GTKML_BITS_HASHER;
+// hashes and compares userdata values as nul terminated c strings
+GTKML_PUBLIC GtkMl_Hasher GTKML_C_STR_HASHER;
 GTKML_PUBLIC GtkMl_Hasher GTKML_PTR_HASHER;
 
 // creates a new context on the heap
@@ -711,16 +826,25 @@ GTKML_PUBLIC GtkMl_Context *gtk_ml_new_context() GTKML_MUST_USE;
 // must be deleted with `gtk_ml_del_context`
 GTKML_PUBLIC GtkMl_Context *gtk_ml_new_debugger(pid_t dbg_process) GTKML_MUST_USE;
 // sets the debug process of a debugger context
-GTKML_PUBLIC void gtk_ml_set_debug(GtkMl_Context *ctx, pid_t dbg_process, GtkMl_Context *debugee);
+// and marks `debugee` in that process as debugged, it must be stopped
+GTKML_PUBLIC gboolean gtk_ml_set_debug(GtkMl_Context *ctx, GtkMl_SObj *err, pid_t dbg_process, GtkMl_Context *debugee) GTKML_MUST_USE;
 #endif /* GTKML_ENABLE_POSIX */
 // deletes a context created with `gtk_ml_new_context`
 GTKML_PUBLIC void gtk_ml_del_context(GtkMl_Context *ctx);
 // loads an executable program into the context
 GTKML_PUBLIC void gtk_ml_load_program(GtkMl_Context *ctx, GtkMl_Program* program);
+// selects the instruction dispatch engine of the context
+// falls back to `GTKML_DISPATCH_TABLE` if the engine wasn't compiled in
+GTKML_PUBLIC void gtk_ml_set_dispatch(GtkMl_Context *ctx, GtkMl_Dispatch dispatch);
+// returns the number of instructions executed by the context so far
+GTKML_PUBLIC uint64_t gtk_ml_executed(GtkMl_Context *ctx) GTKML_MUST_USE;
 // runs a program previously loaded with `gtk_ml_load_program`
 GTKML_PUBLIC gboolean gtk_ml_run_program(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_SObj program, GtkMl_SObj args) GTKML_MUST_USE;
 // gets an export address from a program previously loaded with `gtk_ml_load_program`
 GTKML_PUBLIC GtkMl_SObj gtk_ml_get_export(GtkMl_Context *ctx, GtkMl_SObj *err, const char *linkage_name) GTKML_MUST_USE;
+// looks up an export of a program without allocating, or returns NULL
+// the export lives as long as the context that built the program, so it may be cached
+GTKML_PUBLIC GtkMl_SObj gtk_ml_program_export(GtkMl_Program *program, const char *linkage_name) GTKML_MUST_USE;
 // compile a lambda expression to bytecode with expanding macros
 GTKML_PUBLIC gboolean gtk_ml_compile_program(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_SObj *err, GtkMl_SObj lambda) GTKML_MUST_USE;
 
@@ -826,6 +950,8 @@ GTKML_PUBLIC gboolean gtk_ml_build_array_push(GtkMl_Context *ctx, GtkMl_Builder
 GTKML_PUBLIC gboolean gtk_ml_build_array_pop(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) GTKML_MUST_USE;
 // builds a push in the chosen basic_block
 GTKML_PUBLIC gboolean gtk_ml_build_array_concat(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) GTKML_MUST_USE;
+// builds a slice in the chosen basic_block
+GTKML_PUBLIC gboolean gtk_ml_build_array_slice(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) GTKML_MUST_USE;
 // builds a push in the chosen basic_block
 GTKML_PUBLIC gboolean gtk_ml_build_map_get(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) GTKML_MUST_USE;
 // builds a push in the chosen basic_block
@@ -838,6 +964,16 @@ GTKML_PUBLIC gboolean gtk_ml_build_set_contains(GtkMl_Context *ctx, GtkMl_Builde
 GTKML_PUBLIC gboolean gtk_ml_build_set_insert(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) GTKML_MUST_USE;
 // builds a push in the chosen basic_block
 GTKML_PUBLIC gboolean gtk_ml_build_set_delete(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) GTKML_MUST_USE;
+// builds a map->table in the chosen basic_block
+GTKML_PUBLIC gboolean gtk_ml_build_map_to_table(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) GTKML_MUST_USE;
+// builds a table->map in the chosen basic_block
+GTKML_PUBLIC gboolean gtk_ml_build_table_to_map(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) GTKML_MUST_USE;
+// builds a table-get in the chosen basic_block
+GTKML_PUBLIC gboolean gtk_ml_build_table_get(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) GTKML_MUST_USE;
+// builds a table-insert in the chosen basic_block
+GTKML_PUBLIC gboolean gtk_ml_build_table_insert(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) GTKML_MUST_USE;
+// builds a table-delete in the chosen basic_block
+GTKML_PUBLIC gboolean gtk_ml_build_table_delete(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) GTKML_MUST_USE;
 // builds a call to C in the chosen basic_block
 GTKML_PUBLIC gboolean gtk_ml_build_call_core(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err, GtkMl_Data data) GTKML_MUST_USE;
 // builds a call instruction in the chosen basic_block
@@ -864,6 +1000,9 @@ GTKML_PUBLIC gboolean gtk_ml_build_bitor(GtkMl_Context *ctx, GtkMl_Builder *b, G
 GTKML_PUBLIC gboolean gtk_ml_build_bitxor(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) GTKML_MUST_USE;
 // builds a cmp instruction in the chosen basic_block
 GTKML_PUBLIC gboolean gtk_ml_build_cmp(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err, GtkMl_Data data) GTKML_MUST_USE;
+// builds the register form `opcode` of a binary arithmetic instruction in the chosen basic_block
+// `registers` is a data index of the packed local slots Rs | Ra << 32
+GTKML_PUBLIC gboolean gtk_ml_build_binary_rr(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err, GtkMl_Opcode opcode, GtkMl_Data registers) GTKML_MUST_USE;
 
 // loads an expression from a path
 GTKML_PUBLIC GtkMl_SObj gtk_ml_load(GtkMl_Context *ctx, char **src, GtkMl_SObj *err, const char *file) GTKML_MUST_USE;
@@ -871,6 +1010,9 @@ GTKML_PUBLIC GtkMl_SObj gtk_ml_load(GtkMl_Context *ctx, char **src, GtkMl_SObj *
 GTKML_PUBLIC GtkMl_SObj gtk_ml_loadf(GtkMl_Context *ctx, char **src, GtkMl_SObj *err, FILE *stream) GTKML_MUST_USE;
 // loads an expression from a string
 GTKML_PUBLIC GtkMl_SObj gtk_ml_loads(GtkMl_Context *ctx, GtkMl_SObj *err, const char *src) GTKML_MUST_USE;
+// loads and builds a path, reusing the program built from the same source in cache_dir if there is one
+// without a cache_dir it always compiles, like `gtk_ml_load` followed by `gtk_ml_build`
+GTKML_PUBLIC GtkMl_Program *gtk_ml_load_cached(GtkMl_Context *ctx, char **src, GtkMl_SObj *err, const char *file, const char *cache_dir) GTKML_MUST_USE;
 
 GTKML_PUBLIC gboolean gtk_ml_is_ident_begin(unsigned char c) GTKML_MUST_USE;
 GTKML_PUBLIC gboolean gtk_ml_is_ident_cont(unsigned char c) GTKML_MUST_USE;
@@ -895,6 +1037,8 @@ GTKML_PUBLIC gboolean gtk_ml_collect(GtkMl_Context *ctx) GTKML_MUST_USE;
 GTKML_PUBLIC gboolean gtk_ml_disable_gc(GtkMl_Context *ctx);
 // reenables gc
 GTKML_PUBLIC void gtk_ml_enable_gc(GtkMl_Context *ctx, gboolean enabled);
+// sets how many objects a full collection may scan per step, 0 finishes marking and sweeping in one step
+GTKML_PUBLIC void gtk_ml_set_gc_budget(GtkMl_Context *ctx, size_t budget);
 // dumps a value to a file
 GTKML_PUBLIC gboolean gtk_ml_dumpf_value(GtkMl_Context *ctx, FILE *stream, GtkMl_SObj *err, GtkMl_TaggedValue expr) GTKML_MUST_USE;
 // dumps an sobject to a file
@@ -920,6 +1064,12 @@ GTKML_PUBLIC gboolean gtk_ml_hash(GtkMl_Hasher *hasher, GtkMl_Hash *hash, GtkMl_
 
 // will set the metamap of a value, if that value is a table
 GTKML_PUBLIC void gtk_ml_setmetamap(GtkMl_SObj value, GtkMl_SObj mm);
+// must be called after storing a reference into an already existing s-object
+// the generational gc only rescans old objects that went through here
+GTKML_PUBLIC void gtk_ml_write_barrier(GtkMl_SObj s);
+// for a reference stored into an object that can't be named, like an expansion written back into the ast
+// `value` is treated as old until the next full collection finds out whether it is still reachable
+GTKML_PUBLIC void gtk_ml_write_barrier_value(GtkMl_SObj value);
 // will get the metamap of a value, or NULL if that value is not a table
 GTKML_PUBLIC GtkMl_SObj gtk_ml_getmetamap(GtkMl_SObj value) GTKML_MUST_USE;
 
@@ -941,6 +1091,7 @@ GTKML_PUBLIC GtkMl_SObj gtk_ml_new_list(GtkMl_Context *ctx, GtkMl_Span *span, Gt
 GTKML_PUBLIC GtkMl_SObj gtk_ml_new_map(GtkMl_Context *ctx, GtkMl_Span *span, GtkMl_SObj metamap) GTKML_MUST_USE;
 GTKML_PUBLIC GtkMl_SObj gtk_ml_new_set(GtkMl_Context *ctx, GtkMl_Span *span) GTKML_MUST_USE;
 GTKML_PUBLIC GtkMl_SObj gtk_ml_new_array(GtkMl_Context *ctx, GtkMl_Span *span) GTKML_MUST_USE;
+GTKML_PUBLIC GtkMl_SObj gtk_ml_new_table(GtkMl_Context *ctx, GtkMl_Span *span) GTKML_MUST_USE;
 GTKML_PUBLIC GtkMl_SObj gtk_ml_new_var(GtkMl_Context *ctx, GtkMl_Span *span, GtkMl_SObj expr) GTKML_MUST_USE;
 GTKML_PUBLIC GtkMl_SObj gtk_ml_new_vararg(GtkMl_Context *ctx, GtkMl_Span *span, GtkMl_SObj expr) GTKML_MUST_USE;
 GTKML_PUBLIC GtkMl_SObj gtk_ml_new_quote(GtkMl_Context *ctx, GtkMl_Span *span, GtkMl_SObj expr) GTKML_MUST_USE;
@@ -983,6 +1134,12 @@ GTKML_PUBLIC gboolean gtk_ml_serf_program(GtkMl_Serializer *serf, GtkMl_Context
 // deserializes a program from a sequence of bytes
 GTKML_PUBLIC GtkMl_Program *gtk_ml_deserf_program(GtkMl_Deserializer *deserf, GtkMl_Context *ctx, FILE *stream, GtkMl_SObj *err) GTKML_MUST_USE;
 
+// writes a program as an image that `gtk_ml_map_image` can use in place
+// images only fit the build of the library that wrote them
+GTKML_PUBLIC gboolean gtk_ml_serf_image(GtkMl_Context *ctx, FILE *stream, GtkMl_SObj *err, const GtkMl_Program *program) GTKML_MUST_USE;
+// maps a program image, its text and data are used where they are and its statics only have their pointers fixed
+GTKML_PUBLIC GtkMl_Program *gtk_ml_map_image(GtkMl_Context *ctx, GtkMl_SObj *err, const char *file) GTKML_MUST_USE;
+
 /* data structures */
 
 typedef enum GtkMl_VisitResult {
@@ -994,6 +1151,7 @@ typedef enum GtkMl_VisitResult {
 typedef GtkMl_VisitResult (*GtkMl_HashTrieFn)(GtkMl_HashTrie *ht, GtkMl_TaggedValue key, GtkMl_TaggedValue value, GtkMl_TaggedValue data);
 typedef GtkMl_VisitResult (*GtkMl_HashSetFn)(GtkMl_HashSet *hs, GtkMl_TaggedValue value, GtkMl_TaggedValue data);
 typedef GtkMl_VisitResult (*GtkMl_ArrayFn)(GtkMl_Array *array, size_t index, GtkMl_TaggedValue value, GtkMl_TaggedValue data);
+typedef GtkMl_VisitResult (*GtkMl_HashTableFn)(GtkMl_HashTable *table, GtkMl_TaggedValue key, GtkMl_TaggedValue value, GtkMl_TaggedValue data);
 
 GTKML_PUBLIC void gtk_ml_new_hash_trie(GtkMl_HashTrie *ht, GtkMl_Hasher *hasher);
 GTKML_PUBLIC void gtk_ml_del_hash_trie(GtkMl_Context *ctx, GtkMl_HashTrie *ht, void (*deleter)(GtkMl_Context *, GtkMl_TaggedValue));
@@ -1001,6 +1159,9 @@ GTKML_PUBLIC void gtk_ml_hash_trie_copy(GtkMl_HashTrie *out, GtkMl_HashTrie *ht)
 GTKML_PUBLIC size_t gtk_ml_hash_trie_len(GtkMl_HashTrie *ht) GTKML_MUST_USE;
 GTKML_PUBLIC void gtk_ml_hash_trie_concat(GtkMl_HashTrie *out, GtkMl_HashTrie *lhs, GtkMl_HashTrie *rhs);
 GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_hash_trie_insert(GtkMl_HashTrie *out, GtkMl_HashTrie *ht, GtkMl_TaggedValue key, GtkMl_TaggedValue value);
+// inserts into `ht` itself, mutating the nodes only `ht` references and copying the rest
+// `ht` must own its references, i.e. come from `gtk_ml_new_hash_trie`, `gtk_ml_hash_trie_copy` or another insert
+GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_hash_trie_transient_insert(GtkMl_HashTrie *ht, GtkMl_TaggedValue key, GtkMl_TaggedValue value);
 GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_hash_trie_get(GtkMl_HashTrie *ht, GtkMl_TaggedValue key) GTKML_MUST_USE;
 GTKML_PUBLIC gboolean gtk_ml_hash_trie_contains(GtkMl_HashTrie *ht, GtkMl_TaggedValue key) GTKML_MUST_USE;
 GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_hash_trie_delete(GtkMl_HashTrie *out, GtkMl_HashTrie *ht, GtkMl_TaggedValue key);
@@ -1013,20 +1174,45 @@ GTKML_PUBLIC void gtk_ml_hash_set_copy(GtkMl_HashSet *out, GtkMl_HashSet *hs);
 GTKML_PUBLIC size_t gtk_ml_hash_set_len(GtkMl_HashSet *hs) GTKML_MUST_USE;
 GTKML_PUBLIC void gtk_ml_hash_set_concat(GtkMl_HashSet *out, GtkMl_HashSet *lhs, GtkMl_HashSet *rhs);
 GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_hash_set_insert(GtkMl_HashSet *out, GtkMl_HashSet *hs, GtkMl_TaggedValue value);
+// same as `gtk_ml_hash_trie_transient_insert`
+GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_hash_set_transient_insert(GtkMl_HashSet *hs, GtkMl_TaggedValue value);
 GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_hash_set_get(GtkMl_HashSet *hs, GtkMl_TaggedValue value) GTKML_MUST_USE;
 GTKML_PUBLIC gboolean gtk_ml_hash_set_contains(GtkMl_HashSet *hs, GtkMl_TaggedValue value) GTKML_MUST_USE;
 GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_hash_set_delete(GtkMl_HashSet *out, GtkMl_HashSet *hs, GtkMl_TaggedValue value);
 GTKML_PUBLIC void gtk_ml_hash_set_foreach(GtkMl_HashSet *ht, GtkMl_HashSetFn fn, GtkMl_TaggedValue data);
 GTKML_PUBLIC gboolean gtk_ml_hash_set_equal(GtkMl_HashSet *lhs, GtkMl_HashSet *rhs) GTKML_MUST_USE;
 
+GTKML_PUBLIC void gtk_ml_new_hash_table(GtkMl_HashTable *table, GtkMl_Hasher *hasher);
+GTKML_PUBLIC void gtk_ml_del_hash_table(GtkMl_Context *ctx, GtkMl_HashTable *table, void (*deleter)(GtkMl_Context *, GtkMl_TaggedValue));
+GTKML_PUBLIC size_t gtk_ml_hash_table_len(GtkMl_HashTable *table) GTKML_MUST_USE;
+// inserts in place, returns the value `key` had before or none
+GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_hash_table_insert(GtkMl_HashTable *table, GtkMl_TaggedValue key, GtkMl_TaggedValue value);
+GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_hash_table_get(GtkMl_HashTable *table, GtkMl_TaggedValue key) GTKML_MUST_USE;
+GTKML_PUBLIC gboolean gtk_ml_hash_table_contains(GtkMl_HashTable *table, GtkMl_TaggedValue key) GTKML_MUST_USE;
+// deletes in place, returns the value `key` had or none
+GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_hash_table_delete(GtkMl_HashTable *table, GtkMl_TaggedValue key);
+// the table must not change while it is visited
+GTKML_PUBLIC void gtk_ml_hash_table_foreach(GtkMl_HashTable *table, GtkMl_HashTableFn fn, GtkMl_TaggedValue data);
+// fills a new table with the entries of `ht`
+GTKML_PUBLIC void gtk_ml_hash_table_from_trie(GtkMl_HashTable *out, GtkMl_HashTrie *ht);
+// fills a new persistent map with the entries of `table`
+GTKML_PUBLIC void gtk_ml_hash_trie_from_table(GtkMl_HashTrie *out, GtkMl_HashTable *table);
+
 GTKML_PUBLIC void gtk_ml_new_array_trie(GtkMl_Array *array);
 GTKML_PUBLIC void gtk_ml_new_string_trie(GtkMl_Array *array);
 GTKML_PUBLIC void gtk_ml_del_array_trie(GtkMl_Context *ctx, GtkMl_Array *array, void (*deleter)(GtkMl_Context *, GtkMl_TaggedValue));
 GTKML_PUBLIC void gtk_ml_array_trie_copy(GtkMl_Array *out, GtkMl_Array *array);
 GTKML_PUBLIC gboolean gtk_ml_array_trie_is_string(GtkMl_Array *array) GTKML_MUST_USE;
 GTKML_PUBLIC size_t gtk_ml_array_trie_len(GtkMl_Array *array) GTKML_MUST_USE;
+// shares the nodes of both sides, rebalancing only along the seam
 GTKML_PUBLIC void gtk_ml_array_trie_concat(GtkMl_Array *out, GtkMl_Array *lhs, GtkMl_Array *rhs);
+// the elements `start` to `end - 1`, both clamped to the length of `array`
+GTKML_PUBLIC void gtk_ml_array_trie_slice(GtkMl_Array *out, GtkMl_Array *array, size_t start, size_t end);
+// the elements in front of `index` and the ones from `index` onwards
+GTKML_PUBLIC void gtk_ml_array_trie_split(GtkMl_Array *lhs, GtkMl_Array *rhs, GtkMl_Array *array, size_t index);
 GTKML_PUBLIC void gtk_ml_array_trie_push(GtkMl_Array *out, GtkMl_Array *array, GtkMl_TaggedValue value);
+// same as `gtk_ml_hash_trie_transient_insert`
+GTKML_PUBLIC void gtk_ml_array_trie_transient_push(GtkMl_Array *array, GtkMl_TaggedValue value);
 GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_array_trie_pop(GtkMl_Array *out, GtkMl_Array *array);
 GTKML_PUBLIC GtkMl_TaggedValue gtk_ml_array_trie_get(GtkMl_Array *array, size_t index) GTKML_MUST_USE;
 GTKML_PUBLIC gboolean gtk_ml_array_trie_contains(GtkMl_Array *array, size_t *index, GtkMl_TaggedValue value) GTKML_MUST_USE;
@@ -1035,6 +1221,18 @@ GTKML_PUBLIC void gtk_ml_array_trie_foreach(GtkMl_Array *ht, GtkMl_ArrayFn fn, G
 GTKML_PUBLIC void gtk_ml_array_trie_foreach_rev(GtkMl_Array *ht, GtkMl_ArrayFn fn, GtkMl_TaggedValue data);
 GTKML_PUBLIC gboolean gtk_ml_array_trie_equal(GtkMl_Array *lhs, GtkMl_Array *rhs) GTKML_MUST_USE;
 
+typedef GtkMl_VisitResult (*GtkMl_StringFn)(GtkMl_Array *array, const char *ptr, size_t len, GtkMl_TaggedValue data);
+
+// appends `len` bytes of utf-8 to the string `array`, replacing malformed sequences with U+FFFD
+// same as `gtk_ml_hash_trie_transient_insert`
+GTKML_PUBLIC void gtk_ml_string_append(GtkMl_Array *array, const char *ptr, size_t len);
+// the length of the string `array` in bytes
+GTKML_PUBLIC size_t gtk_ml_string_bytes(GtkMl_Array *array) GTKML_MUST_USE;
+// writes the utf-8 bytes of `array` to `out`, which must hold `gtk_ml_string_bytes(array)` of them
+GTKML_PUBLIC void gtk_ml_string_write(GtkMl_Array *array, char *out);
+// visits the bytes of `array` in order, a few contiguous chunks at a time
+GTKML_PUBLIC void gtk_ml_string_foreach_chunk(GtkMl_Array *array, GtkMl_StringFn fn, GtkMl_TaggedValue data);
+
 /* miscelaneous */
 
 GTKML_PUBLIC void gtk_ml_delete_sobject_reference(GtkMl_Context *ctx, GtkMl_TaggedValue sobject);
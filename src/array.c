@@ -7,66 +7,106 @@
 #define GTKML_A_BITS 5
 #define GTKML_A_SIZE (1 << GTKML_A_BITS)
 #define GTKML_A_MASK (GTKML_A_SIZE - 1)
+// how many more children than necessary a node may keep after a concatenation
+#define GTKML_A_EXTRAS 2
 
 typedef enum GtkMl_ArrayNodeKind {
     GTKML_A_LEAF,
     GTKML_A_BRANCH,
 } GtkMl_ArrayNodeKind;
 
-typedef struct GtkMl_ALeaf {
-    GtkMl_TaggedValue value;
-} GtkMl_ALeaf;
-
-typedef struct GtkMl_ABranch {
-    GtkMl_ArrayNode **nodes;
-    size_t len;
-} GtkMl_ABranch;
-
 typedef union GtkMl_AUnion {
-    GtkMl_ALeaf a_leaf;
-    GtkMl_ABranch a_branch;
+    GtkMl_TaggedValue values[GTKML_A_SIZE];
+    GtkMl_ArrayNode *nodes[GTKML_A_SIZE];
 } GtkMl_AUnion;
 
+// leaves hold up to 32 consecutive values, branches up to 32 subtrees one level down
+// a branch is regular if every child but its last one is full,
+// otherwise it is relaxed and `sizes` says where each child ends
 struct GtkMl_ArrayNode {
     int rc;
-    size_t shift; // (depth - 1) * GTKML_A_BITS
+    // the number of filled slots
+    // arrays sharing a tail may see fewer of them, see `gtk_ml_array_trie_transient_push`
+    uint32_t len;
     GtkMl_ArrayNodeKind kind;
+    // set once a leaf is part of a tree, after which its length never changes
+    gboolean sealed;
+    // the number of elements in the first `i + 1` children, NULL if the branch is regular
+    size_t *sizes;
     GtkMl_AUnion value;
 };
 
-GTKML_PRIVATE GtkMl_ArrayNode *new_leaf(GtkMl_TaggedValue value);
-GTKML_PRIVATE GtkMl_ArrayNode *new_branch(size_t shift, size_t len);
+GTKML_PRIVATE GtkMl_ArrayNode *new_leaf();
+GTKML_PRIVATE GtkMl_ArrayNode *new_branch();
 GTKML_PRIVATE GtkMl_ArrayNode *copy_node(GtkMl_ArrayNode *node);
 GTKML_PRIVATE void del_node(GtkMl_Context *ctx, GtkMl_ArrayNode *node, void (*deleter)(GtkMl_Context *, GtkMl_TaggedValue));
-GTKML_PRIVATE gboolean push(GtkMl_ArrayNode **out, GtkMl_ArrayNode *node, size_t *depth, GtkMl_TaggedValue value);
-GTKML_PRIVATE GtkMl_TaggedValue get(GtkMl_ArrayNode *node, size_t index);
-GTKML_PRIVATE GtkMl_TaggedValue delete(GtkMl_ArrayNode **out, gboolean *shiftme, GtkMl_ArrayNode *node, size_t index);
-GTKML_PRIVATE GtkMl_VisitResult foreach(GtkMl_Array *array, GtkMl_ArrayNode *node, size_t index, GtkMl_ArrayFn fn, GtkMl_TaggedValue data);
-GTKML_PRIVATE GtkMl_VisitResult foreach_rev(GtkMl_Array *array, GtkMl_ArrayNode *node, size_t index, GtkMl_ArrayFn fn, GtkMl_TaggedValue data);
-GTKML_PRIVATE gboolean equal(GtkMl_ArrayNode *lhs, GtkMl_ArrayNode *rhs);
+GTKML_PRIVATE size_t size_of(GtkMl_ArrayNode *node, uint32_t level);
+GTKML_PRIVATE void set_sizes(GtkMl_ArrayNode *node, uint32_t level);
+GTKML_PRIVATE uint32_t child_index(GtkMl_ArrayNode *node, uint32_t level, size_t *index);
+GTKML_PRIVATE GtkMl_ArrayNode *find_leaf(GtkMl_ArrayNode *root, uint32_t shift, size_t *index);
+GTKML_PRIVATE GtkMl_ArrayNode *leaf_for(GtkMl_Array *array, size_t *index, size_t *len);
+GTKML_PRIVATE void own(GtkMl_ArrayNode **slot);
+GTKML_PRIVATE GtkMl_ArrayNode *new_path(uint32_t level, GtkMl_ArrayNode *leaf);
+GTKML_PRIVATE gboolean push_leaf(GtkMl_ArrayNode **slot, uint32_t level, GtkMl_ArrayNode *leaf);
+GTKML_PRIVATE void push_tree(GtkMl_Array *array, GtkMl_ArrayNode *leaf);
+GTKML_PRIVATE GtkMl_ArrayNode *pop_leaf(GtkMl_ArrayNode **slot, uint32_t level);
+GTKML_PRIVATE void pop_tree(GtkMl_Array *array);
+GTKML_PRIVATE void normalize(GtkMl_Array *array);
+GTKML_PRIVATE GtkMl_TaggedValue transient_pop(GtkMl_Array *array);
+GTKML_PRIVATE GtkMl_ArrayNode *concat_trees(GtkMl_ArrayNode *left, uint32_t lshift, GtkMl_ArrayNode *right, uint32_t rshift, gboolean top);
+GTKML_PRIVATE GtkMl_ArrayNode *rebalance(GtkMl_ArrayNode *left, GtkMl_ArrayNode *centre, GtkMl_ArrayNode *right, uint32_t level);
+GTKML_PRIVATE void take_tree(GtkMl_ArrayNode **slot, uint32_t level, size_t n);
+GTKML_PRIVATE void drop_tree(GtkMl_ArrayNode **slot, uint32_t level, size_t n);
+GTKML_PRIVATE void take(GtkMl_Array *array, size_t n);
+GTKML_PRIVATE void drop(GtkMl_Array *array, size_t n);
 GTKML_PRIVATE GtkMl_VisitResult fn_contains(GtkMl_Array *array, size_t index, GtkMl_TaggedValue value, GtkMl_TaggedValue data);
 
 void gtk_ml_new_array_trie(GtkMl_Array *array) {
     array->root = NULL;
+    array->tail = NULL;
+    array->shift = 0;
+    array->tail_len = 0;
+    array->hash = 0;
     array->len = 0;
     array->string = 0;
 }
 
 void gtk_ml_new_string_trie(GtkMl_Array *array) {
-    array->root = NULL;
+    array->rope = NULL;
+    array->hash = 0;
     array->len = 0;
     array->string = 1;
 }
 
 void gtk_ml_del_array_trie(GtkMl_Context *ctx, GtkMl_Array *array, void (*deleter)(GtkMl_Context *, GtkMl_TaggedValue)) {
+    if (array->string) {
+        gtk_ml_string_del(array);
+        return;
+    }
+
     del_node(ctx, array->root, deleter);
+    del_node(ctx, array->tail, deleter);
     array->root = NULL;
+    array->tail = NULL;
+    array->shift = 0;
+    array->tail_len = 0;
+    array->hash = 0;
     array->len = 0;
 }
 
 void gtk_ml_array_trie_copy(GtkMl_Array *out, GtkMl_Array *array) {
+    if (array->string) {
+        gtk_ml_string_copy(out, array);
+        return;
+    }
+
     out->root = copy_node(array->root);
+    out->tail = copy_node(array->tail);
+    out->shift = array->shift;
+    out->tail_len = array->tail_len;
+    out->hash = array->hash;
     out->len = array->len;
+    out->string = array->string;
 }
 
 gboolean gtk_ml_array_trie_is_string(GtkMl_Array *array) {
@@ -77,54 +117,151 @@ size_t gtk_ml_array_trie_len(GtkMl_Array *array) {
     return array->len;
 }
 
-GTKML_PRIVATE GtkMl_VisitResult fn_concat(GtkMl_Array *ht, size_t index, GtkMl_TaggedValue value, GtkMl_TaggedValue data) {
-    (void) ht;
+GTKML_PRIVATE GtkMl_VisitResult fn_concat(GtkMl_Array *array, size_t index, GtkMl_TaggedValue value, GtkMl_TaggedValue data) {
+    (void) array;
     (void) index;
 
     GtkMl_Array *dest = data.value.userdata;
 
-    GtkMl_Array new;
-    gtk_ml_array_trie_push(&new, dest, value);
-    *dest = new;
+    gtk_ml_array_trie_transient_push(dest, value);
 
     return GTKML_VISIT_RECURSE;
 }
 
 void gtk_ml_array_trie_concat(GtkMl_Array *out, GtkMl_Array *lhs, GtkMl_Array *rhs) {
-    out->root = copy_node(lhs->root);
-    out->len = lhs->len;
+    if (lhs->string && rhs->string) {
+        gtk_ml_string_concat(out, lhs, rhs);
+        return;
+    }
+
+    gtk_ml_array_trie_copy(out, lhs);
 
-    gtk_ml_array_trie_foreach(rhs, fn_concat, gtk_ml_value_userdata(out));
-    out->string = lhs->string;
+    if (lhs->string || rhs->string || rhs->len <= 2 * GTKML_A_SIZE) {
+        // short right hand sides are cheaper to push than to merge
+        // and strings mixed with arrays have no trees to merge
+        gtk_ml_array_trie_foreach(rhs, fn_concat, gtk_ml_value_userdata(out));
+        return;
+    }
+
+    if (!out->len) {
+        gtk_ml_del_array_trie(NULL, out, gtk_ml_delete_value);
+        gtk_ml_array_trie_copy(out, rhs);
+        out->string = lhs->string;
+        return;
+    }
+
+    // the tail of `lhs` becomes the last leaf of its tree
+    GtkMl_ArrayNode *leaf = out->tail;
+    if (leaf->len != out->tail_len) {
+        leaf = new_leaf();
+        memcpy(leaf->value.values, out->tail->value.values, sizeof(GtkMl_TaggedValue) * out->tail_len);
+        leaf->len = out->tail_len;
+        del_node(NULL, out->tail, gtk_ml_delete_value);
+    }
+    out->tail = NULL;
+    push_tree(out, leaf);
+
+    GtkMl_ArrayNode *root = concat_trees(out->root, out->shift, rhs->root, rhs->shift, 1);
+    del_node(NULL, out->root, gtk_ml_delete_value);
+    out->root = root;
+    out->shift = (out->shift > rhs->shift? out->shift : rhs->shift) + GTKML_A_BITS;
+    normalize(out);
+
+    out->tail = copy_node(rhs->tail);
+    out->tail_len = rhs->tail_len;
+    out->hash = 0;
+    out->len = lhs->len + rhs->len;
+}
+
+void gtk_ml_array_trie_slice(GtkMl_Array *out, GtkMl_Array *array, size_t start, size_t end) {
+    if (array->string) {
+        gtk_ml_string_slice(out, array, start, end);
+        return;
+    }
+
+    gtk_ml_array_trie_copy(out, array);
+
+    if (end > out->len) {
+        end = out->len;
+    }
+    if (start > end) {
+        start = end;
+    }
+    if (start > 0 || end < out->len) {
+        out->hash = 0;
+    }
+
+    take(out, end);
+    drop(out, start);
+}
+
+void gtk_ml_array_trie_split(GtkMl_Array *lhs, GtkMl_Array *rhs, GtkMl_Array *array, size_t index) {
+    gtk_ml_array_trie_slice(lhs, array, 0, index);
+    gtk_ml_array_trie_slice(rhs, array, index, array->len);
 }
 
 void gtk_ml_array_trie_push(GtkMl_Array *out, GtkMl_Array *array, GtkMl_TaggedValue value) {
-    out->root = NULL;
-    out->len = array->len + 1;
-    out->string = array->string;
+    // the copy shares every node, so the transient push copies whatever it has to change
+    gtk_ml_array_trie_copy(out, array);
+    gtk_ml_array_trie_transient_push(out, value);
+}
 
-    size_t depth;
-    gboolean result = push(&out->root, array->root, &depth, value);
-    if (!result) {
-        out->root = new_branch(array->root->shift + GTKML_A_BITS, 2);
-        out->root->value.a_branch.nodes[0] = copy_node(array->root);
-        size_t shift = out->root->shift;
-        GtkMl_ArrayNode **out_node = out->root->value.a_branch.nodes + 1;
-        while (depth--) {
-            shift -= GTKML_A_BITS;
-            *out_node = new_branch(shift, 1);
-            out_node = (*out_node)->value.a_branch.nodes;
-        }
-        *out_node = new_leaf(value);
+void gtk_ml_array_trie_transient_push(GtkMl_Array *array, GtkMl_TaggedValue value) {
+    if (array->string) {
+        gtk_ml_string_push(array, value);
+        return;
+    }
+
+    array->hash = 0;
+
+    if (array->tail_len == GTKML_A_SIZE) {
+        // the tail is full, move it into the tree
+        push_tree(array, array->tail);
+        array->tail = NULL;
+        array->tail_len = 0;
     }
+
+    if (!array->tail) {
+        array->tail = new_leaf();
+    } else if (array->tail->rc == 1) {
+        // slots past `tail_len` are left over from pops and slices and can be reused
+        array->tail->len = array->tail_len;
+        array->tail->sealed = 0;
+    } else if (array->tail->sealed || array->tail->len != array->tail_len) {
+        // another array already appended to this tail, or it is a leaf of some tree
+        GtkMl_ArrayNode *tail = new_leaf();
+        memcpy(tail->value.values, array->tail->value.values, sizeof(GtkMl_TaggedValue) * array->tail_len);
+        tail->len = array->tail_len;
+        del_node(NULL, array->tail, gtk_ml_delete_value);
+        array->tail = tail;
+    }
+    // a shared tail whose filled slots are all ours is appended to in place,
+    // the other arrays sharing it never look past their own `tail_len`
+
+    array->tail->value.values[array->tail->len++] = value;
+    ++array->tail_len;
+    ++array->len;
 }
 
 GtkMl_TaggedValue gtk_ml_array_trie_pop(GtkMl_Array *out, GtkMl_Array *array) {
-    return gtk_ml_array_trie_delete(out, array, array->len - 1);
+    gtk_ml_array_trie_copy(out, array);
+    if (out->string) {
+        return gtk_ml_string_pop(out);
+    }
+    return transient_pop(out);
 }
 
 GtkMl_TaggedValue gtk_ml_array_trie_get(GtkMl_Array *array, size_t index) {
-    return get(array->root, index);
+    if (array->string) {
+        return gtk_ml_string_get(array, index);
+    }
+
+    if (index >= array->len) {
+        return gtk_ml_value_none();
+    }
+    size_t len;
+    GtkMl_ArrayNode *leaf = leaf_for(array, &index, &len);
+    return leaf->value.values[index];
 }
 
 struct ContainsData {
@@ -135,7 +272,7 @@ struct ContainsData {
 
 gboolean gtk_ml_array_trie_contains(GtkMl_Array *array, size_t *index, GtkMl_TaggedValue value) {
     struct ContainsData contains = { value, 0, 0 };
-    foreach(array, array->root, 0, fn_contains, gtk_ml_value_userdata(&contains));
+    gtk_ml_array_trie_foreach(array, fn_contains, gtk_ml_value_userdata(&contains));
     if (contains.contains) {
         *index = contains.index;
     }
@@ -143,26 +280,59 @@ gboolean gtk_ml_array_trie_contains(GtkMl_Array *array, size_t *index, GtkMl_Tag
 }
 
 GtkMl_TaggedValue gtk_ml_array_trie_delete(GtkMl_Array *out, GtkMl_Array *array, size_t index) {
-    out->root = NULL;
-    out->len = array->len - 1;
-    out->string = array->string;
-
-    gboolean shiftme = 0;
-    GtkMl_TaggedValue result = delete(&out->root, &shiftme, array->root, index);
-    if (array->root->kind != GTKML_A_LEAF && shiftme) {
-        size_t len = array->root->value.a_branch.len;
-        size_t idx = index;
-        memmove(&out->root->value.a_branch.nodes[idx], &out->root->value.a_branch.nodes[idx + 1], sizeof(GtkMl_ArrayNode *) * (len - idx - 1));
+    if (index >= array->len) {
+        gtk_ml_array_trie_copy(out, array);
+        return gtk_ml_value_none();
     }
+
+    GtkMl_TaggedValue result = gtk_ml_array_trie_get(array, index);
+
+    GtkMl_Array front;
+    GtkMl_Array back;
+    gtk_ml_array_trie_slice(&front, array, 0, index);
+    gtk_ml_array_trie_slice(&back, array, index + 1, array->len);
+    gtk_ml_array_trie_concat(out, &front, &back);
+    gtk_ml_del_array_trie(NULL, &front, gtk_ml_delete_value);
+    gtk_ml_del_array_trie(NULL, &back, gtk_ml_delete_value);
+
     return result;
 }
 
 void gtk_ml_array_trie_foreach(GtkMl_Array *array, GtkMl_ArrayFn fn, GtkMl_TaggedValue data) {
-    foreach(array, array->root, 0, fn, data);
+    if (array->string) {
+        gtk_ml_string_foreach(array, fn, data);
+        return;
+    }
+
+    for (size_t i = 0; i < array->len;) {
+        size_t offset = i;
+        size_t len;
+        GtkMl_ArrayNode *leaf = leaf_for(array, &offset, &len);
+        for (; offset < len; offset++, i++) {
+            if (fn(array, i, leaf->value.values[offset], data) == GTKML_VISIT_BREAK) {
+                return;
+            }
+        }
+    }
 }
 
 void gtk_ml_array_trie_foreach_rev(GtkMl_Array *array, GtkMl_ArrayFn fn, GtkMl_TaggedValue data) {
-    foreach_rev(array, array->root, 0, fn, data);
+    if (array->string) {
+        gtk_ml_string_foreach_rev(array, fn, data);
+        return;
+    }
+
+    for (size_t i = array->len; i > 0;) {
+        size_t offset = i - 1;
+        size_t len;
+        GtkMl_ArrayNode *leaf = leaf_for(array, &offset, &len);
+        for (size_t j = offset + 1; j > 0; j--) {
+            --i;
+            if (fn(array, i, leaf->value.values[j - 1], data) == GTKML_VISIT_BREAK) {
+                return;
+            }
+        }
+    }
 }
 
 gboolean gtk_ml_array_trie_equal(GtkMl_Array *lhs, GtkMl_Array *rhs) {
@@ -174,26 +344,56 @@ gboolean gtk_ml_array_trie_equal(GtkMl_Array *lhs, GtkMl_Array *rhs) {
         return 0;
     }
 
-    return equal(lhs->root, rhs->root);
+    if (lhs->string) {
+        return gtk_ml_string_equal(lhs, rhs);
+    }
+
+    if (lhs->root == rhs->root && lhs->tail == rhs->tail) {
+        return 1;
+    }
+
+    if (lhs->hash && rhs->hash && lhs->hash != rhs->hash) {
+        return 0;
+    }
+
+    // the leaves of the two sides need not line up, so compare the overlap of each pair
+    for (size_t i = 0; i < lhs->len;) {
+        size_t l = i;
+        size_t r = i;
+        size_t llen;
+        size_t rlen;
+        GtkMl_ArrayNode *lleaf = leaf_for(lhs, &l, &llen);
+        GtkMl_ArrayNode *rleaf = leaf_for(rhs, &r, &rlen);
+        size_t count = llen - l < rlen - r? llen - l : rlen - r;
+        if (lleaf != rleaf || l != r) {
+            for (size_t j = 0; j < count; j++) {
+                if (!gtk_ml_equal_value(lleaf->value.values[l + j], rleaf->value.values[r + j])) {
+                    return 0;
+                }
+            }
+        }
+        i += count;
+    }
+    return 1;
 }
 
-GtkMl_ArrayNode *new_leaf(GtkMl_TaggedValue value) {
+GtkMl_ArrayNode *new_leaf() {
     GtkMl_ArrayNode *node = malloc(sizeof(GtkMl_ArrayNode));
     node->rc = 1;
-    node->shift = -GTKML_A_BITS;
+    node->len = 0;
     node->kind = GTKML_A_LEAF;
-    node->value.a_leaf.value = value;
+    node->sealed = 0;
+    node->sizes = NULL;
     return node;
 }
 
-GtkMl_ArrayNode *new_branch(size_t shift, size_t len) {
+GtkMl_ArrayNode *new_branch() {
     GtkMl_ArrayNode *node = malloc(sizeof(GtkMl_ArrayNode));
     node->rc = 1;
-    node->shift = shift;
+    node->len = 0;
     node->kind = GTKML_A_BRANCH;
-    node->value.a_branch.nodes = malloc(sizeof(GtkMl_ArrayNode *) * GTKML_A_SIZE);
-    memset(node->value.a_branch.nodes, 0, sizeof(GtkMl_ArrayNode *) * GTKML_A_SIZE);
-    node->value.a_branch.len = len;
+    node->sealed = 0;
+    node->sizes = NULL;
     return node;
 }
 
@@ -216,157 +416,507 @@ void del_node(GtkMl_Context *ctx, GtkMl_ArrayNode *node, void (*deleter)(GtkMl_C
     if (!node->rc) {
         switch (node->kind) {
         case GTKML_A_LEAF:
-            deleter(ctx, node->value.a_leaf.value);
+            for (uint32_t i = 0; i < node->len; i++) {
+                deleter(ctx, node->value.values[i]);
+            }
             break;
         case GTKML_A_BRANCH:
-            for (size_t i = 0; i < node->value.a_branch.len; i++) {
-                del_node(ctx, node->value.a_branch.nodes[i], deleter);
+            for (uint32_t i = 0; i < node->len; i++) {
+                del_node(ctx, node->value.nodes[i], deleter);
             }
-            free(node->value.a_branch.nodes);
+            free(node->sizes);
             break;
         }
         free(node);
     }
 }
 
-gboolean push(GtkMl_ArrayNode **out, GtkMl_ArrayNode *node, size_t *depth, GtkMl_TaggedValue value) {
-    if (!node) {
-        *out = new_leaf(value);
-        return 1;
+// the number of elements below `node`, which is a non-empty node at `level`
+size_t size_of(GtkMl_ArrayNode *node, uint32_t level) {
+    if (!level) {
+        return node->len;
+    }
+    if (node->sizes) {
+        return node->sizes[node->len - 1];
     }
+    return ((size_t) (node->len - 1) << level) + size_of(node->value.nodes[node->len - 1], level - GTKML_A_BITS);
+}
 
-    switch (node->kind) {
-    case GTKML_A_LEAF:
-        *depth = 0;
-        return 0;
-    case GTKML_A_BRANCH: {
-        size_t len = node->value.a_branch.len;
-        if (len == GTKML_A_SIZE) {
-            *out = new_branch(node->shift, len);
-        } else {
-            *out = new_branch(node->shift, len + 1);
+// makes `node` regular or relaxed, whichever its children call for
+void set_sizes(GtkMl_ArrayNode *node, uint32_t level) {
+    size_t sizes[GTKML_A_SIZE];
+    size_t total = 0;
+    gboolean regular = 1;
+    for (uint32_t i = 0; i < node->len; i++) {
+        size_t size = size_of(node->value.nodes[i], level - GTKML_A_BITS);
+        if (i + 1 < node->len && size != (size_t) 1 << level) {
+            regular = 0;
         }
-        for (size_t i = 0; i < len; i++) {
-            (*out)->value.a_branch.nodes[i] = copy_node(node->value.a_branch.nodes[i]);
+        total += size;
+        sizes[i] = total;
+    }
+
+    if (regular) {
+        free(node->sizes);
+        node->sizes = NULL;
+        return;
+    }
+
+    if (!node->sizes) {
+        node->sizes = malloc(sizeof(size_t) * GTKML_A_SIZE);
+    }
+    memcpy(node->sizes, sizes, sizeof(size_t) * node->len);
+}
+
+// the child of the branch `node` holding element `*index`, which becomes the index into that child
+uint32_t child_index(GtkMl_ArrayNode *node, uint32_t level, size_t *index) {
+    // no child holds more than `1 << level` elements, so this is never past the right one
+    uint32_t idx = *index >> level;
+    if (node->sizes) {
+        while (node->sizes[idx] <= *index) {
+            ++idx;
         }
-        size_t idx = len;
-        if (idx == GTKML_A_SIZE) {
-            gboolean result = push(&(*out)->value.a_branch.nodes[GTKML_A_SIZE - 1], node->value.a_branch.nodes[GTKML_A_SIZE - 1], depth, value);
-            if (!result) {
-                ++*depth;
-            }
-            return result;
-        } else {
-            gboolean result = push(&(*out)->value.a_branch.nodes[idx], node->value.a_branch.nodes[idx], depth, value);
-            if (!result) {
-                ++idx;
-                size_t shift = (*out)->shift;
-                GtkMl_ArrayNode **out_node = (*out)->value.a_branch.nodes + idx;
-                while ((*depth)--) {
-                    shift -= GTKML_A_BITS;
-                    *out_node = new_branch(shift, 1);
-                    out_node = (*out_node)->value.a_branch.nodes;
-                }
-                *out_node = new_leaf(value);
-            }
-            return result;
+        if (idx) {
+            *index -= node->sizes[idx - 1];
         }
+    } else {
+        *index -= (size_t) idx << level;
     }
+    return idx;
+}
+
+GtkMl_ArrayNode *find_leaf(GtkMl_ArrayNode *root, uint32_t shift, size_t *index) {
+    GtkMl_ArrayNode *node = root;
+    for (uint32_t level = shift; level > 0; level -= GTKML_A_BITS) {
+        node = node->value.nodes[child_index(node, level, index)];
     }
+    return node;
 }
 
-GtkMl_TaggedValue get(GtkMl_ArrayNode *node, size_t index) {
-    if (!node) {
-        return gtk_ml_value_none();
+// the leaf holding element `*index` and how many of its elements belong to `array`
+GtkMl_ArrayNode *leaf_for(GtkMl_Array *array, size_t *index, size_t *len) {
+    size_t offset = array->len - array->tail_len;
+    if (*index >= offset) {
+        *index -= offset;
+        *len = array->tail_len;
+        return array->tail;
     }
+    GtkMl_ArrayNode *leaf = find_leaf(array->root, array->shift, index);
+    *len = leaf->len;
+    return leaf;
+}
 
-    switch (node->kind) {
-    case GTKML_A_LEAF:
-        return node->value.a_leaf.value;
-    case GTKML_A_BRANCH: {
-        size_t idx = (index >> node->shift) & GTKML_A_MASK;
-        return get(node->value.a_branch.nodes[idx], index);
+// makes `*slot` a branch only the caller references, copying it if it is shared
+void own(GtkMl_ArrayNode **slot) {
+    GtkMl_ArrayNode *node = *slot;
+    if (node->rc == 1) {
+        return;
     }
+
+    GtkMl_ArrayNode *copy = new_branch();
+    for (uint32_t i = 0; i < node->len; i++) {
+        copy->value.nodes[i] = copy_node(node->value.nodes[i]);
+    }
+    copy->len = node->len;
+    if (node->sizes) {
+        copy->sizes = malloc(sizeof(size_t) * GTKML_A_SIZE);
+        memcpy(copy->sizes, node->sizes, sizeof(size_t) * node->len);
     }
+    del_node(NULL, node, gtk_ml_delete_value);
+    *slot = copy;
 }
 
-GtkMl_TaggedValue delete(GtkMl_ArrayNode **out, gboolean *shiftme, GtkMl_ArrayNode *node, size_t index) {
-    if (!node) {
-        return gtk_ml_value_none();
+GtkMl_ArrayNode *new_path(uint32_t level, GtkMl_ArrayNode *leaf) {
+    if (!level) {
+        return leaf;
     }
 
-    switch (node->kind) {
-    case GTKML_A_LEAF:
-        *shiftme = 1;
-        del_node(NULL, *out, gtk_ml_delete_value);
-        *out = NULL;
-        return node->value.a_leaf.value;
-    case GTKML_A_BRANCH: {
-        *out = new_branch(node->shift, node->value.a_branch.len);
-        for (size_t i = 0; i < node->value.a_branch.len; i++) {
-            (*out)->value.a_branch.nodes[i] = copy_node(node->value.a_branch.nodes[i]);
+    GtkMl_ArrayNode *node = new_branch();
+    node->value.nodes[0] = new_path(level - GTKML_A_BITS, leaf);
+    node->len = 1;
+    return node;
+}
+
+// appends `leaf` below the branch `*slot`, returns 0 if there is no room for it
+gboolean push_leaf(GtkMl_ArrayNode **slot, uint32_t level, GtkMl_ArrayNode *leaf) {
+    if (level > GTKML_A_BITS) {
+        own(slot);
+        GtkMl_ArrayNode *node = *slot;
+        if (push_leaf(&node->value.nodes[node->len - 1], level - GTKML_A_BITS, leaf)) {
+            if (node->sizes) {
+                node->sizes[node->len - 1] += leaf->len;
+            }
+            return 1;
         }
-        uint32_t idx = (index >> node->shift) & GTKML_A_MASK;
-        gboolean shiftme = 0;
-        GtkMl_TaggedValue result = delete(&(*out)->value.a_branch.nodes[idx], &shiftme, node->value.a_branch.nodes[idx], index);
-        if (shiftme) {
-            --(*out)->value.a_branch.len;
-            size_t len = (*out)->value.a_branch.len;
-            for (size_t i = idx; i < len; i++) {
-                (*out)->value.a_branch.nodes[i] = node->value.a_branch.nodes[i + 1];
+    }
+
+    if ((*slot)->len == GTKML_A_SIZE) {
+        return 0;
+    }
+
+    own(slot);
+    GtkMl_ArrayNode *node = *slot;
+    node->value.nodes[node->len++] = new_path(level - GTKML_A_BITS, leaf);
+    if (node->sizes) {
+        node->sizes[node->len - 1] = node->sizes[node->len - 2] + leaf->len;
+    } else if (size_of(node->value.nodes[node->len - 2], level - GTKML_A_BITS) != (size_t) 1 << level) {
+        // the previous last child was not full
+        set_sizes(node, level);
+    }
+    return 1;
+}
+
+// appends `leaf` to the tree of `array`, growing it by a level if it is full
+void push_tree(GtkMl_Array *array, GtkMl_ArrayNode *leaf) {
+    leaf->sealed = 1;
+
+    if (!array->root) {
+        array->root = leaf;
+        array->shift = 0;
+        return;
+    }
+
+    if (array->shift && push_leaf(&array->root, array->shift, leaf)) {
+        return;
+    }
+
+    GtkMl_ArrayNode *root = new_branch();
+    root->value.nodes[0] = array->root;
+    root->value.nodes[1] = new_path(array->shift, leaf);
+    root->len = 2;
+    array->root = root;
+    array->shift += GTKML_A_BITS;
+    set_sizes(root, array->shift);
+}
+
+// removes the last leaf below the branch `*slot` and returns it
+GtkMl_ArrayNode *pop_leaf(GtkMl_ArrayNode **slot, uint32_t level) {
+    own(slot);
+    GtkMl_ArrayNode *node = *slot;
+
+    GtkMl_ArrayNode *leaf;
+    if (level > GTKML_A_BITS) {
+        GtkMl_ArrayNode **child = &node->value.nodes[node->len - 1];
+        leaf = pop_leaf(child, level - GTKML_A_BITS);
+        if ((*child)->len) {
+            if (node->sizes) {
+                node->sizes[node->len - 1] -= leaf->len;
             }
+            return leaf;
         }
+        del_node(NULL, *child, gtk_ml_delete_value);
+    } else {
+        leaf = node->value.nodes[node->len - 1];
+    }
+    --node->len;
+    return leaf;
+}
+
+// moves the last leaf of the tree into the tail
+void pop_tree(GtkMl_Array *array) {
+    if (!array->shift) {
+        array->tail = array->root;
+        array->root = NULL;
+    } else {
+        array->tail = pop_leaf(&array->root, array->shift);
+        normalize(array);
+    }
+    array->tail_len = array->tail->len;
+}
+
+// drops root branches with a single child
+void normalize(GtkMl_Array *array) {
+    while (array->shift && array->root->len == 1) {
+        GtkMl_ArrayNode *root = copy_node(array->root->value.nodes[0]);
+        del_node(NULL, array->root, gtk_ml_delete_value);
+        array->root = root;
+        array->shift -= GTKML_A_BITS;
+    }
+}
+
+GtkMl_TaggedValue transient_pop(GtkMl_Array *array) {
+    if (!array->len) {
+        return gtk_ml_value_none();
+    }
+
+    GtkMl_TaggedValue result = array->tail->value.values[array->tail_len - 1];
+    --array->tail_len;
+    --array->len;
+    array->hash = 0;
+
+    if (array->tail_len) {
+        // the popped slot stays filled, a later push will overwrite or skip it
         return result;
     }
+
+    del_node(NULL, array->tail, gtk_ml_delete_value);
+    array->tail = NULL;
+    if (array->root) {
+        pop_tree(array);
     }
+    return result;
 }
 
-GtkMl_VisitResult foreach(GtkMl_Array *array, GtkMl_ArrayNode *node, size_t index, GtkMl_ArrayFn fn, GtkMl_TaggedValue data) {
-    if (!node) {
-        return GTKML_VISIT_RECURSE;
+// joins two subtrees into a new branch one level above the higher of them
+// only the nodes along the seam are rebuilt, everything else is shared
+GtkMl_ArrayNode *concat_trees(GtkMl_ArrayNode *left, uint32_t lshift, GtkMl_ArrayNode *right, uint32_t rshift, gboolean top) {
+    if (lshift > rshift) {
+        GtkMl_ArrayNode *centre = concat_trees(left->value.nodes[left->len - 1], lshift - GTKML_A_BITS, right, rshift, 0);
+        return rebalance(left, centre, NULL, lshift);
+    } else if (lshift < rshift) {
+        GtkMl_ArrayNode *centre = concat_trees(left, lshift, right->value.nodes[0], rshift - GTKML_A_BITS, 0);
+        return rebalance(NULL, centre, right, rshift);
+    } else if (lshift) {
+        GtkMl_ArrayNode *centre = concat_trees(left->value.nodes[left->len - 1], lshift - GTKML_A_BITS, right->value.nodes[0], rshift - GTKML_A_BITS, 0);
+        return rebalance(left, centre, right, lshift);
+    }
+
+    GtkMl_ArrayNode *node = new_branch();
+    if (top && left->len + right->len <= GTKML_A_SIZE) {
+        GtkMl_ArrayNode *leaf = new_leaf();
+        memcpy(leaf->value.values, left->value.values, sizeof(GtkMl_TaggedValue) * left->len);
+        memcpy(leaf->value.values + left->len, right->value.values, sizeof(GtkMl_TaggedValue) * right->len);
+        leaf->len = left->len + right->len;
+        leaf->sealed = 1;
+        node->value.nodes[0] = leaf;
+        node->len = 1;
+    } else {
+        node->value.nodes[0] = copy_node(left);
+        node->value.nodes[1] = copy_node(right);
+        node->len = 2;
+    }
+    set_sizes(node, GTKML_A_BITS);
+    return node;
+}
+
+// merges the children of `left` and `right` with `centre` standing in for the two along the seam,
+// then redistributes them until at most `GTKML_A_EXTRAS` more than necessary are left
+GtkMl_ArrayNode *rebalance(GtkMl_ArrayNode *left, GtkMl_ArrayNode *centre, GtkMl_ArrayNode *right, uint32_t level) {
+    GtkMl_ArrayNode *all[3 * GTKML_A_SIZE];
+    uint32_t counts[3 * GTKML_A_SIZE];
+    uint32_t n = 0;
+
+    if (left) {
+        for (uint32_t i = 0; i + 1 < left->len; i++) {
+            all[n++] = copy_node(left->value.nodes[i]);
+        }
+    }
+    for (uint32_t i = 0; i < centre->len; i++) {
+        all[n++] = copy_node(centre->value.nodes[i]);
+    }
+    if (right) {
+        for (uint32_t i = 1; i < right->len; i++) {
+            all[n++] = copy_node(right->value.nodes[i]);
+        }
+    }
+    del_node(NULL, centre, gtk_ml_delete_value);
+
+    size_t total = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        counts[i] = all[i]->len;
+        total += counts[i];
+    }
+
+    // plan the new child counts, spreading each underfull child over the ones after it
+    uint32_t optimal = (total + GTKML_A_SIZE - 1) / GTKML_A_SIZE;
+    uint32_t shuffled = n;
+    uint32_t i = 0;
+    while (optimal + GTKML_A_EXTRAS < shuffled) {
+        while (counts[i] > GTKML_A_SIZE - 1) {
+            ++i;
+        }
+
+        uint32_t remaining = counts[i];
+        do {
+            uint32_t size = remaining + counts[i + 1] < GTKML_A_SIZE? remaining + counts[i + 1] : GTKML_A_SIZE;
+            remaining = remaining + counts[i + 1] - size;
+            counts[i] = size;
+            ++i;
+        } while (remaining);
+
+        for (uint32_t j = i; j + 1 < shuffled; j++) {
+            counts[j] = counts[j + 1];
+        }
+        --shuffled;
+        --i;
     }
 
-    switch (node->kind) {
-    case GTKML_A_LEAF:
-        return fn(array, index, node->value.a_leaf.value, data);
-    case GTKML_A_BRANCH: {
-        for (size_t i = 0; i < node->value.a_branch.len; i++) {
-            switch (foreach(array, node->value.a_branch.nodes[i], (index << node->shift) | i, fn, data)) {
-            case GTKML_VISIT_RECURSE:
-                continue;
-            case GTKML_VISIT_CONTINUE:
-                return GTKML_VISIT_RECURSE;
-            case GTKML_VISIT_BREAK:
-                return GTKML_VISIT_BREAK;
+    // carry out the plan, reusing children whose contents do not move
+    GtkMl_ArrayNode *merged[3 * GTKML_A_SIZE];
+    uint32_t idx = 0;
+    uint32_t offset = 0;
+    for (uint32_t j = 0; j < shuffled; j++) {
+        if (!offset && all[idx]->len == counts[j]) {
+            merged[j] = all[idx++];
+            continue;
+        }
+
+        GtkMl_ArrayNode *node = level == GTKML_A_BITS? new_leaf() : new_branch();
+        while (node->len < counts[j]) {
+            GtkMl_ArrayNode *from = all[idx];
+            uint32_t count = from->len - offset < counts[j] - node->len? from->len - offset : counts[j] - node->len;
+            if (level == GTKML_A_BITS) {
+                memcpy(node->value.values + node->len, from->value.values + offset, sizeof(GtkMl_TaggedValue) * count);
+            } else {
+                for (uint32_t k = 0; k < count; k++) {
+                    node->value.nodes[node->len + k] = copy_node(from->value.nodes[offset + k]);
+                }
+            }
+            node->len += count;
+            offset += count;
+            if (offset == from->len) {
+                del_node(NULL, from, gtk_ml_delete_value);
+                ++idx;
+                offset = 0;
             }
         }
-        return GTKML_VISIT_RECURSE;
+        if (level == GTKML_A_BITS) {
+            node->sealed = 1;
+        } else {
+            set_sizes(node, level - GTKML_A_BITS);
+        }
+        merged[j] = node;
     }
+
+    // at most 64 children are left, which fit in two branches
+    GtkMl_ArrayNode *result = new_branch();
+    for (uint32_t j = 0; j < shuffled; j += GTKML_A_SIZE) {
+        GtkMl_ArrayNode *node = new_branch();
+        for (uint32_t k = j; k < shuffled && k < j + GTKML_A_SIZE; k++) {
+            node->value.nodes[node->len++] = merged[k];
+        }
+        set_sizes(node, level);
+        result->value.nodes[result->len++] = node;
     }
+    set_sizes(result, level + GTKML_A_BITS);
+    return result;
 }
 
-GtkMl_VisitResult foreach_rev(GtkMl_Array *array, GtkMl_ArrayNode *node, size_t index, GtkMl_ArrayFn fn, GtkMl_TaggedValue data) {
-    if (!node) {
-        return GTKML_VISIT_RECURSE;
+// keeps the first `n` elements below the branch `*slot`, `n` being the end of one of its leaves
+void take_tree(GtkMl_ArrayNode **slot, uint32_t level, size_t n) {
+    own(slot);
+    GtkMl_ArrayNode *node = *slot;
+
+    size_t index = n - 1;
+    uint32_t idx = child_index(node, level, &index);
+    for (uint32_t i = idx + 1; i < node->len; i++) {
+        del_node(NULL, node->value.nodes[i], gtk_ml_delete_value);
+    }
+    node->len = idx + 1;
+
+    if (level > GTKML_A_BITS && index + 1 < size_of(node->value.nodes[idx], level - GTKML_A_BITS)) {
+        take_tree(&node->value.nodes[idx], level - GTKML_A_BITS, index + 1);
+    }
+    if (node->sizes) {
+        node->sizes[idx] = n;
+    }
+}
+
+// drops the first `n` elements below `*slot`, which holds more than `n`
+void drop_tree(GtkMl_ArrayNode **slot, uint32_t level, size_t n) {
+    if (!level) {
+        GtkMl_ArrayNode *leaf = *slot;
+        GtkMl_ArrayNode *rest = new_leaf();
+        memcpy(rest->value.values, leaf->value.values + n, sizeof(GtkMl_TaggedValue) * (leaf->len - n));
+        rest->len = leaf->len - n;
+        rest->sealed = 1;
+        del_node(NULL, leaf, gtk_ml_delete_value);
+        *slot = rest;
+        return;
     }
 
-    switch (node->kind) {
-    case GTKML_A_LEAF:
-        return fn(array, index, node->value.a_leaf.value, data);
-    case GTKML_A_BRANCH: {
-        for (size_t i = node->value.a_branch.len; i > 0; i--) {
-            switch (foreach_rev(array, node->value.a_branch.nodes[i - 1], (index << GTKML_A_BITS) | (i - 1), fn, data)) {
-            case GTKML_VISIT_RECURSE:
-                continue;
-            case GTKML_VISIT_CONTINUE:
-                return GTKML_VISIT_RECURSE;
-            case GTKML_VISIT_BREAK:
-                return GTKML_VISIT_BREAK;
+    own(slot);
+    GtkMl_ArrayNode *node = *slot;
+
+    size_t index = n;
+    uint32_t idx = child_index(node, level, &index);
+    for (uint32_t i = 0; i < idx; i++) {
+        del_node(NULL, node->value.nodes[i], gtk_ml_delete_value);
+    }
+    memmove(node->value.nodes, node->value.nodes + idx, sizeof(GtkMl_ArrayNode *) * (node->len - idx));
+    node->len -= idx;
+
+    if (index) {
+        drop_tree(&node->value.nodes[0], level - GTKML_A_BITS, index);
+    }
+    set_sizes(node, level);
+}
+
+// keeps the first `n` elements of `array`
+void take(GtkMl_Array *array, size_t n) {
+    size_t offset = array->len - array->tail_len;
+    if (n >= offset) {
+        array->tail_len = n - offset;
+        array->len = n;
+        if (!array->tail_len) {
+            del_node(NULL, array->tail, gtk_ml_delete_value);
+            array->tail = NULL;
+            if (array->root) {
+                pop_tree(array);
             }
         }
-        return GTKML_VISIT_RECURSE;
+        return;
+    }
+
+    del_node(NULL, array->tail, gtk_ml_delete_value);
+    array->tail = NULL;
+    array->tail_len = 0;
+    array->len = n;
+    if (!n) {
+        del_node(NULL, array->root, gtk_ml_delete_value);
+        array->root = NULL;
+        array->shift = 0;
+        return;
+    }
+
+    // the leaf holding the new last element becomes the tail
+    size_t index = n - 1;
+    array->tail = copy_node(find_leaf(array->root, array->shift, &index));
+    array->tail_len = index + 1;
+
+    size_t keep = n - array->tail_len;
+    if (keep) {
+        take_tree(&array->root, array->shift, keep);
+        normalize(array);
+    } else {
+        del_node(NULL, array->root, gtk_ml_delete_value);
+        array->root = NULL;
+        array->shift = 0;
+    }
+}
+
+// drops the first `n` elements of `array`
+void drop(GtkMl_Array *array, size_t n) {
+    if (!n) {
+        return;
     }
+
+    size_t offset = array->len - array->tail_len;
+    if (n < offset) {
+        drop_tree(&array->root, array->shift, n);
+        normalize(array);
+        array->len -= n;
+        return;
+    }
+
+    // only the tail is left, or part of it
+    del_node(NULL, array->root, gtk_ml_delete_value);
+    array->root = NULL;
+    array->shift = 0;
+
+    size_t skip = n - offset;
+    if (skip == array->tail_len) {
+        del_node(NULL, array->tail, gtk_ml_delete_value);
+        array->tail = NULL;
+    } else if (skip) {
+        GtkMl_ArrayNode *tail = new_leaf();
+        memcpy(tail->value.values, array->tail->value.values + skip, sizeof(GtkMl_TaggedValue) * (array->tail_len - skip));
+        tail->len = array->tail_len - skip;
+        del_node(NULL, array->tail, gtk_ml_delete_value);
+        array->tail = tail;
     }
+    array->tail_len -= skip;
+    array->len -= n;
 }
 
 GtkMl_VisitResult fn_contains(GtkMl_Array *array, size_t index, GtkMl_TaggedValue value, GtkMl_TaggedValue data) {
@@ -382,46 +932,32 @@ GtkMl_VisitResult fn_contains(GtkMl_Array *array, size_t index, GtkMl_TaggedValu
     }
 }
 
-gboolean equal(GtkMl_ArrayNode *lhs, GtkMl_ArrayNode *rhs) {
-    if (lhs == rhs) {
-        return 1;
-    }
-
-    if (lhs->kind != rhs->kind) {
-        return 0;
-    }
-
-    switch (lhs->kind) {
-    case GTKML_A_LEAF:
-        return gtk_ml_equal_value(lhs->value.a_leaf.value, rhs->value.a_leaf.value);
-    case GTKML_A_BRANCH:
-        if (lhs->value.a_branch.len != rhs->value.a_branch.len) {
-            return 0;
-        }
-        for (size_t i = 0; i < lhs->value.a_branch.len; i++) {
-            if (!equal(lhs->value.a_branch.nodes[i], rhs->value.a_branch.nodes[i])) {
-                return 0;
-            }
-        }
-        return 1;
-    }
-}
-
 #ifdef GTKML_ENABLE_POSIX
 /* debug stuff */
 
 GTKML_PRIVATE GtkMl_ArrayNode *copy_node_debug(GtkMl_Context *ctx, GtkMl_ArrayNode *node);
 // GTKML_PRIVATE void del_node_debug(GtkMl_Context *ctx, GtkMl_ArrayNode *node, void (*deleter)(GtkMl_Context *, GtkMl_TaggedValue));
-// GTKML_PRIVATE gboolean push_debug(GtkMl_Context *ctx, GtkMl_ArrayNode **out, GtkMl_ArrayNode *node, size_t *depth, GtkMl_TaggedValue value);
-GTKML_PRIVATE GtkMl_TaggedValue get_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_ArrayNode *node, size_t index);
-// GTKML_PRIVATE GtkMl_TaggedValue delete_debug(GtkMl_Context *ctx, GtkMl_ArrayNode **out, gboolean *shiftme, GtkMl_ArrayNode *node, size_t index);
-GTKML_PRIVATE GtkMl_VisitResult foreach_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, GtkMl_ArrayNode *node, size_t index, GtkMl_ArrayDebugFn fn, GtkMl_TaggedValue data);
+GTKML_PRIVATE GtkMl_ArrayNode *leaf_for_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, size_t *index, size_t *len);
 GTKML_PRIVATE gboolean equal_debug(GtkMl_Context *ctx, GtkMl_ArrayNode *lhs, GtkMl_ArrayNode *rhs);
 GTKML_PRIVATE GtkMl_VisitResult fn_contains_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, size_t index, GtkMl_TaggedValue value, GtkMl_TaggedValue data);
 
 void gtk_ml_array_trie_copy_debug(GtkMl_Context *ctx, GtkMl_Array *out, GtkMl_Array *array) {
+    if (array->string) {
+        fprintf(stderr, "warning: copying strings is currently unavailable in debug mode\n");
+        out->rope = NULL;
+        out->hash = 0;
+        out->len = 0;
+        out->string = 1;
+        return;
+    }
+
     out->root = copy_node_debug(ctx, array->root);
+    out->tail = copy_node_debug(ctx, array->tail);
+    out->shift = array->shift;
+    out->tail_len = array->tail_len;
+    out->hash = 0;
     out->len = array->len;
+    out->string = array->string;
 }
 
 gboolean gtk_ml_array_trie_is_string_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array) {
@@ -443,7 +979,7 @@ GTKML_PRIVATE GtkMl_VisitResult fn_concat_debug(GtkMl_Context *ctx, GtkMl_SObj *
 
     GtkMl_Array *dest = data.value.userdata;
 
-    GtkMl_Array new;
+    GtkMl_Array new = *dest;
     gtk_ml_array_trie_push_debug(ctx, &new, dest, value);
     *dest = new;
 
@@ -451,8 +987,7 @@ GTKML_PRIVATE GtkMl_VisitResult fn_concat_debug(GtkMl_Context *ctx, GtkMl_SObj *
 }
 
 gboolean gtk_ml_array_trie_concat_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *out, GtkMl_Array *lhs, GtkMl_Array *rhs) {
-    out->root = copy_node(lhs->root);
-    out->len = lhs->len;
+    gtk_ml_array_trie_copy(out, lhs);
 
     return gtk_ml_array_trie_foreach_debug(ctx, err, rhs, fn_concat_debug, gtk_ml_value_userdata(out));
 }
@@ -470,7 +1005,20 @@ GtkMl_TaggedValue gtk_ml_array_trie_pop_debug(GtkMl_Context *ctx, GtkMl_Array *o
 }
 
 GtkMl_TaggedValue gtk_ml_array_trie_get_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, size_t index) {
-    return get_debug(ctx, err, array->root, index);
+    if (array->string) {
+        return gtk_ml_string_get_debug(ctx, err, array, index);
+    }
+
+    if (index >= array->len) {
+        return gtk_ml_value_none();
+    }
+
+    size_t len;
+    GtkMl_ArrayNode *leaf = leaf_for_debug(ctx, err, array, &index, &len);
+    if (*err) {
+        return gtk_ml_value_none();
+    }
+    return gtk_ml_dbg_read_value(ctx, err, &leaf->value.values[index]);
 }
 
 struct ContainsDebugData {
@@ -481,7 +1029,7 @@ struct ContainsDebugData {
 
 gboolean gtk_ml_array_trie_contains_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, size_t *index, GtkMl_TaggedValue value) {
     struct ContainsDebugData contains = { value, 0, 0 };
-    foreach_debug(ctx, err, array, array->root, 0, fn_contains_debug, gtk_ml_value_userdata(&contains));
+    (void) gtk_ml_array_trie_foreach_debug(ctx, err, array, fn_contains_debug, gtk_ml_value_userdata(&contains));
     if (contains.contains) {
         *index = contains.index;
     }
@@ -498,8 +1046,28 @@ GtkMl_TaggedValue gtk_ml_array_trie_delete_debug(GtkMl_Context *ctx, GtkMl_Array
 }
 
 gboolean gtk_ml_array_trie_foreach_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, GtkMl_ArrayDebugFn fn, GtkMl_TaggedValue data) {
+    if (array->string) {
+        return gtk_ml_string_foreach_debug(ctx, err, array, fn, data);
+    }
+
     *err = NULL;
-    foreach_debug(ctx, err, array, array->root, 0, fn, data);
+    for (size_t i = 0; i < array->len;) {
+        size_t offset = i;
+        size_t len;
+        GtkMl_ArrayNode *leaf = leaf_for_debug(ctx, err, array, &offset, &len);
+        if (*err) {
+            return 0;
+        }
+        for (; offset < len; offset++, i++) {
+            GtkMl_TaggedValue value = gtk_ml_dbg_read_value(ctx, err, &leaf->value.values[offset]);
+            if (*err) {
+                return 0;
+            }
+            if (fn(ctx, err, array, i, value, data) == GTKML_VISIT_BREAK) {
+                return *err == NULL;
+            }
+        }
+    }
     return *err == NULL;
 }
 
@@ -508,20 +1076,21 @@ gboolean gtk_ml_array_trie_equal_debug(GtkMl_Context *ctx, GtkMl_Array *lhs, Gtk
         return 0;
     }
 
-    return equal_debug(ctx, lhs->root, rhs->root);
+    if (lhs->string || rhs->string) {
+        return lhs->string == rhs->string && equal_debug(ctx, (GtkMl_ArrayNode *) lhs->rope, (GtkMl_ArrayNode *) rhs->rope);
+    }
+
+    return equal_debug(ctx, lhs->root, rhs->root) && equal_debug(ctx, lhs->tail, rhs->tail);
 }
 
-// GtkMl_ArrayNode *new_leaf_debug(GtkMl_Context *ctx, GtkMl_TaggedValue value) {
+// GtkMl_ArrayNode *new_leaf_debug(GtkMl_Context *ctx) {
 //     (void) ctx;
-//     (void) value;
 //     fprintf(stderr, "warning: new_leaf is currently unavailable in debug mode\n");
 //     return NULL;
 // }
 // 
-// GtkMl_ArrayNode *new_branch_debug(GtkMl_Context *ctx, size_t shift, size_t len) {
+// GtkMl_ArrayNode *new_branch_debug(GtkMl_Context *ctx) {
 //     (void) ctx;
-//     (void) shift;
-//     (void) len;
 //     fprintf(stderr, "warning: new_branch is currently unavailable in debug mode\n");
 //     return NULL;
 // }
@@ -539,98 +1108,43 @@ GtkMl_ArrayNode *copy_node_debug(GtkMl_Context *ctx, GtkMl_ArrayNode *node) {
 //     (void) deleter;
 //     fprintf(stderr, "warning: del_node is currently unavailable in debug mode\n");
 // }
-// 
-// gboolean push_debug(GtkMl_Context *ctx, GtkMl_ArrayNode **out, GtkMl_ArrayNode *node, size_t *depth, GtkMl_TaggedValue value) {
-//     (void) ctx;
-//     (void) out;
-//     (void) node;
-//     (void) depth;
-//     (void) value;
-//     fprintf(stderr, "warning: push is currently unavailable in debug mode\n");
-//     return 0;
-// }
-
-GtkMl_TaggedValue get_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_ArrayNode *node, size_t index) {
-    if (!node) {
-        return gtk_ml_value_none();
-    }
-
-    GtkMl_ArrayNodeKind kind = (GtkMl_ArrayNodeKind) gtk_ml_dbg_read_u32(ctx, err, &node->kind);
-    if (*err) {
-        return gtk_ml_value_none();
-    }
-    switch (kind) {
-    case GTKML_A_LEAF:
-        return gtk_ml_dbg_read_value(ctx, err, &node->value.a_leaf.value);
-    case GTKML_A_BRANCH: {
-        size_t shift = gtk_ml_dbg_read_u64(ctx, err, &node->shift);
-        size_t idx = (index >> shift) & GTKML_A_MASK;
-        GtkMl_ArrayNode *next = gtk_ml_dbg_read_ptr(ctx, err, &node->value.a_branch.nodes[idx]);
-        if (*err) {
-            return gtk_ml_value_none();
-        }
-        return get_debug(ctx, err, next, index);
-    }
-    }
-}
-
-// GtkMl_TaggedValue delete_debug(GtkMl_Context *ctx, GtkMl_ArrayNode **out, gboolean *shiftme, GtkMl_ArrayNode *node, size_t index) {
-//     (void) ctx;
-//     (void) out;
-//     (void) shiftme;
-//     (void) node;
-//     (void) index;
-//     fprintf(stderr, "warning: delete is currently unavailable in debug mode\n");
-//     return NULL;
-// }
 
-GtkMl_VisitResult foreach_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, GtkMl_ArrayNode *node, size_t index, GtkMl_ArrayDebugFn fn, GtkMl_TaggedValue data) {
-    if (!node) {
-        return GTKML_VISIT_RECURSE;
+GtkMl_ArrayNode *leaf_for_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, size_t *index, size_t *len) {
+    size_t offset = array->len - array->tail_len;
+    if (*index >= offset) {
+        *index -= offset;
+        *len = array->tail_len;
+        return array->tail;
     }
 
-    GtkMl_ArrayNodeKind kind = (GtkMl_ArrayNodeKind) gtk_ml_dbg_read_u32(ctx, err, &node->kind);
-    if (*err) {
-        return GTKML_VISIT_BREAK;
-    }
-    switch (kind) {
-    case GTKML_A_LEAF: {
-        GtkMl_TaggedValue value = gtk_ml_dbg_read_value(ctx, err, &node->value.a_leaf.value);
-        if (*err) {
-            return GTKML_VISIT_BREAK;
-        }
-        return fn(ctx, err, array, index, value, data);
-    }
-    case GTKML_A_BRANCH: {
-        size_t len = gtk_ml_dbg_read_u64(ctx, err, &node->value.a_branch.len);
-        if (*err) {
-            return GTKML_VISIT_BREAK;
-        }
-        size_t shift = gtk_ml_dbg_read_u64(ctx, err, &node->shift);
+    GtkMl_ArrayNode *node = array->root;
+    for (uint32_t level = array->shift; level > 0; level -= GTKML_A_BITS) {
+        size_t idx = *index >> level;
+        size_t *sizes = gtk_ml_dbg_read_ptr(ctx, err, &node->sizes);
         if (*err) {
-            return GTKML_VISIT_BREAK;
+            return NULL;
         }
-        for (size_t i = 0; i < len; i++) {
-            GtkMl_ArrayNode **nodes = gtk_ml_dbg_read_ptr(ctx, err, &node->value.a_branch.nodes);
-            if (*err) {
-                return GTKML_VISIT_BREAK;
-            }
-            GtkMl_ArrayNode *next = gtk_ml_dbg_read_ptr(ctx, err, &nodes[i]);
-            if (*err) {
-                return GTKML_VISIT_BREAK;
+        if (sizes) {
+            size_t size;
+            while ((size = gtk_ml_dbg_read_u64(ctx, err, &sizes[idx])) <= *index) {
+                if (*err) {
+                    return NULL;
+                }
+                ++idx;
             }
-            switch (foreach_debug(ctx, err, array, next, (index << shift) | i, fn, data)) {
-            case GTKML_VISIT_RECURSE:
-                continue;
-            case GTKML_VISIT_CONTINUE:
-                return GTKML_VISIT_RECURSE;
-            case GTKML_VISIT_BREAK:
-                return GTKML_VISIT_BREAK;
+            if (idx) {
+                *index -= gtk_ml_dbg_read_u64(ctx, err, &sizes[idx - 1]);
             }
+        } else {
+            *index -= idx << level;
+        }
+        node = gtk_ml_dbg_read_ptr(ctx, err, &node->value.nodes[idx]);
+        if (*err) {
+            return NULL;
         }
-        return GTKML_VISIT_RECURSE;
-    }
     }
+    *len = gtk_ml_dbg_read_u32(ctx, err, &node->len);
+    return node;
 }
 
 GtkMl_VisitResult fn_contains_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, size_t index, GtkMl_TaggedValue value, GtkMl_TaggedValue data) {
@@ -21,6 +21,10 @@
         ++b->len_builder; \
     } while (0);
 
+GTKML_PRIVATE void reset_constants(GtkMl_Builder *b);
+GTKML_PRIVATE GtkMl_SObj export_name(GtkMl_SObj addr);
+GTKML_PRIVATE GtkMl_SObj all_exports(GtkMl_Context *ctx, GtkMl_Instruction *text, size_t n, GtkMl_TaggedValue *data, GtkMl_SObj *statics);
+
 GtkMl_Builder *gtk_ml_new_builder(GtkMl_Context *ctx) {
     GtkMl_Builder *b = malloc(sizeof(GtkMl_Builder));
 
@@ -32,11 +36,15 @@ GtkMl_Builder *gtk_ml_new_builder(GtkMl_Context *ctx) {
     b->data[0] = gtk_ml_value_none();
     b->len_data = 1;
     b->cap_data = 64;
+    gtk_ml_new_hash_table(&b->data_index, &GTKML_BITS_HASHER);
 
     b->statics = malloc(sizeof(GtkMl_SObj) * 64);
     b->statics[0] = NULL;
     b->len_static = 1;
     b->cap_static = 64;
+    gtk_ml_new_hash_table(&b->static_index, &GTKML_PTR_HASHER);
+
+    reset_constants(b);
 
     b->counter = gtk_ml_new_var(ctx, NULL, gtk_ml_new_int(ctx, NULL, 0));
     b->flags = GTKML_F_NONE;
@@ -77,6 +85,12 @@ GtkMl_Builder *gtk_ml_new_builder(GtkMl_Context *ctx) {
     gtk_ml_add_builder(b, "push", gtk_ml_builder_push, 0, 0, 0);
     gtk_ml_add_builder(b, "pop", gtk_ml_builder_pop, 0, 0, 0);
     gtk_ml_add_builder(b, "concat", gtk_ml_builder_concat, 0, 0, 0);
+    gtk_ml_add_builder(b, "slice", gtk_ml_builder_slice, 0, 0, 0);
+    gtk_ml_add_builder(b, "table", gtk_ml_builder_table, 0, 0, 0);
+    gtk_ml_add_builder(b, "table->map", gtk_ml_builder_table_to_map, 0, 0, 0);
+    gtk_ml_add_builder(b, "table-get", gtk_ml_builder_table_get, 0, 0, 0);
+    gtk_ml_add_builder(b, "table-insert", gtk_ml_builder_table_insert, 0, 0, 0);
+    gtk_ml_add_builder(b, "table-delete", gtk_ml_builder_table_delete, 0, 0, 0);
     gtk_ml_add_builder(b, "+", gtk_ml_builder_add, 0, 0, 0);
     gtk_ml_add_builder(b, "-", gtk_ml_builder_sub, 0, 0, 0);
     gtk_ml_add_builder(b, "*", gtk_ml_builder_mul, 0, 0, 0);
@@ -148,6 +162,7 @@ unsigned int gtk_ml_builder_clear_cond(GtkMl_Builder *b) {
 GtkMl_SObj gtk_ml_builder_get_and_inc(GtkMl_Context *ctx, GtkMl_Builder *b) {
     GtkMl_SObj value = b->counter->value.s_var.expr;
     b->counter->value.s_var.expr = gtk_ml_new_int(ctx, NULL, value->value.s_int.value + 1);
+    gtk_ml_write_barrier(b->counter);
     return value;
 }
 
@@ -843,6 +858,24 @@ gboolean gtk_ml_build_array_concat(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_B
     return 1;
 }
 
+gboolean gtk_ml_build_array_slice(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) {
+    (void) ctx;
+    (void) err;
+
+    if (basic_block->len_text == basic_block->cap_text) {
+        basic_block->cap_text *= 2;
+        basic_block->text = realloc(basic_block->text, sizeof(GtkMl_Instruction) * basic_block->cap_text);
+    }
+
+    basic_block->text[basic_block->len_text].cond = gtk_ml_builder_clear_cond(b);
+    basic_block->text[basic_block->len_text].category = GTKML_I_GENERIC;
+    basic_block->text[basic_block->len_text].opcode = GTKML_I_ARRAY_SLICE;
+    basic_block->text[basic_block->len_text].data = 0;
+    ++basic_block->len_text;
+
+    return 1;
+}
+
 gboolean gtk_ml_build_map_get(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) {
     (void) ctx;
     (void) err;
@@ -951,6 +984,96 @@ gboolean gtk_ml_build_set_delete(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_Bas
     return 1;
 }
 
+gboolean gtk_ml_build_map_to_table(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) {
+    (void) ctx;
+    (void) err;
+
+    if (basic_block->len_text == basic_block->cap_text) {
+        basic_block->cap_text *= 2;
+        basic_block->text = realloc(basic_block->text, sizeof(GtkMl_Instruction) * basic_block->cap_text);
+    }
+
+    basic_block->text[basic_block->len_text].cond = gtk_ml_builder_clear_cond(b);
+    basic_block->text[basic_block->len_text].category = GTKML_I_GENERIC;
+    basic_block->text[basic_block->len_text].opcode = GTKML_I_MAP_TO_TABLE;
+    basic_block->text[basic_block->len_text].data = 0;
+    ++basic_block->len_text;
+
+    return 1;
+}
+
+gboolean gtk_ml_build_table_to_map(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) {
+    (void) ctx;
+    (void) err;
+
+    if (basic_block->len_text == basic_block->cap_text) {
+        basic_block->cap_text *= 2;
+        basic_block->text = realloc(basic_block->text, sizeof(GtkMl_Instruction) * basic_block->cap_text);
+    }
+
+    basic_block->text[basic_block->len_text].cond = gtk_ml_builder_clear_cond(b);
+    basic_block->text[basic_block->len_text].category = GTKML_I_GENERIC;
+    basic_block->text[basic_block->len_text].opcode = GTKML_I_TABLE_TO_MAP;
+    basic_block->text[basic_block->len_text].data = 0;
+    ++basic_block->len_text;
+
+    return 1;
+}
+
+gboolean gtk_ml_build_table_get(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) {
+    (void) ctx;
+    (void) err;
+
+    if (basic_block->len_text == basic_block->cap_text) {
+        basic_block->cap_text *= 2;
+        basic_block->text = realloc(basic_block->text, sizeof(GtkMl_Instruction) * basic_block->cap_text);
+    }
+
+    basic_block->text[basic_block->len_text].cond = gtk_ml_builder_clear_cond(b);
+    basic_block->text[basic_block->len_text].category = GTKML_I_GENERIC;
+    basic_block->text[basic_block->len_text].opcode = GTKML_I_TABLE_GET;
+    basic_block->text[basic_block->len_text].data = 0;
+    ++basic_block->len_text;
+
+    return 1;
+}
+
+gboolean gtk_ml_build_table_insert(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) {
+    (void) ctx;
+    (void) err;
+
+    if (basic_block->len_text == basic_block->cap_text) {
+        basic_block->cap_text *= 2;
+        basic_block->text = realloc(basic_block->text, sizeof(GtkMl_Instruction) * basic_block->cap_text);
+    }
+
+    basic_block->text[basic_block->len_text].cond = gtk_ml_builder_clear_cond(b);
+    basic_block->text[basic_block->len_text].category = GTKML_I_GENERIC;
+    basic_block->text[basic_block->len_text].opcode = GTKML_I_TABLE_INSERT;
+    basic_block->text[basic_block->len_text].data = 0;
+    ++basic_block->len_text;
+
+    return 1;
+}
+
+gboolean gtk_ml_build_table_delete(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err) {
+    (void) ctx;
+    (void) err;
+
+    if (basic_block->len_text == basic_block->cap_text) {
+        basic_block->cap_text *= 2;
+        basic_block->text = realloc(basic_block->text, sizeof(GtkMl_Instruction) * basic_block->cap_text);
+    }
+
+    basic_block->text[basic_block->len_text].cond = gtk_ml_builder_clear_cond(b);
+    basic_block->text[basic_block->len_text].category = GTKML_I_GENERIC;
+    basic_block->text[basic_block->len_text].opcode = GTKML_I_TABLE_DELETE;
+    basic_block->text[basic_block->len_text].data = 0;
+    ++basic_block->len_text;
+
+    return 1;
+}
+
 gboolean gtk_ml_build_call_core(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err, GtkMl_Data data) {
     (void) ctx;
     (void) err;
@@ -1160,7 +1283,7 @@ gboolean gtk_ml_build_bitor(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlo
 
     basic_block->text[basic_block->len_text].cond = gtk_ml_builder_clear_cond(b);
     basic_block->text[basic_block->len_text].category = GTKML_I_GENERIC;
-    basic_block->text[basic_block->len_text].opcode = GTKML_I_BIT_AND;
+    basic_block->text[basic_block->len_text].opcode = GTKML_I_BIT_OR;
     basic_block->text[basic_block->len_text].data = 0;
     ++basic_block->len_text;
 
@@ -1185,6 +1308,24 @@ gboolean gtk_ml_build_bitxor(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBl
     return 1;
 }
 
+gboolean gtk_ml_build_binary_rr(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock *basic_block, GtkMl_SObj *err, GtkMl_Opcode opcode, GtkMl_Data registers) {
+    (void) ctx;
+    (void) err;
+
+    if (basic_block->len_text == basic_block->cap_text) {
+        basic_block->cap_text *= 2;
+        basic_block->text = realloc(basic_block->text, sizeof(GtkMl_Instruction) * basic_block->cap_text);
+    }
+
+    basic_block->text[basic_block->len_text].cond = gtk_ml_builder_clear_cond(b);
+    basic_block->text[basic_block->len_text].category = GTKML_I_GENERIC;
+    basic_block->text[basic_block->len_text].opcode = opcode;
+    basic_block->text[basic_block->len_text].data = registers;
+    ++basic_block->len_text;
+
+    return 1;
+}
+
 GtkMl_BasicBlock *gtk_ml_append_basic_block(GtkMl_Builder *b, const char *name) {
     if (b->len_bb == b->cap_bb) {
         b->cap_bb *= 2;
@@ -1204,10 +1345,9 @@ GtkMl_BasicBlock *gtk_ml_append_basic_block(GtkMl_Builder *b, const char *name)
 }
 
 GtkMl_Data gtk_ml_append_data(GtkMl_Builder *b, GtkMl_TaggedValue value) {
-    for (GtkMl_Data i = 0; i < b->len_data; i++) {
-        if (b->data[i].tag == value.tag && b->data[i].value.u64 == value.value.u64) {
-            return i;
-        }
+    GtkMl_TaggedValue found = gtk_ml_hash_table_get(&b->data_index, value);
+    if (gtk_ml_has_value(found)) {
+        return found.value.u64;
     }
 
     if (b->len_data == b->cap_data) {
@@ -1218,15 +1358,15 @@ GtkMl_Data gtk_ml_append_data(GtkMl_Builder *b, GtkMl_TaggedValue value) {
     GtkMl_Data handle = b->len_data;
     b->data[handle] = value;
     ++b->len_data;
+    gtk_ml_hash_table_insert(&b->data_index, value, gtk_ml_value_uint(handle));
 
     return handle;
 }
 
 GtkMl_Static gtk_ml_append_static(GtkMl_Builder *b, GtkMl_SObj value) {
-    for (GtkMl_Static i = 0; i < b->len_static; i++) {
-        if (b->statics[i] == value) {
-            return i;
-        }
+    GtkMl_TaggedValue found = gtk_ml_hash_table_get(&b->static_index, gtk_ml_value_sobject(value));
+    if (gtk_ml_has_value(found)) {
+        return found.value.u64;
     }
 
     if (b->len_static == b->cap_static) {
@@ -1237,17 +1377,49 @@ GtkMl_Static gtk_ml_append_static(GtkMl_Builder *b, GtkMl_SObj value) {
     GtkMl_Static handle = b->len_static;
     b->statics[handle] = value;
     ++b->len_static;
+    gtk_ml_hash_table_insert(&b->static_index, gtk_ml_value_sobject(value), gtk_ml_value_uint(handle));
 
     return handle;
 }
 
+// drops every data and static but the reserved first ones
+void reset_constants(GtkMl_Builder *b) {
+    gtk_ml_del_hash_table(NULL, &b->data_index, gtk_ml_delete_value);
+    gtk_ml_del_hash_table(NULL, &b->static_index, gtk_ml_delete_value);
+    b->len_data = 1;
+    b->len_static = 1;
+    gtk_ml_hash_table_insert(&b->data_index, b->data[0], gtk_ml_value_uint(0));
+    gtk_ml_hash_table_insert(&b->static_index, gtk_ml_value_sobject(b->statics[0]), gtk_ml_value_uint(0));
+}
+
+// the linkage name of an exported program or address
+GtkMl_SObj export_name(GtkMl_SObj addr) {
+    if (addr->kind == GTKML_S_PROGRAM) {
+        return addr->value.s_program.linkage_name;
+    } else {
+        return addr->value.s_address.linkage_name;
+    }
+}
+
+// an array of the linkage names of every export in text, only built to report a linkage error
+GtkMl_SObj all_exports(GtkMl_Context *ctx, GtkMl_Instruction *text, size_t n, GtkMl_TaggedValue *data, GtkMl_SObj *statics) {
+    GtkMl_SObj exports = gtk_ml_new_array(ctx, NULL);
+    for (size_t i = 0; i < n; i++) {
+        if (text[i].category & GTKML_I_EXPORT) {
+            gtk_ml_array_trie_transient_push(&exports->value.s_array.array, gtk_ml_value_sobject(export_name(statics[data[text[i].data].value.u64])));
+        }
+    }
+    return exports;
+}
+
 GTKML_PRIVATE GtkMl_Program *build(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Builder *b, GtkMl_Stage stage, gboolean complete) {
     if (ctx->gc->program_len == ctx->gc->program_cap) {
         ctx->gc->program_cap *= 2;
         ctx->gc->programs = realloc(ctx->gc->programs, sizeof(GtkMl_Program *) * ctx->gc->program_cap);
     }
-    ctx->gc->programs[ctx->gc->program_len] = malloc(sizeof(GtkMl_Program));
+    ctx->gc->programs[ctx->gc->program_len] = calloc(1, sizeof(GtkMl_Program));
     GtkMl_Program *out = ctx->gc->programs[ctx->gc->program_len++];
+    gtk_ml_new_hash_table(&out->exports, &GTKML_C_STR_HASHER);
 
     size_t n = 0;
     size_t n_static = b->len_static;
@@ -1282,6 +1454,10 @@ GTKML_PRIVATE GtkMl_Program *build(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Bu
         }
     }
 
+    // linkage name to the pc of its export, the first export of a name wins
+    GtkMl_HashTable exports;
+    gtk_ml_new_hash_table(&exports, &GTKML_DEFAULT_HASHER);
+
     for (size_t i = 0; i < n; i++) {
         GtkMl_Instruction instr = result[i];
         if (instr.category & GTKML_I_EXPORT) {
@@ -1291,11 +1467,16 @@ GTKML_PRIVATE GtkMl_Program *build(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Bu
             } else if (addr->kind == GTKML_S_ADDRESS) {
                 addr->value.s_address.addr = 8 * i;
             } else {
+                gtk_ml_del_hash_table(ctx, &exports, gtk_ml_delete_value);
                 *err = gtk_ml_error(ctx, "export-error", GTKML_ERR_EXPORT_ERROR, 0, 0, 0, 2,
                     gtk_ml_new_keyword(ctx, NULL, 0, "pc", strlen("pc")), gtk_ml_new_int(ctx, NULL, 8 * i),
                     gtk_ml_new_keyword(ctx, NULL, 0, "got", strlen("got")), addr);
                 return NULL;
             }
+            GtkMl_TaggedValue exp = gtk_ml_value_sobject(export_name(addr));
+            if (!gtk_ml_hash_table_contains(&exports, exp)) {
+                gtk_ml_hash_table_insert(&exports, exp, gtk_ml_value_uint(i));
+            }
         }
     }
 
@@ -1304,58 +1485,33 @@ GTKML_PRIVATE GtkMl_Program *build(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Bu
         if (instr.category & GTKML_I_EXTERN) {
             GtkMl_SObj ext = statics[data[instr.data].value.u64];
             if (ext->kind != GTKML_S_ARRAY || !gtk_ml_array_trie_is_string(&ext->value.s_array.array)) {
+                gtk_ml_del_hash_table(ctx, &exports, gtk_ml_delete_value);
                 *err = gtk_ml_error(ctx, "type-error", GTKML_ERR_TYPE_ERROR, 0, 0, 0, 2, gtk_ml_new_keyword(ctx, NULL, 0, "expected", strlen("expected")), gtk_ml_new_keyword(ctx, NULL, 0, "string", strlen("string")), gtk_ml_new_keyword(ctx, NULL, 0, "got", strlen("got")), ext);
                 return NULL;
             }
-            gboolean found = 0;
-            GtkMl_Array all_exports;
-            gtk_ml_new_array_trie(&all_exports);
-
-            for (size_t l = 0; l < n; l++) {
-                GtkMl_Instruction instr = result[l];
-                if (instr.category & GTKML_I_EXPORT) {
-                    GtkMl_SObj addr = statics[data[instr.data].value.u64];
-                    GtkMl_SObj exp;
-                    if (addr->kind == GTKML_S_PROGRAM) {
-                        exp = addr->value.s_program.linkage_name;
-                    } else if (addr->kind == GTKML_S_ADDRESS) {
-                        exp = addr->value.s_address.linkage_name;
-                    } else {
-                        *err = gtk_ml_error(ctx, "export-error", GTKML_ERR_EXPORT_ERROR, 0, 0, 0, 1, gtk_ml_new_keyword(ctx, NULL, 0, "got", strlen("got")), addr);
-                        return NULL;
-                    }
-                    GtkMl_Array new;
-                    gtk_ml_array_trie_push(&new, &all_exports, gtk_ml_value_sobject(exp));
-                    gtk_ml_del_array_trie(ctx, &all_exports, gtk_ml_delete_value);
-                    all_exports = new;
-                    if (gtk_ml_equal(ext, exp)) {
-                        result[i].category &= ~GTKML_I_EXTERN;
-                        if (result[i].category == GTKML_I_GENERIC) {
-                            result[i].data = result[l].data;
-                        } else {
-                            *err = gtk_ml_error(ctx, "category-error", GTKML_ERR_CATEGORY_ERROR, 0, 0, 0, 0);
-                            return NULL;
-                        }
-                        found = 1;
-                        break;
-                    }
-                }
+
+            GtkMl_TaggedValue found = gtk_ml_hash_table_get(&exports, gtk_ml_value_sobject(ext));
+            if (!gtk_ml_has_value(found)) {
+                gtk_ml_del_hash_table(ctx, &exports, gtk_ml_delete_value);
+                *err = gtk_ml_error(ctx, "linkage-error", GTKML_ERR_LINKAGE_ERROR, 0, 0, 0, 2,
+                    gtk_ml_new_keyword(ctx, NULL, 0, "linkage-name", strlen("linkage-name")), ext,
+                    gtk_ml_new_keyword(ctx, NULL, 0, "all-exports", strlen("all-exports")), all_exports(ctx, result, n, data, statics));
+                return NULL;
             }
 
-            if (found) {
-                gtk_ml_del_array_trie(ctx, &all_exports, gtk_ml_delete_value);
+            result[i].category &= ~GTKML_I_EXTERN;
+            if (result[i].category == GTKML_I_GENERIC) {
+                result[i].data = result[found.value.u64].data;
             } else {
-                GtkMl_SObj exports = gtk_ml_new_array(ctx, NULL);
-                exports->value.s_array.array = all_exports;
-                GtkMl_SObj error = gtk_ml_error(ctx, "linkage-error", GTKML_ERR_LINKAGE_ERROR, 0, 0, 0, 2,
-                    gtk_ml_new_keyword(ctx, NULL, 0, "linkage-name", strlen("linkage-name")), ext,
-                    gtk_ml_new_keyword(ctx, NULL, 0, "all-exports", strlen("all-exports")), exports);
-                *err = error;
+                gtk_ml_del_hash_table(ctx, &exports, gtk_ml_delete_value);
+                *err = gtk_ml_error(ctx, "category-error", GTKML_ERR_CATEGORY_ERROR, 0, 0, 0, 0);
                 return NULL;
             }
         }
     }
 
+    gtk_ml_del_hash_table(ctx, &exports, gtk_ml_delete_value);
+
     if (!complete) {
         char *start = malloc(strlen("_start") + 1);
         strcpy(start, "_start");
@@ -1375,8 +1531,7 @@ GTKML_PRIVATE GtkMl_Program *build(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Bu
             }
             memset(b->basic_blocks, 0, sizeof(GtkMl_BasicBlock *) * b->len_bb);
             b->len_bb = 0;
-            b->len_static = 1;
-            b->len_data = 1;
+            reset_constants(b);
 
             char *start = malloc(strlen("_start") + 1);
             strcpy(start, "_start");
@@ -1395,8 +1550,7 @@ GTKML_PRIVATE GtkMl_Program *build(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Bu
             }
             memset(b->basic_blocks, 0, sizeof(GtkMl_BasicBlock *) * b->len_bb);
             b->len_bb = 0;
-            b->len_static = 1;
-            b->len_data = 1;
+            reset_constants(b);
 
             char *start = malloc(strlen("_start") + 1);
             strcpy(start, "_start");
@@ -1423,6 +1577,8 @@ GTKML_PRIVATE GtkMl_Program *build(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Bu
             free(b->base);
             free(b->data);
             free(b->statics);
+            gtk_ml_del_hash_table(ctx, &b->data_index, gtk_ml_delete_value);
+            gtk_ml_del_hash_table(ctx, &b->static_index, gtk_ml_delete_value);
             free(b->basic_blocks);
             free(b);
             ctx->gc->builder = NULL;
@@ -1440,6 +1596,8 @@ GTKML_PRIVATE GtkMl_Program *build(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Bu
         }
     }
 
+    gtk_ml_index_exports(out);
+
     return out;
 }
 
@@ -32,6 +32,7 @@ GTKML_PRIVATE const char *TYPENAME[] = {
     [GTKML_S_MACRO] = "macro",
     [GTKML_S_LIGHTDATA] = "lightdata",
     [GTKML_S_USERDATA] = "userdata",
+    [GTKML_S_TABLE] = "table",
 };
 
 GTKML_PRIVATE const char *PRIMNAME[] = {
@@ -43,18 +44,7 @@ GTKML_PRIVATE const char *PRIMNAME[] = {
     [GTKML_TAG_USERDATA] = "lightdata",
 };
 
-GTKML_PRIVATE GtkMl_TaggedValue gtk_ml_get_data(GtkMl_Program *program, GtkMl_Data data) {
-    GtkMl_TaggedValue value = program->data[data];
-    if (!gtk_ml_has_value(value)) {
-        return gtk_ml_value_none();
-    } else if (gtk_ml_is_primitive(value)) {
-        return value;
-    } else {
-        return gtk_ml_value_sobject(program->statics[value.value.u64]);
-    }
-}
-
-#define ENTER(vm, gc) \
+#define ENTER(vm) \
     do { \
         if (vm->base_stack_ptr == vm->base_stack_cap) { \
             vm->base_stack_cap *= 2; \
@@ -62,28 +52,24 @@ GTKML_PRIVATE GtkMl_TaggedValue gtk_ml_get_data(GtkMl_Program *program, GtkMl_Da
         } \
         vm->base_stack[vm->base_stack_ptr++] = vm->local_base; \
         vm->local_base = vm->local_len; \
-        gc->base_stack[gc->base_stack_ptr++] = gc->local_base; \
-        gc->local_base = gc->local_len; \
     } while (0)
 
-#define LEAVE(vm, gc) \
+#define LEAVE(vm) \
     do { \
         vm->local_len = vm->local_base; \
         vm->local_base = vm->base_stack[--vm->base_stack_ptr]; \
-        gc->local_len = gc->local_base; \
-        gc->local_base = gc->base_stack[--gc->base_stack_ptr]; \
     } while (0)
 
 #define PC_INCREMENT vm->pc += 8
 
-gboolean gtk_ml_i_nop(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_nop(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     PC_INCREMENT;
     return 1;
 }
 
-gboolean gtk_ml_i_halt(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_halt(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     vm->flags |= GTKML_F_HALT;
@@ -124,11 +110,79 @@ GTKML_PRIVATE void set_flags(GtkMl_Vm *vm, GtkMl_TaggedValue result) {
     }
 }
 
+// operand reads of the quickened instructions
+// they accept exactly the values the generic instructions treat as ints or floats,
+// `boxed` is set when the generic instruction would have boxed its result
+GTKML_PRIVATE gboolean int_operand(GtkMl_TaggedValue tv, int64_t *value, gboolean *boxed) {
+    if (tv.tag == GTKML_TAG_INT64) {
+        *value = tv.value.s64;
+        return 1;
+    } else if (gtk_ml_is_sobject(tv) && tv.value.sobj->kind == GTKML_S_INT) {
+        *value = tv.value.sobj->value.s_int.value;
+        *boxed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+GTKML_PRIVATE gboolean float_operand(GtkMl_TaggedValue tv, double *value, gboolean *boxed) {
+    if (tv.tag == GTKML_TAG_FLOAT) {
+        *value = tv.value.flt;
+        return 1;
+    } else if (gtk_ml_is_sobject(tv) && tv.value.sobj->kind == GTKML_S_FLOAT) {
+        *value = tv.value.sobj->value.s_float.value;
+        *boxed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+// called by the generic instructions with the operands they are about to use
+GTKML_PRIVATE void quicken(GtkMl_Vm *vm, GtkMl_TaggedValue tv_lhs, GtkMl_TaggedValue tv_rhs) {
+    int64_t i;
+    double f;
+    gboolean boxed;
+    if (int_operand(tv_lhs, &i, &boxed) && int_operand(tv_rhs, &i, &boxed)) {
+        gtk_ml_vm_quicken(vm, GTKML_QUICKEN_INT);
+    } else if (float_operand(tv_lhs, &f, &boxed) && float_operand(tv_rhs, &f, &boxed)) {
+        gtk_ml_vm_quicken(vm, GTKML_QUICKEN_FLOAT);
+    }
+}
+
+// reads the register operands of a quickened register instruction
+// anything out of the frame is left to the generic instruction to report
+GTKML_PRIVATE gboolean peek_registers(GtkMl_Vm *vm, GtkMl_TaggedValue data, GtkMl_TaggedValue *rs, GtkMl_TaggedValue *ra) {
+    size_t lhs = vm->local_base + (data.value.u64 & 0xffffffff);
+    size_t rhs = vm->local_base + (data.value.u64 >> 32);
+    if (lhs >= vm->local_len || rhs >= vm->local_len) {
+        return 0;
+    }
+    *rs = vm->local[lhs];
+    *ra = vm->local[rhs];
+    return 1;
+}
+
+GTKML_PRIVATE void push_int(GtkMl_Vm *vm, gboolean boxed, int64_t value) {
+    if (boxed) {
+        gtk_ml_push(vm->ctx, gtk_ml_value_sobject(gtk_ml_new_int(vm->ctx, NULL, value)));
+    } else {
+        gtk_ml_vm_push(vm, gtk_ml_value_int(value));
+    }
+    vm->flags |= (value == 0)? GTKML_F_EQUAL : GTKML_F_NEQUAL;
+}
+
+GTKML_PRIVATE void push_float(GtkMl_Vm *vm, gboolean boxed, double value) {
+    if (boxed) {
+        gtk_ml_push(vm->ctx, gtk_ml_value_sobject(gtk_ml_new_float(vm->ctx, NULL, value)));
+    } else {
+        gtk_ml_vm_push(vm, gtk_ml_value_float(value));
+    }
+    // floats are stored with single precision either way
+    vm->flags |= ((float) value == 0.0)? GTKML_F_EQUAL : GTKML_F_NEQUAL;
+}
+
 #define gtk_ml_i_signed_binary(name, operator) \
-    gboolean gtk_ml_i_signed_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) { \
-        (void) data; \
-        GtkMl_TaggedValue tv_lhs = gtk_ml_pop(vm->ctx); \
-        GtkMl_TaggedValue tv_rhs = gtk_ml_pop(vm->ctx); \
+    GTKML_PRIVATE gboolean signed_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue tv_lhs, GtkMl_TaggedValue tv_rhs) { \
         double flhs; \
         double frhs; \
         int64_t ilhs; \
@@ -209,13 +263,17 @@ GTKML_PRIVATE void set_flags(GtkMl_Vm *vm, GtkMl_TaggedValue result) {
         set_flags(vm, gtk_ml_peek(vm->ctx)); \
         PC_INCREMENT; \
         return 1; \
-    }
-
-#define gtk_ml_i_unsigned_binary(name, operator) \
-    gboolean gtk_ml_i_unsigned_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) { \
+    } \
+    gboolean gtk_ml_i_signed_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) { \
         (void) data; \
         GtkMl_TaggedValue tv_lhs = gtk_ml_pop(vm->ctx); \
         GtkMl_TaggedValue tv_rhs = gtk_ml_pop(vm->ctx); \
+        quicken(vm, tv_lhs, tv_rhs); \
+        return signed_##name(vm, err, tv_lhs, tv_rhs); \
+    }
+
+#define gtk_ml_i_unsigned_binary(name, operator) \
+    GTKML_PRIVATE gboolean unsigned_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue tv_lhs, GtkMl_TaggedValue tv_rhs) { \
         double flhs; \
         double frhs; \
         uint64_t ilhs; \
@@ -296,13 +354,16 @@ GTKML_PRIVATE void set_flags(GtkMl_Vm *vm, GtkMl_TaggedValue result) {
         set_flags(vm, gtk_ml_peek(vm->ctx)); \
         PC_INCREMENT; \
         return 1; \
-    }
-
-#define gtk_ml_i_signed_binaryf(name, operator, fn) \
-    gboolean gtk_ml_i_signed_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) { \
+    } \
+    gboolean gtk_ml_i_unsigned_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) { \
         (void) data; \
         GtkMl_TaggedValue tv_lhs = gtk_ml_pop(vm->ctx); \
         GtkMl_TaggedValue tv_rhs = gtk_ml_pop(vm->ctx); \
+        return unsigned_##name(vm, err, tv_lhs, tv_rhs); \
+    }
+
+#define gtk_ml_i_signed_binaryf(name, operator, fn) \
+    GTKML_PRIVATE gboolean signed_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue tv_lhs, GtkMl_TaggedValue tv_rhs) { \
         double flhs; \
         double frhs; \
         int64_t ilhs; \
@@ -383,13 +444,16 @@ GTKML_PRIVATE void set_flags(GtkMl_Vm *vm, GtkMl_TaggedValue result) {
         set_flags(vm, gtk_ml_peek(vm->ctx)); \
         PC_INCREMENT; \
         return 1; \
-    }
-
-#define gtk_ml_i_unsigned_binaryf(name, operator, fn) \
-    gboolean gtk_ml_i_unsigned_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) { \
+    } \
+    gboolean gtk_ml_i_signed_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) { \
         (void) data; \
         GtkMl_TaggedValue tv_lhs = gtk_ml_pop(vm->ctx); \
         GtkMl_TaggedValue tv_rhs = gtk_ml_pop(vm->ctx); \
+        return signed_##name(vm, err, tv_lhs, tv_rhs); \
+    }
+
+#define gtk_ml_i_unsigned_binaryf(name, operator, fn) \
+    GTKML_PRIVATE gboolean unsigned_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue tv_lhs, GtkMl_TaggedValue tv_rhs) { \
         double flhs; \
         double frhs; \
         uint64_t ilhs; \
@@ -470,13 +534,16 @@ GTKML_PRIVATE void set_flags(GtkMl_Vm *vm, GtkMl_TaggedValue result) {
         set_flags(vm, gtk_ml_peek(vm->ctx)); \
         PC_INCREMENT; \
         return 1; \
-    }
-
-#define gtk_ml_i_bitwise(name, operation) \
-    gboolean gtk_ml_i_bit_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) { \
+    } \
+    gboolean gtk_ml_i_unsigned_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) { \
         (void) data; \
         GtkMl_TaggedValue tv_lhs = gtk_ml_pop(vm->ctx); \
         GtkMl_TaggedValue tv_rhs = gtk_ml_pop(vm->ctx); \
+        return unsigned_##name(vm, err, tv_lhs, tv_rhs); \
+    }
+
+#define gtk_ml_i_bitwise(name, operation) \
+    GTKML_PRIVATE gboolean bit_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue tv_lhs, GtkMl_TaggedValue tv_rhs) { \
         uint64_t ilhs; \
         uint64_t irhs; \
         gboolean sobj = gtk_ml_is_sobject(tv_lhs) || gtk_ml_is_sobject(tv_rhs); \
@@ -514,6 +581,12 @@ GTKML_PRIVATE void set_flags(GtkMl_Vm *vm, GtkMl_TaggedValue result) {
         set_flags(vm, gtk_ml_peek(vm->ctx)); \
         PC_INCREMENT; \
         return 1; \
+    } \
+    gboolean gtk_ml_i_bit_##name(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) { \
+        (void) data; \
+        GtkMl_TaggedValue tv_lhs = gtk_ml_pop(vm->ctx); \
+        GtkMl_TaggedValue tv_rhs = gtk_ml_pop(vm->ctx); \
+        return bit_##name(vm, err, tv_lhs, tv_rhs); \
     }
 
 gtk_ml_i_signed_binary(add, +)
@@ -531,11 +604,119 @@ gtk_ml_i_bitwise(nand, ~(ilhs & irhs))
 gtk_ml_i_bitwise(nor, ~(ilhs | irhs))
 gtk_ml_i_bitwise(xnor, ~(ilhs ^ irhs))
 
-gboolean gtk_ml_i_cmp_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
-    GtkMl_Cmp cmp = gtk_ml_get_data(vm->program, data).value.u64;
+// reads the two register operands of a register form instruction
+// registers are slots of the current local frame, packed as Rs | Ra << 32
+GTKML_PRIVATE gboolean get_registers(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data, GtkMl_TaggedValue *rs, GtkMl_TaggedValue *ra) {
+    GtkMl_TaggedValue lhs = gtk_ml_get_local(vm->ctx, data.value.u64 & 0xffffffff);
+    GtkMl_TaggedValue rhs = gtk_ml_get_local(vm->ctx, data.value.u64 >> 32);
+    if (!gtk_ml_has_value(lhs) || !gtk_ml_has_value(rhs)) {
+        *err = gtk_ml_error(vm->ctx, "binding-error", GTKML_ERR_BINDING_ERROR, 0, 0, 0, 0);
+        return 0;
+    }
+    *rs = lhs;
+    *ra = rhs;
+    return 1;
+}
+
+#define gtk_ml_i_register_binary(name) \
+    gboolean gtk_ml_i_##name##_rr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) { \
+        GtkMl_TaggedValue tv_lhs; \
+        GtkMl_TaggedValue tv_rhs; \
+        if (!get_registers(vm, err, data, &tv_lhs, &tv_rhs)) { \
+            return 0; \
+        } \
+        quicken(vm, tv_lhs, tv_rhs); \
+        return name(vm, err, tv_lhs, tv_rhs); \
+    }
+
+gtk_ml_i_register_binary(signed_add)
+gtk_ml_i_register_binary(signed_subtract)
+gtk_ml_i_register_binary(signed_multiply)
+gtk_ml_i_register_binary(signed_divide)
+gtk_ml_i_register_binary(signed_modulo)
+gtk_ml_i_register_binary(bit_and)
+gtk_ml_i_register_binary(bit_or)
+gtk_ml_i_register_binary(bit_xor)
+gtk_ml_i_register_binary(bit_nand)
+gtk_ml_i_register_binary(bit_nor)
+gtk_ml_i_register_binary(bit_xnor)
+
+// the int/int and float/float forms the generic instructions quicken into
+// a mismatching operand deoptimizes the instruction back to its generic form
+#define gtk_ml_i_quickened_binary(name, operator) \
+    gboolean gtk_ml_i_signed_##name##_int(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) { \
+        int64_t ilhs; \
+        int64_t irhs; \
+        gboolean boxed = 0; \
+        if (vm->stack_len < 2) { \
+            return gtk_ml_vm_deoptimize(vm, err, data); \
+        } \
+        GtkMl_TaggedValue tv_lhs = vm->stack[vm->stack_len - 1]; \
+        GtkMl_TaggedValue tv_rhs = vm->stack[vm->stack_len - 2]; \
+        if (!int_operand(tv_lhs, &ilhs, &boxed) || !int_operand(tv_rhs, &irhs, &boxed)) { \
+            return gtk_ml_vm_deoptimize(vm, err, data); \
+        } \
+        vm->stack_len -= 2; \
+        push_int(vm, boxed, ilhs operator irhs); \
+        PC_INCREMENT; \
+        return 1; \
+    } \
+    gboolean gtk_ml_i_signed_##name##_float(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) { \
+        double flhs; \
+        double frhs; \
+        gboolean boxed = 0; \
+        if (vm->stack_len < 2) { \
+            return gtk_ml_vm_deoptimize(vm, err, data); \
+        } \
+        GtkMl_TaggedValue tv_lhs = vm->stack[vm->stack_len - 1]; \
+        GtkMl_TaggedValue tv_rhs = vm->stack[vm->stack_len - 2]; \
+        if (!float_operand(tv_lhs, &flhs, &boxed) || !float_operand(tv_rhs, &frhs, &boxed)) { \
+            return gtk_ml_vm_deoptimize(vm, err, data); \
+        } \
+        vm->stack_len -= 2; \
+        push_float(vm, boxed, flhs operator frhs); \
+        PC_INCREMENT; \
+        return 1; \
+    } \
+    gboolean gtk_ml_i_signed_##name##_rr_int(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) { \
+        GtkMl_TaggedValue tv_lhs; \
+        GtkMl_TaggedValue tv_rhs; \
+        int64_t ilhs; \
+        int64_t irhs; \
+        gboolean boxed = 0; \
+        if (!peek_registers(vm, data, &tv_lhs, &tv_rhs) \
+                || !int_operand(tv_lhs, &ilhs, &boxed) || !int_operand(tv_rhs, &irhs, &boxed)) { \
+            return gtk_ml_vm_deoptimize(vm, err, data); \
+        } \
+        push_int(vm, boxed, ilhs operator irhs); \
+        PC_INCREMENT; \
+        return 1; \
+    } \
+    gboolean gtk_ml_i_signed_##name##_rr_float(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) { \
+        GtkMl_TaggedValue tv_lhs; \
+        GtkMl_TaggedValue tv_rhs; \
+        double flhs; \
+        double frhs; \
+        gboolean boxed = 0; \
+        if (!peek_registers(vm, data, &tv_lhs, &tv_rhs) \
+                || !float_operand(tv_lhs, &flhs, &boxed) || !float_operand(tv_rhs, &frhs, &boxed)) { \
+            return gtk_ml_vm_deoptimize(vm, err, data); \
+        } \
+        push_float(vm, boxed, flhs operator frhs); \
+        PC_INCREMENT; \
+        return 1; \
+    }
+
+gtk_ml_i_quickened_binary(add, +)
+gtk_ml_i_quickened_binary(subtract, -)
+gtk_ml_i_quickened_binary(multiply, *)
+
+gboolean gtk_ml_i_cmp_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
+    GtkMl_Cmp cmp = data.value.u64;
 
     GtkMl_TaggedValue tv_lhs = gtk_ml_pop(vm->ctx);
     GtkMl_TaggedValue tv_rhs = gtk_ml_pop(vm->ctx);
+    quicken(vm, tv_lhs, tv_rhs);
 
     double flhs;
     double frhs;
@@ -646,7 +827,96 @@ gboolean gtk_ml_i_cmp_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_car(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_cmp_imm_int(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
+    int64_t ilhs;
+    int64_t irhs;
+    gboolean boxed = 0;
+    if (vm->stack_len < 2) {
+        return gtk_ml_vm_deoptimize(vm, err, data);
+    }
+    GtkMl_TaggedValue tv_lhs = vm->stack[vm->stack_len - 1];
+    GtkMl_TaggedValue tv_rhs = vm->stack[vm->stack_len - 2];
+    if (!int_operand(tv_lhs, &ilhs, &boxed) || !int_operand(tv_rhs, &irhs, &boxed)) {
+        return gtk_ml_vm_deoptimize(vm, err, data);
+    }
+
+    gboolean result;
+    switch ((GtkMl_Cmp) data.value.u64) {
+    case GTKML_CMP_EQUAL:
+        result = ilhs == irhs;
+        break;
+    case GTKML_CMP_NOT_EQUAL:
+        result = ilhs != irhs;
+        break;
+    case GTKML_CMP_LESS:
+        result = ilhs < irhs;
+        break;
+    case GTKML_CMP_GREATER:
+        result = ilhs > irhs;
+        break;
+    case GTKML_CMP_LESS_EQUAL:
+        result = ilhs <= irhs;
+        break;
+    case GTKML_CMP_GREATER_EQUAL:
+        result = ilhs >= irhs;
+        break;
+    default:
+        return gtk_ml_vm_deoptimize(vm, err, data);
+    }
+
+    vm->stack_len -= 2;
+    gtk_ml_vm_push(vm, result? gtk_ml_value_true() : gtk_ml_value_false());
+
+    PC_INCREMENT;
+    return 1;
+}
+
+gboolean gtk_ml_i_cmp_imm_float(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
+    double flhs;
+    double frhs;
+    gboolean boxed = 0;
+    if (vm->stack_len < 2) {
+        return gtk_ml_vm_deoptimize(vm, err, data);
+    }
+    GtkMl_TaggedValue tv_lhs = vm->stack[vm->stack_len - 1];
+    GtkMl_TaggedValue tv_rhs = vm->stack[vm->stack_len - 2];
+    if (!float_operand(tv_lhs, &flhs, &boxed) || !float_operand(tv_rhs, &frhs, &boxed)) {
+        return gtk_ml_vm_deoptimize(vm, err, data);
+    }
+
+    gboolean result;
+    switch ((GtkMl_Cmp) data.value.u64) {
+    // equality of floats is whatever `gtk_ml_equal_value` says it is
+    case GTKML_CMP_EQUAL:
+        result = gtk_ml_equal_value(tv_lhs, tv_rhs);
+        break;
+    case GTKML_CMP_NOT_EQUAL:
+        result = !gtk_ml_equal_value(tv_lhs, tv_rhs);
+        break;
+    case GTKML_CMP_LESS:
+        result = flhs < frhs;
+        break;
+    case GTKML_CMP_GREATER:
+        result = flhs > frhs;
+        break;
+    case GTKML_CMP_LESS_EQUAL:
+        result = flhs <= frhs;
+        break;
+    case GTKML_CMP_GREATER_EQUAL:
+        result = flhs >= frhs;
+        break;
+    default:
+        return gtk_ml_vm_deoptimize(vm, err, data);
+    }
+
+    vm->stack_len -= 2;
+    gtk_ml_vm_push(vm, result? gtk_ml_value_true() : gtk_ml_value_false());
+
+    PC_INCREMENT;
+    return 1;
+}
+
+gboolean gtk_ml_i_car(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     GtkMl_SObj list = gtk_ml_pop(vm->ctx).value.sobj;
@@ -662,7 +932,7 @@ gboolean gtk_ml_i_car(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_cdr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_cdr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     GtkMl_SObj list = gtk_ml_pop(vm->ctx).value.sobj;
@@ -678,7 +948,7 @@ gboolean gtk_ml_i_cdr(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_bind(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_bind(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     gtk_ml_set_local(vm->ctx, gtk_ml_pop(vm->ctx));
@@ -686,23 +956,16 @@ gboolean gtk_ml_i_bind(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_enter_bind_args(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_enter_bind_args(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
-    ENTER(vm, vm->ctx->gc);
+    ENTER(vm);
 
     GtkMl_SObj params = gtk_ml_pop(vm->ctx).value.sobj;
-    GtkMl_SObj _params = params;
-    size_t n_params = 0;
+    size_t n_params = gtk_ml_list_len(params);
     size_t n_args = gtk_ml_pop(vm->ctx).value.u64;
 
-    while (params->kind != GTKML_S_NIL) {
-        ++n_params;
-        params = gtk_ml_cdr(params);
-    }
-
-    params = _params;
     while (params->kind != GTKML_S_NIL) {
         GtkMl_SObj key = gtk_ml_car(params);
         if (key->kind == GTKML_S_VARARG) {
@@ -718,21 +981,21 @@ gboolean gtk_ml_i_enter_bind_args(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data
         params = gtk_ml_cdr(params);
     }
 
-    ENTER(vm, vm->ctx->gc);
+    ENTER(vm);
 
     PC_INCREMENT;
     return 1;
 }
 
-gboolean gtk_ml_i_enter(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_enter(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
-    ENTER(vm, vm->ctx->gc);
+    ENTER(vm);
     PC_INCREMENT;
     return 1;
 }
 
-gboolean gtk_ml_i_leave(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_leave(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -741,18 +1004,17 @@ gboolean gtk_ml_i_leave(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
         return 0;
     }
 
-    LEAVE(vm, vm->ctx->gc);
+    LEAVE(vm);
     PC_INCREMENT;
     return 1;
 }
 
-gboolean gtk_ml_i_unwrap(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_unwrap(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     GtkMl_SObj list = gtk_ml_pop(vm->ctx).value.sobj;
-    size_t n = 0;
+    size_t n = gtk_ml_list_len(list);
     while (list->kind != GTKML_S_NIL) {
-        ++n;
         gtk_ml_push(vm->ctx, gtk_ml_value_sobject(gtk_ml_car(list)));
         list = gtk_ml_cdr(list);
     }
@@ -761,7 +1023,7 @@ gboolean gtk_ml_i_unwrap(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_typeof(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_typeof(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     GtkMl_TaggedValue value = gtk_ml_pop(vm->ctx);
@@ -842,7 +1104,7 @@ GtkMl_TaggedValue gtk_ml_to_prim(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Tagg
     }
 }
 
-gboolean gtk_ml_i_to_sobj(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_to_sobj(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     GtkMl_TaggedValue value = gtk_ml_pop(vm->ctx);
@@ -856,7 +1118,7 @@ gboolean gtk_ml_i_to_sobj(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_to_prim(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_to_prim(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     GtkMl_TaggedValue value = gtk_ml_pop(vm->ctx);
@@ -871,7 +1133,7 @@ gboolean gtk_ml_i_to_prim(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_define(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_define(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     GtkMl_SObj key = gtk_ml_to_sobj(vm->ctx, err, gtk_ml_pop(vm->ctx)).value.sobj;
@@ -881,7 +1143,7 @@ gboolean gtk_ml_i_define(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_list(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_list(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -900,18 +1162,18 @@ gboolean gtk_ml_i_list(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_push_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_push_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
-    gtk_ml_push(vm->ctx, gtk_ml_get_data(vm->program, data));
+    gtk_ml_push(vm->ctx, data);
     PC_INCREMENT;
     return 1;
 }
 
-gboolean gtk_ml_i_setf_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_setf_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
-    GtkMl_TaggedValue value = gtk_ml_get_data(vm->program, data);
+    GtkMl_TaggedValue value = data;
     if (gtk_ml_is_primitive(value)) {
         switch (value.tag) {
         case GTKML_TAG_BOOL:
@@ -949,7 +1211,7 @@ gboolean gtk_ml_i_setf_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_popf(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_popf(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     GtkMl_TaggedValue value = gtk_ml_pop(vm->ctx);
@@ -990,7 +1252,7 @@ gboolean gtk_ml_i_popf(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_pop(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_pop(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     gtk_ml_pop(vm->ctx);
@@ -998,10 +1260,10 @@ gboolean gtk_ml_i_pop(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_get_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_get_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
-    GtkMl_SObj key = gtk_ml_to_sobj(vm->ctx, err, gtk_ml_get_data(vm->program, data)).value.sobj;
+    GtkMl_SObj key = gtk_ml_to_sobj(vm->ctx, err, data).value.sobj;
     GtkMl_TaggedValue value = gtk_ml_get(vm->ctx, key);
     if (gtk_ml_has_value(value)) {
         gtk_ml_push(vm->ctx, value);
@@ -1014,10 +1276,10 @@ gboolean gtk_ml_i_get_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_local_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_local_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
-    size_t offset = gtk_ml_get_data(vm->program, data).value.u64;
+    size_t offset = data.value.u64;
     GtkMl_TaggedValue value = gtk_ml_get_local(vm->ctx, offset);
     if (gtk_ml_has_value(value)) {
         gtk_ml_push(vm->ctx, value);
@@ -1030,10 +1292,10 @@ gboolean gtk_ml_i_local_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_list_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_list_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
 
-    uint64_t n = gtk_ml_get_data(vm->program, data).value.u64;
+    uint64_t n = data.value.u64;
 
     GtkMl_SObj list = gtk_ml_new_nil(vm->ctx, NULL);
 
@@ -1048,19 +1310,17 @@ gboolean gtk_ml_i_list_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_map_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_map_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
 
-    uint64_t n = gtk_ml_get_data(vm->program, data).value.u64;
+    uint64_t n = data.value.u64;
 
     GtkMl_SObj map = gtk_ml_new_map(vm->ctx, NULL, NULL);
 
     while (n--) {
         GtkMl_TaggedValue value = gtk_ml_to_sobj(vm->ctx, err, gtk_ml_pop(vm->ctx));
         GtkMl_TaggedValue key = gtk_ml_to_sobj(vm->ctx, err, gtk_ml_pop(vm->ctx));
-        GtkMl_SObj new = gtk_ml_new_map(vm->ctx, NULL, NULL);
-        gtk_ml_hash_trie_insert(&new->value.s_map.map, &map->value.s_map.map, key, value);
-        map = new;
+        gtk_ml_hash_trie_transient_insert(&map->value.s_map.map, key, value);
     }
 
     gtk_ml_push(vm->ctx, gtk_ml_value_sobject(map));
@@ -1069,18 +1329,16 @@ gboolean gtk_ml_i_map_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_set_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_set_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
 
-    uint64_t n = gtk_ml_get_data(vm->program, data).value.u64;
+    uint64_t n = data.value.u64;
 
     GtkMl_SObj set = gtk_ml_new_set(vm->ctx, NULL);
 
     while (n--) {
         GtkMl_TaggedValue key = gtk_ml_to_sobj(vm->ctx, err, gtk_ml_pop(vm->ctx));
-        GtkMl_SObj new = gtk_ml_new_set(vm->ctx, NULL);
-        gtk_ml_hash_set_insert(&new->value.s_set.set, &set->value.s_set.set, key);
-        set = new;
+        gtk_ml_hash_set_transient_insert(&set->value.s_set.set, key);
     }
 
     gtk_ml_push(vm->ctx, gtk_ml_value_sobject(set));
@@ -1089,18 +1347,16 @@ gboolean gtk_ml_i_set_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_array_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_array_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
 
-    uint64_t n = gtk_ml_get_data(vm->program, data).value.u64;
+    uint64_t n = data.value.u64;
 
     GtkMl_SObj array = gtk_ml_new_array(vm->ctx, NULL);
 
     while (n--) {
         GtkMl_TaggedValue value = gtk_ml_to_sobj(vm->ctx, err, gtk_ml_pop(vm->ctx));
-        GtkMl_SObj new = gtk_ml_new_array(vm->ctx, NULL);
-        gtk_ml_array_trie_push(&new->value.s_array.array, &array->value.s_array.array, value);
-        array = new;
+        gtk_ml_array_trie_transient_push(&array->value.s_array.array, value);
     }
 
     gtk_ml_push(vm->ctx, gtk_ml_value_sobject(array));
@@ -1109,7 +1365,7 @@ gboolean gtk_ml_i_array_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_setmm_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_setmm_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1126,7 +1382,7 @@ gboolean gtk_ml_i_setmm_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_getmm_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_getmm_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1143,7 +1399,7 @@ gboolean gtk_ml_i_getmm_imm(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_var(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_var(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1155,7 +1411,7 @@ gboolean gtk_ml_i_var(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_getvar(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_getvar(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1181,7 +1437,7 @@ gboolean gtk_ml_i_getvar(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_assignvar(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_assignvar(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1203,18 +1459,23 @@ gboolean gtk_ml_i_assignvar(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
         return 0;
     }
     var->value.s_var.expr = newvalue;
+    gtk_ml_write_barrier(var);
     gtk_ml_push(vm->ctx, gtk_ml_value_sobject(var));
 
     PC_INCREMENT;
     return 1;
 }
 
-gboolean gtk_ml_i_len(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_len(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
     GtkMl_SObj container = gtk_ml_pop(vm->ctx).value.sobj;
     switch (container->kind) {
+    case GTKML_S_NIL:
+    case GTKML_S_LIST:
+        gtk_ml_push(vm->ctx, gtk_ml_value_int(gtk_ml_list_len(container)));
+        break;
     case GTKML_S_ARRAY:
         gtk_ml_push(vm->ctx, gtk_ml_value_int(gtk_ml_array_trie_len(&container->value.s_array.array)));
         break;
@@ -1224,6 +1485,9 @@ gboolean gtk_ml_i_len(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     case GTKML_S_SET:
         gtk_ml_push(vm->ctx, gtk_ml_value_int(gtk_ml_hash_set_len(&container->value.s_set.set)));
         break;
+    case GTKML_S_TABLE:
+        gtk_ml_push(vm->ctx, gtk_ml_value_int(gtk_ml_hash_table_len(&container->value.s_table.table)));
+        break;
     default:
         *err = gtk_ml_error(vm->ctx, "type-error", GTKML_ERR_CONTAINER_ERROR, 0, 0, 0, 0);
         return 0;
@@ -1233,7 +1497,7 @@ gboolean gtk_ml_i_len(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_array_index(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_array_index(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1276,7 +1540,7 @@ gboolean gtk_ml_i_array_index(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_array_push(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_array_push(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1290,9 +1554,20 @@ gboolean gtk_ml_i_array_push(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
         return 0;
     }
 
+    GtkMl_TaggedValue elem = gtk_ml_pop(vm->ctx);
+
+    if (gtk_ml_array_trie_is_string(&container->value.s_array.array)
+            && elem.tag != GTKML_TAG_CHAR
+            && !(gtk_ml_is_sobject(elem) && elem.value.sobj->kind == GTKML_S_CHAR)) {
+        GtkMl_SObj error = gtk_ml_error(vm->ctx, "type-error", GTKML_ERR_TYPE_ERROR, 0, 0, 0, 2,
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "expected", strlen("expected")), gtk_ml_new_keyword(vm->ctx, NULL, 0, "char", strlen("char")),
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "got-value", strlen("got-value")), gtk_ml_to_sobj(vm->ctx, err, elem).value.sobj);
+        *err = error;
+        return 0;
+    }
+
     GtkMl_SObj result = gtk_ml_new_array(vm->ctx, NULL);
     gtk_ml_del_array_trie(vm->ctx, &result->value.s_array.array, gtk_ml_delete_value);
-    GtkMl_TaggedValue elem = gtk_ml_pop(vm->ctx);
 
     gtk_ml_array_trie_push(&result->value.s_array.array, &container->value.s_array.array, elem);
     gtk_ml_push(vm->ctx, gtk_ml_value_sobject(result));
@@ -1301,7 +1576,7 @@ gboolean gtk_ml_i_array_push(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_array_pop(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_array_pop(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1327,7 +1602,7 @@ gboolean gtk_ml_i_array_pop(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_array_concat(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_array_concat(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1365,7 +1640,47 @@ gboolean gtk_ml_i_array_concat(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_map_get(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_array_slice(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
+    (void) err;
+    (void) data;
+
+    GtkMl_SObj array = gtk_ml_pop(vm->ctx).value.sobj;
+    GtkMl_SObj start = gtk_ml_pop(vm->ctx).value.sobj;
+    GtkMl_SObj end = gtk_ml_pop(vm->ctx).value.sobj;
+
+    if (start->kind != GTKML_S_INT || end->kind != GTKML_S_INT) {
+        GtkMl_SObj error = gtk_ml_error(vm->ctx, "type-error", GTKML_ERR_TYPE_ERROR, 0, 0, 0, 2,
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "expected", strlen("expected")), gtk_ml_new_keyword(vm->ctx, NULL, 0, "int", strlen("int")),
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "got-value", strlen("got-value")), start->kind != GTKML_S_INT? start : end);
+        *err = error;
+        return 0;
+    }
+
+    switch (array->kind) {
+    case GTKML_S_ARRAY: {
+        // negative bounds are clamped to 0, bounds past the end to the length
+        int64_t from = start->value.s_int.value < 0? 0 : start->value.s_int.value;
+        int64_t to = end->value.s_int.value < 0? 0 : end->value.s_int.value;
+        GtkMl_SObj result = gtk_ml_new_array(vm->ctx, NULL);
+        gtk_ml_del_array_trie(vm->ctx, &result->value.s_array.array, gtk_ml_delete_value);
+        gtk_ml_array_trie_slice(&result->value.s_array.array, &array->value.s_array.array, from, to);
+        gtk_ml_push(vm->ctx, gtk_ml_value_sobject(result));
+        break;
+    }
+    default: {
+        GtkMl_SObj error = gtk_ml_error(vm->ctx, "type-error", GTKML_ERR_TYPE_ERROR, 0, 0, 0, 2,
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "expected", strlen("expected")), gtk_ml_new_keyword(vm->ctx, NULL, 0, "array", strlen("array")),
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "got-value", strlen("got-value")), array);
+        *err = error;
+        return 0;
+    }
+    }
+
+    PC_INCREMENT;
+    return 1;
+}
+
+gboolean gtk_ml_i_map_get(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1398,7 +1713,7 @@ gboolean gtk_ml_i_map_get(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_map_insert(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_map_insert(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1426,7 +1741,7 @@ gboolean gtk_ml_i_map_insert(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_map_delete(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_map_delete(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1453,7 +1768,7 @@ gboolean gtk_ml_i_map_delete(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_set_contains(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_set_contains(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1478,7 +1793,7 @@ gboolean gtk_ml_i_set_contains(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_set_insert(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_set_insert(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1505,7 +1820,7 @@ gboolean gtk_ml_i_set_insert(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_set_delete(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_set_delete(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1532,7 +1847,145 @@ gboolean gtk_ml_i_set_delete(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_call(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_map_to_table(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
+    (void) err;
+    (void) data;
+
+    GtkMl_SObj container = gtk_ml_pop(vm->ctx).value.sobj;
+
+    switch (container->kind) {
+    case GTKML_S_MAP: {
+        GtkMl_SObj result = gtk_ml_new_table(vm->ctx, NULL);
+        gtk_ml_hash_table_from_trie(&result->value.s_table.table, &container->value.s_map.map);
+        gtk_ml_push(vm->ctx, gtk_ml_value_sobject(result));
+        break;
+    }
+    default: {
+        GtkMl_SObj error = gtk_ml_error(vm->ctx, "type-error", GTKML_ERR_TYPE_ERROR, 0, 0, 0, 2,
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "expected", strlen("expected")), gtk_ml_new_keyword(vm->ctx, NULL, 0, "map", strlen("map")),
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "got-value", strlen("got-value")), container);
+        *err = error;
+        return 0;
+    }
+    }
+
+    PC_INCREMENT;
+    return 1;
+}
+
+gboolean gtk_ml_i_table_to_map(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
+    (void) err;
+    (void) data;
+
+    GtkMl_SObj container = gtk_ml_pop(vm->ctx).value.sobj;
+
+    switch (container->kind) {
+    case GTKML_S_TABLE: {
+        GtkMl_SObj result = gtk_ml_new_map(vm->ctx, NULL, NULL);
+        gtk_ml_del_hash_trie(vm->ctx, &result->value.s_map.map, gtk_ml_delete_value);
+        gtk_ml_hash_trie_from_table(&result->value.s_map.map, &container->value.s_table.table);
+        gtk_ml_push(vm->ctx, gtk_ml_value_sobject(result));
+        break;
+    }
+    default: {
+        GtkMl_SObj error = gtk_ml_error(vm->ctx, "type-error", GTKML_ERR_TYPE_ERROR, 0, 0, 0, 2,
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "expected", strlen("expected")), gtk_ml_new_keyword(vm->ctx, NULL, 0, "table", strlen("table")),
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "got-value", strlen("got-value")), container);
+        *err = error;
+        return 0;
+    }
+    }
+
+    PC_INCREMENT;
+    return 1;
+}
+
+gboolean gtk_ml_i_table_get(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
+    (void) err;
+    (void) data;
+
+    GtkMl_SObj container = gtk_ml_pop(vm->ctx).value.sobj;
+    GtkMl_TaggedValue key = gtk_ml_pop(vm->ctx);
+
+    switch (container->kind) {
+    case GTKML_S_TABLE: {
+        GtkMl_TaggedValue opt = gtk_ml_hash_table_get(&container->value.s_table.table, key);
+        if (gtk_ml_has_value(opt)) {
+            gtk_ml_push(vm->ctx, opt);
+        } else {
+            GtkMl_SObj error = gtk_ml_error(vm->ctx, "index-out-of-bounds", GTKML_ERR_INDEX_ERROR, 0, 0, 0, 1,
+                gtk_ml_new_keyword(vm->ctx, NULL, 0, "key", strlen("key")), key);
+            *err = error;
+            return 0;
+        }
+        break;
+    }
+    default: {
+        GtkMl_SObj error = gtk_ml_error(vm->ctx, "type-error", GTKML_ERR_TYPE_ERROR, 0, 0, 0, 2,
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "expected", strlen("expected")), gtk_ml_new_keyword(vm->ctx, NULL, 0, "table", strlen("table")),
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "got-value", strlen("got-value")), container);
+        *err = error;
+        return 0;
+    }
+    }
+
+    PC_INCREMENT;
+    return 1;
+}
+
+gboolean gtk_ml_i_table_insert(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
+    (void) err;
+    (void) data;
+
+    GtkMl_SObj container = gtk_ml_pop(vm->ctx).value.sobj;
+    GtkMl_TaggedValue key = gtk_ml_pop(vm->ctx);
+    GtkMl_TaggedValue value = gtk_ml_pop(vm->ctx);
+
+    switch (container->kind) {
+    case GTKML_S_TABLE:
+        gtk_ml_hash_table_insert(&container->value.s_table.table, key, value);
+        gtk_ml_write_barrier(container);
+        gtk_ml_push(vm->ctx, gtk_ml_value_sobject(container));
+        break;
+    default: {
+        GtkMl_SObj error = gtk_ml_error(vm->ctx, "type-error", GTKML_ERR_TYPE_ERROR, 0, 0, 0, 2,
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "expected", strlen("expected")), gtk_ml_new_keyword(vm->ctx, NULL, 0, "table", strlen("table")),
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "got-value", strlen("got-value")), container);
+        *err = error;
+        return 0;
+    }
+    }
+
+    PC_INCREMENT;
+    return 1;
+}
+
+gboolean gtk_ml_i_table_delete(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
+    (void) err;
+    (void) data;
+
+    GtkMl_SObj container = gtk_ml_pop(vm->ctx).value.sobj;
+    GtkMl_TaggedValue key = gtk_ml_pop(vm->ctx);
+
+    switch (container->kind) {
+    case GTKML_S_TABLE:
+        gtk_ml_hash_table_delete(&container->value.s_table.table, key);
+        gtk_ml_push(vm->ctx, gtk_ml_value_sobject(container));
+        break;
+    default: {
+        GtkMl_SObj error = gtk_ml_error(vm->ctx, "type-error", GTKML_ERR_TYPE_ERROR, 0, 0, 0, 2,
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "expected", strlen("expected")), gtk_ml_new_keyword(vm->ctx, NULL, 0, "table", strlen("table")),
+            gtk_ml_new_keyword(vm->ctx, NULL, 0, "got-value", strlen("got-value")), container);
+        *err = error;
+        return 0;
+    }
+    }
+
+    PC_INCREMENT;
+    return 1;
+}
+
+gboolean gtk_ml_i_call(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1555,7 +2008,7 @@ gboolean gtk_ml_i_call(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_leave_ret(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_leave_ret(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
 
@@ -1568,8 +2021,8 @@ gboolean gtk_ml_i_leave_ret(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
             return 0;
         }
 
-        LEAVE(vm, vm->ctx->gc);
-        LEAVE(vm, vm->ctx->gc);
+        LEAVE(vm);
+        LEAVE(vm);
 
         uint64_t pc = vm->call_stack[--vm->call_stack_ptr];
         uint64_t flags = vm->call_stack[--vm->call_stack_ptr];
@@ -1580,9 +2033,9 @@ gboolean gtk_ml_i_leave_ret(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_call_core(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_call_core(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) data;
-    GtkMl_TaggedValue (*function)(GtkMl_Context *, GtkMl_SObj *, GtkMl_TaggedValue) = vm->core[gtk_ml_get_data(vm->program, data).value.u64];
+    GtkMl_TaggedValue (*function)(GtkMl_Context *, GtkMl_SObj *, GtkMl_TaggedValue) = vm->core[data.value.u64];
     GtkMl_TaggedValue expr = gtk_ml_pop(vm->ctx);
     GtkMl_TaggedValue value = function(vm->ctx, err, expr);
     if (gtk_ml_has_value(value)) {
@@ -1594,20 +2047,20 @@ gboolean gtk_ml_i_call_core(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
     return 1;
 }
 
-gboolean gtk_ml_i_branch_absolute(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_branch_absolute(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     vm->flags &= ~GTKML_F_GENERIC;
-    GtkMl_SObj addr = gtk_ml_to_sobj(vm->ctx, err, gtk_ml_get_data(vm->program, data)).value.sobj;
+    GtkMl_SObj addr = gtk_ml_to_sobj(vm->ctx, err, data).value.sobj;
     vm->pc = addr->value.s_address.addr;
     return 1;
 }
 
-gboolean gtk_ml_i_branch_relative(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_Data data) {
+gboolean gtk_ml_i_branch_relative(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
     (void) err;
     (void) data;
     vm->flags &= ~GTKML_F_GENERIC;
-    GtkMl_SObj addr = gtk_ml_to_sobj(vm->ctx, err, gtk_ml_get_data(vm->program, data)).value.sobj;
+    GtkMl_SObj addr = gtk_ml_to_sobj(vm->ctx, err, data).value.sobj;
     vm->pc += 8 + addr->value.s_address.addr;
     return 1;
 }
@@ -1023,6 +1023,150 @@ gboolean gtk_ml_builder_concat(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_Basic
     return gtk_ml_build_array_concat(ctx, b, *basic_block, err);
 }
 
+gboolean gtk_ml_builder_slice(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) {
+    GtkMl_SObj args = gtk_ml_cdr(*stmt);
+
+    if (args->kind == GTKML_S_NIL
+            || gtk_ml_cdr(args)->kind == GTKML_S_NIL
+            || gtk_ml_cddr(args)->kind == GTKML_S_NIL) {
+        *err = gtk_ml_error(ctx, "arity-error", GTKML_ERR_ARITY_ERROR, (*stmt)->span.ptr != NULL, (*stmt)->span.line, (*stmt)->span.col, 0);
+        return 0;
+    }
+
+    GtkMl_SObj *array = &gtk_ml_car(args);
+    GtkMl_SObj *start = &gtk_ml_cdar(args);
+    GtkMl_SObj *end = &gtk_ml_cddar(args);
+
+    if (!gtk_ml_compile_expression(ctx, b, basic_block, err, end, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
+        return 0;
+    }
+    if (!gtk_ml_compile_expression(ctx, b, basic_block, err, start, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
+        return 0;
+    }
+    if (!gtk_ml_compile_expression(ctx, b, basic_block, err, array, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
+        return 0;
+    }
+    return gtk_ml_build_array_slice(ctx, b, *basic_block, err);
+}
+
+gboolean gtk_ml_builder_table(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) {
+    GtkMl_SObj args = gtk_ml_cdr(*stmt);
+
+    if (args->kind == GTKML_S_NIL) {
+        *err = gtk_ml_error(ctx, "arity-error", GTKML_ERR_ARITY_ERROR, (*stmt)->span.ptr != NULL, (*stmt)->span.line, (*stmt)->span.col, 0);
+        return 0;
+    }
+
+    GtkMl_SObj *map = &gtk_ml_car(args);
+
+    if (!gtk_ml_compile_expression(ctx, b, basic_block, err, map, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
+        return 0;
+    }
+    return gtk_ml_build_map_to_table(ctx, b, *basic_block, err);
+}
+
+gboolean gtk_ml_builder_table_to_map(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) {
+    GtkMl_SObj args = gtk_ml_cdr(*stmt);
+
+    if (args->kind == GTKML_S_NIL) {
+        *err = gtk_ml_error(ctx, "arity-error", GTKML_ERR_ARITY_ERROR, (*stmt)->span.ptr != NULL, (*stmt)->span.line, (*stmt)->span.col, 0);
+        return 0;
+    }
+
+    GtkMl_SObj *table = &gtk_ml_car(args);
+
+    if (!gtk_ml_compile_expression(ctx, b, basic_block, err, table, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
+        return 0;
+    }
+    return gtk_ml_build_table_to_map(ctx, b, *basic_block, err);
+}
+
+gboolean gtk_ml_builder_table_get(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) {
+    GtkMl_SObj args = gtk_ml_cdr(*stmt);
+
+    if (args->kind == GTKML_S_NIL
+            || gtk_ml_cdr(args)->kind == GTKML_S_NIL) {
+        *err = gtk_ml_error(ctx, "arity-error", GTKML_ERR_ARITY_ERROR, (*stmt)->span.ptr != NULL, (*stmt)->span.line, (*stmt)->span.col, 0);
+        return 0;
+    }
+
+    GtkMl_SObj *table = &gtk_ml_car(args);
+    GtkMl_SObj *key = &gtk_ml_cdar(args);
+
+    if (!gtk_ml_compile_expression(ctx, b, basic_block, err, key, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
+        return 0;
+    }
+    if (!gtk_ml_compile_expression(ctx, b, basic_block, err, table, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
+        return 0;
+    }
+    return gtk_ml_build_table_get(ctx, b, *basic_block, err);
+}
+
+gboolean gtk_ml_builder_table_insert(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) {
+    GtkMl_SObj args = gtk_ml_cdr(*stmt);
+
+    if (args->kind == GTKML_S_NIL
+            || gtk_ml_cdr(args)->kind == GTKML_S_NIL
+            || gtk_ml_cddr(args)->kind == GTKML_S_NIL) {
+        *err = gtk_ml_error(ctx, "arity-error", GTKML_ERR_ARITY_ERROR, (*stmt)->span.ptr != NULL, (*stmt)->span.line, (*stmt)->span.col, 0);
+        return 0;
+    }
+
+    GtkMl_SObj *table = &gtk_ml_car(args);
+    GtkMl_SObj *key = &gtk_ml_cdar(args);
+    GtkMl_SObj *value = &gtk_ml_cddar(args);
+
+    if (!gtk_ml_compile_expression(ctx, b, basic_block, err, value, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
+        return 0;
+    }
+    if (!gtk_ml_compile_expression(ctx, b, basic_block, err, key, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
+        return 0;
+    }
+    if (!gtk_ml_compile_expression(ctx, b, basic_block, err, table, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
+        return 0;
+    }
+    return gtk_ml_build_table_insert(ctx, b, *basic_block, err);
+}
+
+gboolean gtk_ml_builder_table_delete(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) {
+    GtkMl_SObj args = gtk_ml_cdr(*stmt);
+
+    if (args->kind == GTKML_S_NIL
+            || gtk_ml_cdr(args)->kind == GTKML_S_NIL) {
+        *err = gtk_ml_error(ctx, "arity-error", GTKML_ERR_ARITY_ERROR, (*stmt)->span.ptr != NULL, (*stmt)->span.line, (*stmt)->span.col, 0);
+        return 0;
+    }
+
+    GtkMl_SObj *table = &gtk_ml_car(args);
+    GtkMl_SObj *key = &gtk_ml_cdar(args);
+
+    if (!gtk_ml_compile_expression(ctx, b, basic_block, err, key, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
+        return 0;
+    }
+    if (!gtk_ml_compile_expression(ctx, b, basic_block, err, table, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
+        return 0;
+    }
+    return gtk_ml_build_table_delete(ctx, b, *basic_block, err);
+}
+
+// assigns both operands of a binary expression to registers if they're locals
+// registers are the slots of the local frame, so the operands don't go through the stack
+GTKML_PRIVATE gboolean allocate_registers(GtkMl_Builder *b, GtkMl_SObj lhs, GtkMl_SObj rhs, GtkMl_Data *registers) {
+    if (lhs->kind != GTKML_S_SYMBOL || rhs->kind != GTKML_S_SYMBOL) {
+        return 0;
+    }
+    GtkMl_TaggedValue rs = gtk_ml_builder_get(b, lhs);
+    GtkMl_TaggedValue ra = gtk_ml_builder_get(b, rhs);
+    if (!gtk_ml_has_value(rs) || !gtk_ml_has_value(ra)) {
+        return 0;
+    }
+    if (rs.value.u64 > 0xffffffff || ra.value.u64 > 0xffffffff) {
+        return 0;
+    }
+    *registers = gtk_ml_append_data(b, gtk_ml_value_int(rs.value.u64 | (ra.value.u64 << 32)));
+    return 1;
+}
+
 gboolean gtk_ml_builder_add(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlock **basic_block, GtkMl_SObj *err, GtkMl_SObj *stmt, gboolean allow_intr, gboolean allow_macro, gboolean allow_runtime, gboolean allow_macro_expansion) {
     GtkMl_SObj args = gtk_ml_cdr(*stmt);
 
@@ -1034,6 +1178,11 @@ gboolean gtk_ml_builder_add(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlo
     GtkMl_SObj *lhs = &gtk_ml_car(args);
     GtkMl_SObj *rhs = &gtk_ml_cdar(args);
 
+    GtkMl_Data registers;
+    if (allocate_registers(b, *lhs, *rhs, &registers)) {
+        return gtk_ml_build_binary_rr(ctx, b, *basic_block, err, GTKML_I_ADD_RR, registers);
+    }
+
     if (!gtk_ml_compile_expression(ctx, b, basic_block, err, rhs, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
         return 0;
     }
@@ -1067,6 +1216,11 @@ gboolean gtk_ml_builder_sub(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlo
     GtkMl_SObj *lhs = &gtk_ml_car(args);
     GtkMl_SObj *rhs = &gtk_ml_cdar(args);
 
+    GtkMl_Data registers;
+    if (allocate_registers(b, *lhs, *rhs, &registers)) {
+        return gtk_ml_build_binary_rr(ctx, b, *basic_block, err, GTKML_I_SUBTRACT_RR, registers);
+    }
+
     if (!gtk_ml_compile_expression(ctx, b, basic_block, err, rhs, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
         return 0;
     }
@@ -1087,6 +1241,11 @@ gboolean gtk_ml_builder_mul(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlo
     GtkMl_SObj *lhs = &gtk_ml_car(args);
     GtkMl_SObj *rhs = &gtk_ml_cdar(args);
 
+    GtkMl_Data registers;
+    if (allocate_registers(b, *lhs, *rhs, &registers)) {
+        return gtk_ml_build_binary_rr(ctx, b, *basic_block, err, GTKML_I_SIGNED_MULTIPLY_RR, registers);
+    }
+
     if (!gtk_ml_compile_expression(ctx, b, basic_block, err, rhs, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
         return 0;
     }
@@ -1107,6 +1266,11 @@ gboolean gtk_ml_builder_div(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlo
     GtkMl_SObj *lhs = &gtk_ml_car(args);
     GtkMl_SObj *rhs = &gtk_ml_cdar(args);
 
+    GtkMl_Data registers;
+    if (allocate_registers(b, *lhs, *rhs, &registers)) {
+        return gtk_ml_build_binary_rr(ctx, b, *basic_block, err, GTKML_I_SIGNED_DIVIDE_RR, registers);
+    }
+
     if (!gtk_ml_compile_expression(ctx, b, basic_block, err, rhs, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
         return 0;
     }
@@ -1127,6 +1291,11 @@ gboolean gtk_ml_builder_mod(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicBlo
     GtkMl_SObj *lhs = &gtk_ml_car(args);
     GtkMl_SObj *rhs = &gtk_ml_cdar(args);
 
+    GtkMl_Data registers;
+    if (allocate_registers(b, *lhs, *rhs, &registers)) {
+        return gtk_ml_build_binary_rr(ctx, b, *basic_block, err, GTKML_I_SIGNED_MODULO_RR, registers);
+    }
+
     if (!gtk_ml_compile_expression(ctx, b, basic_block, err, rhs, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
         return 0;
     }
@@ -1167,6 +1336,11 @@ gboolean gtk_ml_builder_bitand(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_Basic
     GtkMl_SObj *lhs = &gtk_ml_car(args);
     GtkMl_SObj *rhs = &gtk_ml_cdar(args);
 
+    GtkMl_Data registers;
+    if (allocate_registers(b, *lhs, *rhs, &registers)) {
+        return gtk_ml_build_binary_rr(ctx, b, *basic_block, err, GTKML_I_BIT_AND_RR, registers);
+    }
+
     if (!gtk_ml_compile_expression(ctx, b, basic_block, err, rhs, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
         return 0;
     }
@@ -1187,6 +1361,11 @@ gboolean gtk_ml_builder_bitor(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_BasicB
     GtkMl_SObj *lhs = &gtk_ml_car(args);
     GtkMl_SObj *rhs = &gtk_ml_cdar(args);
 
+    GtkMl_Data registers;
+    if (allocate_registers(b, *lhs, *rhs, &registers)) {
+        return gtk_ml_build_binary_rr(ctx, b, *basic_block, err, GTKML_I_BIT_OR_RR, registers);
+    }
+
     if (!gtk_ml_compile_expression(ctx, b, basic_block, err, rhs, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
         return 0;
     }
@@ -1207,6 +1386,11 @@ gboolean gtk_ml_builder_bitxor(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_Basic
     GtkMl_SObj *lhs = &gtk_ml_car(args);
     GtkMl_SObj *rhs = &gtk_ml_cdar(args);
 
+    GtkMl_Data registers;
+    if (allocate_registers(b, *lhs, *rhs, &registers)) {
+        return gtk_ml_build_binary_rr(ctx, b, *basic_block, err, GTKML_I_BIT_XOR_RR, registers);
+    }
+
     if (!gtk_ml_compile_expression(ctx, b, basic_block, err, rhs, allow_intr, allow_macro, allow_runtime, allow_macro_expansion)) {
         return 0;
     }
@@ -1356,6 +1540,7 @@ gboolean gtk_ml_compile_cond_expression(GtkMl_Context *ctx, GtkMl_Builder *b, Gt
     case GTKML_S_MAP:
     case GTKML_S_SET:
     case GTKML_S_ARRAY: 
+    case GTKML_S_TABLE:
     case GTKML_S_VAR:
         return gtk_ml_build_setf_imm(ctx, b, *basic_block, err, gtk_ml_append_data(b, gtk_ml_value_true()));
     case GTKML_S_LIST:
@@ -1528,6 +1713,7 @@ gboolean gtk_ml_compile_quasi_expression(GtkMl_Context *ctx, GtkMl_Builder *b, G
     case GTKML_S_ADDRESS:
     case GTKML_S_LIGHTDATA:
     case GTKML_S_USERDATA:
+    case GTKML_S_TABLE:
     case GTKML_S_SYMBOL:
     case GTKML_S_LAMBDA:
     case GTKML_S_MACRO:
@@ -1663,6 +1849,7 @@ gboolean gtk_ml_compile_expression(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_B
     case GTKML_S_ADDRESS:
     case GTKML_S_LIGHTDATA:
     case GTKML_S_USERDATA:
+    case GTKML_S_TABLE:
         return gtk_ml_build_push_imm(ctx, b, *basic_block, err, gtk_ml_append_static_data(b, *stmt));
     case GTKML_S_SYMBOL: {
         GtkMl_TaggedValue local = gtk_ml_builder_get(b, *stmt);
@@ -1809,7 +1996,9 @@ gboolean gtk_ml_compile_expression(GtkMl_Context *ctx, GtkMl_Builder *b, GtkMl_B
                     return 0;
                 }
 
+                // nothing tells which cell `stmt` is in, and that cell may be old or already marked
                 *stmt = result;
+                gtk_ml_write_barrier_value(result);
 
                 return gtk_ml_compile_expression(ctx, b, basic_block, err, stmt, allow_intr, allow_macro, allow_runtime, allow_macro_expansion);
             }
@@ -1895,11 +2084,7 @@ gboolean gtk_ml_compile_program_internal(GtkMl_Context *ctx, GtkMl_Builder *b, G
 
     gtk_ml_builder_enter(ctx, b, 0);
 
-    size_t len = 0;
-    while (params->kind != GTKML_S_NIL) {
-        ++len;
-        params = gtk_ml_cdr(params);
-    }
+    size_t len = gtk_ml_list_len(params);
 
     int64_t *offsets = malloc(sizeof(int64_t) * len);
     GtkMl_SObj revparams = gtk_ml_new_nil(ctx, NULL);
@@ -1991,6 +2176,11 @@ GTKML_PRIVATE GtkMl_VisitResult collect_intrinsics_array(GtkMl_Array *array, siz
 
     struct CollectData *col = data.value.userdata;
 
+    // the characters of a string are not expressions
+    if (!gtk_ml_is_sobject(value)) {
+        return GTKML_VISIT_RECURSE;
+    }
+
     col->change |= collect_intrinsics_inner(col->ctx, col->b, value.value.sobj, col->has_intr);
 
     return GTKML_VISIT_RECURSE;
@@ -2161,6 +2351,11 @@ GTKML_PRIVATE GtkMl_VisitResult collect_macros_array(GtkMl_Array *array, size_t
 
     struct CollectData *col = data.value.userdata;
 
+    // the characters of a string are not expressions
+    if (!gtk_ml_is_sobject(value)) {
+        return GTKML_VISIT_RECURSE;
+    }
+
     col->change |= collect_macros_inner(col->ctx, col->b, value.value.sobj, col->has_intr);
 
     return GTKML_VISIT_RECURSE;
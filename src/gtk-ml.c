@@ -1,10 +1,16 @@
+#ifdef GTKML_ENABLE_POSIX
+#define _POSIX_C_SOURCE 200809L
+#endif /* GTKML_ENABLE_POSIX */
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
 #include <ctype.h>
+#include <time.h>
 #ifdef GTKML_ENABLE_POSIX
 #include <sys/ptrace.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif /* GTKML_ENABLE_POSIX */
 #ifdef GTKML_ENABLE_GTK
 #include <gtk/gtk.h>
@@ -77,9 +83,37 @@ GTKML_PRIVATE const char *S_OPCODES[] = {
     [GTKML_I_CALL_CORE] = GTKML_SI_CALL_CORE,
     [GTKML_I_BRANCH_ABSOLUTE] = GTKML_SI_BRANCH_ABSOLUTE,
     [GTKML_I_BRANCH_RELATIVE] = GTKML_SI_BRANCH_RELATIVE,
+    [GTKML_I_ADD_RR] = GTKML_SI_ADD_RR,
+    [GTKML_I_SUBTRACT_RR] = GTKML_SI_SUBTRACT_RR,
+    [GTKML_I_SIGNED_MULTIPLY_RR] = GTKML_SI_SIGNED_MULTIPLY_RR,
+    [GTKML_I_SIGNED_DIVIDE_RR] = GTKML_SI_SIGNED_DIVIDE_RR,
+    [GTKML_I_SIGNED_MODULO_RR] = GTKML_SI_SIGNED_MODULO_RR,
+    [GTKML_I_BIT_AND_RR] = GTKML_SI_BIT_AND_RR,
+    [GTKML_I_BIT_OR_RR] = GTKML_SI_BIT_OR_RR,
+    [GTKML_I_BIT_XOR_RR] = GTKML_SI_BIT_XOR_RR,
+    [GTKML_I_BIT_NAND_RR] = GTKML_SI_BIT_NAND_RR,
+    [GTKML_I_BIT_NOR_RR] = GTKML_SI_BIT_NOR_RR,
+    [GTKML_I_BIT_XNOR_RR] = GTKML_SI_BIT_XNOR_RR,
+    [GTKML_I_ARRAY_SLICE] = GTKML_SI_ARRAY_SLICE,
+    [GTKML_I_MAP_TO_TABLE] = GTKML_SI_MAP_TO_TABLE,
+    [GTKML_I_TABLE_TO_MAP] = GTKML_SI_TABLE_TO_MAP,
+    [GTKML_I_TABLE_GET] = GTKML_SI_TABLE_GET,
+    [GTKML_I_TABLE_INSERT] = GTKML_SI_TABLE_INSERT,
+    [GTKML_I_TABLE_DELETE] = GTKML_SI_TABLE_DELETE,
     [255] = NULL,
 };
 
+GTKML_PRIVATE void hash_start(GtkMl_Hash *hash);
+GTKML_PRIVATE void hash_word(GtkMl_Hash *hash, uint64_t word);
+GTKML_PRIVATE void hash_bytes(GtkMl_Hash *hash, const void *_ptr, size_t len);
+GTKML_PRIVATE void hash_finish(GtkMl_Hash *hash);
+
+GTKML_PRIVATE char *cache_path(const char *cache_dir, const char *src, size_t len);
+GTKML_PRIVATE FILE *cache_tmp(char *tmp, size_t size, const char *path);
+GTKML_PRIVATE void cache_program(GtkMl_Context *ctx, const char *path, GtkMl_Program *program);
+
+GTKML_PRIVATE gboolean hash_update(GtkMl_Hash *hash, GtkMl_TaggedValue ptr, gboolean *mutable);
+
 GTKML_PRIVATE void default_hash_start(GtkMl_Hash *hash);
 GTKML_PRIVATE gboolean default_hash_update(GtkMl_Hash *hash, GtkMl_TaggedValue ptr);
 GTKML_PRIVATE void default_hash_finish(GtkMl_Hash *hash);
@@ -89,6 +123,10 @@ GTKML_PRIVATE void value_hash_start(GtkMl_Hash *hash);
 GTKML_PRIVATE gboolean value_hash_update(GtkMl_Hash *hash, GtkMl_TaggedValue ptr);
 GTKML_PRIVATE void value_hash_finish(GtkMl_Hash *hash);
 GTKML_PRIVATE gboolean value_equal(GtkMl_TaggedValue lhs, GtkMl_TaggedValue rhs);
+GTKML_PRIVATE gboolean bits_equal(GtkMl_TaggedValue lhs, GtkMl_TaggedValue rhs);
+
+GTKML_PRIVATE gboolean c_str_hash_update(GtkMl_Hash *hash, GtkMl_TaggedValue str);
+GTKML_PRIVATE gboolean c_str_equal(GtkMl_TaggedValue lhs, GtkMl_TaggedValue rhs);
 
 GTKML_PRIVATE void ptr_hash_start(GtkMl_Hash *hash);
 GTKML_PRIVATE gboolean ptr_hash_update(GtkMl_Hash *hash, GtkMl_TaggedValue ptr);
@@ -111,6 +149,20 @@ GtkMl_Hasher GTKML_VALUE_HASHER = {
     value_equal
 };
 
+GtkMl_Hasher GTKML_BITS_HASHER = {
+    value_hash_start,
+    value_hash_update,
+    value_hash_finish,
+    bits_equal
+};
+
+GtkMl_Hasher GTKML_C_STR_HASHER = {
+    value_hash_start,
+    c_str_hash_update,
+    value_hash_finish,
+    c_str_equal
+};
+
 GtkMl_Hasher GTKML_PTR_HASHER = {
     ptr_hash_start,
     ptr_hash_update,
@@ -125,6 +177,23 @@ GtkMl_Hasher GTKML_PTR_HASHER = {
         ++ctx->parser.len_reader; \
     } while (0);
 
+GTKML_PRIVATE void gc_add_vm(GtkMl_Gc *gc, GtkMl_Vm *vm) {
+    if (gc->vm_len == gc->vm_cap) {
+        gc->vm_cap *= 2;
+        gc->vms = realloc(gc->vms, sizeof(GtkMl_Vm *) * gc->vm_cap);
+    }
+    gc->vms[gc->vm_len++] = vm;
+}
+
+GTKML_PRIVATE void gc_remove_vm(GtkMl_Gc *gc, GtkMl_Vm *vm) {
+    for (size_t i = 0; i < gc->vm_len; i++) {
+        if (gc->vms[i] == vm) {
+            gc->vms[i] = gc->vms[--gc->vm_len];
+            return;
+        }
+    }
+}
+
 GtkMl_Context *gtk_ml_new_context() {
     return gtk_ml_new_context_with_gc(gtk_ml_new_gc());
 }
@@ -132,10 +201,12 @@ GtkMl_Context *gtk_ml_new_context() {
 GtkMl_Context *gtk_ml_new_context_with_gc(GtkMl_Gc *gc) {
     GtkMl_Context *ctx = malloc(sizeof(GtkMl_Context));
     ctx->is_debugger = 0;
+    ctx->is_debuggee = 0;
     ctx->enable_breakpoint = 0;
     ctx->dbg_done = 0;
     ctx->vm = gtk_ml_new_vm(ctx);
     ctx->gc = gc;
+    gc_add_vm(gc, ctx->vm);
 
     // ({'flags-none G_APPLICATION_FLAGS_NONE})
     GtkMl_SObj bindings = gtk_ml_new_var(ctx, NULL, gtk_ml_new_map(ctx, NULL, NULL));
@@ -169,6 +240,7 @@ GtkMl_Context *gtk_ml_new_context_with_gc(GtkMl_Gc *gc) {
 }
 
 void gtk_ml_del_context(GtkMl_Context *ctx) {
+    gc_remove_vm(ctx->gc, ctx->vm);
     gtk_ml_del_gc(ctx, ctx->gc);
     gtk_ml_del_vm(ctx->vm);
 
@@ -185,9 +257,12 @@ GtkMl_Context *gtk_ml_new_debugger(pid_t dbg_process) {
     return ctx;
 }
 
-void gtk_ml_set_debug(GtkMl_Context *ctx, pid_t dbg_process, GtkMl_Context *debugee) {
+gboolean gtk_ml_set_debug(GtkMl_Context *ctx, GtkMl_SObj *err, pid_t dbg_process, GtkMl_Context *debugee) {
     ctx->dbg_process = dbg_process;
     ctx->dbg_ctx = debugee;
+    // the debuggee checks this when it leaves the breakpoint and switches to the instrumented loop
+    gtk_ml_dbg_write_boolean(ctx, err, &debugee->is_debuggee, 1);
+    return *err == NULL;
 }
 #endif /* GTKML_ENABLE_POSIX */
 
@@ -197,28 +272,39 @@ GtkMl_Gc *gtk_ml_new_gc() {
     gc->gc_enabled = 1;
     gc->n_values = 0;
     gc->m_values = GTKML_GC_COUNT_THRESHOLD;
-    gc->first = NULL;
+    gc->slabs = NULL;
+    gc->partial = NULL;
+    gc->slab = NULL;
 
-    gc->stack_len = 0;
-    gc->stack_cap = GTKML_GC_STACK;
-    gc->stack = malloc(sizeof(GtkMl_SObj) * gc->stack_cap);
+    gc->nursery_len = 0;
+    gc->nursery_cap = GTKML_GC_NURSERY_THRESHOLD;
+    gc->nursery = malloc(sizeof(GtkMl_SObj) * gc->nursery_cap);
 
-    gc->local_base = 0;
-    gc->local_len = 0;
-    gc->local_cap = GTKML_GC_STACK;
-    gc->local = malloc(sizeof(GtkMl_SObj) * gc->local_cap);
+    gc->remembered_len = 0;
+    gc->remembered_cap = 64;
+    gc->remembered = malloc(sizeof(GtkMl_SObj) * gc->remembered_cap);
 
-    gc->base_stack_ptr = 0;
-    gc->base_stack_cap = GTKML_GC_STACK;
-    gc->base_stack = malloc(sizeof(uint64_t) * gc->base_stack_cap);
+    gc->marking = 0;
+    gc->mark_stop = GTKML_FLAG_REACHABLE;
+    gc->mark_budget = GTKML_GC_MARK_BUDGET;
+    gc->gray_len = 0;
+    gc->gray_cap = 256;
+    gc->gray = malloc(sizeof(GtkMl_SObj) * gc->gray_cap);
+
+    gc->sweeping = 0;
+    gc->sweep_slab = NULL;
+
+    gc->vm_len = 0;
+    gc->vm_cap = 4;
+    gc->vms = malloc(sizeof(GtkMl_Vm *) * gc->vm_cap);
 
     gc->program_len = 0;
     gc->program_cap = 16;
     gc->programs = malloc(sizeof(GtkMl_Program *) * gc->program_cap);
 
-    gc->free_len = 0;
-    gc->free_cap = 64;
-    gc->free_all = malloc(sizeof(GtkMl_SObj) * gc->free_cap);
+    gc->interned_len = 0;
+    gc->interned_cap = 256;
+    gc->interned = calloc(gc->interned_cap, sizeof(GtkMl_SObj));
 
     gc->static_stack = NULL;
     gc->builder = NULL;
@@ -231,79 +317,195 @@ GtkMl_Gc *gtk_ml_gc_copy(GtkMl_Gc *gc) {
     return gc;
 }
 
-GTKML_PRIVATE void free_all(GtkMl_Gc *gc) {
-    for (size_t i = 0; i < gc->free_len; i++) {
-        free(gc->free_all[i]);
+GTKML_PRIVATE GtkMl_Slab *new_slab(GtkMl_Gc *gc) {
+    GtkMl_Slab *slab = aligned_alloc(GTKML_SLAB_SIZE, GTKML_SLAB_SIZE);
+    slab->gc = gc;
+    slab->prev = NULL;
+    slab->next = gc->slabs;
+    if (gc->slabs) {
+        gc->slabs->prev = slab;
+    }
+    gc->slabs = slab;
+    slab->next_partial = NULL;
+    slab->in_partial = 0;
+    slab->unswept = 0;
+    slab->free = NULL;
+    slab->bump = 0;
+    slab->used = 0;
+    return slab;
+}
+
+GTKML_PRIVATE void del_slab(GtkMl_Gc *gc, GtkMl_Slab *slab) {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        gc->slabs = slab->next;
+    }
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+    free(slab);
+}
+
+GtkMl_SObj gtk_ml_gc_alloc(GtkMl_Gc *gc) {
+    GtkMl_Slab *slab = gc->slab;
+    if (!slab || (!slab->free && slab->bump == GTKML_SLAB_CELLS)) {
+        if (gc->partial) {
+            slab = gc->partial;
+            gc->partial = slab->next_partial;
+            slab->in_partial = 0;
+        } else {
+            slab = new_slab(gc);
+        }
+        gc->slab = slab;
+    }
+
+    GtkMl_SObj s;
+    if (slab->free) {
+        s = slab->free;
+        slab->free = s->next;
+    } else {
+        s = &slab->cells[slab->bump++];
+    }
+    ++slab->used;
+
+    // no minor collection runs until a full one is over, and that one frees or promotes whatever is on the pages it sweeps
+    // cells handed out while it sweeps are on pages it is done with, so they start out old
+    if (gc->sweeping) {
+        s->flags = GTKML_FLAG_OLD;
+        return s;
+    }
+
+    s->flags = GTKML_FLAG_NONE;
+    if (gc->marking) {
+        return s;
+    }
+
+    if (gc->nursery_len == gc->nursery_cap) {
+        gc->nursery_cap *= 2;
+        gc->nursery = realloc(gc->nursery, sizeof(GtkMl_SObj) * gc->nursery_cap);
+    }
+    gc->nursery[gc->nursery_len++] = s;
+
+    return s;
+}
+
+GTKML_PRIVATE GtkMl_Slab *slab_of(GtkMl_SObj s) {
+    return (GtkMl_Slab *) ((uintptr_t) s & ~(uintptr_t) (GTKML_SLAB_SIZE - 1));
+}
+
+// returns a cell to its page, the page itself is only released by `sweep_slab`
+// unswept pages are queued once they are swept, so nothing is allocated next to stale marks
+GTKML_PRIVATE void gc_free(GtkMl_Gc *gc, GtkMl_SObj s) {
+    GtkMl_Slab *slab = slab_of(s);
+    s->flags = GTKML_FLAG_FREE;
+    s->next = slab->free;
+    slab->free = s;
+    --slab->used;
+    --gc->n_values;
+    if (!slab->in_partial && !slab->unswept && slab != gc->slab) {
+        slab->next_partial = gc->partial;
+        slab->in_partial = 1;
+        gc->partial = slab;
+    }
+}
+
+GTKML_PRIVATE void mark_sobject(GtkMl_Gc *gc, GtkMl_SObj s);
+
+void gtk_ml_write_barrier(GtkMl_SObj s) {
+    // image cells have no slab, and are never written to anyway
+    if (s->flags & GTKML_FLAG_IMAGE) {
+        return;
+    }
+
+    GtkMl_Gc *gc = slab_of(s)->gc;
+
+    // an object scanned by an ongoing full collection has to be scanned again
+    if (gc->marking && (s->flags & (GTKML_FLAG_REACHABLE | GTKML_FLAG_GRAY)) == GTKML_FLAG_REACHABLE) {
+        s->flags &= ~GTKML_FLAG_REACHABLE;
+        mark_sobject(gc, s);
+    }
+
+    // survivors on pages that aren't swept yet turn old without being scanned again, so they count as old already
+    gboolean old = (s->flags & GTKML_FLAG_OLD) || (gc->sweeping && (s->flags & GTKML_FLAG_REACHABLE));
+    if (old && !(s->flags & GTKML_FLAG_REMEMBERED)) {
+        if (gc->remembered_len == gc->remembered_cap) {
+            gc->remembered_cap *= 2;
+            gc->remembered = realloc(gc->remembered, sizeof(GtkMl_SObj) * gc->remembered_cap);
+        }
+        gc->remembered[gc->remembered_len++] = s;
+        s->flags |= GTKML_FLAG_REMEMBERED;
+    }
+}
+
+void gtk_ml_write_barrier_value(GtkMl_SObj value) {
+    if (value->flags & GTKML_FLAG_IMAGE) {
+        return;
+    }
+
+    GtkMl_Gc *gc = slab_of(value)->gc;
+
+    // whatever holds it may have been scanned already
+    if (gc->marking) {
+        mark_sobject(gc, value);
     }
-    gc->free_len = 0;
+
+    // and may be old, so the next minor collection scans its fields instead of freeing it
+    value->flags |= GTKML_FLAG_OLD;
+    gtk_ml_write_barrier(value);
 }
 
 void gtk_ml_del_gc(GtkMl_Context *ctx, GtkMl_Gc *gc) {
     --gc->rc;
     if (!gc->rc) {
-        GtkMl_SObj value = gc->first;
-        while (value) {
-            GtkMl_SObj next = value->next;
-            gtk_ml_del(ctx, value);
-            value = next;
+        // everything goes, there is nothing left to unintern
+        free(gc->interned);
+        gc->interned = NULL;
+        gc->interned_cap = 0;
+
+        while (gc->slabs) {
+            GtkMl_Slab *slab = gc->slabs;
+            for (size_t i = 0; i < slab->bump; i++) {
+                if (!(slab->cells[i].flags & GTKML_FLAG_FREE)) {
+                    gtk_ml_del(ctx, &slab->cells[i]);
+                }
+            }
+            del_slab(gc, slab);
         }
-        free_all(gc);
-        free(gc->free_all);
 
         for (size_t i = 0; i < gc->program_len; i++) {
             gtk_ml_del_program(gc->programs[i]);
         }
         free(gc->programs);
-        free(gc->stack);
-        free(gc->local);
+        free(gc->vms);
+        free(gc->nursery);
+        free(gc->remembered);
+        free(gc->gray);
         free(gc);
     }
 }
 
-void gtk_ml_gc_push(GtkMl_Gc *gc, GtkMl_SObj sobj) {
-    if (gc->stack_len == gc->stack_cap) {
-        gc->stack_cap *= 2;
-        gc->stack = realloc(gc->stack, sizeof(GtkMl_SObj) * gc->stack_cap);
-    }
-    gc->stack[gc->stack_len++] = sobj;
-}
-
-GtkMl_SObj gtk_ml_gc_pop(GtkMl_Gc *gc) {
-    return gc->stack[--gc->stack_len];
-}
-
 void gtk_ml_push(GtkMl_Context *ctx, GtkMl_TaggedValue value) {
     gtk_ml_vm_push(ctx->vm, value);
-    if (gtk_ml_is_sobject(value)) {
-        gtk_ml_gc_push(ctx->gc, value.value.sobj);
-    }
 }
 
 void gtk_ml_set_local(GtkMl_Context *ctx, GtkMl_TaggedValue value) {
-    gtk_ml_set_local_internal(ctx->vm, ctx->gc, value);
+    gtk_ml_set_local_internal(ctx->vm, value);
 }
 
 GtkMl_TaggedValue gtk_ml_get_local(GtkMl_Context *ctx, int64_t offset) {
-    return gtk_ml_get_local_internal(ctx->vm, ctx->gc, offset);
+    return gtk_ml_get_local_internal(ctx->vm, offset);
 }
 
-void gtk_ml_set_local_internal(GtkMl_Vm *vm, GtkMl_Gc *gc, GtkMl_TaggedValue value) {
+void gtk_ml_set_local_internal(GtkMl_Vm *vm, GtkMl_TaggedValue value) {
     if (vm->local_len == vm->local_cap) {
         vm->local_cap *= 2;
         vm->local = realloc(vm->local, sizeof(GtkMl_TaggedValue) * vm->local_cap);
     }
     vm->local[vm->local_len++] = value;
-    if (gtk_ml_is_sobject(value)) {
-        if (gc->local_len == gc->local_cap) {
-            gc->local_cap *= 2;
-            gc->local = realloc(gc->local, sizeof(GtkMl_TaggedValue) * gc->local_cap);
-        }
-        gc->local[gc->local_len++] = value.value.sobj;
-    }
 }
 
-GtkMl_TaggedValue gtk_ml_get_local_internal(GtkMl_Vm *vm, GtkMl_Gc *gc, int64_t offset) {
-    (void) gc;
+GtkMl_TaggedValue gtk_ml_get_local_internal(GtkMl_Vm *vm, int64_t offset) {
     int64_t ptr = vm->local_base + offset;
     if (ptr < 0 || ptr >= (int64_t) vm->local_len) {
         return gtk_ml_value_none();
@@ -313,25 +515,7 @@ GtkMl_TaggedValue gtk_ml_get_local_internal(GtkMl_Vm *vm, GtkMl_Gc *gc, int64_t
 }
 
 GtkMl_TaggedValue gtk_ml_pop(GtkMl_Context *ctx) {
-    GtkMl_TaggedValue result = gtk_ml_vm_pop(ctx->vm);
-    if (gtk_ml_is_sobject(result)) {
-        GtkMl_SObj gc_result = gtk_ml_gc_pop(ctx->gc);
-        if (result.value.sobj != gc_result) {
-            size_t offset = 0;
-            fprintf(stderr, "fatal error: vm stack and gc stack got desynchronized %p, %p\n\n vm value: ", (void *) result.value.sobj, (void *) gc_result);
-            (void) gtk_ml_dumpf(ctx, stderr, NULL, result.value.sobj);
-            fprintf(stderr, "\n gc value: ");
-            (void) gtk_ml_dumpf(ctx, stderr, NULL, gc_result);
-            fprintf(stderr, "\n\n popping from vm stack until equal\n");
-            while (result.value.sobj != gc_result) {
-                result = gtk_ml_vm_pop(ctx->vm);
-                ++offset;
-            }
-            fprintf(stderr, " offset is %zu\n", offset);
-            exit(1);
-        }
-    }
-    return result;
+    return gtk_ml_vm_pop(ctx->vm);
 }
 
 GtkMl_TaggedValue gtk_ml_peek(GtkMl_Context *ctx) {
@@ -339,14 +523,26 @@ GtkMl_TaggedValue gtk_ml_peek(GtkMl_Context *ctx) {
 }
 
 void gtk_ml_load_program(GtkMl_Context *ctx, GtkMl_Program* program) {
-    ctx->vm->program = program;
+    gtk_ml_vm_load_program(ctx->vm, program);
+}
+
+void gtk_ml_set_dispatch(GtkMl_Context *ctx, GtkMl_Dispatch dispatch) {
+#ifdef GTKML_ENABLE_THREADED
+    ctx->vm->dispatch = dispatch;
+#else
+    (void) dispatch;
+    ctx->vm->dispatch = GTKML_DISPATCH_TABLE;
+#endif /* GTKML_ENABLE_THREADED */
+}
+
+uint64_t gtk_ml_executed(GtkMl_Context *ctx) {
+    return ctx->vm->n_executed;
 }
 
 gboolean gtk_ml_run_program_internal(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_SObj program, GtkMl_SObj args, gboolean brk) {
     GtkMl_SObj params = program->value.s_program.args;
 
     int64_t n_args = 0;
-    int64_t n_params = 0;
 
     if (args) {
         while (args->kind != GTKML_S_NIL) {
@@ -357,15 +553,10 @@ gboolean gtk_ml_run_program_internal(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_
         }
     }
 
-    GtkMl_SObj last_param = NULL;
-    while (params->kind != GTKML_S_NIL) {
-        last_param = gtk_ml_car(params);
-        params = gtk_ml_cdr(params);
-        ++n_params;
-    }
+    int64_t n_params = gtk_ml_list_len(params);
 
     if (n_params < n_args) {
-        if (!last_param || last_param->kind != GTKML_S_VARARG) {
+        if (!program->value.s_program.variadic) {
             *err = gtk_ml_error(ctx, "arity-error", GTKML_ERR_ARITY_ERROR, 0, 0, 0, 0);
             return 0;
         }
@@ -389,15 +580,9 @@ gboolean gtk_ml_run_program(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_SObj prog
 }
 
 GtkMl_SObj gtk_ml_get_export(GtkMl_Context *ctx, GtkMl_SObj *err, const char *linkage_name) {
-    GtkMl_SObj ext = gtk_ml_new_string(ctx, NULL, linkage_name, strlen(linkage_name));
-    for (size_t i = 0; i < ctx->vm->program->n_text; i++) {
-        GtkMl_Instruction instr = ctx->vm->program->text[i];
-        if (instr.category == GTKML_I_EXPORT) {
-            GtkMl_SObj program = ctx->vm->program->statics[ctx->vm->program->data[instr.data].value.u64];
-            if (gtk_ml_equal(ext, program->value.s_program.linkage_name)) {
-                return program;
-            }
-        }
+    GtkMl_SObj program = gtk_ml_program_export(ctx->vm->program, linkage_name);
+    if (program) {
+        return program;
     }
 
     char *name = malloc(strlen(linkage_name) + 1);
@@ -407,11 +592,56 @@ GtkMl_SObj gtk_ml_get_export(GtkMl_Context *ctx, GtkMl_SObj *err, const char *li
     return NULL;
 }
 
+GtkMl_SObj gtk_ml_program_export(GtkMl_Program *program, const char *linkage_name) {
+    GtkMl_TaggedValue result = gtk_ml_hash_table_get(&program->exports, gtk_ml_value_userdata((void *) linkage_name));
+    if (gtk_ml_has_value(result)) {
+        return result.value.sobj;
+    }
+    return NULL;
+}
+
+void gtk_ml_index_exports(GtkMl_Program *program) {
+    for (size_t i = 0; i < program->n_text; i++) {
+        GtkMl_Instruction instr = program->text[i];
+        if (instr.category == GTKML_I_EXPORT) {
+            GtkMl_SObj addr = program->statics[program->data[instr.data].value.u64];
+            GtkMl_SObj linkage_name;
+            if (addr->kind == GTKML_S_PROGRAM) {
+                linkage_name = addr->value.s_program.linkage_name;
+            } else if (addr->kind == GTKML_S_ADDRESS) {
+                linkage_name = addr->value.s_address.linkage_name;
+            } else {
+                continue;
+            }
+            // the first export of a name wins, like it does when linking
+            char *name = gtk_ml_to_c_str(linkage_name);
+            if (gtk_ml_hash_table_contains(&program->exports, gtk_ml_value_userdata(name))) {
+                free(name);
+            } else {
+                gtk_ml_hash_table_insert(&program->exports, gtk_ml_value_userdata(name), gtk_ml_value_sobject(addr));
+            }
+        }
+    }
+}
+
+GTKML_PRIVATE void delete_export_name(GtkMl_Context *ctx, GtkMl_TaggedValue value) {
+    (void) ctx;
+    if (value.tag == GTKML_TAG_USERDATA) {
+        free(value.value.userdata);
+    }
+}
+
 void gtk_ml_del_program(GtkMl_Program* program) {
-    free((void *) program->start);
-    free(program->text);
-    free(program->data);
-    free(program->statics);
+    if (program->image) {
+        gtk_ml_unmap_image(program);
+    } else {
+        free((void *) program->start);
+        free(program->text);
+        free(program->data);
+        free(program->statics);
+    }
+    free(program->pinned);
+    gtk_ml_del_hash_table(NULL, &program->exports, delete_export_name);
     free(program);
 }
 
@@ -424,6 +654,14 @@ GTKML_PRIVATE GtkMl_VisitResult array_to_c_str(GtkMl_Array *array, size_t idx, G
 
 char *gtk_ml_to_c_str(GtkMl_SObj string) {
     GtkMl_Array *array = &string->value.s_array.array;
+    if (gtk_ml_array_trie_is_string(array)) {
+        size_t len = gtk_ml_string_bytes(array);
+        char *c_str = malloc(len + 1);
+        gtk_ml_string_write(array, c_str);
+        c_str[len] = 0;
+        return c_str;
+    }
+
     size_t len = gtk_ml_array_trie_len(array);
     char *c_str = malloc(len + 1);
     gtk_ml_array_trie_foreach(array, array_to_c_str, gtk_ml_value_userdata(c_str));
@@ -464,59 +702,332 @@ GtkMl_SObj gtk_ml_loads(GtkMl_Context *ctx, GtkMl_SObj *err, const char *src) {
     }
     GtkMl_Token *_tokenv = tokenv;
 
-    GtkMl_SObj body = gtk_ml_new_nil(ctx, NULL);
-    GtkMl_SObj *last = &body;
+    size_t len = 0;
+    size_t cap = 64;
+    GtkMl_SObj *lines = malloc(sizeof(GtkMl_SObj) * cap);
 
     while (tokenc) {
         GtkMl_SObj line = gtk_ml_parse(ctx, err, &_tokenv, &tokenc);
         if (!line) {
+            free(lines);
             return NULL;
         }
-        GtkMl_SObj new = gtk_ml_new_list(ctx, NULL, line, *last);
-        *last = new;
-        last = &gtk_ml_cdr(new);
+        if (len == cap) {
+            cap *= 2;
+            lines = realloc(lines, sizeof(GtkMl_SObj) * cap);
+        }
+        lines[len++] = line;
     }
 
+    // cells can't be changed once made, so the body is made back to front
+    GtkMl_SObj body = gtk_ml_new_nil(ctx, NULL);
+    while (len) {
+        body = gtk_ml_new_list(ctx, NULL, lines[--len], body);
+    }
+    free(lines);
+
     GtkMl_SObj result = gtk_ml_new_lambda(ctx, NULL, gtk_ml_new_nil(ctx, NULL), body, gtk_ml_new_nil(ctx, NULL));
 
     free(tokenv);
     return result;
 }
 
-GTKML_PRIVATE void jenkins_start(GtkMl_Hash *hash) {
-    *hash = 0;
+GtkMl_Program *gtk_ml_load_cached(GtkMl_Context *ctx, char **src, GtkMl_SObj *err, const char *file, const char *cache_dir) {
+    *src = NULL;
+
+    FILE *stream = fopen(file, "r");
+    if (!stream) {
+        *err = gtk_ml_error(ctx, "io-error", GTKML_ERR_IO_ERROR, 0, 0, 0, 0);
+        return NULL;
+    }
+    fseek(stream, 0l, SEEK_END);
+    size_t size = ftell(stream);
+    fseek(stream, 0l, SEEK_SET);
+    *src = malloc(size + 1);
+    size_t read = fread(*src, 1, size, stream);
+    fclose(stream);
+    if (read != size) {
+        *err = gtk_ml_error(ctx, "io-error", GTKML_ERR_IO_ERROR, 0, 0, 0, 0);
+        return NULL;
+    }
+    (*src)[size] = 0;
+
+    char *path = NULL;
+    if (cache_dir) {
+        path = cache_path(cache_dir, *src, size);
+        GtkMl_SObj map_err = NULL;
+        GtkMl_Program *program = gtk_ml_map_image(ctx, &map_err, path);
+        if (program) {
+            free(path);
+            return program;
+        }
+        // an entry that is missing or can't be read is compiled again and replaced
+    }
+
+    GtkMl_SObj lambda = gtk_ml_loads(ctx, err, *src);
+    if (!lambda) {
+        free(path);
+        return NULL;
+    }
+
+    gtk_ml_push(ctx, gtk_ml_value_sobject(lambda));
+
+    GtkMl_Builder *builder = gtk_ml_new_builder(ctx);
+    if (!gtk_ml_compile_program(ctx, builder, err, lambda)) {
+        free(path);
+        return NULL;
+    }
+
+    GtkMl_Program *program = gtk_ml_build(ctx, err, builder);
+    if (!program) {
+        free(path);
+        return NULL;
+    }
+
+    if (path) {
+        cache_program(ctx, path, program);
+        free(path);
+    }
+
+    return program;
+}
+
+// the source, the library version and the shape of the bytecode all go into the key
+char *cache_path(const char *cache_dir, const char *src, size_t len) {
+    GtkMl_Hash hash;
+    hash_start(&hash);
+    hash_bytes(&hash, GTKML_VERSION, strlen(GTKML_VERSION));
+    hash_word(&hash, GTKML_BYTECODE_VERSION);
+    hash_word(&hash, sizeof(GtkMl_Instruction));
+    hash_word(&hash, sizeof(GtkMl_TaggedValue));
+    hash_bytes(&hash, src, len);
+    hash_finish(&hash);
+
+    size_t size = strlen(cache_dir) + strlen("/.bgtkml") + 17;
+    char *path = malloc(size);
+    snprintf(path, size, "%s/%016"GTKML_FMT_64"x.bgtkml", cache_dir, hash);
+    return path;
 }
 
-GTKML_PRIVATE void jenkins_update(GtkMl_Hash *hash, const void *_ptr, size_t len) {
-    GtkMl_Hash h = *hash;
+// writes to a temporary file first, so nobody ever reads a half written entry
+#define GTKML_CACHE_TMP_TRIES 16
+
+// opens a file next to `path` that no one else is writing, its name is left in `tmp`
+FILE *cache_tmp(char *tmp, size_t size, const char *path) {
+#ifdef GTKML_ENABLE_POSIX
+    snprintf(tmp, size, "%s.XXXXXX", path);
+    int fd = mkstemp(tmp);
+    if (fd == -1) {
+        return NULL;
+    }
+    // mkstemp only lets the owner read it, but an entry is read by whoever shares the cache
+    FILE *stream = NULL;
+    if (fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) != 0 || !(stream = fdopen(fd, "wb"))) {
+        close(fd);
+        remove(tmp);
+    }
+    return stream;
+#else
+    // without mkstemp a few made up names are tried, a file that is already there is someone else's
+    GtkMl_Hash seed = (GtkMl_Hash) time(NULL) ^ (GtkMl_Hash) clock() ^ (GtkMl_Hash) (uintptr_t) tmp;
+    for (uint64_t i = 0; i < GTKML_CACHE_TMP_TRIES; i++) {
+        hash_word(&seed, i);
+        snprintf(tmp, size, "%s.%06x", path, (unsigned int) (seed & 0xffffff));
+        FILE *stream = fopen(tmp, "wbx");
+        if (stream) {
+            return stream;
+        }
+    }
+    return NULL;
+#endif /* GTKML_ENABLE_POSIX */
+}
+
+void cache_program(GtkMl_Context *ctx, const char *path, GtkMl_Program *program) {
+    size_t size = strlen(path) + strlen(".XXXXXX") + 1;
+    char *tmp = malloc(size);
+
+    // every writer gets its own file, so one that died halfway doesn't get in the way of the next
+    FILE *stream = cache_tmp(tmp, size, path);
+    if (!stream) {
+        free(tmp);
+        return;
+    }
+
+    // programs that can't be written as an image, like those holding userdata, are just not cached
+    GtkMl_SObj err = NULL;
+    gboolean written = gtk_ml_serf_image(ctx, stream, &err, program);
+    written = fclose(stream) == 0 && written;
+
+    if (!written || rename(tmp, path) != 0) {
+        remove(tmp);
+    }
+    free(tmp);
+}
+
+// 64 bits at a time, with the rounds and the avalanche of xxh64
+#define GTKML_H_PRIME1 0x9E3779B185EBCA87ull
+#define GTKML_H_PRIME2 0xC2B2AE3D27D4EB4Full
+#define GTKML_H_PRIME3 0x165667B19E3779F9ull
+#define GTKML_H_PRIME4 0x85EBCA77C2B2AE63ull
+
+GTKML_PRIVATE uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+GTKML_PRIVATE void hash_start(GtkMl_Hash *hash) {
+    *hash = GTKML_H_PRIME3;
+}
+
+GTKML_PRIVATE void hash_word(GtkMl_Hash *hash, uint64_t word) {
+    uint64_t k = rotl64(word * GTKML_H_PRIME2, 31) * GTKML_H_PRIME1;
+    *hash = rotl64(*hash ^ k, 27) * GTKML_H_PRIME1 + GTKML_H_PRIME4;
+}
+
+// the length goes in last, so trailing zeroes still change the hash
+GTKML_PRIVATE void hash_bytes(GtkMl_Hash *hash, const void *_ptr, size_t len) {
     const char *ptr = _ptr;
-    for (size_t i = 0; i < len; i++) {
-        h += ptr[i];
-        h += h << 10;
-        h ^= h >> 6;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, ptr + i, sizeof(uint64_t));
+        hash_word(hash, word);
     }
-    *hash = h;
+    if (i < len) {
+        uint64_t word = 0;
+        memcpy(&word, ptr + i, len - i);
+        hash_word(hash, word);
+    }
+    hash_word(hash, len);
 }
 
-GTKML_PRIVATE void jenkins_finish(GtkMl_Hash *hash) {
+GTKML_PRIVATE void hash_finish(GtkMl_Hash *hash) {
     GtkMl_Hash h = *hash;
-    h += h << 3;
-    h ^= h >> 11;
-    h += h << 15;
+    h ^= h >> 33;
+    h *= GTKML_H_PRIME2;
+    h ^= h >> 29;
+    h *= GTKML_H_PRIME3;
+    h ^= h >> 32;
     *hash = h;
 }
 
+// keywords have the same layout as symbols, the intern table reads both through `s_symbol`
+GTKML_PRIVATE size_t intern_home(GtkMl_Gc *gc, GtkMl_SKind kind, GtkMl_Hash hash) {
+    return (hash + kind) & (gc->interned_cap - 1);
+}
+
+GTKML_PRIVATE void intern_insert(GtkMl_Gc *gc, GtkMl_SObj s) {
+    size_t mask = gc->interned_cap - 1;
+    size_t i = intern_home(gc, s->kind, s->value.s_symbol.hash);
+    while (gc->interned[i]) {
+        i = (i + 1) & mask;
+    }
+    gc->interned[i] = s;
+}
+
+GtkMl_SObj gtk_ml_intern(GtkMl_Context *ctx, GtkMl_SKind kind, gboolean owned, const char *ptr, size_t len) {
+    GtkMl_Gc *gc = ctx->gc;
+
+    GtkMl_Hash hash;
+    hash_start(&hash);
+    hash_bytes(&hash, ptr, len);
+    hash_finish(&hash);
+
+    size_t mask = gc->interned_cap - 1;
+    for (size_t i = intern_home(gc, kind, hash); gc->interned[i]; i = (i + 1) & mask) {
+        GtkMl_SObj s = gc->interned[i];
+        if (s->kind == kind
+                && s->value.s_symbol.hash == hash
+                && s->value.s_symbol.len == len
+                && memcmp(s->value.s_symbol.ptr, ptr, len) == 0) {
+            if (owned) {
+                free((void *) ptr);
+            }
+            // the sweep has already decided about everything else, an unswept page would free this
+            if (gc->sweeping && slab_of(s)->unswept) {
+                s->flags |= GTKML_FLAG_REACHABLE;
+            }
+            return s;
+        }
+    }
+
+    if (!owned) {
+        char *copy = malloc(len);
+        memcpy(copy, ptr, len);
+        ptr = copy;
+    }
+
+    GtkMl_SObj s = gtk_ml_new_sobject(ctx, NULL, kind);
+    s->value.s_symbol.owned = 1;
+    s->value.s_symbol.ptr = ptr;
+    s->value.s_symbol.len = len;
+    s->value.s_symbol.hash = hash;
+    s->value.s_symbol.interned = s;
+
+    if (4 * (gc->interned_len + 1) > 3 * gc->interned_cap) {
+        GtkMl_SObj *old = gc->interned;
+        size_t old_cap = gc->interned_cap;
+        gc->interned_cap *= 2;
+        gc->interned = calloc(gc->interned_cap, sizeof(GtkMl_SObj));
+        for (size_t i = 0; i < old_cap; i++) {
+            if (old[i]) {
+                intern_insert(gc, old[i]);
+            }
+        }
+        free(old);
+    }
+    intern_insert(gc, s);
+    ++gc->interned_len;
+
+    return s;
+}
+
+// removes a freed symbol or keyword, the rest of its cluster is shifted back into the hole
+GTKML_PRIVATE void unintern(GtkMl_Gc *gc, GtkMl_SObj s) {
+    if (!gc->interned) {
+        return;
+    }
+
+    size_t mask = gc->interned_cap - 1;
+    size_t i = intern_home(gc, s->kind, s->value.s_symbol.hash);
+    while (gc->interned[i] != s) {
+        if (!gc->interned[i]) {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+
+    for (size_t j = (i + 1) & mask; gc->interned[j]; j = (j + 1) & mask) {
+        GtkMl_SObj next = gc->interned[j];
+        size_t home = intern_home(gc, next->kind, next->value.s_symbol.hash);
+        // `next` may only move back if the hole lies between its home and its slot
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            gc->interned[i] = next;
+            i = j;
+        }
+    }
+    gc->interned[i] = NULL;
+    --gc->interned_len;
+}
+
 struct HashData {
-    GtkMl_Hash *hash;
-    gboolean (*hasher)(GtkMl_Hash *hash, GtkMl_TaggedValue value);
+    GtkMl_Hash sum;
+    gboolean ok;
+    gboolean mutable;
 };
 
+// maps and sets add up the hashes of their entries, so the order the trie keeps them in doesn't matter
 GTKML_PRIVATE GtkMl_VisitResult hash_trie_update(GtkMl_HashTrie *ht, GtkMl_TaggedValue key, GtkMl_TaggedValue value, GtkMl_TaggedValue _data) {
     (void) ht;
 
     struct HashData *data = _data.value.userdata;
-    data->hasher(data->hash, key);
-    data->hasher(data->hash, value);
+    GtkMl_Hash hash;
+    hash_start(&hash);
+    if (!hash_update(&hash, key, &data->mutable) || !hash_update(&hash, value, &data->mutable)) {
+        data->ok = 0;
+        return GTKML_VISIT_BREAK;
+    }
+    hash_finish(&hash);
+    data->sum += hash;
 
     return GTKML_VISIT_RECURSE;
 }
@@ -525,7 +1036,14 @@ GTKML_PRIVATE GtkMl_VisitResult hash_set_update(GtkMl_HashSet *hs, GtkMl_TaggedV
     (void) hs;
 
     struct HashData *data = _data.value.userdata;
-    data->hasher(data->hash, value);
+    GtkMl_Hash hash;
+    hash_start(&hash);
+    if (!hash_update(&hash, value, &data->mutable)) {
+        data->ok = 0;
+        return GTKML_VISIT_BREAK;
+    }
+    hash_finish(&hash);
+    data->sum += hash;
 
     return GTKML_VISIT_RECURSE;
 }
@@ -535,109 +1053,260 @@ GTKML_PRIVATE GtkMl_VisitResult array_update(GtkMl_Array *array, size_t index, G
     (void) index;
 
     struct HashData *data = _data.value.userdata;
-    data->hasher(data->hash, value);
+    if (!hash_update(&data->sum, value, &data->mutable)) {
+        data->ok = 0;
+        return GTKML_VISIT_BREAK;
+    }
+
+    return GTKML_VISIT_RECURSE;
+}
+
+// ropes split the same string in different places, so bytes are gathered into whole words first
+struct StringHashData {
+    GtkMl_Hash hash;
+    uint64_t word;
+    size_t fill;
+    size_t len;
+};
+
+GTKML_PRIVATE GtkMl_VisitResult string_update(GtkMl_Array *array, const char *ptr, size_t len, GtkMl_TaggedValue _data) {
+    (void) array;
+
+    struct StringHashData *data = _data.value.userdata;
+    data->len += len;
+
+    size_t i = 0;
+    if (data->fill) {
+        size_t n = sizeof(uint64_t) - data->fill;
+        n = n < len? n : len;
+        memcpy((char *) &data->word + data->fill, ptr, n);
+        data->fill += n;
+        i = n;
+        if (data->fill < sizeof(uint64_t)) {
+            return GTKML_VISIT_RECURSE;
+        }
+        hash_word(&data->hash, data->word);
+        data->fill = 0;
+    }
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, ptr + i, sizeof(uint64_t));
+        hash_word(&data->hash, word);
+    }
+    if (i < len) {
+        data->word = 0;
+        memcpy(&data->word, ptr + i, len - i);
+        data->fill = len - i;
+    }
 
     return GTKML_VISIT_RECURSE;
 }
 
+// 0 means not hashed yet
+#define GTKML_CACHED_HASH(h) ((h)? (h) : 1)
+
+// `*mutable` is set if the contents reach a var, `assign` changes those without clearing the cache, so they are never cached
+GTKML_PRIVATE gboolean hash_container(GtkMl_SObj value, GtkMl_Hash *out, gboolean *mutable) {
+    struct HashData data = { 0, 1, 0 };
+
+    switch (value->kind) {
+    case GTKML_S_MAP: {
+        GtkMl_HashTrie *map = &value->value.s_map.map;
+        if (!map->hash) {
+            gtk_ml_hash_trie_foreach(map, hash_trie_update, gtk_ml_value_userdata(&data));
+            if (!data.ok) {
+                return 0;
+            }
+            hash_word(&data.sum, map->len);
+            hash_finish(&data.sum);
+            if (data.mutable) {
+                *mutable = 1;
+                *out = data.sum;
+                break;
+            }
+            map->hash = GTKML_CACHED_HASH(data.sum);
+        }
+        *out = map->hash;
+    } break;
+    case GTKML_S_SET: {
+        GtkMl_HashSet *set = &value->value.s_set.set;
+        if (!set->hash) {
+            gtk_ml_hash_set_foreach(set, hash_set_update, gtk_ml_value_userdata(&data));
+            if (!data.ok) {
+                return 0;
+            }
+            hash_word(&data.sum, set->len);
+            hash_finish(&data.sum);
+            if (data.mutable) {
+                *mutable = 1;
+                *out = data.sum;
+                break;
+            }
+            set->hash = GTKML_CACHED_HASH(data.sum);
+        }
+        *out = set->hash;
+    } break;
+    case GTKML_S_ARRAY: {
+        GtkMl_Array *array = &value->value.s_array.array;
+        if (!array->hash && gtk_ml_array_trie_is_string(array)) {
+            struct StringHashData string = { 0, 0, 0, 0 };
+            hash_start(&string.hash);
+            gtk_ml_string_foreach_chunk(array, string_update, gtk_ml_value_userdata(&string));
+            if (string.fill) {
+                hash_word(&string.hash, string.word);
+            }
+            hash_word(&string.hash, string.len);
+            hash_finish(&string.hash);
+            array->hash = GTKML_CACHED_HASH(string.hash);
+        } else if (!array->hash) {
+            hash_start(&data.sum);
+            gtk_ml_array_trie_foreach(array, array_update, gtk_ml_value_userdata(&data));
+            if (!data.ok) {
+                return 0;
+            }
+            hash_finish(&data.sum);
+            if (data.mutable) {
+                *mutable = 1;
+                *out = data.sum;
+                break;
+            }
+            array->hash = GTKML_CACHED_HASH(data.sum);
+        }
+        *out = array->hash;
+    } break;
+    default:
+        return 0;
+    }
+
+    return 1;
+}
+
+// primitives hash like the s-objects they are equal to
+GTKML_PRIVATE gboolean prim_hash_update(GtkMl_Hash *hash, GtkMl_TaggedValue value) {
+    switch (value.tag) {
+    case GTKML_TAG_NIL:
+        hash_word(hash, GTKML_S_NIL);
+        break;
+    case GTKML_TAG_BOOL:
+        hash_word(hash, value.value.boolean? GTKML_S_TRUE : GTKML_S_FALSE);
+        break;
+    case GTKML_TAG_CHAR:
+        hash_word(hash, GTKML_S_CHAR);
+        hash_word(hash, value.value.unicode);
+        break;
+    case GTKML_TAG_INT:
+    case GTKML_TAG_INT64:
+    case GTKML_TAG_UINT64:
+        hash_word(hash, GTKML_S_INT);
+        hash_word(hash, value.value.u64);
+        break;
+    case GTKML_TAG_USERDATA:
+        hash_word(hash, GTKML_S_LIGHTDATA);
+        hash_word(hash, (uintptr_t) value.value.userdata);
+        break;
+    default:
+        return 0;
+    }
+    return 1;
+}
+
 void default_hash_start(GtkMl_Hash *hash) {
-    jenkins_start(hash);
+    hash_start(hash);
 }
 
-gboolean default_hash_update(GtkMl_Hash *hash, GtkMl_TaggedValue ptr) {
+gboolean hash_update(GtkMl_Hash *hash, GtkMl_TaggedValue ptr, gboolean *mutable) {
+    if (gtk_ml_is_primitive(ptr)) {
+        return prim_hash_update(hash, ptr);
+    }
+
     GtkMl_SObj value = ptr.value.sobj;
 
-    jenkins_update(hash, &value->kind, sizeof(GtkMl_SKind));
+    hash_word(hash, value->kind);
     switch (value->kind) {
     case GTKML_S_NIL:
     case GTKML_S_FALSE:
     case GTKML_S_TRUE:
         break;
     case GTKML_S_INT:
-        jenkins_update(hash, &value->value.s_int.value, sizeof(int64_t));
+        hash_word(hash, value->value.s_int.value);
         break;
     case GTKML_S_FLOAT:
         return 0;
     case GTKML_S_CHAR:
-        jenkins_update(hash, &value->value.s_char.value, sizeof(uint32_t));
+        hash_word(hash, value->value.s_char.value);
         break;
     case GTKML_S_SYMBOL:
-        jenkins_update(hash, value->value.s_symbol.ptr, value->value.s_symbol.len);
+        hash_word(hash, value->value.s_symbol.hash);
         break;
     case GTKML_S_KEYWORD:
-        jenkins_update(hash, value->value.s_keyword.ptr, value->value.s_keyword.len);
+        hash_word(hash, value->value.s_keyword.hash);
         break;
     case GTKML_S_LIST:
         do {
-            default_hash_update(hash, gtk_ml_value_sobject(gtk_ml_car(value)));
+            if (!hash_update(hash, gtk_ml_value_sobject(gtk_ml_car(value)), mutable)) {
+                return 0;
+            }
             value = gtk_ml_cdr(value);
         } while (value->kind != GTKML_S_NIL);
         break;
-    case GTKML_S_MAP: {
-        struct HashData data = { hash, default_hash_update };
-        gtk_ml_hash_trie_foreach(&value->value.s_map.map, hash_trie_update, gtk_ml_value_userdata(&data));
-    } break;
-    case GTKML_S_SET: {
-        struct HashData data = { hash, default_hash_update };
-        gtk_ml_hash_set_foreach(&value->value.s_set.set, hash_set_update, gtk_ml_value_userdata(&data));
-    } break;
+    case GTKML_S_MAP:
+    case GTKML_S_SET:
     case GTKML_S_ARRAY: {
-        struct HashData data;
-        if (gtk_ml_array_trie_is_string(&value->value.s_array.array)) {
-            data = (struct HashData) { hash, value_hash_update };
-        } else {
-            data = (struct HashData) { hash, default_hash_update };
+        GtkMl_Hash contents;
+        if (!hash_container(value, &contents, mutable)) {
+            return 0;
         }
-        gtk_ml_array_trie_foreach(&value->value.s_array.array, array_update, gtk_ml_value_userdata(&data));
+        hash_word(hash, contents);
     } break;
     case GTKML_S_VAR:
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_var.expr));
-        break;
+        *mutable = 1;
+        return hash_update(hash, gtk_ml_value_sobject(value->value.s_var.expr), mutable);
     case GTKML_S_VARARG:
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_vararg.expr));
-        break;
+        return hash_update(hash, gtk_ml_value_sobject(value->value.s_vararg.expr), mutable);
     case GTKML_S_QUOTE:
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_quote.expr));
-        break;
+        return hash_update(hash, gtk_ml_value_sobject(value->value.s_quote.expr), mutable);
     case GTKML_S_QUASIQUOTE:
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_quasiquote.expr));
-        break;
+        return hash_update(hash, gtk_ml_value_sobject(value->value.s_quasiquote.expr), mutable);
     case GTKML_S_UNQUOTE:
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_unquote.expr));
-        break;
+        return hash_update(hash, gtk_ml_value_sobject(value->value.s_unquote.expr), mutable);
     case GTKML_S_LAMBDA:
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_lambda.args));
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_lambda.body));
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_lambda.capture));
-        break;
+        return hash_update(hash, gtk_ml_value_sobject(value->value.s_lambda.args), mutable)
+            && hash_update(hash, gtk_ml_value_sobject(value->value.s_lambda.body), mutable)
+            && hash_update(hash, gtk_ml_value_sobject(value->value.s_lambda.capture), mutable);
     case GTKML_S_PROGRAM:
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_program.linkage_name));
-        jenkins_update(hash, &value->value.s_program.addr, sizeof(uint64_t));
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_program.args));
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_program.body));
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_program.capture));
-        break;
+        hash_word(hash, value->value.s_program.addr);
+        return hash_update(hash, gtk_ml_value_sobject(value->value.s_program.linkage_name), mutable)
+            && hash_update(hash, gtk_ml_value_sobject(value->value.s_program.args), mutable)
+            && hash_update(hash, gtk_ml_value_sobject(value->value.s_program.body), mutable)
+            && hash_update(hash, gtk_ml_value_sobject(value->value.s_program.capture), mutable);
     case GTKML_S_ADDRESS:
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_address.linkage_name));
-        jenkins_update(hash, &value->value.s_address.addr, sizeof(uint64_t));
-        break;
+        hash_word(hash, value->value.s_address.addr);
+        return hash_update(hash, gtk_ml_value_sobject(value->value.s_address.linkage_name), mutable);
     case GTKML_S_MACRO:
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_macro.args));
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_macro.body));
-        default_hash_update(hash, gtk_ml_value_sobject(value->value.s_macro.capture));
-        break;
+        return hash_update(hash, gtk_ml_value_sobject(value->value.s_macro.args), mutable)
+            && hash_update(hash, gtk_ml_value_sobject(value->value.s_macro.body), mutable)
+            && hash_update(hash, gtk_ml_value_sobject(value->value.s_macro.capture), mutable);
     case GTKML_S_LIGHTDATA:
-        jenkins_update(hash, &value->value.s_lightdata.userdata, sizeof(void *));
+        hash_word(hash, (uintptr_t) value->value.s_lightdata.userdata);
         break;
     case GTKML_S_USERDATA:
-        jenkins_update(hash, &value->value.s_userdata.userdata, sizeof(void *));
+        hash_word(hash, (uintptr_t) value->value.s_userdata.userdata);
+        break;
+    case GTKML_S_TABLE:
+        // tables change in place, so they are only ever equal to themselves
+        hash_word(hash, (uintptr_t) value);
         break;
     }
     return 1;
 }
 
+gboolean default_hash_update(GtkMl_Hash *hash, GtkMl_TaggedValue ptr) {
+    gboolean mutable = 0;
+    return hash_update(hash, ptr, &mutable);
+}
+
 void default_hash_finish(GtkMl_Hash *hash) {
-    jenkins_finish(hash);
+    hash_finish(hash);
 }
 
 gboolean default_equal(GtkMl_TaggedValue lhs, GtkMl_TaggedValue rhs) {
@@ -645,24 +1314,38 @@ gboolean default_equal(GtkMl_TaggedValue lhs, GtkMl_TaggedValue rhs) {
 }
 
 void value_hash_start(GtkMl_Hash *hash) {
-    jenkins_start(hash);
+    hash_start(hash);
 }
 
 gboolean value_hash_update(GtkMl_Hash *hash, GtkMl_TaggedValue value) {
-    jenkins_update(hash, &value, sizeof(value));
+    hash_word(hash, value.tag);
+    hash_word(hash, value.value.u64);
     return 1;
 }
 
 void value_hash_finish(GtkMl_Hash *hash) {
-    jenkins_finish(hash);
+    hash_finish(hash);
 }
 
 gboolean value_equal(GtkMl_TaggedValue lhs, GtkMl_TaggedValue rhs) {
     return gtk_ml_equal_value(lhs, rhs);
 }
 
+gboolean bits_equal(GtkMl_TaggedValue lhs, GtkMl_TaggedValue rhs) {
+    return lhs.tag == rhs.tag && lhs.value.u64 == rhs.value.u64;
+}
+
+gboolean c_str_hash_update(GtkMl_Hash *hash, GtkMl_TaggedValue str) {
+    hash_bytes(hash, str.value.userdata, strlen(str.value.userdata));
+    return 1;
+}
+
+gboolean c_str_equal(GtkMl_TaggedValue lhs, GtkMl_TaggedValue rhs) {
+    return strcmp(lhs.value.userdata, rhs.value.userdata) == 0;
+}
+
 void ptr_hash_start(GtkMl_Hash *hash) {
-    jenkins_start(hash);
+    hash_start(hash);
 }
 
 gboolean ptr_hash_update(GtkMl_Hash *hash, GtkMl_TaggedValue ptr) {
@@ -671,24 +1354,22 @@ gboolean ptr_hash_update(GtkMl_Hash *hash, GtkMl_TaggedValue ptr) {
 }
 
 void ptr_hash_finish(GtkMl_Hash *hash) {
-    jenkins_finish(hash);
+    hash_finish(hash);
 }
 
 gboolean ptr_equal(GtkMl_TaggedValue lhs, GtkMl_TaggedValue rhs) {
     return lhs.value.u64 == rhs.value.u64;
 }
 
-GTKML_PRIVATE void mark_sobject(GtkMl_SObj s);
-
 GTKML_PRIVATE GtkMl_VisitResult mark_hash_trie(GtkMl_HashTrie *ht, GtkMl_TaggedValue key, GtkMl_TaggedValue value, GtkMl_TaggedValue data) {
     (void) ht;
-    (void) data;
+    GtkMl_Gc *gc = data.value.userdata;
 
     if (gtk_ml_is_sobject(key)) {
-        mark_sobject(key.value.sobj);
+        mark_sobject(gc, key.value.sobj);
     }
     if (gtk_ml_is_sobject(value)) {
-        mark_sobject(value.value.sobj);
+        mark_sobject(gc, value.value.sobj);
     }
 
     return GTKML_VISIT_RECURSE;
@@ -696,34 +1377,42 @@ GTKML_PRIVATE GtkMl_VisitResult mark_hash_trie(GtkMl_HashTrie *ht, GtkMl_TaggedV
 
 GTKML_PRIVATE GtkMl_VisitResult mark_hash_set(GtkMl_HashSet *hs, GtkMl_TaggedValue key, GtkMl_TaggedValue data) {
     (void) hs;
-    (void) data;
+    GtkMl_Gc *gc = data.value.userdata;
 
     if (gtk_ml_is_sobject(key)) {
-        mark_sobject(key.value.sobj);
+        mark_sobject(gc, key.value.sobj);
     }
 
     return GTKML_VISIT_RECURSE;
 }
 
-GTKML_PRIVATE GtkMl_VisitResult mark_array(GtkMl_Array *array, size_t idx, GtkMl_TaggedValue value, GtkMl_TaggedValue data) {
-    (void) array;
-    (void) idx;
-    (void) data;
+GTKML_PRIVATE GtkMl_VisitResult mark_hash_table(GtkMl_HashTable *table, GtkMl_TaggedValue key, GtkMl_TaggedValue value, GtkMl_TaggedValue data) {
+    (void) table;
+    GtkMl_Gc *gc = data.value.userdata;
 
+    if (gtk_ml_is_sobject(key)) {
+        mark_sobject(gc, key.value.sobj);
+    }
     if (gtk_ml_is_sobject(value)) {
-        mark_sobject(value.value.sobj);
+        mark_sobject(gc, value.value.sobj);
     }
 
     return GTKML_VISIT_RECURSE;
 }
 
-GTKML_PRIVATE void mark_sobject(GtkMl_SObj s) {
-    if (s->flags & GTKML_FLAG_REACHABLE) {
-        return;
+GTKML_PRIVATE GtkMl_VisitResult mark_array(GtkMl_Array *array, size_t idx, GtkMl_TaggedValue value, GtkMl_TaggedValue data) {
+    (void) array;
+    (void) idx;
+    GtkMl_Gc *gc = data.value.userdata;
+
+    if (gtk_ml_is_sobject(value)) {
+        mark_sobject(gc, value.value.sobj);
     }
 
-    s->flags |= GTKML_FLAG_REACHABLE;
+    return GTKML_VISIT_RECURSE;
+}
 
+GTKML_PRIVATE void mark_fields(GtkMl_Gc *gc, GtkMl_SObj s) {
     switch (s->kind) {
     case GTKML_S_NIL:
     case GTKML_S_TRUE:
@@ -731,101 +1420,162 @@ GTKML_PRIVATE void mark_sobject(GtkMl_SObj s) {
     case GTKML_S_INT:
     case GTKML_S_FLOAT:
     case GTKML_S_CHAR:
+    case GTKML_S_LIGHTDATA:
+        break;
     case GTKML_S_KEYWORD:
+        if (s->value.s_keyword.interned != s) {
+            mark_sobject(gc, s->value.s_keyword.interned);
+        }
+        break;
     case GTKML_S_SYMBOL:
-    case GTKML_S_LIGHTDATA:
+        if (s->value.s_symbol.interned != s) {
+            mark_sobject(gc, s->value.s_symbol.interned);
+        }
         break;
     case GTKML_S_USERDATA:
-        mark_sobject(s->value.s_userdata.keep);
+        mark_sobject(gc, s->value.s_userdata.keep);
         break;
     case GTKML_S_LIST:
-        mark_sobject(gtk_ml_car(s));
-        mark_sobject(gtk_ml_cdr(s));
+        mark_sobject(gc, gtk_ml_car(s));
+        mark_sobject(gc, gtk_ml_cdr(s));
         break;
     case GTKML_S_MAP:
-        gtk_ml_hash_trie_foreach(&s->value.s_map.map, mark_hash_trie, gtk_ml_value_none());
+        gtk_ml_hash_trie_foreach(&s->value.s_map.map, mark_hash_trie, gtk_ml_value_userdata(gc));
         if (s->value.s_map.metamap) {
-            mark_sobject(s->value.s_map.metamap);
+            mark_sobject(gc, s->value.s_map.metamap);
         }
         break;
     case GTKML_S_SET:
-        gtk_ml_hash_set_foreach(&s->value.s_set.set, mark_hash_set, gtk_ml_value_none());
+        gtk_ml_hash_set_foreach(&s->value.s_set.set, mark_hash_set, gtk_ml_value_userdata(gc));
         break;
     case GTKML_S_ARRAY:
         if (!gtk_ml_array_trie_is_string(&s->value.s_array.array)) {
-            gtk_ml_array_trie_foreach(&s->value.s_array.array, mark_array, gtk_ml_value_none());
+            gtk_ml_array_trie_foreach(&s->value.s_array.array, mark_array, gtk_ml_value_userdata(gc));
         }
         break;
+    case GTKML_S_TABLE:
+        gtk_ml_hash_table_foreach(&s->value.s_table.table, mark_hash_table, gtk_ml_value_userdata(gc));
+        break;
     case GTKML_S_VAR:
-        mark_sobject(s->value.s_var.expr);
+        mark_sobject(gc, s->value.s_var.expr);
         break;
     case GTKML_S_VARARG:
-        mark_sobject(s->value.s_vararg.expr);
+        mark_sobject(gc, s->value.s_vararg.expr);
         break;
     case GTKML_S_QUOTE:
-        mark_sobject(s->value.s_quote.expr);
+        mark_sobject(gc, s->value.s_quote.expr);
         break;
     case GTKML_S_QUASIQUOTE:
-        mark_sobject(s->value.s_quasiquote.expr);
+        mark_sobject(gc, s->value.s_quasiquote.expr);
         break;
     case GTKML_S_UNQUOTE:
-        mark_sobject(s->value.s_unquote.expr);
+        mark_sobject(gc, s->value.s_unquote.expr);
         break;
     case GTKML_S_ADDRESS:
-        mark_sobject(s->value.s_address.linkage_name);
+        mark_sobject(gc, s->value.s_address.linkage_name);
         break;
     case GTKML_S_PROGRAM:
-        mark_sobject(s->value.s_program.linkage_name);
-        mark_sobject(s->value.s_program.args);
-        mark_sobject(s->value.s_program.body);
-        mark_sobject(s->value.s_program.capture);
+        mark_sobject(gc, s->value.s_program.linkage_name);
+        mark_sobject(gc, s->value.s_program.args);
+        mark_sobject(gc, s->value.s_program.body);
+        mark_sobject(gc, s->value.s_program.capture);
         break;
     case GTKML_S_LAMBDA:
-        mark_sobject(s->value.s_lambda.args);
-        mark_sobject(s->value.s_lambda.body);
-        mark_sobject(s->value.s_lambda.capture);
+        mark_sobject(gc, s->value.s_lambda.args);
+        mark_sobject(gc, s->value.s_lambda.body);
+        mark_sobject(gc, s->value.s_lambda.capture);
         break;
     case GTKML_S_MACRO:
-        mark_sobject(s->value.s_macro.args);
-        mark_sobject(s->value.s_macro.body);
-        mark_sobject(s->value.s_macro.capture);
+        mark_sobject(gc, s->value.s_macro.args);
+        mark_sobject(gc, s->value.s_macro.body);
+        mark_sobject(gc, s->value.s_macro.capture);
         break;
     }
 }
 
-GTKML_PRIVATE void mark_program(GtkMl_Program *program) {
+// shades an object gray, it is scanned later by `propagate`
+// marking stops at objects with any of the `mark_stop` flags set
+// a full collection stops at reachable objects, a minor one also at old ones
+GTKML_PRIVATE void mark_sobject(GtkMl_Gc *gc, GtkMl_SObj s) {
+    if (s->flags & gc->mark_stop) {
+        return;
+    }
+
+    s->flags |= GTKML_FLAG_REACHABLE | GTKML_FLAG_GRAY;
+
+    if (gc->gray_len == gc->gray_cap) {
+        gc->gray_cap *= 2;
+        gc->gray = realloc(gc->gray, sizeof(GtkMl_SObj) * gc->gray_cap);
+    }
+    gc->gray[gc->gray_len++] = s;
+}
+
+// scans at most `budget` gray objects, returns whether none are left
+GTKML_PRIVATE gboolean propagate(GtkMl_Gc *gc, size_t budget) {
+    while (gc->gray_len && budget) {
+        GtkMl_SObj s = gc->gray[--gc->gray_len];
+        if (s->flags & GTKML_FLAG_FREE) {
+            continue;
+        }
+        s->flags &= ~GTKML_FLAG_GRAY;
+        mark_fields(gc, s);
+        --budget;
+    }
+    return !gc->gray_len;
+}
+
+GTKML_PRIVATE void mark_program(GtkMl_Gc *gc, GtkMl_Program *program) {
     for (GtkMl_Static i = 1; i < program->n_static; i++) {
-        mark_sobject(program->statics[i]);
+        mark_sobject(gc, program->statics[i]);
+    }
+    // cells of an image are never scanned, so whatever they point to on the heap is marked here
+    for (size_t i = 0; i < program->n_pinned; i++) {
+        mark_sobject(gc, program->pinned[i]);
     }
 }
 
-GTKML_PRIVATE void mark_builder(GtkMl_Builder *b) {
+GTKML_PRIVATE void mark_builder(GtkMl_Gc *gc, GtkMl_Builder *b) {
     for (GtkMl_Static i = 1; i < b->len_static; i++) {
-        mark_sobject(b->statics[i]);
+        mark_sobject(gc, b->statics[i]);
     }
-    mark_sobject(b->bindings);
+    mark_sobject(gc, b->bindings);
 }
 
-GTKML_PRIVATE void mark(GtkMl_Context *ctx) {
-    for (size_t sp = 0; sp < ctx->gc->stack_len; sp++) {
-        mark_sobject(ctx->gc->stack[sp]);
+GTKML_PRIVATE void mark_vm(GtkMl_Gc *gc, GtkMl_Vm *vm) {
+    for (size_t sp = 0; sp < vm->stack_len; sp++) {
+        if (gtk_ml_is_sobject(vm->stack[sp])) {
+            mark_sobject(gc, vm->stack[sp].value.sobj);
+        }
+    }
+    for (size_t sp = 0; sp < vm->local_len; sp++) {
+        if (gtk_ml_is_sobject(vm->local[sp])) {
+            mark_sobject(gc, vm->local[sp].value.sobj);
+        }
     }
-    for (size_t sp = 0; sp < ctx->gc->local_len; sp++) {
-        mark_sobject(ctx->gc->local[sp]);
+}
+
+GTKML_PRIVATE void mark(GtkMl_Gc *gc) {
+    for (size_t i = 0; i < gc->vm_len; i++) {
+        mark_vm(gc, gc->vms[i]);
     }
-    if (ctx->gc->static_stack) {
-        mark_sobject(ctx->gc->static_stack);
+    if (gc->static_stack) {
+        mark_sobject(gc, gc->static_stack);
     }
-    for (size_t i = 0; i < ctx->gc->program_len; i++) {
-        mark_program(ctx->gc->programs[i]);
+    for (size_t i = 0; i < gc->program_len; i++) {
+        mark_program(gc, gc->programs[i]);
     }
-    if (ctx->gc->builder) {
-        mark_builder(ctx->gc->builder);
+    if (gc->builder) {
+        mark_builder(gc, gc->builder);
     }
 }
 
 void gtk_ml_delete(GtkMl_Context *ctx, GtkMl_SObj s) {
-    if ((s->flags & GTKML_FLAG_REACHABLE) || (s->flags & GTKML_FLAG_DELETE)) {
+    if ((s->flags & GTKML_FLAG_REACHABLE) || (s->flags & GTKML_FLAG_DELETE) || (s->flags & GTKML_FLAG_FREE)) {
+        return;
+    }
+
+    // interned symbols and keywords are shared, only the gc knows when they are unused
+    if ((s->kind == GTKML_S_SYMBOL || s->kind == GTKML_S_KEYWORD) && s->value.s_symbol.interned == s) {
         return;
     }
 
@@ -866,6 +1616,9 @@ void gtk_ml_delete(GtkMl_Context *ctx, GtkMl_SObj s) {
     case GTKML_S_ARRAY:
         gtk_ml_del_array_trie(ctx, &s->value.s_array.array, gtk_ml_delete_value);
         break;
+    case GTKML_S_TABLE:
+        gtk_ml_del_hash_table(ctx, &s->value.s_table.table, gtk_ml_delete_value);
+        break;
     case GTKML_S_VAR:
         gtk_ml_delete(ctx, s->value.s_var.expr);
         break;
@@ -900,12 +1653,7 @@ void gtk_ml_delete(GtkMl_Context *ctx, GtkMl_SObj s) {
         gtk_ml_delete(ctx, s->value.s_macro.capture);
         break;
     }
-    if (ctx->gc->free_len == ctx->gc->free_cap) {
-        ctx->gc->free_cap *= 2;
-        ctx->gc->free_all = realloc(ctx->gc->free_all, sizeof(GtkMl_SObj) * ctx->gc->free_cap);
-    }
-    ctx->gc->free_all[ctx->gc->free_len++] = s;
-    --ctx->gc->n_values;
+    gc_free(ctx->gc, s);
 }
 
 void gtk_ml_del(GtkMl_Context *ctx, GtkMl_SObj s) {
@@ -937,12 +1685,21 @@ void gtk_ml_del(GtkMl_Context *ctx, GtkMl_SObj s) {
     case GTKML_S_ARRAY:
         gtk_ml_del_array_trie(ctx, &s->value.s_array.array, gtk_ml_delete_value);
         break;
+    case GTKML_S_TABLE:
+        gtk_ml_del_hash_table(ctx, &s->value.s_table.table, gtk_ml_delete_value);
+        break;
     case GTKML_S_KEYWORD:
+        if (s->value.s_keyword.interned == s) {
+            unintern(ctx->gc, s);
+        }
         if (s->value.s_keyword.owned) {
             free((void *) s->value.s_keyword.ptr);
         }
         break;
     case GTKML_S_SYMBOL:
+        if (s->value.s_symbol.interned == s) {
+            unintern(ctx->gc, s);
+        }
         if (s->value.s_symbol.owned) {
             free((void *) s->value.s_symbol.ptr);
         }
@@ -951,44 +1708,162 @@ void gtk_ml_del(GtkMl_Context *ctx, GtkMl_SObj s) {
         s->value.s_userdata.del(ctx, s->value.s_userdata.userdata);
         break;
     }
-    if (ctx->gc->free_len == ctx->gc->free_cap) {
-        ctx->gc->free_cap *= 2;
-        ctx->gc->free_all = realloc(ctx->gc->free_all, sizeof(GtkMl_SObj) * ctx->gc->free_cap);
+    gc_free(ctx->gc, s);
+}
+
+// frees the unreached cells of a page, the survivors are old afterwards
+// returns whether the page was released
+GTKML_PRIVATE gboolean sweep_slab(GtkMl_Context *ctx, GtkMl_Slab *slab) {
+    GtkMl_Gc *gc = ctx->gc;
+
+    for (size_t i = 0; i < slab->bump; i++) {
+        GtkMl_SObj s = &slab->cells[i];
+        if (s->flags & GTKML_FLAG_FREE) {
+            continue;
+        }
+        if (s->flags & GTKML_FLAG_REACHABLE) {
+            s->flags &= ~GTKML_FLAG_REACHABLE;
+            s->flags |= GTKML_FLAG_OLD;
+        } else {
+            gtk_ml_del(ctx, s);
+        }
+    }
+    slab->unswept = 0;
+
+    if (slab == gc->slab) {
+        return 0;
+    }
+    if (!slab->used) {
+        del_slab(gc, slab);
+        return 1;
+    }
+    if (slab->free && !slab->in_partial) {
+        slab->next_partial = gc->partial;
+        slab->in_partial = 1;
+        gc->partial = slab;
+    }
+    return 0;
+}
+
+// runs once marking is done
+// every page gets flagged unswept and only swept pages are allocated from until the sweep is over
+GTKML_PRIVATE void begin_sweep(GtkMl_Context *ctx) {
+    GtkMl_Gc *gc = ctx->gc;
+
+    gc->partial = NULL;
+    for (GtkMl_Slab *slab = gc->slabs; slab; slab = slab->next) {
+        slab->in_partial = 0;
+        slab->unswept = 1;
+    }
+
+    // everything allocated so far is either freed or promoted by the sweep
+    gc->nursery_len = 0;
+    for (size_t i = 0; i < gc->remembered_len; i++) {
+        gc->remembered[i]->flags &= ~GTKML_FLAG_REMEMBERED;
+    }
+    gc->remembered_len = 0;
+
+    if (gc->slab) {
+        (void) sweep_slab(ctx, gc->slab);
     }
-    ctx->gc->free_all[ctx->gc->free_len++] = s;
-    --ctx->gc->n_values;
+
+    gc->sweeping = 1;
+    gc->sweep_slab = gc->slabs;
 }
 
-GTKML_PRIVATE void sweep(GtkMl_Context *ctx) {
-    GtkMl_SObj *value = &ctx->gc->first;
-    while (*value) {
-        if ((*value)->flags & GTKML_FLAG_REACHABLE) {
-            (*value)->flags &= ~GTKML_FLAG_REACHABLE;
-            value = &(*value)->next;
+// sweeps at most `budget` pages, returns whether the sweep is over
+// pages created since the sweep began are in front of `sweep_slab` and never visited
+GTKML_PRIVATE gboolean sweep(GtkMl_Context *ctx, size_t budget) {
+    GtkMl_Gc *gc = ctx->gc;
+
+    while (gc->sweep_slab && budget) {
+        GtkMl_Slab *slab = gc->sweep_slab;
+        gc->sweep_slab = slab->next;
+        if (slab->unswept) {
+            (void) sweep_slab(ctx, slab);
+            --budget;
+        }
+    }
+
+    if (gc->sweep_slab) {
+        return 0;
+    }
+
+    gc->sweeping = 0;
+    return 1;
+}
+
+// only traces what was allocated since the last collection
+// old objects are treated as live, except that the ones written to are rescanned
+GTKML_PRIVATE void collect_nursery(GtkMl_Context *ctx) {
+    GtkMl_Gc *gc = ctx->gc;
+
+    gc->mark_stop = GTKML_FLAG_REACHABLE | GTKML_FLAG_OLD;
+    mark(gc);
+    for (size_t i = 0; i < gc->remembered_len; i++) {
+        GtkMl_SObj s = gc->remembered[i];
+        if (s->flags & GTKML_FLAG_FREE) {
+            continue;
+        }
+        s->flags &= ~GTKML_FLAG_REMEMBERED;
+        mark_fields(gc, s);
+    }
+    gc->remembered_len = 0;
+    (void) propagate(gc, SIZE_MAX);
+
+    // cells freed and reused since they were allocated show up more than once
+    for (size_t i = 0; i < gc->nursery_len; i++) {
+        GtkMl_SObj s = gc->nursery[i];
+        if (s->flags & (GTKML_FLAG_FREE | GTKML_FLAG_OLD)) {
+            continue;
+        }
+        if (s->flags & GTKML_FLAG_REACHABLE) {
+            s->flags &= ~GTKML_FLAG_REACHABLE;
+            s->flags |= GTKML_FLAG_OLD;
         } else {
-            GtkMl_SObj unreachable = *value;
-            *value = (*value)->next;
-            gtk_ml_del(ctx, unreachable);
+            gtk_ml_del(ctx, s);
         }
     }
+    gc->nursery_len = 0;
 }
 
-// simple mark & sweep gc
+// generational, incremental mark & sweep gc
+// a full collection shades the roots, then scans `mark_budget` gray objects per step
+// the vm stacks are not behind a write barrier, so the roots are shaded again before sweeping
+// the heap is then swept GTKML_GC_SWEEP_BUDGET pages per step
 gboolean gtk_ml_collect(GtkMl_Context *ctx) {
-    if (!ctx->gc->gc_enabled) {
+    GtkMl_Gc *gc = ctx->gc;
+
+    if (!gc->gc_enabled) {
         return 0;
     }
 
-    if (ctx->gc->n_values < ctx->gc->m_values) {
+    if (gc->marking) {
+        if (gc->mark_budget && !propagate(gc, gc->mark_budget)) {
+            return 1;
+        }
+
+        size_t n_values = gc->n_values;
+        mark(gc);
+        (void) propagate(gc, SIZE_MAX);
+        gc->marking = 0;
+        gc->m_values = 2 * n_values;
+        begin_sweep(ctx);
+        if (!gc->mark_budget) {
+            (void) sweep(ctx, SIZE_MAX);
+        }
+    } else if (gc->sweeping) {
+        (void) sweep(ctx, GTKML_GC_SWEEP_BUDGET);
+    } else if (gc->n_values >= gc->m_values) {
+        gc->marking = 1;
+        gc->mark_stop = GTKML_FLAG_REACHABLE;
+        mark(gc);
+    } else if (gc->nursery_len >= GTKML_GC_NURSERY_THRESHOLD) {
+        collect_nursery(ctx);
+    } else {
         return 0;
     }
 
-    size_t n_values = ctx->gc->n_values;
-    mark(ctx);
-    sweep(ctx);
-    free_all(ctx->gc);
-    ctx->gc->m_values = 2 * n_values;
-
     return 1;
 }
 
@@ -1002,6 +1877,10 @@ void gtk_ml_enable_gc(GtkMl_Context *ctx, gboolean enabled) {
     ctx->gc->gc_enabled = enabled;
 }
 
+void gtk_ml_set_gc_budget(GtkMl_Context *ctx, size_t budget) {
+    ctx->gc->mark_budget = budget;
+}
+
 gboolean gtk_ml_equal(GtkMl_SObj lhs, GtkMl_SObj rhs) {
     if (lhs == rhs) {
         return 1;
@@ -1025,9 +1904,9 @@ gboolean gtk_ml_equal(GtkMl_SObj lhs, GtkMl_SObj rhs) {
     case GTKML_S_CHAR:
         return lhs->value.s_char.value == rhs->value.s_char.value;
     case GTKML_S_KEYWORD:
-        return lhs->value.s_keyword.len == rhs->value.s_keyword.len && memcmp(lhs->value.s_keyword.ptr, rhs->value.s_keyword.ptr, lhs->value.s_keyword.len) == 0;
+        return lhs->value.s_keyword.interned == rhs->value.s_keyword.interned;
     case GTKML_S_SYMBOL:
-        return lhs->value.s_symbol.len == rhs->value.s_symbol.len && memcmp(lhs->value.s_symbol.ptr, rhs->value.s_symbol.ptr, lhs->value.s_symbol.len) == 0;
+        return lhs->value.s_symbol.interned == rhs->value.s_symbol.interned;
     case GTKML_S_LIGHTDATA:
         return lhs->value.s_lightdata.userdata == rhs->value.s_lightdata.userdata;
     case GTKML_S_USERDATA:
@@ -1050,6 +1929,9 @@ gboolean gtk_ml_equal(GtkMl_SObj lhs, GtkMl_SObj rhs) {
         }
         break;
     case GTKML_S_LIST:
+        if (lhs->value.s_list.len != rhs->value.s_list.len) {
+            return 0;
+        }
         if (gtk_ml_equal(gtk_ml_car(lhs), gtk_ml_car(rhs))) {
             return gtk_ml_equal(gtk_ml_cdr(lhs), gtk_ml_cdr(rhs));
         }
@@ -1060,6 +1942,9 @@ gboolean gtk_ml_equal(GtkMl_SObj lhs, GtkMl_SObj rhs) {
         return gtk_ml_hash_set_equal(&lhs->value.s_set.set, &rhs->value.s_set.set);
     case GTKML_S_ARRAY:
         return gtk_ml_array_trie_equal(&lhs->value.s_array.array, &rhs->value.s_array.array);
+    case GTKML_S_TABLE:
+        // identical tables were handled above
+        return 0;
     case GTKML_S_VAR:
         return gtk_ml_equal(lhs->value.s_var.expr, rhs->value.s_var.expr);
     case GTKML_S_VARARG:
@@ -1105,6 +1990,7 @@ gboolean gtk_ml_equal_value(GtkMl_TaggedValue lhs, GtkMl_TaggedValue rhs) {
         case GTKML_S_MAP:
         case GTKML_S_SET:
         case GTKML_S_ARRAY:
+        case GTKML_S_TABLE:
         case GTKML_S_VAR:
         case GTKML_S_VARARG:
         case GTKML_S_QUOTE:
@@ -1139,6 +2025,7 @@ gboolean gtk_ml_equal_value(GtkMl_TaggedValue lhs, GtkMl_TaggedValue rhs) {
         case GTKML_S_MAP:
         case GTKML_S_SET:
         case GTKML_S_ARRAY:
+        case GTKML_S_TABLE:
         case GTKML_S_VAR:
         case GTKML_S_VARARG:
         case GTKML_S_QUOTE:
@@ -1172,6 +2059,7 @@ gboolean gtk_ml_hash_debug(GtkMl_Context *ctx, GtkMl_Hasher *hasher, GtkMl_Hash
 void gtk_ml_setmetamap(GtkMl_SObj value, GtkMl_SObj mm) {
     if (value->kind == GTKML_S_MAP) {
         value->value.s_map.metamap = mm;
+        gtk_ml_write_barrier(value);
     }
 }
 
@@ -1215,7 +2103,7 @@ GtkMl_SObj gtk_ml_error(GtkMl_Context *ctx, const char *err, const char *descrip
             GtkMl_SObj program = gtk_ml_new_nil(ctx, NULL);
             size_t call_at = ctx->vm->call_stack[i + 1];
             GtkMl_SObj export = NULL;
-            for (size_t ptr = 0; ptr <= call_at; ptr += 8) {
+            for (size_t ptr = 0; ptr <= call_at && (ptr >> 3) < ctx->vm->program->n_text; ptr += 8) {
                 GtkMl_Instruction instr = ctx->vm->program->text[ptr >> 3];
                 if (instr.category == GTKML_I_EXPORT) {
                     if (ctx->vm->program->statics[ctx->vm->program->data[instr.data].value.u64]->kind == GTKML_S_PROGRAM
@@ -1258,7 +2146,8 @@ GtkMl_SObj gtk_ml_error(GtkMl_Context *ctx, const char *err, const char *descrip
         GtkMl_SObj program = gtk_ml_new_nil(ctx, NULL);
         size_t call_at = ctx->vm->pc;
         GtkMl_SObj export = NULL;
-        for (size_t ptr = 0; ptr <= call_at; ptr += 8) {
+        // outside of a run the pc may still point into whatever program ran last
+        for (size_t ptr = 0; ptr <= call_at && (ptr >> 3) < ctx->vm->program->n_text; ptr += 8) {
             GtkMl_Instruction instr = ctx->vm->program->text[ptr >> 3];
             if (instr.category == GTKML_I_EXPORT) {
                 if (ctx->vm->program->statics[ctx->vm->program->data[instr.data].value.u64]->kind == GTKML_S_PROGRAM
@@ -1527,6 +2416,10 @@ gboolean gtk_ml_dumpf_debug(GtkMl_Context *ctx, FILE *stream, GtkMl_SObj *err, G
         fprintf(stream, "}");
         return 1;
     }
+    case GTKML_S_TABLE:
+        // the slots live in the debuggee, only the size of the table is shown
+        fprintf(stream, "(table #%zu)", expr->value.s_table.table.len);
+        return 1;
     case GTKML_S_ARRAY: {
         if (gtk_ml_array_trie_is_string_debug(ctx, err, &expr->value.s_array.array)) {
             fprintf(stream, "\"");
@@ -1754,6 +2647,24 @@ GTKML_PRIVATE GtkMl_VisitResult dumpf_hash_trie(GtkMl_HashTrie *ht, GtkMl_Tagged
     return GTKML_VISIT_RECURSE;
 }
 
+GTKML_PRIVATE GtkMl_VisitResult dumpf_hash_table(GtkMl_HashTable *table, GtkMl_TaggedValue key, GtkMl_TaggedValue value, GtkMl_TaggedValue _data) {
+    struct DumpfData *data = _data.value.userdata;
+
+    if (!gtk_ml_dumpf_value(data->ctx, data->stream, data->err, key)) {
+        return 0;
+    }
+    fprintf(data->stream, " ");
+    if (!gtk_ml_dumpf_value(data->ctx, data->stream, data->err, value)) {
+        return 0;
+    }
+    ++data->n;
+    if (data->n < gtk_ml_hash_table_len(table)) {
+        fprintf(data->stream, " ");
+    }
+
+    return GTKML_VISIT_RECURSE;
+}
+
 GTKML_PRIVATE GtkMl_VisitResult dumpf_hash_set(GtkMl_HashSet *hs, GtkMl_TaggedValue key, GtkMl_TaggedValue _data) {
     struct DumpfData *data = _data.value.userdata;
 
@@ -1784,12 +2695,10 @@ GTKML_PRIVATE GtkMl_VisitResult dumpf_array(GtkMl_Array *array, size_t idx, GtkM
     return GTKML_VISIT_RECURSE;
 }
 
-GTKML_PRIVATE GtkMl_VisitResult dumpf_string(GtkMl_Array *array, size_t idx, GtkMl_TaggedValue key, GtkMl_TaggedValue data) {
+GTKML_PRIVATE GtkMl_VisitResult dumpf_string(GtkMl_Array *array, const char *ptr, size_t len, GtkMl_TaggedValue data) {
     (void) array;
-    (void) idx;
-    (void) data;
 
-    fprintf(data.value.userdata, "%c", key.value.unicode);
+    fwrite(ptr, 1, len, data.value.userdata);
 
     return GTKML_VISIT_RECURSE;
 }
@@ -1847,10 +2756,17 @@ gboolean gtk_ml_dumpf(GtkMl_Context *ctx, FILE *stream, GtkMl_SObj *err, GtkMl_S
         fprintf(stream, "}");
         return 1;
     }
+    case GTKML_S_TABLE: {
+        fprintf(stream, "(table {");
+        struct DumpfData data = { ctx, stream, err, 0 };
+        gtk_ml_hash_table_foreach(&expr->value.s_table.table, dumpf_hash_table, gtk_ml_value_userdata(&data));
+        fprintf(stream, "})");
+        return 1;
+    }
     case GTKML_S_ARRAY: {
         if (gtk_ml_array_trie_is_string(&expr->value.s_array.array)) {
             fprintf(stream, "\"");
-            gtk_ml_array_trie_foreach(&expr->value.s_array.array, dumpf_string, gtk_ml_value_userdata(stream));
+            gtk_ml_string_foreach_chunk(&expr->value.s_array.array, dumpf_string, gtk_ml_value_userdata(stream));
             fprintf(stream, "\"");
             return 1;
         } else {
@@ -2071,6 +2987,24 @@ GTKML_PRIVATE GtkMl_VisitResult dumpsnr_hash_trie(GtkMl_HashTrie *ht, GtkMl_Tagg
     return GTKML_VISIT_RECURSE;
 }
 
+GTKML_PRIVATE GtkMl_VisitResult dumpsnr_hash_table(GtkMl_HashTable *table, GtkMl_TaggedValue key, GtkMl_TaggedValue value, GtkMl_TaggedValue _data) {
+    struct DumpsnrData *data = _data.value.userdata;
+
+    if (!gtk_ml_dumpsnr_internal(data->ctx, data->buffer, data->offset, data->size, data->err, key.value.sobj)) {
+        return 0;
+    }
+    snrprint_at(data->buffer, *data->offset, data->size, " ");
+    if (!gtk_ml_dumpsnr_internal(data->ctx, data->buffer, data->offset, data->size, data->err, value.value.sobj)) {
+        return 0;
+    }
+    ++data->n;
+    if (data->n < gtk_ml_hash_table_len(table)) {
+        snrprint_at(data->buffer, *data->offset, data->size, " ");
+    }
+
+    return GTKML_VISIT_RECURSE;
+}
+
 GTKML_PRIVATE GtkMl_VisitResult dumpsnr_hash_set(GtkMl_HashSet *hs, GtkMl_TaggedValue key, GtkMl_TaggedValue _data) {
     struct DumpsnrData *data = _data.value.userdata;
 
@@ -2101,12 +3035,11 @@ GTKML_PRIVATE GtkMl_VisitResult dumpsnr_array(GtkMl_Array *array, size_t idx, Gt
     return GTKML_VISIT_RECURSE;
 }
 
-GTKML_PRIVATE GtkMl_VisitResult dumpsnr_string(GtkMl_Array *array, size_t idx, GtkMl_TaggedValue key, GtkMl_TaggedValue _data) {
+GTKML_PRIVATE GtkMl_VisitResult dumpsnr_string(GtkMl_Array *array, const char *ptr, size_t len, GtkMl_TaggedValue _data) {
     (void) array;
-    (void) idx;
 
     struct DumpsnrData *data = _data.value.userdata;
-    snrprintf_at(data->buffer, *data->offset, data->size, "%c", key.value.unicode);
+    snrprintf_at(data->buffer, *data->offset, data->size, "%.*s", (int) len, ptr);
 
     return GTKML_VISIT_RECURSE;
 }
@@ -2164,11 +3097,18 @@ char *gtk_ml_dumpsnr_internal(GtkMl_Context *ctx, char *buffer, size_t *offset,
         snrprint_at(buffer, *offset, size, "}");
         return buffer;
     }
+    case GTKML_S_TABLE: {
+        snrprint_at(buffer, *offset, size, "(table {");
+        struct DumpsnrData data = { ctx, buffer, offset, size, err, 0 };
+        gtk_ml_hash_table_foreach(&expr->value.s_table.table, dumpsnr_hash_table, gtk_ml_value_userdata(&data));
+        snrprint_at(buffer, *offset, size, "})");
+        return buffer;
+    }
     case GTKML_S_ARRAY: {
         if (gtk_ml_array_trie_is_string(&expr->value.s_array.array)) {
             snrprint_at(buffer, *offset, size, "\"");
             struct DumpsnrData data = { ctx, buffer, offset, size, err, 0 };
-            gtk_ml_array_trie_foreach(&expr->value.s_array.array, dumpsnr_string, gtk_ml_value_userdata(&data));
+            gtk_ml_string_foreach_chunk(&expr->value.s_array.array, dumpsnr_string, gtk_ml_value_userdata(&data));
             snrprint_at(buffer, *offset, size, "\"");
             return buffer;
         } else {
@@ -2399,26 +3339,17 @@ gboolean gtk_ml_dumpf_program_internal(GtkMl_Context *ctx, FILE *stream, GtkMl_S
 
 gboolean gtk_ml_dumpf_stack(GtkMl_Context *ctx, FILE *stream, GtkMl_SObj *err) {
     size_t start = 0;
-    size_t end = ctx->gc->stack_len;
+    size_t end = ctx->vm->stack_len;
 
-    fprintf(stream, "gc stack\n\n");
+    fprintf(stream, "vm stack\n\n");
     for (size_t i = start; i < end; i++) {
-        GtkMl_SObj s = ctx->gc->stack[i];
         fprintf(stream, "%zu ", i);
-        if (!gtk_ml_dumpf(ctx, stream, err, s)) {
+        if (!gtk_ml_dumpf_value(ctx, stream, err, ctx->vm->stack[i])) {
             return 0;
         }
         fprintf(stream, "\n");
     }
 
-    start = 0;
-    end = ctx->vm->stack_len;
-    fprintf(stream, "\n\nvm stack\n\n");
-    for (size_t i = start; i < end; i++) {
-        GtkMl_TaggedValue s = ctx->vm->stack[i];
-        fprintf(stream, "%zu %"GTKML_FMT_64"x\n", i, s.value.u64);
-    }
-
     return 1;
 }
 
@@ -2553,35 +3484,6 @@ gboolean gtk_ml_dumpf_line_debug(GtkMl_Context *ctx, FILE *stream, GtkMl_SObj *e
 }
 
 gboolean gtk_ml_dumpf_stack_debug(GtkMl_Context *ctx, FILE *stream, GtkMl_SObj *err) {
-    {
-        GtkMl_Gc *gc = gtk_ml_dbg_read_ptr(ctx, err, &ctx->gc);
-        if (*err) {
-            return 0;
-        }
-        GtkMl_SObj *stack = gtk_ml_dbg_read_ptr(ctx, err, &gc->stack);
-        if (*err) {
-            return 0;
-        }
-        size_t start = 0;
-        size_t end = gtk_ml_dbg_read_u64(ctx, err, &gc->stack_len);
-        if (*err) {
-            return 0;
-        }
-
-        fprintf(stream, "gc stack\n\n");
-        for (size_t i = start; i < end; i++) {
-            GtkMl_SObj s = gtk_ml_dbg_read_ptr(ctx, err, &stack[i]);
-            if (*err) {
-                return 0;
-            }
-            fprintf(stream, "%zu ", i);
-            if (!gtk_ml_dumpf_debug(ctx, stream, err, s)) {
-                return 0;
-            }
-            fprintf(stream, "\n");
-        }
-    }
-
     {
         GtkMl_Vm *vm = gtk_ml_dbg_read_ptr(ctx, err, &ctx->vm);
         if (*err) {
@@ -2593,13 +3495,21 @@ gboolean gtk_ml_dumpf_stack_debug(GtkMl_Context *ctx, FILE *stream, GtkMl_SObj *
         }
         size_t start = 0;
         size_t end = gtk_ml_dbg_read_u64(ctx, err, &vm->stack_len);
-        fprintf(stream, "\n\nvm stack\n\n");
+        fprintf(stream, "vm stack\n\n");
         for (size_t i = start; i < end; i++) {
             GtkMl_TaggedValue s = gtk_ml_dbg_read_value(ctx, err, &stack[i]);
             if (*err) {
                 return 0;
             }
-            fprintf(stream, "%zu %"GTKML_FMT_64"x\n", i, s.value.u64);
+            fprintf(stream, "%zu ", i);
+            if (gtk_ml_is_sobject(s)) {
+                if (!gtk_ml_dumpf_debug(ctx, stream, err, s.value.sobj)) {
+                    return 0;
+                }
+                fprintf(stream, "\n");
+            } else {
+                fprintf(stream, "%"GTKML_FMT_64"x\n", s.value.u64);
+            }
         }
     }
 
@@ -2760,7 +3670,7 @@ void gtk_ml_breakpoint(GtkMl_Context *ctx) {
 
 void gtk_ml_breakpoint_internal(GtkMl_Context *ctx, gboolean enable) {
     if (enable) {
-        __asm__ volatile ( "int $3" : : "a" (ctx) :);
+        __asm__ volatile ( "int $3" : : "a" (ctx) : "memory");
     }
 }
 #endif /* GTKML_ENABLE_ASM */
@@ -5,6 +5,7 @@
 #define _GNU_SOURCE 1
 #include <stdlib.h>
 #include <errno.h>
+#include <signal.h>
 #include <sys/ptrace.h>
 #include <sys/wait.h>
 #include <sys/user.h>
@@ -218,6 +219,7 @@ int main(int argc, const char **argv, char *const *envp) {
                     gtk_ml_array_trie_push(&new, &current.value.sobj->value.s_array.array, gtk_ml_value_sobject(value));
                     gtk_ml_del_array_trie(ctx, &current.value.sobj->value.s_array.array, gtk_ml_delete_value);
                     current.value.sobj->value.s_array.array = new;
+                    gtk_ml_write_barrier(current.value.sobj);
                 } else {
                     GtkMl_HashTrie new;
                     gtk_ml_hash_trie_insert(&new, &opts, gtk_ml_value_sobject(keyword), gtk_ml_value_sobject(value));
@@ -248,6 +250,7 @@ int main(int argc, const char **argv, char *const *envp) {
                 gtk_ml_array_trie_push(&new, &current.value.sobj->value.s_array.array, gtk_ml_value_sobject(value));
                 gtk_ml_del_array_trie(ctx, &current.value.sobj->value.s_array.array, gtk_ml_delete_value);
                 current.value.sobj->value.s_array.array = new;
+                gtk_ml_write_barrier(current.value.sobj);
             } else {
                 GtkMl_HashTrie new;
                 gtk_ml_hash_trie_insert(&new, &opts, gtk_ml_value_sobject(keyword), gtk_ml_value_sobject(value));
@@ -359,11 +362,18 @@ int main(int argc, const char **argv, char *const *envp) {
         struct user_regs_struct regs;
         ptrace(PTRACE_GETREGS, pid, NULL, &regs);
 
+        // while it is still stopped, so it runs the instrumented loop once it continues
+        if (!gtk_ml_set_debug(ctx, &err, pid, (GtkMl_Context *) regs.rax)) {
+            (void) gtk_ml_dumpf(ctx, stderr, NULL, err);
+            fprintf(stderr, "\n");
+            kill(pid, SIGKILL);
+            gtk_ml_del_context(ctx);
+            return 1;
+        }
+
         ptrace(PTRACE_CONT, pid, NULL, NULL);
         waitpid(pid, &wait_status, 0);
 
-        gtk_ml_set_debug(ctx, pid, (GtkMl_Context *) regs.rax);
-
         linenoiseInstallWindowChangeHandler();
 
         //linenoiseSetCompletionCallback(completionHook);
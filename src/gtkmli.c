@@ -25,6 +25,7 @@ GTKML_PRIVATE const struct ParameterPrototype PARAMS[] = {
     ['f'] = { 1, 1, 0, 0, 'f', "file", "PATH", "Load and execute a file from a PATH." },
     ['F'] = { 1, 1, 0, 0, 'F', "file-and-run", "PATH", "Load and execute a file from a PATH and then run it as a GTK application." },
     ['h'] = { 1, 0, 0, 0, 'h', "help", NULL, "Print this message and exit." },
+    ['n'] = { 1, 0, 0, 0, 'n', "no-cache", NULL, "Compile :f or :F even if its bytecode is cached, and don't cache it." },
     ['V'] = { 1, 0, 0, 0, 'V', "version", NULL, "Print the current version and exit." },
     ['v'] = { 1, 0, 0, 0, 'v', "verbose", NULL, "Print some additional information." },
     [255] = {0, 0, 0, 0, 0, NULL, NULL, NULL },
@@ -166,6 +167,7 @@ int main(int argc, const char **argv) {
                     gtk_ml_array_trie_push(&new, &current.value.sobj->value.s_array.array, gtk_ml_value_sobject(value));
                     gtk_ml_del_array_trie(ctx, &current.value.sobj->value.s_array.array, gtk_ml_delete_value);
                     current.value.sobj->value.s_array.array = new;
+                    gtk_ml_write_barrier(current.value.sobj);
                 } else {
                     GtkMl_HashTrie new;
                     gtk_ml_hash_trie_insert(&new, &opts, gtk_ml_value_sobject(keyword), gtk_ml_value_sobject(value));
@@ -196,6 +198,7 @@ int main(int argc, const char **argv) {
                 gtk_ml_array_trie_push(&new, &current.value.sobj->value.s_array.array, gtk_ml_value_sobject(value));
                 gtk_ml_del_array_trie(ctx, &current.value.sobj->value.s_array.array, gtk_ml_delete_value);
                 current.value.sobj->value.s_array.array = new;
+                gtk_ml_write_barrier(current.value.sobj);
             } else {
                 GtkMl_HashTrie new;
                 gtk_ml_hash_trie_insert(&new, &opts, gtk_ml_value_sobject(keyword), gtk_ml_value_sobject(value));
@@ -369,8 +372,22 @@ int main(int argc, const char **argv) {
 
             gtk_ml_load_program(ctx, program);
         } else {
-            GtkMl_SObj lambda;
-            if (!(lambda = gtk_ml_load(ctx, &src, &err, file))) {
+            // compiled programs are cached by the hash of their source
+            char *cache_dir = NULL;
+            GtkMl_SObj no_cache_kw = gtk_ml_new_keyword(ctx, NULL, 0, PARAMS['n'].long_opt, strlen(PARAMS['n'].long_opt));
+            gtk_ml_push(ctx, gtk_ml_value_sobject(no_cache_kw));
+            GtkMl_SObj no_cache_opt = gtk_ml_hash_trie_get(&flags, gtk_ml_value_sobject(no_cache_kw)).value.sobj;
+            if (no_cache_opt->kind != GTKML_S_TRUE) {
+                cache_dir = g_build_filename(g_get_user_cache_dir(), "gtk-ml", NULL);
+                if (g_mkdir_with_parents(cache_dir, 0700) != 0) {
+                    g_free(cache_dir);
+                    cache_dir = NULL;
+                }
+            }
+
+            program = gtk_ml_load_cached(ctx, &src, &err, file, cache_dir);
+            g_free(cache_dir);
+            if (!program) {
                 GtkMl_SObj err_kw = gtk_ml_new_keyword(ctx, NULL, 0, "err", strlen("err"));
                 gtk_ml_push(ctx, gtk_ml_value_sobject(err_kw));
                 GtkMl_SObj err_kind = gtk_ml_hash_trie_get(&err->value.s_map.map, gtk_ml_value_sobject(err_kw)).value.sobj;
@@ -385,43 +402,21 @@ int main(int argc, const char **argv) {
                                 gtk_ml_value_sobject(gtk_ml_new_keyword(ctx, NULL, 0, "filename", strlen("filename"))), gtk_ml_value_sobject(gtk_ml_new_string(ctx, NULL, file, strlen(file))));
                         gtk_ml_del_hash_trie(ctx, &err->value.s_map.map, gtk_ml_delete_value);
                         err->value.s_map.map = new;
+                        gtk_ml_write_barrier(err);
                     }
 
                     gtk_ml_hash_trie_insert(&new, &err->value.s_map.map, gtk_ml_value_sobject(gtk_ml_new_keyword(ctx, NULL, 0, "errno", strlen("errno"))), gtk_ml_value_sobject(gtk_ml_new_int(ctx, NULL, errnum)));
                     gtk_ml_del_hash_trie(ctx, &err->value.s_map.map, gtk_ml_delete_value);
                     err->value.s_map.map = new;
+                    gtk_ml_write_barrier(err);
 
                     const char *desc = strerror(errnum);
                     gtk_ml_hash_trie_insert(&new, &err->value.s_map.map, gtk_ml_value_sobject(gtk_ml_new_keyword(ctx, NULL, 0, "desc", strlen("desc"))), gtk_ml_value_sobject(gtk_ml_new_string(ctx, NULL, desc, strlen(desc))));
                     gtk_ml_del_hash_trie(ctx, &err->value.s_map.map, gtk_ml_delete_value);
                     err->value.s_map.map = new;
+                    gtk_ml_write_barrier(err);
                 }
 
-                free(file);
-                (void) gtk_ml_dumpf(ctx, stderr, NULL, err);
-
-                fprintf(stderr, "\n");
-                gtk_ml_del_context(ctx);
-                return 1;
-            }
-
-            gtk_ml_push(ctx, gtk_ml_value_sobject(lambda));
-
-            GtkMl_Builder *builder = gtk_ml_new_builder(ctx);
-
-            if (!gtk_ml_compile_program(ctx, builder, &err, lambda)) {
-                if (src) {
-                    free(src);
-                }
-                free(file);
-                (void) gtk_ml_dumpf(ctx, stderr, NULL, err);
-                fprintf(stderr, "\n");
-                gtk_ml_del_context(ctx);
-                return 1;
-            }
-
-            program = gtk_ml_build(ctx, &err, builder);
-            if (!program) {
                 if (src) {
                     free(src);
                 }
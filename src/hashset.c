@@ -12,32 +12,45 @@
 typedef enum GtkMl_HashSetNodeKind {
     GTKML_HS_LEAF,
     GTKML_HS_BRANCH,
+    GTKML_HS_COLLISION,
 } GtkMl_HashSetNodeKind;
 
 typedef struct GtkMl_HLeaf {
     GtkMl_TaggedValue key;
 } GtkMl_HLeaf;
 
+// a branch only stores its non-empty children, in index order
+// child `idx` is present if bit `idx` of `bitmap` is set and lives at `popcount(bitmap & (bit - 1))`
 typedef struct GtkMl_HBranch {
-    GtkMl_HashSetNode **nodes;
+    uint32_t bitmap;
 } GtkMl_HBranch;
 
+// leaves whose keys all hash to `hash`, stored in `nodes` and searched linearly
+typedef struct GtkMl_HCollision {
+    GtkMl_Hash hash;
+    uint32_t len;
+} GtkMl_HCollision;
+
 typedef union GtkMl_HUnion {
     GtkMl_HLeaf h_leaf;
     GtkMl_HBranch h_branch;
+    GtkMl_HCollision h_collision;
 } GtkMl_HUnion;
 
 struct GtkMl_HashSetNode {
     int rc;
     GtkMl_HashSetNodeKind kind;
     GtkMl_HUnion value;
+    GtkMl_HashSetNode *nodes[]; // the children of a branch or collision node, allocated along with it
 };
 
 GTKML_PRIVATE GtkMl_HashSetNode *new_leaf(GtkMl_TaggedValue key);
-GTKML_PRIVATE GtkMl_HashSetNode *new_branch();
+GTKML_PRIVATE GtkMl_HashSetNode *new_branch(uint32_t bitmap);
+GTKML_PRIVATE GtkMl_HashSetNode *new_collision(GtkMl_Hash hash, uint32_t len);
 GTKML_PRIVATE GtkMl_HashSetNode *copy_node(GtkMl_HashSetNode *node);
 GTKML_PRIVATE void del_node(GtkMl_Context *ctx, GtkMl_HashSetNode *node, void (*deleter)(GtkMl_Context *, GtkMl_TaggedValue));
 GTKML_PRIVATE GtkMl_TaggedValue insert(GtkMl_Hasher *hasher, GtkMl_HashSetNode **out, size_t *inc, GtkMl_HashSetNode *node, GtkMl_TaggedValue key, GtkMl_Hash hash, uint32_t shift);
+GTKML_PRIVATE GtkMl_TaggedValue insert_mut(GtkMl_Hasher *hasher, GtkMl_HashSetNode **slot, size_t *inc, GtkMl_TaggedValue key, GtkMl_Hash hash, uint32_t shift);
 GTKML_PRIVATE GtkMl_TaggedValue get(GtkMl_Hasher *hasher, GtkMl_HashSetNode *node, GtkMl_TaggedValue key, GtkMl_Hash hash, uint32_t shift);
 GTKML_PRIVATE GtkMl_TaggedValue delete(GtkMl_Hasher *hasher, GtkMl_HashSetNode **out, size_t *dec, GtkMl_HashSetNode *node, GtkMl_TaggedValue key, GtkMl_Hash hash, uint32_t shift);
 GTKML_PRIVATE GtkMl_VisitResult foreach(GtkMl_HashSet *hs, GtkMl_HashSetNode *node, GtkMl_HashSetFn fn, GtkMl_TaggedValue data);
@@ -47,18 +60,21 @@ void gtk_ml_new_hash_set(GtkMl_HashSet *hs, GtkMl_Hasher *hasher) {
     hs->hasher = hasher;
     hs->root = NULL;
     hs->len = 0;
+    hs->hash = 0;
 }
 
 void gtk_ml_del_hash_set(GtkMl_Context *ctx, GtkMl_HashSet *hs, void (*deleter)(GtkMl_Context *, GtkMl_TaggedValue)) {
     del_node(ctx, hs->root, deleter);
     hs->root = NULL;
     hs->len = 0;
+    hs->hash = 0;
 }
 
 void gtk_ml_hash_set_copy(GtkMl_HashSet *out, GtkMl_HashSet *hs) {
     out->hasher = hs->hasher;
     out->root = copy_node(hs->root);
     out->len = hs->len;
+    out->hash = hs->hash;
 }
 
 size_t gtk_ml_hash_set_len(GtkMl_HashSet *hs) {
@@ -70,9 +86,7 @@ GTKML_PRIVATE GtkMl_VisitResult fn_concat(GtkMl_HashSet *hs, GtkMl_TaggedValue k
 
     GtkMl_HashSet *dest = data.value.userdata;
 
-    GtkMl_HashSet new;
-    gtk_ml_hash_set_insert(&new, dest, key);
-    *dest = new;
+    gtk_ml_hash_set_transient_insert(dest, key);
     
     return GTKML_VISIT_RECURSE;
 }
@@ -81,6 +95,7 @@ void gtk_ml_hash_set_concat(GtkMl_HashSet *out, GtkMl_HashSet *lhs, GtkMl_HashSe
     out->hasher = lhs->hasher;
     out->root = copy_node(lhs->root);
     out->len = lhs->len;
+    out->hash = 0;
 
     gtk_ml_hash_set_foreach(rhs, fn_concat, gtk_ml_value_userdata(out));
 }
@@ -89,6 +104,7 @@ GtkMl_TaggedValue gtk_ml_hash_set_insert(GtkMl_HashSet *out, GtkMl_HashSet *hs,
     out->hasher = hs->hasher;
     out->root = NULL;
     out->len = hs->len;
+    out->hash = 0;
 
     GtkMl_Hash hash;
     if (!gtk_ml_hash(hs->hasher, &hash, key)) {
@@ -97,6 +113,16 @@ GtkMl_TaggedValue gtk_ml_hash_set_insert(GtkMl_HashSet *out, GtkMl_HashSet *hs,
     return insert(hs->hasher, &out->root, &out->len, hs->root, key, hash, 0);
 }
 
+GtkMl_TaggedValue gtk_ml_hash_set_transient_insert(GtkMl_HashSet *hs, GtkMl_TaggedValue key) {
+    hs->hash = 0;
+
+    GtkMl_Hash hash;
+    if (!gtk_ml_hash(hs->hasher, &hash, key)) {
+        return gtk_ml_value_none();
+    }
+    return insert_mut(hs->hasher, &hs->root, &hs->len, key, hash, 0);
+}
+
 GtkMl_TaggedValue gtk_ml_hash_set_get(GtkMl_HashSet *hs, GtkMl_TaggedValue key) {
     GtkMl_Hash hash;
     if (!gtk_ml_hash(hs->hasher, &hash, key)) {
@@ -117,6 +143,7 @@ GtkMl_TaggedValue gtk_ml_hash_set_delete(GtkMl_HashSet *out, GtkMl_HashSet *hs,
     out->hasher = hs->hasher;
     out->root = NULL;
     out->len = hs->len;
+    out->hash = 0;
 
     GtkMl_Hash hash;
     if (!gtk_ml_hash(hs->hasher, &hash, key)) {
@@ -134,6 +161,10 @@ gboolean gtk_ml_hash_set_equal(GtkMl_HashSet *lhs, GtkMl_HashSet *rhs) {
         return 0;
     }
 
+    if (lhs->hash && rhs->hash && lhs->hash != rhs->hash) {
+        return 0;
+    }
+
     return equal(lhs->hasher, lhs->root, rhs->root);
 }
 
@@ -145,12 +176,42 @@ GtkMl_HashSetNode *new_leaf(GtkMl_TaggedValue key) {
     return node;
 }
 
-GtkMl_HashSetNode *new_branch() {
-    GtkMl_HashSetNode *node = malloc(sizeof(GtkMl_HashSetNode));
+GTKML_PRIVATE uint32_t popcount(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(x);
+#else
+    x = x - ((x >> 1) & 0x55555555);
+    x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+    return (((x + (x >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+#endif
+}
+
+GTKML_PRIVATE uint32_t n_children(GtkMl_HashSetNode *node) {
+    switch (node->kind) {
+    case GTKML_HS_LEAF:
+        return 0;
+    case GTKML_HS_BRANCH:
+        return popcount(node->value.h_branch.bitmap);
+    case GTKML_HS_COLLISION:
+        return node->value.h_collision.len;
+    }
+    return 0;
+}
+
+GtkMl_HashSetNode *new_branch(uint32_t bitmap) {
+    GtkMl_HashSetNode *node = malloc(sizeof(GtkMl_HashSetNode) + sizeof(GtkMl_HashSetNode *) * popcount(bitmap));
     node->rc = 1;
     node->kind = GTKML_HS_BRANCH;
-    node->value.h_branch.nodes = malloc(sizeof(GtkMl_HashSetNode *) * GTKML_H_SIZE);
-    memset(node->value.h_branch.nodes, 0, sizeof(GtkMl_HashSetNode *) * GTKML_H_SIZE);
+    node->value.h_branch.bitmap = bitmap;
+    return node;
+}
+
+GtkMl_HashSetNode *new_collision(GtkMl_Hash hash, uint32_t len) {
+    GtkMl_HashSetNode *node = malloc(sizeof(GtkMl_HashSetNode) + sizeof(GtkMl_HashSetNode *) * len);
+    node->rc = 1;
+    node->kind = GTKML_HS_COLLISION;
+    node->value.h_collision.hash = hash;
+    node->value.h_collision.len = len;
     return node;
 }
 
@@ -171,21 +232,35 @@ void del_node(GtkMl_Context *ctx, GtkMl_HashSetNode *node, void (*deleter)(GtkMl
 
     --node->rc;
     if (!node->rc) {
-        switch (node->kind) {
-        case GTKML_HS_LEAF:
+        if (node->kind == GTKML_HS_LEAF) {
             deleter(ctx, node->value.h_leaf.key);
-            break;
-        case GTKML_HS_BRANCH:
-            for (size_t i = 0; i < GTKML_H_SIZE; i++) {
-                del_node(ctx, node->value.h_branch.nodes[i], deleter);
+        } else {
+            uint32_t len = n_children(node);
+            for (uint32_t i = 0; i < len; i++) {
+                del_node(ctx, node->nodes[i], deleter);
             }
-            free(node->value.h_branch.nodes);
-            break;
         }
         free(node);
     }
 }
 
+// `node` is a leaf or collision node whose keys hash to `_hash`, which differs from `hash`
+// pushes it down until the two hashes disagree on an index
+GTKML_PRIVATE GtkMl_TaggedValue split(GtkMl_Hasher *hasher, GtkMl_HashSetNode **out, size_t *inc, GtkMl_HashSetNode *node, GtkMl_Hash _hash, GtkMl_TaggedValue key, GtkMl_Hash hash, uint32_t shift) {
+    uint32_t _bit = 1u << ((_hash >> shift) & GTKML_H_MASK);
+    uint32_t bit = 1u << ((hash >> shift) & GTKML_H_MASK);
+    if (bit == _bit) {
+        *out = new_branch(bit);
+        return split(hasher, &(*out)->nodes[0], inc, node, _hash, key, hash, shift + GTKML_H_BITS);
+    }
+
+    ++*inc;
+    *out = new_branch(bit | _bit);
+    (*out)->nodes[bit < _bit? 0 : 1] = new_leaf(key);
+    (*out)->nodes[bit < _bit? 1 : 0] = copy_node(node);
+    return gtk_ml_value_none();
+}
+
 GtkMl_TaggedValue insert(GtkMl_Hasher *hasher, GtkMl_HashSetNode **out, size_t *inc, GtkMl_HashSetNode *node, GtkMl_TaggedValue key, GtkMl_Hash hash, uint32_t shift) {
     if (!node) {
         ++*inc;
@@ -194,45 +269,150 @@ GtkMl_TaggedValue insert(GtkMl_Hasher *hasher, GtkMl_HashSetNode **out, size_t *
     }
 
     switch (node->kind) {
-    case GTKML_HS_LEAF:
+    case GTKML_HS_LEAF: {
         if (hasher->equal(key, node->value.h_leaf.key)) {
             *out = new_leaf(key);
             return node->value.h_leaf.key;
-        } else {
-            *out = new_branch();
+        }
 
-            GtkMl_Hash _hash;
-            if (!gtk_ml_hash(hasher, &_hash, node->value.h_leaf.key)) {
-                return gtk_ml_value_none();
-            }
-            uint32_t _idx = (_hash >> shift) & GTKML_H_MASK;
-            (*out)->value.h_branch.nodes[_idx] = copy_node(node);
-
-            if (hash == _hash) {
-                fprintf(stderr, "fatal error: two non-equal keys in a hash map have the same hashes %"GTKML_FMT_64"x, %"GTKML_FMT_64"x\n", key.value.u64, node->value.h_leaf.key.value.u64);
-                if (gtk_ml_is_sobject(key)) {
-                    (void) gtk_ml_dumpf(NULL, stderr, NULL, key.value.sobj);
-                    fprintf(stderr, ", ");
+        GtkMl_Hash _hash;
+        if (!gtk_ml_hash(hasher, &_hash, node->value.h_leaf.key)) {
+            *out = copy_node(node);
+            return gtk_ml_value_none();
+        }
+
+        if (hash == _hash) {
+            ++*inc;
+            *out = new_collision(hash, 2);
+            (*out)->nodes[0] = copy_node(node);
+            (*out)->nodes[1] = new_leaf(key);
+            return gtk_ml_value_none();
+        }
+
+        return split(hasher, out, inc, node, _hash, key, hash, shift);
+    }
+    case GTKML_HS_BRANCH: {
+        uint32_t bitmap = node->value.h_branch.bitmap;
+        uint32_t bit = 1u << ((hash >> shift) & GTKML_H_MASK);
+        uint32_t pos = popcount(bitmap & (bit - 1));
+        uint32_t len = popcount(bitmap);
+
+        if (bitmap & bit) {
+            *out = new_branch(bitmap);
+            for (uint32_t i = 0; i < len; i++) {
+                if (i != pos) {
+                    (*out)->nodes[i] = copy_node(node->nodes[i]);
                 }
-                if (gtk_ml_is_sobject(node->value.h_leaf.key)) {
-                    (void) gtk_ml_dumpf(NULL, stderr, NULL, node->value.h_leaf.key.value.sobj);
+            }
+            return insert(hasher, &(*out)->nodes[pos], inc, node->nodes[pos], key, hash, shift + GTKML_H_BITS);
+        }
+
+        ++*inc;
+        *out = new_branch(bitmap | bit);
+        for (uint32_t i = 0; i < pos; i++) {
+            (*out)->nodes[i] = copy_node(node->nodes[i]);
+        }
+        (*out)->nodes[pos] = new_leaf(key);
+        for (uint32_t i = pos; i < len; i++) {
+            (*out)->nodes[i + 1] = copy_node(node->nodes[i]);
+        }
+        return gtk_ml_value_none();
+    }
+    case GTKML_HS_COLLISION: {
+        GtkMl_Hash _hash = node->value.h_collision.hash;
+        if (hash != _hash) {
+            return split(hasher, out, inc, node, _hash, key, hash, shift);
+        }
+
+        uint32_t len = node->value.h_collision.len;
+        for (uint32_t i = 0; i < len; i++) {
+            if (hasher->equal(key, node->nodes[i]->value.h_leaf.key)) {
+                *out = new_collision(hash, len);
+                for (uint32_t j = 0; j < len; j++) {
+                    (*out)->nodes[j] = j == i? new_leaf(key) : copy_node(node->nodes[j]);
                 }
-                fprintf(stderr, "\n");
-                exit(1);
+                return node->nodes[i]->value.h_leaf.key;
             }
+        }
 
-            uint32_t idx = (hash >> shift) & GTKML_H_MASK;
-            return insert(hasher, &(*out)->value.h_branch.nodes[idx], inc, (*out)->value.h_branch.nodes[idx], key, hash, shift + GTKML_H_BITS);
+        ++*inc;
+        *out = new_collision(hash, len + 1);
+        for (uint32_t i = 0; i < len; i++) {
+            (*out)->nodes[i] = copy_node(node->nodes[i]);
         }
+        (*out)->nodes[len] = new_leaf(key);
+        return gtk_ml_value_none();
+    }
+    }
+}
+
+// like `insert`, but updates the trie rooted at `*slot` in place
+// nodes with a reference count of one are only reachable through `*slot`, so they are mutated directly,
+// anything shared falls back to `insert` and the reference through `*slot` is dropped afterwards
+GtkMl_TaggedValue insert_mut(GtkMl_Hasher *hasher, GtkMl_HashSetNode **slot, size_t *inc, GtkMl_TaggedValue key, GtkMl_Hash hash, uint32_t shift) {
+    GtkMl_HashSetNode *node = *slot;
+
+    if (!node || node->rc != 1) {
+        GtkMl_HashSetNode *out;
+        GtkMl_TaggedValue result = insert(hasher, &out, inc, node, key, hash, shift);
+        del_node(NULL, node, gtk_ml_delete_value);
+        *slot = out;
+        return result;
+    }
+
+    switch (node->kind) {
+    case GTKML_HS_LEAF:
+        if (hasher->equal(key, node->value.h_leaf.key)) {
+            GtkMl_TaggedValue result = node->value.h_leaf.key;
+            node->value.h_leaf.key = key;
+            return result;
+        }
+        break;
     case GTKML_HS_BRANCH: {
-        *out = new_branch();
-        for (size_t i = 0; i < GTKML_H_SIZE; i++) {
-            (*out)->value.h_branch.nodes[i] = copy_node(node->value.h_branch.nodes[i]);
+        uint32_t bitmap = node->value.h_branch.bitmap;
+        uint32_t bit = 1u << ((hash >> shift) & GTKML_H_MASK);
+        uint32_t pos = popcount(bitmap & (bit - 1));
+        uint32_t len = popcount(bitmap);
+
+        if (bitmap & bit) {
+            return insert_mut(hasher, &node->nodes[pos], inc, key, hash, shift + GTKML_H_BITS);
         }
-        uint32_t idx = (hash >> shift) & GTKML_H_MASK;
-        return insert(hasher, &(*out)->value.h_branch.nodes[idx], inc, node->value.h_branch.nodes[idx], key, hash, shift + GTKML_H_BITS);
+
+        ++*inc;
+        node = realloc(node, sizeof(GtkMl_HashSetNode) + sizeof(GtkMl_HashSetNode *) * (len + 1));
+        memmove(&node->nodes[pos + 1], &node->nodes[pos], sizeof(GtkMl_HashSetNode *) * (len - pos));
+        node->nodes[pos] = new_leaf(key);
+        node->value.h_branch.bitmap = bitmap | bit;
+        *slot = node;
+        return gtk_ml_value_none();
+    }
+    case GTKML_HS_COLLISION: {
+        if (hash != node->value.h_collision.hash) {
+            break;
+        }
+
+        uint32_t len = node->value.h_collision.len;
+        for (uint32_t i = 0; i < len; i++) {
+            if (hasher->equal(key, node->nodes[i]->value.h_leaf.key)) {
+                return insert_mut(hasher, &node->nodes[i], inc, key, hash, shift);
+            }
+        }
+
+        ++*inc;
+        node = realloc(node, sizeof(GtkMl_HashSetNode) + sizeof(GtkMl_HashSetNode *) * (len + 1));
+        node->nodes[len] = new_leaf(key);
+        node->value.h_collision.len = len + 1;
+        *slot = node;
+        return gtk_ml_value_none();
     }
     }
+
+    // a leaf or collision node that has to be split, which allocates a new path either way
+    GtkMl_HashSetNode *out;
+    GtkMl_TaggedValue result = insert(hasher, &out, inc, node, key, hash, shift);
+    del_node(NULL, node, gtk_ml_delete_value);
+    *slot = out;
+    return result;
 }
 
 GtkMl_TaggedValue get(GtkMl_Hasher *hasher, GtkMl_HashSetNode *node, GtkMl_TaggedValue key, GtkMl_Hash hash, uint32_t shift) {
@@ -248,14 +428,30 @@ GtkMl_TaggedValue get(GtkMl_Hasher *hasher, GtkMl_HashSetNode *node, GtkMl_Tagge
             return gtk_ml_value_none();
         }
     case GTKML_HS_BRANCH: {
-        uint32_t idx = (hash >> shift) & GTKML_H_MASK;
-        return get(hasher, node->value.h_branch.nodes[idx], key, hash, shift + GTKML_H_BITS);
+        uint32_t bitmap = node->value.h_branch.bitmap;
+        uint32_t bit = 1u << ((hash >> shift) & GTKML_H_MASK);
+        if (!(bitmap & bit)) {
+            return gtk_ml_value_none();
+        }
+        return get(hasher, node->nodes[popcount(bitmap & (bit - 1))], key, hash, shift + GTKML_H_BITS);
     }
+    case GTKML_HS_COLLISION:
+        if (hash != node->value.h_collision.hash) {
+            return gtk_ml_value_none();
+        }
+        for (uint32_t i = 0; i < node->value.h_collision.len; i++) {
+            if (hasher->equal(node->nodes[i]->value.h_leaf.key, key)) {
+                return node->nodes[i]->value.h_leaf.key;
+            }
+        }
+        return gtk_ml_value_none();
     }
 }
 
+// a branch left with a single leaf or collision node is replaced by it, so a trie only depends on its keys
 GtkMl_TaggedValue delete(GtkMl_Hasher *hasher, GtkMl_HashSetNode **out, size_t *dec, GtkMl_HashSetNode *node, GtkMl_TaggedValue key, GtkMl_Hash hash, uint32_t shift) {
     if (!node) {
+        *out = NULL;
         return gtk_ml_value_none();
     }
 
@@ -263,19 +459,77 @@ GtkMl_TaggedValue delete(GtkMl_Hasher *hasher, GtkMl_HashSetNode **out, size_t *
     case GTKML_HS_LEAF:
         if (hasher->equal(node->value.h_leaf.key, key)) {
             --*dec;
-            del_node(NULL, *out, gtk_ml_delete_value);
             *out = NULL;
             return node->value.h_leaf.key;
         } else {
+            *out = copy_node(node);
             return gtk_ml_value_none();
         }
     case GTKML_HS_BRANCH: {
-        *out = new_branch();
-        for (size_t i = 0; i < GTKML_H_SIZE; i++) {
-            (*out)->value.h_branch.nodes[i] = copy_node(node->value.h_branch.nodes[i]);
+        uint32_t bitmap = node->value.h_branch.bitmap;
+        uint32_t bit = 1u << ((hash >> shift) & GTKML_H_MASK);
+        uint32_t pos = popcount(bitmap & (bit - 1));
+        uint32_t len = popcount(bitmap);
+
+        if (!(bitmap & bit)) {
+            *out = copy_node(node);
+            return gtk_ml_value_none();
+        }
+
+        GtkMl_HashSetNode *child;
+        GtkMl_TaggedValue result = delete(hasher, &child, dec, node->nodes[pos], key, hash, shift + GTKML_H_BITS);
+        if (!gtk_ml_has_value(result)) {
+            del_node(NULL, child, gtk_ml_delete_value);
+            *out = copy_node(node);
+            return result;
         }
-        uint32_t idx = (hash >> shift) & GTKML_H_MASK;
-        return delete(hasher, &(*out)->value.h_branch.nodes[idx], dec, node->value.h_branch.nodes[idx], key, hash, shift + GTKML_H_BITS);
+
+        if (child) {
+            if (len == 1 && child->kind != GTKML_HS_BRANCH) {
+                *out = child;
+                return result;
+            }
+            *out = new_branch(bitmap);
+            for (uint32_t i = 0; i < len; i++) {
+                (*out)->nodes[i] = i == pos? child : copy_node(node->nodes[i]);
+            }
+        } else if (len == 1) {
+            *out = NULL;
+        } else if (len == 2 && node->nodes[1 - pos]->kind != GTKML_HS_BRANCH) {
+            *out = copy_node(node->nodes[1 - pos]);
+        } else {
+            *out = new_branch(bitmap & ~bit);
+            for (uint32_t i = 0; i < pos; i++) {
+                (*out)->nodes[i] = copy_node(node->nodes[i]);
+            }
+            for (uint32_t i = pos + 1; i < len; i++) {
+                (*out)->nodes[i - 1] = copy_node(node->nodes[i]);
+            }
+        }
+        return result;
+    }
+    case GTKML_HS_COLLISION: {
+        uint32_t len = node->value.h_collision.len;
+        if (hash == node->value.h_collision.hash) {
+            for (uint32_t i = 0; i < len; i++) {
+                if (hasher->equal(node->nodes[i]->value.h_leaf.key, key)) {
+                    --*dec;
+                    if (len == 2) {
+                        *out = copy_node(node->nodes[1 - i]);
+                    } else {
+                        *out = new_collision(hash, len - 1);
+                        for (uint32_t j = 0; j < len; j++) {
+                            if (j != i) {
+                                (*out)->nodes[j < i? j : j - 1] = copy_node(node->nodes[j]);
+                            }
+                        }
+                    }
+                    return node->nodes[i]->value.h_leaf.key;
+                }
+            }
+        }
+        *out = copy_node(node);
+        return gtk_ml_value_none();
     }
     }
 }
@@ -288,9 +542,11 @@ GtkMl_VisitResult foreach(GtkMl_HashSet *hs, GtkMl_HashSetNode *node, GtkMl_Hash
     switch (node->kind) {
     case GTKML_HS_LEAF:
         return fn(hs, node->value.h_leaf.key, data);
-    case GTKML_HS_BRANCH: {
-        for (size_t i = 0; i < GTKML_H_SIZE; i++) {
-            switch (foreach(hs, node->value.h_branch.nodes[i], fn, data)) {
+    case GTKML_HS_BRANCH:
+    case GTKML_HS_COLLISION: {
+        uint32_t len = n_children(node);
+        for (uint32_t i = 0; i < len; i++) {
+            switch (foreach(hs, node->nodes[i], fn, data)) {
             case GTKML_VISIT_RECURSE:
                 continue;
             case GTKML_VISIT_CONTINUE:
@@ -316,14 +572,39 @@ gboolean equal(GtkMl_Hasher *hasher, GtkMl_HashSetNode *lhs, GtkMl_HashSetNode *
     switch (lhs->kind) {
     case GTKML_HS_LEAF:
         return hasher->equal(lhs->value.h_leaf.key, rhs->value.h_leaf.key);
-    case GTKML_HS_BRANCH:
-        for (size_t i = 0; i < GTKML_H_SIZE; i++) {
-            if (!equal(hasher, lhs->value.h_branch.nodes[i], rhs->value.h_branch.nodes[i])) {
+    case GTKML_HS_BRANCH: {
+        if (lhs->value.h_branch.bitmap != rhs->value.h_branch.bitmap) {
+            return 0;
+        }
+        uint32_t len = popcount(lhs->value.h_branch.bitmap);
+        for (uint32_t i = 0; i < len; i++) {
+            if (!equal(hasher, lhs->nodes[i], rhs->nodes[i])) {
                 return 0;
             }
         }
         return 1;
     }
+    case GTKML_HS_COLLISION: {
+        // the leaves are in insertion order, which two equal tries need not share
+        uint32_t len = lhs->value.h_collision.len;
+        if (lhs->value.h_collision.hash != rhs->value.h_collision.hash || len != rhs->value.h_collision.len) {
+            return 0;
+        }
+        for (uint32_t i = 0; i < len; i++) {
+            gboolean found = 0;
+            for (uint32_t j = 0; j < len; j++) {
+                if (equal(hasher, lhs->nodes[i], rhs->nodes[j])) {
+                    found = 1;
+                    break;
+                }
+            }
+            if (!found) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    }
 }
 
 #ifdef GTKML_ENABLE_POSIX
@@ -343,6 +624,7 @@ void gtk_ml_hash_set_copy_debug(GtkMl_Context *ctx, GtkMl_HashSet *out, GtkMl_Ha
     out->hasher = hs->hasher;
     out->root = copy_node_debug(ctx, hs->root);
     out->len = hs->len;
+    out->hash = 0;
 }
 
 size_t gtk_ml_hash_set_len_debug(GtkMl_Context *ctx, GtkMl_HashSet *hs) {
@@ -367,6 +649,7 @@ gboolean gtk_ml_hash_set_concat_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl
     out->hasher = lhs->hasher;
     out->root = copy_node_debug(ctx, lhs->root);
     out->len = lhs->len;
+    out->hash = 0;
 
     return gtk_ml_hash_set_foreach_debug(ctx, err, rhs, fn_concat_debug, gtk_ml_value_userdata(out));
 }
@@ -375,6 +658,7 @@ GtkMl_TaggedValue gtk_ml_hash_set_insert_debug(GtkMl_Context *ctx, GtkMl_HashSet
     out->hasher = hs->hasher;
     out->root = NULL;
     out->len = hs->len;
+    out->hash = 0;
 
     GtkMl_Hash hash;
     if (!gtk_ml_hash_debug(ctx, hs->hasher, &hash, key)) {
@@ -403,6 +687,7 @@ GtkMl_TaggedValue gtk_ml_hash_set_delete_debug(GtkMl_Context *ctx, GtkMl_HashSet
     out->hasher = hs->hasher;
     out->root = NULL;
     out->len = hs->len;
+    out->hash = 0;
 
     GtkMl_Hash hash;
     if (!gtk_ml_hash_debug(ctx, hs->hasher, &hash, key)) {
@@ -507,13 +792,19 @@ GtkMl_VisitResult foreach_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_HashS
         }
         return fn(ctx, err, hs, key, data);
     }
-    case GTKML_HS_BRANCH: {
-        for (size_t i = 0; i < GTKML_H_SIZE; i++) {
-            GtkMl_HashSetNode **nodes = gtk_ml_dbg_read_ptr(ctx, err, &node->value.h_branch.nodes);
-            if (*err) {
-                return GTKML_VISIT_BREAK;
-            }
-            GtkMl_HashSetNode *next = gtk_ml_dbg_read_ptr(ctx, err, &nodes[i]);
+    case GTKML_HS_BRANCH:
+    case GTKML_HS_COLLISION: {
+        uint32_t len;
+        if (kind == GTKML_HS_BRANCH) {
+            len = popcount(gtk_ml_dbg_read_u32(ctx, err, &node->value.h_branch.bitmap));
+        } else {
+            len = gtk_ml_dbg_read_u32(ctx, err, &node->value.h_collision.len);
+        }
+        if (*err) {
+            return GTKML_VISIT_BREAK;
+        }
+        for (uint32_t i = 0; i < len; i++) {
+            GtkMl_HashSetNode *next = gtk_ml_dbg_read_ptr(ctx, err, &node->nodes[i]);
             if (*err) {
                 return GTKML_VISIT_BREAK;
             }
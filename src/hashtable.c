@@ -0,0 +1,339 @@
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#define GTKML_INCLUDE_INTERNAL
+#include "gtk-ml.h"
+#include "gtk-ml-internal.h"
+
+// a full slot has the low 7 bits of the hash of its key as its control byte instead
+#define GTKML_T_EMPTY 0x80
+#define GTKML_T_DELETED 0xfe
+
+// slots are probed a group of control bytes at a time
+// sse2 compares the 16 bytes of a group at once, everything else compares 8 packed into a word
+#if defined(__SSE2__)
+#define GTKML_T_GROUP 16
+typedef uint32_t GtkMl_GroupMask;
+#else
+#define GTKML_T_GROUP 8
+typedef uint64_t GtkMl_GroupMask;
+#endif
+
+// a table grows once 7/8 of its slots are used
+#define GTKML_T_LOAD(cap) ((cap) - (cap) / 8)
+
+#define GTKML_T_H1(hash) ((hash) >> 7)
+#define GTKML_T_H2(hash) ((uint8_t) ((hash) & 0x7f))
+
+struct GtkMl_HashTableSlot {
+    GtkMl_TaggedValue key;
+    GtkMl_TaggedValue value;
+};
+
+GTKML_PRIVATE GtkMl_GroupMask match_byte(const uint8_t *group, uint8_t byte);
+GTKML_PRIVATE GtkMl_GroupMask match_empty(const uint8_t *group);
+GTKML_PRIVATE GtkMl_GroupMask match_free(const uint8_t *group);
+GTKML_PRIVATE size_t next_match(GtkMl_GroupMask *mask);
+GTKML_PRIVATE size_t find(GtkMl_HashTable *table, GtkMl_TaggedValue key, GtkMl_Hash hash);
+GTKML_PRIVATE size_t find_free(GtkMl_HashTable *table, GtkMl_Hash hash);
+GTKML_PRIVATE void resize(GtkMl_HashTable *table, size_t cap);
+
+void gtk_ml_new_hash_table(GtkMl_HashTable *table, GtkMl_Hasher *hasher) {
+    table->hasher = hasher;
+    table->ctrl = NULL;
+    table->slots = NULL;
+    table->len = 0;
+    table->cap = 0;
+    table->growth_left = 0;
+}
+
+void gtk_ml_del_hash_table(GtkMl_Context *ctx, GtkMl_HashTable *table, void (*deleter)(GtkMl_Context *, GtkMl_TaggedValue)) {
+    for (size_t i = 0; i < table->cap; i++) {
+        if (!(table->ctrl[i] & 0x80)) {
+            deleter(ctx, table->slots[i].key);
+            deleter(ctx, table->slots[i].value);
+        }
+    }
+    free(table->ctrl);
+    free(table->slots);
+    table->ctrl = NULL;
+    table->slots = NULL;
+    table->len = 0;
+    table->cap = 0;
+    table->growth_left = 0;
+}
+
+size_t gtk_ml_hash_table_len(GtkMl_HashTable *table) {
+    return table->len;
+}
+
+GtkMl_TaggedValue gtk_ml_hash_table_insert(GtkMl_HashTable *table, GtkMl_TaggedValue key, GtkMl_TaggedValue value) {
+    GtkMl_Hash hash;
+    if (!gtk_ml_hash(table->hasher, &hash, key)) {
+        return gtk_ml_value_none();
+    }
+
+    size_t idx = find(table, key, hash);
+    if (idx != table->cap) {
+        GtkMl_TaggedValue result = table->slots[idx].value;
+        table->slots[idx].key = key;
+        table->slots[idx].value = value;
+        return result;
+    }
+
+    idx = find_free(table, hash);
+    if (table->cap == 0 || (table->growth_left == 0 && table->ctrl[idx] == GTKML_T_EMPTY)) {
+        // tombstones are dropped by rehashing in place as long as they make up at least half the load
+        if (table->cap && table->len < GTKML_T_LOAD(table->cap) / 2) {
+            resize(table, table->cap);
+        } else {
+            resize(table, table->cap? 2 * table->cap : GTKML_T_GROUP);
+        }
+        idx = find_free(table, hash);
+    }
+
+    if (table->ctrl[idx] == GTKML_T_EMPTY) {
+        --table->growth_left;
+    }
+    table->ctrl[idx] = GTKML_T_H2(hash);
+    table->slots[idx].key = key;
+    table->slots[idx].value = value;
+    ++table->len;
+
+    return gtk_ml_value_none();
+}
+
+GtkMl_TaggedValue gtk_ml_hash_table_get(GtkMl_HashTable *table, GtkMl_TaggedValue key) {
+    GtkMl_Hash hash;
+    if (!gtk_ml_hash(table->hasher, &hash, key)) {
+        return gtk_ml_value_none();
+    }
+
+    size_t idx = find(table, key, hash);
+    if (idx == table->cap) {
+        return gtk_ml_value_none();
+    }
+    return table->slots[idx].value;
+}
+
+gboolean gtk_ml_hash_table_contains(GtkMl_HashTable *table, GtkMl_TaggedValue key) {
+    GtkMl_Hash hash;
+    if (!gtk_ml_hash(table->hasher, &hash, key)) {
+        return 0;
+    }
+
+    return find(table, key, hash) != table->cap;
+}
+
+GtkMl_TaggedValue gtk_ml_hash_table_delete(GtkMl_HashTable *table, GtkMl_TaggedValue key) {
+    GtkMl_Hash hash;
+    if (!gtk_ml_hash(table->hasher, &hash, key)) {
+        return gtk_ml_value_none();
+    }
+
+    size_t idx = find(table, key, hash);
+    if (idx == table->cap) {
+        return gtk_ml_value_none();
+    }
+
+    // a lookup only stops at a group with an empty slot in it,
+    // so if this group already has one no probe sequence runs past it and the slot can be emptied
+    size_t group = idx & ~(size_t) (GTKML_T_GROUP - 1);
+    if (match_empty(table->ctrl + group)) {
+        table->ctrl[idx] = GTKML_T_EMPTY;
+        ++table->growth_left;
+    } else {
+        table->ctrl[idx] = GTKML_T_DELETED;
+    }
+    --table->len;
+
+    return table->slots[idx].value;
+}
+
+void gtk_ml_hash_table_foreach(GtkMl_HashTable *table, GtkMl_HashTableFn fn, GtkMl_TaggedValue data) {
+    for (size_t i = 0; i < table->cap; i++) {
+        if (!(table->ctrl[i] & 0x80)) {
+            if (fn(table, table->slots[i].key, table->slots[i].value, data) == GTKML_VISIT_BREAK) {
+                return;
+            }
+        }
+    }
+}
+
+GTKML_PRIVATE GtkMl_VisitResult fn_from_trie(GtkMl_HashTrie *ht, GtkMl_TaggedValue key, GtkMl_TaggedValue value, GtkMl_TaggedValue data) {
+    (void) ht;
+
+    GtkMl_HashTable *dest = data.value.userdata;
+    gtk_ml_hash_table_insert(dest, key, value);
+
+    return GTKML_VISIT_RECURSE;
+}
+
+void gtk_ml_hash_table_from_trie(GtkMl_HashTable *out, GtkMl_HashTrie *ht) {
+    gtk_ml_new_hash_table(out, ht->hasher);
+
+    size_t len = gtk_ml_hash_trie_len(ht);
+    if (len) {
+        size_t cap = GTKML_T_GROUP;
+        while (GTKML_T_LOAD(cap) < len) {
+            cap *= 2;
+        }
+        resize(out, cap);
+    }
+
+    gtk_ml_hash_trie_foreach(ht, fn_from_trie, gtk_ml_value_userdata(out));
+}
+
+void gtk_ml_hash_trie_from_table(GtkMl_HashTrie *out, GtkMl_HashTable *table) {
+    gtk_ml_new_hash_trie(out, table->hasher);
+
+    for (size_t i = 0; i < table->cap; i++) {
+        if (!(table->ctrl[i] & 0x80)) {
+            gtk_ml_hash_trie_transient_insert(out, table->slots[i].key, table->slots[i].value);
+        }
+    }
+}
+
+#if defined(__SSE2__)
+GtkMl_GroupMask match_byte(const uint8_t *group, uint8_t byte) {
+    __m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+    return (GtkMl_GroupMask) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) byte)));
+}
+
+GtkMl_GroupMask match_empty(const uint8_t *group) {
+    return match_byte(group, GTKML_T_EMPTY);
+}
+
+GtkMl_GroupMask match_free(const uint8_t *group) {
+    // empty and deleted are the only control bytes with their high bit set
+    return (GtkMl_GroupMask) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+}
+
+size_t next_match(GtkMl_GroupMask *mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    size_t i = __builtin_ctz(*mask);
+#else
+    size_t i = 0;
+    while (!(*mask & (1u << i))) {
+        ++i;
+    }
+#endif
+    *mask &= *mask - 1;
+    return i;
+}
+#else
+#define GTKML_T_LSBS 0x0101010101010101ull
+#define GTKML_T_MSBS 0x8080808080808080ull
+
+GTKML_PRIVATE uint64_t load_group(const uint8_t *group) {
+    // little endian no matter the host, so byte `i` is always the one at bit `8 * i`
+    uint64_t word = 0;
+    for (size_t i = 0; i < GTKML_T_GROUP; i++) {
+        word |= (uint64_t) group[i] << (8 * i);
+    }
+    return word;
+}
+
+GtkMl_GroupMask match_byte(const uint8_t *group, uint8_t byte) {
+    // may report a byte right after a real match as a match too, the keys are compared anyway
+    uint64_t word = load_group(group) ^ (GTKML_T_LSBS * byte);
+    return (word - GTKML_T_LSBS) & ~word & GTKML_T_MSBS;
+}
+
+GtkMl_GroupMask match_empty(const uint8_t *group) {
+    // empty is the only control byte with its high bit set and its second lowest bit clear
+    uint64_t word = load_group(group);
+    return word & ~(word << 6) & GTKML_T_MSBS;
+}
+
+GtkMl_GroupMask match_free(const uint8_t *group) {
+    return load_group(group) & GTKML_T_MSBS;
+}
+
+size_t next_match(GtkMl_GroupMask *mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    size_t i = __builtin_ctzll(*mask) / 8;
+#else
+    size_t i = 0;
+    while (!(*mask & (0x80ull << (8 * i)))) {
+        ++i;
+    }
+#endif
+    *mask &= *mask - 1;
+    return i;
+}
+#endif
+
+// returns `table->cap` if `key` is not in the table
+// groups are visited in triangular order, which reaches every group of a power of two table
+size_t find(GtkMl_HashTable *table, GtkMl_TaggedValue key, GtkMl_Hash hash) {
+    if (!table->cap) {
+        return 0;
+    }
+
+    size_t mask = table->cap / GTKML_T_GROUP - 1;
+    size_t group = GTKML_T_H1(hash) & mask;
+    uint8_t h2 = GTKML_T_H2(hash);
+    for (size_t stride = 1;; stride++) {
+        const uint8_t *ctrl = table->ctrl + group * GTKML_T_GROUP;
+        GtkMl_GroupMask matches = match_byte(ctrl, h2);
+        while (matches) {
+            size_t idx = group * GTKML_T_GROUP + next_match(&matches);
+            if (table->hasher->equal(key, table->slots[idx].key)) {
+                return idx;
+            }
+        }
+        if (match_empty(ctrl)) {
+            return table->cap;
+        }
+        group = (group + stride) & mask;
+    }
+}
+
+// the first empty or deleted slot on the probe sequence of `hash`, or 0 if the table has no slots
+size_t find_free(GtkMl_HashTable *table, GtkMl_Hash hash) {
+    if (!table->cap) {
+        return 0;
+    }
+
+    size_t mask = table->cap / GTKML_T_GROUP - 1;
+    size_t group = GTKML_T_H1(hash) & mask;
+    for (size_t stride = 1;; stride++) {
+        GtkMl_GroupMask matches = match_free(table->ctrl + group * GTKML_T_GROUP);
+        if (matches) {
+            return group * GTKML_T_GROUP + next_match(&matches);
+        }
+        group = (group + stride) & mask;
+    }
+}
+
+void resize(GtkMl_HashTable *table, size_t cap) {
+    uint8_t *ctrl = table->ctrl;
+    GtkMl_HashTableSlot *slots = table->slots;
+    size_t old_cap = table->cap;
+
+    table->ctrl = malloc(cap);
+    memset(table->ctrl, GTKML_T_EMPTY, cap);
+    table->slots = malloc(sizeof(GtkMl_HashTableSlot) * cap);
+    table->cap = cap;
+    table->growth_left = GTKML_T_LOAD(cap);
+
+    for (size_t i = 0; i < old_cap; i++) {
+        if (!(ctrl[i] & 0x80)) {
+            // every key in the table was hashed before it was inserted
+            GtkMl_Hash hash = 0;
+            if (!gtk_ml_hash(table->hasher, &hash, slots[i].key)) {
+                continue;
+            }
+            size_t idx = find_free(table, hash);
+            table->ctrl[idx] = GTKML_T_H2(hash);
+            table->slots[idx] = slots[i];
+            --table->growth_left;
+        }
+    }
+
+    free(ctrl);
+    free(slots);
+}
@@ -130,9 +130,7 @@ GtkMl_SObj gtk_ml_parse_set(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Token **t
 
         span_add(&span, &span, &(*tokenv)[0].span);
 
-        GtkMl_SObj set = result;
-        result = gtk_ml_new_set(ctx, &span);
-        gtk_ml_hash_set_insert(&result->value.s_set.set, &set->value.s_set.set, gtk_ml_value_sobject(key));
+        gtk_ml_hash_set_transient_insert(&result->value.s_set.set, gtk_ml_value_sobject(key));
     }
 
     result->span = span;
@@ -297,9 +295,7 @@ GtkMl_SObj gtk_ml_parse_array(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Token *
 
         span_add(&span, &span, &(*tokenv)[0].span);
 
-        GtkMl_SObj array = result;
-        result = gtk_ml_new_array(ctx, &span);
-        gtk_ml_array_trie_push(&result->value.s_array.array, &array->value.s_array.array, gtk_ml_value_sobject(elem));
+        gtk_ml_array_trie_transient_push(&result->value.s_array.array, gtk_ml_value_sobject(elem));
     }
 
     result->span = span;
@@ -351,9 +347,7 @@ GtkMl_SObj gtk_ml_parse_map(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Token **t
 
         span_add(&span, &span, &(*tokenv)[0].span);
 
-        GtkMl_SObj map = result;
-        result = gtk_ml_new_map(ctx, &span, NULL);
-        gtk_ml_hash_trie_insert(&result->value.s_map.map, &map->value.s_map.map, gtk_ml_value_sobject(key), gtk_ml_value_sobject(value));
+        gtk_ml_hash_trie_transient_insert(&result->value.s_map.map, gtk_ml_value_sobject(key), gtk_ml_value_sobject(value));
     }
 
     result->span = span;
@@ -1,5 +1,11 @@
 #include <stdlib.h>
 #include <string.h>
+#ifdef GTKML_ENABLE_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif /* GTKML_ENABLE_POSIX */
 #ifdef GTKML_ENABLE_GTK
 #include <gtk/gtk.h>
 #endif /* GTKML_ENABLE_GTK */
@@ -95,10 +101,7 @@ gboolean gtk_ml_serf_sobject(GtkMl_Serializer *serf, GtkMl_Context *ctx, FILE *s
     }
 
     uint64_t offset = ftell(stream);
-    GtkMl_HashTrie ptr_map;
-    gtk_ml_new_hash_trie(&ptr_map, &GTKML_PTR_HASHER);
-    gtk_ml_hash_trie_insert(&ptr_map, &serf->ptr_map, gtk_ml_value_sobject(value), gtk_ml_value_uint(offset));
-    serf->ptr_map = ptr_map;
+    gtk_ml_hash_trie_transient_insert(&serf->ptr_map, gtk_ml_value_sobject(value), gtk_ml_value_uint(offset));
 
     fprintf(stream, "GTKML-S(");
     uint32_t kind = value->kind;
@@ -156,6 +159,7 @@ gboolean gtk_ml_serf_sobject(GtkMl_Serializer *serf, GtkMl_Context *ctx, FILE *s
         break;
     case GTKML_S_LIGHTDATA:
     case GTKML_S_USERDATA:
+    case GTKML_S_TABLE:
         *err = gtk_ml_error(ctx, "ser-error", GTKML_ERR_SER_ERROR, value->span.ptr != NULL, value->span.line, value->span.col, 0);
         return 0;
     case GTKML_S_LAMBDA:
@@ -328,9 +332,9 @@ GtkMl_SObj gtk_ml_deserf_sobject(GtkMl_Deserializer *deserf, GtkMl_Context *ctx,
         fread(&len, sizeof(uint64_t), 1, stream);
         char *ptr = malloc(len);
         fread(ptr, 1, len, stream);
-        result->value.s_symbol.owned = 1; 
-        result->value.s_symbol.ptr = ptr;
-        result->value.s_symbol.len = len;
+        // symbols are interned, the cell above is left to the gc
+        result->kind = GTKML_S_NIL;
+        result = gtk_ml_new_symbol(ctx, NULL, 1, ptr, len);
         break;
     }
     case GTKML_S_KEYWORD: {
@@ -338,9 +342,9 @@ GtkMl_SObj gtk_ml_deserf_sobject(GtkMl_Deserializer *deserf, GtkMl_Context *ctx,
         fread(&len, sizeof(uint64_t), 1, stream);
         char *ptr = malloc(len);
         fread(ptr, 1, len, stream);
-        result->value.s_keyword.owned = 1; 
-        result->value.s_keyword.ptr = ptr;
-        result->value.s_keyword.len = len;
+        // keywords are interned, the cell above is left to the gc
+        result->kind = GTKML_S_NIL;
+        result = gtk_ml_new_keyword(ctx, NULL, 1, ptr, len);
         break;
     }
     case GTKML_S_LIST: {
@@ -350,17 +354,28 @@ GtkMl_SObj gtk_ml_deserf_sobject(GtkMl_Deserializer *deserf, GtkMl_Context *ctx,
         if (next != ')') {
             fseek(stream, -1, SEEK_CUR);
         }
-        GtkMl_SObj *tail = &result;
+        size_t len = 0;
+        size_t cap = 16;
+        GtkMl_SObj *values = malloc(sizeof(GtkMl_SObj) * cap);
         while (next != ')') {
             GtkMl_SObj value = gtk_ml_deserf_sobject(deserf, ctx, stream, err);
             if (!value) {
+                free(values);
                 return NULL;
             }
-            *tail = gtk_ml_new_list(ctx, NULL, value, gtk_ml_new_nil(ctx, NULL));
-            tail = &gtk_ml_cdr(*tail);
+            if (len == cap) {
+                cap *= 2;
+                values = realloc(values, sizeof(GtkMl_SObj) * cap);
+            }
+            values[len++] = value;
             fread(&next, 1, 1, stream);
         }
         fseek(stream, -1, SEEK_CUR);
+        // cells can't be changed once made, so the list is made back to front
+        while (len) {
+            result = gtk_ml_new_list(ctx, NULL, values[--len], result);
+        }
+        free(values);
         break;
     }
     case GTKML_S_MAP: {
@@ -385,9 +400,7 @@ GtkMl_SObj gtk_ml_deserf_sobject(GtkMl_Deserializer *deserf, GtkMl_Context *ctx,
             if (!value) {
                 return NULL;
             }
-            GtkMl_SObj new = gtk_ml_new_map(ctx, NULL, NULL);
-            gtk_ml_hash_trie_insert(&new->value.s_map.map, &result->value.s_map.map, gtk_ml_value_sobject(key), gtk_ml_value_sobject(value));
-            result = new;
+            gtk_ml_hash_trie_transient_insert(&result->value.s_map.map, gtk_ml_value_sobject(key), gtk_ml_value_sobject(value));
             fread(&next, 1, 1, stream);
         }
         uint32_t has_metamap;
@@ -414,9 +427,7 @@ GtkMl_SObj gtk_ml_deserf_sobject(GtkMl_Deserializer *deserf, GtkMl_Context *ctx,
             if (!key) {
                 return NULL;
             }
-            GtkMl_SObj new = gtk_ml_new_set(ctx, NULL);
-            gtk_ml_hash_set_insert(&new->value.s_set.set, &result->value.s_set.set, gtk_ml_value_sobject(key));
-            result = new;
+            gtk_ml_hash_set_transient_insert(&result->value.s_set.set, gtk_ml_value_sobject(key));
             fread(&next, 1, 1, stream);
         }
         fseek(stream, -1, SEEK_CUR);
@@ -428,13 +439,11 @@ GtkMl_SObj gtk_ml_deserf_sobject(GtkMl_Deserializer *deserf, GtkMl_Context *ctx,
         if (is_string) {
             uint64_t len;
             fread(&len, sizeof(uint64_t), 1, stream);
-            gtk_ml_new_array_trie(&result->value.s_array.array);
+            gtk_ml_new_string_trie(&result->value.s_array.array);
             for (size_t i = 0; i < len; i++) {
                 uint32_t unicode;
                 fread(&unicode, sizeof(uint32_t), 1, stream);
-                GtkMl_SObj new = gtk_ml_new_array(ctx, NULL);
-                gtk_ml_array_trie_push(&new->value.s_array.array, &result->value.s_array.array, gtk_ml_value_char(unicode));
-                result = new;
+                gtk_ml_array_trie_transient_push(&result->value.s_array.array, gtk_ml_value_char(unicode));
             }
         } else {
             char next = 0;
@@ -448,14 +457,11 @@ GtkMl_SObj gtk_ml_deserf_sobject(GtkMl_Deserializer *deserf, GtkMl_Context *ctx,
                 if (!value) {
                     return NULL;
                 }
-                GtkMl_SObj new = gtk_ml_new_array(ctx, NULL);
-                gtk_ml_array_trie_push(&new->value.s_array.array, &result->value.s_array.array, gtk_ml_value_sobject(value));
-                result = new;
+                gtk_ml_array_trie_transient_push(&result->value.s_array.array, gtk_ml_value_sobject(value));
                 fread(&next, 1, 1, stream);
             }
             fseek(stream, -1, SEEK_CUR);
         }
-        result->value.s_array.array.string = is_string;
         break;
     }
     case GTKML_S_VAR: {
@@ -538,6 +544,7 @@ GtkMl_SObj gtk_ml_deserf_sobject(GtkMl_Deserializer *deserf, GtkMl_Context *ctx,
         result->value.s_program.args = args;
         result->value.s_program.body = body;
         result->value.s_program.capture = capture;
+        result->value.s_program.variadic = gtk_ml_params_variadic(args);
         break;
     }
     case GTKML_S_ADDRESS: {
@@ -571,6 +578,7 @@ GtkMl_SObj gtk_ml_deserf_sobject(GtkMl_Deserializer *deserf, GtkMl_Context *ctx,
     }
     case GTKML_S_LIGHTDATA:
     case GTKML_S_USERDATA:
+    case GTKML_S_TABLE:
         *err = gtk_ml_error(ctx, "deser-error", GTKML_ERR_DESER_ERROR, 0, 0, 0, 0);
         return 0;
     default:
@@ -588,10 +596,7 @@ GtkMl_SObj gtk_ml_deserf_sobject(GtkMl_Deserializer *deserf, GtkMl_Context *ctx,
     }
     free(end);
 
-    GtkMl_HashTrie offset_map;
-    gtk_ml_new_hash_trie(&offset_map, &GTKML_PTR_HASHER);
-    gtk_ml_hash_trie_insert(&offset_map, &deserf->offset_map, gtk_ml_value_uint(offset), gtk_ml_value_sobject(result));
-    deserf->offset_map = offset_map;
+    gtk_ml_hash_trie_transient_insert(&deserf->offset_map, gtk_ml_value_uint(offset), gtk_ml_value_sobject(result));
 
     return result;
 }
@@ -626,65 +631,807 @@ gboolean gtk_ml_serf_program(GtkMl_Serializer *serf, GtkMl_Context *ctx, FILE *s
     return 1;
 }
 
+// drops a program that could not be read, it is always the last one made
+GTKML_PRIVATE GtkMl_Program *deserf_program_error(GtkMl_Deserializer *deserf, GtkMl_Context *ctx, GtkMl_SObj *err, gboolean keep_err) {
+    gtk_ml_del_program(ctx->gc->programs[--ctx->gc->program_len]);
+    gtk_ml_del_hash_trie(ctx, &deserf->offset_map, gtk_ml_delete_value);
+    if (!keep_err) {
+        *err = gtk_ml_error(ctx, "deser-error", GTKML_ERR_DESER_ERROR, 0, 0, 0, 0);
+    }
+    return NULL;
+}
+
 GtkMl_Program *gtk_ml_deserf_program(GtkMl_Deserializer *deserf, GtkMl_Context *ctx, FILE *stream, GtkMl_SObj *err) {
     if (ctx->gc->program_len == ctx->gc->program_cap) {
         ctx->gc->program_cap *= 2;
         ctx->gc->programs = realloc(ctx->gc->programs, sizeof(GtkMl_Program *) * ctx->gc->program_cap);
     }
-    ctx->gc->programs[ctx->gc->program_len] = malloc(sizeof(GtkMl_Program));
+    ctx->gc->programs[ctx->gc->program_len] = calloc(1, sizeof(GtkMl_Program));
     GtkMl_Program *program = ctx->gc->programs[ctx->gc->program_len++];
+    gtk_ml_new_hash_table(&program->exports, &GTKML_C_STR_HASHER);
 
-    char *gtkml_p = malloc(strlen("GTKML-P(") + 1);
-    fread(gtkml_p, 1, strlen("GTKML-P("), stream);
-    gtkml_p[strlen("GTKML-P(")] = 0;
-    if (strcmp(gtkml_p, "GTKML-P(") != 0) {
-        free(gtkml_p);
-        *err = gtk_ml_error(ctx, "deser-error", GTKML_ERR_DESER_ERROR, 0, 0, 0, 0);
-        return NULL;
+    char gtkml_p[sizeof("GTKML-P(")] = {0};
+    if (fread(gtkml_p, 1, strlen("GTKML-P("), stream) != strlen("GTKML-P(") || strcmp(gtkml_p, "GTKML-P(") != 0) {
+        return deserf_program_error(deserf, ctx, err, 0);
     }
-    free(gtkml_p);
 
     uint64_t n_start;
-    fread(&n_start, sizeof(uint64_t), 1, stream);
+    if (fread(&n_start, sizeof(uint64_t), 1, stream) != 1) {
+        return deserf_program_error(deserf, ctx, err, 0);
+    }
     program->start = malloc(n_start + 1);
-    fread((void *) program->start, 1, n_start + 1, stream);
+    if (fread((void *) program->start, 1, n_start + 1, stream) != n_start + 1) {
+        return deserf_program_error(deserf, ctx, err, 0);
+    }
 
     uint64_t n_text;
-    fread(&n_text, sizeof(uint64_t), 1, stream);
+    if (fread(&n_text, sizeof(uint64_t), 1, stream) != 1) {
+        return deserf_program_error(deserf, ctx, err, 0);
+    }
+    program->text = malloc(sizeof(GtkMl_Instruction) * n_text);
+    if (fread(program->text, sizeof(GtkMl_Instruction), n_text, stream) != n_text) {
+        return deserf_program_error(deserf, ctx, err, 0);
+    }
     program->n_text = n_text;
-    program->text = malloc(sizeof(GtkMl_Instruction) * program->n_text);
-    fread(program->text, sizeof(GtkMl_Instruction), program->n_text, stream);
 
     uint64_t n_data;
-    fread(&n_data, sizeof(uint64_t), 1, stream);
+    if (fread(&n_data, sizeof(uint64_t), 1, stream) != 1) {
+        return deserf_program_error(deserf, ctx, err, 0);
+    }
+    program->data = malloc(sizeof(GtkMl_TaggedValue) * n_data);
+    if (fread(program->data, sizeof(GtkMl_TaggedValue), n_data, stream) != n_data) {
+        return deserf_program_error(deserf, ctx, err, 0);
+    }
     program->n_data = n_data;
-    program->data = malloc(sizeof(GtkMl_TaggedValue) * program->n_data);
-    fread(program->data, sizeof(GtkMl_TaggedValue), program->n_data, stream);
 
     uint64_t n_static;
-    fread(&n_static, sizeof(uint64_t), 1, stream);
-    program->n_static = n_static;
-    program->statics = malloc(sizeof(GtkMl_SObj) * program->n_static);
+    if (fread(&n_static, sizeof(uint64_t), 1, stream) != 1) {
+        return deserf_program_error(deserf, ctx, err, 0);
+    }
+    program->statics = calloc(n_static, sizeof(GtkMl_SObj));
 
-    for (size_t i = 1; i < program->n_static; i++) {
+    // statics are only marked once they are read
+    for (size_t i = 1; i < n_static; i++) {
         GtkMl_SObj value = gtk_ml_deserf_sobject(deserf, ctx, stream, err);
         if (!value) {
-            return NULL;
+            return deserf_program_error(deserf, ctx, err, 1);
         }
         program->statics[i] = value;
+        program->n_static = i + 1;
     }
+    program->n_static = n_static;
 
-    char *end = malloc(2);
-    fread(end, 1, 1, stream);
-    end[1] = 0;
-    if (strcmp(end, ")") != 0) {
-        free(end);
-        *err = gtk_ml_error(ctx, "deser-error", GTKML_ERR_DESER_ERROR, 0, 0, 0, 0);
-        return NULL;
+    char end[2] = {0};
+    if (fread(end, 1, 1, stream) != 1 || strcmp(end, ")") != 0) {
+        return deserf_program_error(deserf, ctx, err, 0);
     }
-    free(end);
 
     gtk_ml_del_hash_trie(ctx, &deserf->offset_map, gtk_ml_delete_value);
 
+    gtk_ml_index_exports(program);
+
+    return program;
+}
+
+#define GTKML_IMAGE_MAGIC "GTKML-I"
+#define GTKML_IMAGE_VERSION 1
+// the gc stops marking at reachable old objects and only sweeps slabs, so it never looks at image cells
+#define GTKML_IMAGE_FLAGS (GTKML_FLAG_REACHABLE | GTKML_FLAG_OLD | GTKML_FLAG_IMAGE)
+
+// the first bytes of an image, offsets are from the start of the image
+// text and data are used as they are, statics and everything after them is fixed up when mapped
+typedef struct GtkMl_ImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t layout[5]; // the sizes of the structures in the image, see `image_layout`
+    uint64_t size;
+    uint64_t start;
+    uint64_t text;
+    uint64_t n_text;
+    uint64_t data;
+    uint64_t n_data;
+    uint64_t statics;
+    uint64_t n_static;
+    uint64_t heap;
+    uint64_t n_heap;
+    uint64_t relocs;
+    uint64_t n_relocs;
+    uint64_t heap_relocs;
+    uint64_t n_heap_relocs;
+} GtkMl_ImageHeader;
+
+struct ImageItems {
+    GtkMl_SObj *items;
+    size_t len;
+    size_t cap;
+    gboolean result;
+};
+
+GTKML_PRIVATE uint64_t image_ref(GtkMl_ImageWriter *w, GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_SObj value);
+
+GTKML_PRIVATE void image_layout(uint32_t *layout) {
+    layout[0] = sizeof(void *);
+    layout[1] = sizeof(GtkMl_S);
+    layout[2] = sizeof(GtkMl_Instruction);
+    layout[3] = sizeof(GtkMl_TaggedValue);
+    layout[4] = sizeof(GtkMl_ImageHeap);
+}
+
+// statics start on a page of their own, so mapping an image only ever writes to their pages
+GTKML_PRIVATE size_t image_page() {
+#ifdef GTKML_ENABLE_POSIX
+    long page = sysconf(_SC_PAGESIZE);
+    if (page > 0) {
+        return (size_t) page;
+    }
+#endif /* GTKML_ENABLE_POSIX */
+    return 4096;
+}
+
+GTKML_PRIVATE uint64_t image_alloc_aligned(GtkMl_ImageWriter *w, size_t size, size_t align) {
+    uint64_t at = (w->len + align - 1) / align * align;
+    if (at + size > w->cap) {
+        while (at + size > w->cap) {
+            w->cap *= 2;
+        }
+        w->bytes = realloc(w->bytes, w->cap);
+    }
+    memset(w->bytes + w->len, 0, at + size - w->len);
+    w->len = at + size;
+    return at;
+}
+
+uint64_t gtk_ml_image_alloc(GtkMl_ImageWriter *w, size_t size) {
+    return image_alloc_aligned(w, size, 16);
+}
+
+void gtk_ml_image_pointer(GtkMl_ImageWriter *w, uint64_t at, uint64_t target) {
+    uintptr_t offset = target;
+    memcpy(w->bytes + at, &offset, sizeof(uintptr_t));
+
+    if (w->n_relocs == w->cap_relocs) {
+        w->cap_relocs *= 2;
+        w->relocs = realloc(w->relocs, sizeof(uint64_t) * w->cap_relocs);
+    }
+    w->relocs[w->n_relocs++] = at;
+}
+
+GTKML_PRIVATE uint64_t image_copy(GtkMl_ImageWriter *w, const void *ptr, size_t size) {
+    uint64_t at = gtk_ml_image_alloc(w, size);
+    if (size) {
+        memcpy(w->bytes + at, ptr, size);
+    }
+    return at;
+}
+
+// everything in an image is aligned to 16, so references to heap statics are told apart by being odd
+GTKML_PRIVATE void image_field(GtkMl_ImageWriter *w, uint64_t at, uint64_t ref) {
+    if (ref & 1) {
+        if (w->n_heap_relocs == w->cap_heap_relocs) {
+            w->cap_heap_relocs *= 2;
+            w->heap_relocs = realloc(w->heap_relocs, sizeof(GtkMl_ImageHeapReloc) * w->cap_heap_relocs);
+        }
+        w->heap_relocs[w->n_heap_relocs].at = at;
+        w->heap_relocs[w->n_heap_relocs].heap = ref >> 1;
+        ++w->n_heap_relocs;
+    } else {
+        gtk_ml_image_pointer(w, at, ref);
+    }
+}
+
+// NULL pointers are left as they are
+GTKML_PRIVATE gboolean image_child(GtkMl_ImageWriter *w, GtkMl_Context *ctx, GtkMl_SObj *err, uint64_t at, GtkMl_SObj value) {
+    if (!value) {
+        return 1;
+    }
+    uint64_t ref = image_ref(w, ctx, err, value);
+    if (!ref) {
+        return 0;
+    }
+    image_field(w, at, ref);
+    return 1;
+}
+
+// writes everything but the pointers of a cell
+GTKML_PRIVATE uint64_t image_new_cell(GtkMl_ImageWriter *w, GtkMl_SObj value) {
+    GtkMl_S cell;
+    memset(&cell, 0, sizeof(GtkMl_S));
+    cell.flags = GTKML_IMAGE_FLAGS;
+    cell.kind = value->kind;
+
+    switch (value->kind) {
+    case GTKML_S_INT:
+    case GTKML_S_FLOAT:
+    case GTKML_S_CHAR:
+        cell.value = value->value;
+        break;
+    case GTKML_S_LIST:
+        cell.value.s_list.len = value->value.s_list.len;
+        break;
+    case GTKML_S_ARRAY:
+        cell.value.s_array.array.len = value->value.s_array.array.len;
+        cell.value.s_array.array.string = 1;
+        break;
+    case GTKML_S_PROGRAM:
+        cell.value.s_program.addr = value->value.s_program.addr;
+        cell.value.s_program.kind = value->value.s_program.kind;
+        cell.value.s_program.variadic = value->value.s_program.variadic;
+        break;
+    case GTKML_S_ADDRESS:
+        cell.value.s_address.addr = value->value.s_address.addr;
+        break;
+    default:
+        break;
+    }
+
+    uint64_t at = image_copy(w, &cell, sizeof(GtkMl_S));
+    gtk_ml_hash_table_insert(&w->refs, gtk_ml_value_sobject(value), gtk_ml_value_uint(at));
+    return at;
+}
+
+GTKML_PRIVATE uint64_t image_cell(GtkMl_ImageWriter *w, GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_SObj value) {
+    uint64_t first = image_new_cell(w, value);
+    uint64_t at = first;
+
+    gboolean result = 1;
+    switch (value->kind) {
+    case GTKML_S_NIL:
+    case GTKML_S_TRUE:
+    case GTKML_S_FALSE:
+    case GTKML_S_INT:
+    case GTKML_S_FLOAT:
+    case GTKML_S_CHAR:
+        break;
+    case GTKML_S_ARRAY: {
+        uint64_t rope = gtk_ml_string_image(w, &value->value.s_array.array);
+        if (rope) {
+            gtk_ml_image_pointer(w, at + offsetof(GtkMl_S, value.s_array.array.rope), rope);
+        }
+    } break;
+    case GTKML_S_LIST:
+        // the spine of a list is followed instead of recursed into
+        for (;;) {
+            if (!image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_list.car), value->value.s_list.car)) {
+                return 0;
+            }
+            GtkMl_SObj cdr = value->value.s_list.cdr;
+            if (cdr->kind != GTKML_S_LIST || gtk_ml_hash_table_contains(&w->refs, gtk_ml_value_sobject(cdr))) {
+                result = image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_list.cdr), cdr);
+                break;
+            }
+            uint64_t next = image_new_cell(w, cdr);
+            gtk_ml_image_pointer(w, at + offsetof(GtkMl_S, value.s_list.cdr), next);
+            at = next;
+            value = cdr;
+        }
+        break;
+    case GTKML_S_VARARG:
+        result = image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_vararg.expr), value->value.s_vararg.expr);
+        break;
+    case GTKML_S_QUOTE:
+        result = image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_quote.expr), value->value.s_quote.expr);
+        break;
+    case GTKML_S_QUASIQUOTE:
+        result = image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_quasiquote.expr), value->value.s_quasiquote.expr);
+        break;
+    case GTKML_S_UNQUOTE:
+        result = image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_unquote.expr), value->value.s_unquote.expr);
+        break;
+    case GTKML_S_LAMBDA:
+        result = image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_lambda.args), value->value.s_lambda.args)
+            && image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_lambda.body), value->value.s_lambda.body)
+            && image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_lambda.capture), value->value.s_lambda.capture);
+        break;
+    case GTKML_S_MACRO:
+        result = image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_macro.args), value->value.s_macro.args)
+            && image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_macro.body), value->value.s_macro.body)
+            && image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_macro.capture), value->value.s_macro.capture);
+        break;
+    case GTKML_S_PROGRAM:
+        result = image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_program.linkage_name), value->value.s_program.linkage_name)
+            && image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_program.args), value->value.s_program.args)
+            && image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_program.body), value->value.s_program.body)
+            && image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_program.capture), value->value.s_program.capture);
+        break;
+    case GTKML_S_ADDRESS:
+        result = image_child(w, ctx, err, at + offsetof(GtkMl_S, value.s_address.linkage_name), value->value.s_address.linkage_name);
+        break;
+    default:
+        *err = gtk_ml_error(ctx, "invalid-sexpr", GTKML_ERR_INVALID_SEXPR, 0, 0, 0, 0);
+        return 0;
+    }
+
+    return result? first : 0;
+}
+
+GTKML_PRIVATE void image_item(struct ImageItems *items, GtkMl_TaggedValue value) {
+    if (!gtk_ml_is_sobject(value)) {
+        items->result = 0;
+        return;
+    }
+    if (items->len == items->cap) {
+        items->cap = items->cap? items->cap * 2 : 16;
+        items->items = realloc(items->items, sizeof(GtkMl_SObj) * items->cap);
+    }
+    items->items[items->len++] = value.value.sobj;
+}
+
+GTKML_PRIVATE GtkMl_VisitResult image_hash_trie(GtkMl_HashTrie *ht, GtkMl_TaggedValue key, GtkMl_TaggedValue value, GtkMl_TaggedValue data) {
+    (void) ht;
+    image_item(data.value.userdata, key);
+    image_item(data.value.userdata, value);
+    return GTKML_VISIT_RECURSE;
+}
+
+GTKML_PRIVATE GtkMl_VisitResult image_hash_set(GtkMl_HashSet *hs, GtkMl_TaggedValue key, GtkMl_TaggedValue data) {
+    (void) hs;
+    image_item(data.value.userdata, key);
+    return GTKML_VISIT_RECURSE;
+}
+
+GTKML_PRIVATE GtkMl_VisitResult image_array(GtkMl_Array *array, size_t idx, GtkMl_TaggedValue value, GtkMl_TaggedValue data) {
+    (void) array;
+    (void) idx;
+    image_item(data.value.userdata, value);
+    return GTKML_VISIT_RECURSE;
+}
+
+// the next heap static, its reference points to it before it is filled in
+GTKML_PRIVATE uint64_t image_reserve_heap(GtkMl_ImageWriter *w, GtkMl_SObj value) {
+    if (w->n_heap == w->cap_heap) {
+        w->cap_heap *= 2;
+        w->heap = realloc(w->heap, sizeof(GtkMl_ImageHeap) * w->cap_heap);
+    }
+    uint64_t ref = (w->n_heap << 1) | 1;
+    w->heap[w->n_heap++] = (GtkMl_ImageHeap) { value->kind, 0, 0 };
+    gtk_ml_hash_table_insert(&w->refs, gtk_ml_value_sobject(value), gtk_ml_value_uint(ref));
+    return ref;
+}
+
+// heap statics come after everything they point to, so they can be made in order when the image is mapped
+// the exception are vars, which may point back at themselves, so they take their slot first
+// and get their value once every heap static is made
+GTKML_PRIVATE uint64_t image_heap(GtkMl_ImageWriter *w, GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_SObj value) {
+    GtkMl_ImageHeap heap = { value->kind, 0, 0 };
+    struct ImageItems items = { NULL, 0, 0, 1 };
+    uint64_t ref = value->kind == GTKML_S_VAR? image_reserve_heap(w, value) : 0;
+
+    switch (value->kind) {
+    case GTKML_S_SYMBOL:
+        heap.len = value->value.s_symbol.len;
+        heap.items = image_copy(w, value->value.s_symbol.ptr, heap.len);
+        break;
+    case GTKML_S_KEYWORD:
+        heap.len = value->value.s_keyword.len;
+        heap.items = image_copy(w, value->value.s_keyword.ptr, heap.len);
+        break;
+    case GTKML_S_VAR:
+        image_item(&items, gtk_ml_value_sobject(value->value.s_var.expr));
+        heap.len = 1;
+        break;
+    case GTKML_S_ARRAY:
+        gtk_ml_array_trie_foreach(&value->value.s_array.array, image_array, gtk_ml_value_userdata(&items));
+        heap.len = items.len;
+        break;
+    case GTKML_S_SET:
+        gtk_ml_hash_set_foreach(&value->value.s_set.set, image_hash_set, gtk_ml_value_userdata(&items));
+        heap.len = items.len;
+        break;
+    case GTKML_S_MAP:
+        gtk_ml_hash_trie_foreach(&value->value.s_map.map, image_hash_trie, gtk_ml_value_userdata(&items));
+        heap.len = items.len / 2;
+        if (items.result) {
+            image_item(&items, gtk_ml_value_sobject(value->value.s_map.metamap));
+            // the metamap may be NULL
+            items.result = 1;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (!items.result) {
+        free(items.items);
+        *err = gtk_ml_error(ctx, "ser-error", GTKML_ERR_SER_ERROR, value->span.ptr != NULL, value->span.line, value->span.col, 0);
+        return 0;
+    }
+
+    if (items.len) {
+        uint64_t *refs = malloc(sizeof(uint64_t) * items.len);
+        for (size_t i = 0; i < items.len; i++) {
+            refs[i] = items.items[i]? image_ref(w, ctx, err, items.items[i]) : 0;
+            if (items.items[i] && !refs[i]) {
+                free(refs);
+                free(items.items);
+                return 0;
+            }
+        }
+        heap.items = gtk_ml_image_alloc(w, sizeof(GtkMl_SObj) * items.len);
+        for (size_t i = 0; i < items.len; i++) {
+            if (refs[i]) {
+                image_field(w, heap.items + i * sizeof(GtkMl_SObj), refs[i]);
+            }
+        }
+        free(refs);
+    }
+    free(items.items);
+
+    if (!ref) {
+        ref = image_reserve_heap(w, value);
+    }
+    w->heap[ref >> 1] = heap;
+    return ref;
+}
+
+// the offset of a cell in the image or the odd reference to a heap static, 0 on error
+uint64_t image_ref(GtkMl_ImageWriter *w, GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_SObj value) {
+    // spans are not kept, so every symbol is written as the one interned symbol with its name
+    if ((value->kind == GTKML_S_SYMBOL || value->kind == GTKML_S_KEYWORD) && value->value.s_symbol.interned) {
+        value = value->value.s_symbol.interned;
+    }
+
+    GtkMl_TaggedValue found = gtk_ml_hash_table_get(&w->refs, gtk_ml_value_sobject(value));
+    if (gtk_ml_has_value(found)) {
+        return found.value.u64;
+    }
+
+    switch (value->kind) {
+    // symbols have to be interned, and the rest are made of nodes on the heap or may change
+    case GTKML_S_SYMBOL:
+    case GTKML_S_KEYWORD:
+    case GTKML_S_MAP:
+    case GTKML_S_SET:
+    case GTKML_S_VAR:
+        return image_heap(w, ctx, err, value);
+    case GTKML_S_ARRAY:
+        if (!gtk_ml_array_trie_is_string(&value->value.s_array.array)) {
+            return image_heap(w, ctx, err, value);
+        }
+        return image_cell(w, ctx, err, value);
+    case GTKML_S_LIGHTDATA:
+    case GTKML_S_USERDATA:
+    case GTKML_S_TABLE:
+        *err = gtk_ml_error(ctx, "ser-error", GTKML_ERR_SER_ERROR, value->span.ptr != NULL, value->span.line, value->span.col, 0);
+        return 0;
+    default:
+        return image_cell(w, ctx, err, value);
+    }
+}
+
+GTKML_PRIVATE int compare_heap_relocs(const void *lhs, const void *rhs) {
+    uint64_t l = ((const GtkMl_ImageHeapReloc *) lhs)->heap;
+    uint64_t r = ((const GtkMl_ImageHeapReloc *) rhs)->heap;
+    return (l > r) - (l < r);
+}
+
+GTKML_PRIVATE void del_image_writer(GtkMl_ImageWriter *w) {
+    free(w->bytes);
+    free(w->relocs);
+    free(w->heap);
+    free(w->heap_relocs);
+    gtk_ml_del_hash_table(NULL, &w->refs, gtk_ml_delete_value);
+}
+
+gboolean gtk_ml_serf_image(GtkMl_Context *ctx, FILE *stream, GtkMl_SObj *err, const GtkMl_Program *program) {
+    // a pointer in the data section would not mean anything to the next process
+    for (size_t i = 0; i < program->n_data; i++) {
+        if (program->data[i].tag == GTKML_TAG_USERDATA) {
+            *err = gtk_ml_error(ctx, "ser-error", GTKML_ERR_SER_ERROR, 0, 0, 0, 0);
+            return 0;
+        }
+    }
+
+    GtkMl_ImageWriter w;
+    w.len = 0;
+    w.cap = image_page();
+    w.bytes = malloc(w.cap);
+    w.n_relocs = 0;
+    w.cap_relocs = 64;
+    w.relocs = malloc(sizeof(uint64_t) * w.cap_relocs);
+    w.n_heap = 0;
+    w.cap_heap = 16;
+    w.heap = malloc(sizeof(GtkMl_ImageHeap) * w.cap_heap);
+    w.n_heap_relocs = 0;
+    w.cap_heap_relocs = 16;
+    w.heap_relocs = malloc(sizeof(GtkMl_ImageHeapReloc) * w.cap_heap_relocs);
+    gtk_ml_new_hash_table(&w.refs, &GTKML_PTR_HASHER);
+
+    GtkMl_ImageHeader header;
+    memset(&header, 0, sizeof(GtkMl_ImageHeader));
+    // the header is filled in last, it is always at offset 0
+    image_alloc_aligned(&w, sizeof(GtkMl_ImageHeader), 16);
+    memcpy(header.magic, GTKML_IMAGE_MAGIC, sizeof(GTKML_IMAGE_MAGIC));
+    header.version = GTKML_IMAGE_VERSION;
+    image_layout(header.layout);
+
+    header.start = image_copy(&w, program->start, strlen(program->start) + 1);
+    header.text = image_copy(&w, program->text, sizeof(GtkMl_Instruction) * program->n_text);
+    header.n_text = program->n_text;
+    header.data = image_copy(&w, program->data, sizeof(GtkMl_TaggedValue) * program->n_data);
+    header.n_data = program->n_data;
+
+    header.statics = image_alloc_aligned(&w, sizeof(GtkMl_SObj) * program->n_static, w.cap);
+    header.n_static = program->n_static;
+    for (size_t i = 1; i < program->n_static; i++) {
+        if (!image_child(&w, ctx, err, header.statics + i * sizeof(GtkMl_SObj), program->statics[i])) {
+            del_image_writer(&w);
+            return 0;
+        }
+    }
+
+    qsort(w.heap_relocs, w.n_heap_relocs, sizeof(GtkMl_ImageHeapReloc), compare_heap_relocs);
+
+    header.heap = image_copy(&w, w.heap, sizeof(GtkMl_ImageHeap) * w.n_heap);
+    header.n_heap = w.n_heap;
+    header.relocs = image_copy(&w, w.relocs, sizeof(uint64_t) * w.n_relocs);
+    header.n_relocs = w.n_relocs;
+    header.heap_relocs = image_copy(&w, w.heap_relocs, sizeof(GtkMl_ImageHeapReloc) * w.n_heap_relocs);
+    header.n_heap_relocs = w.n_heap_relocs;
+    header.size = w.len;
+    memcpy(w.bytes, &header, sizeof(GtkMl_ImageHeader));
+
+    gboolean result = fwrite(w.bytes, 1, w.len, stream) == w.len;
+    if (!result) {
+        *err = gtk_ml_error(ctx, "io-error", GTKML_ERR_IO_ERROR, 0, 0, 0, 0);
+    }
+
+    del_image_writer(&w);
+
+    return result;
+}
+
+// the whole file, mapped privately where that's possible
+GTKML_PRIVATE char *map_file(const char *file, size_t *size) {
+#ifdef GTKML_ENABLE_POSIX
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    void *image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        return NULL;
+    }
+    *size = st.st_size;
+    return image;
+#else
+    FILE *stream = fopen(file, "rb");
+    if (!stream) {
+        return NULL;
+    }
+    fseek(stream, 0l, SEEK_END);
+    long len = ftell(stream);
+    fseek(stream, 0l, SEEK_SET);
+    if (len <= 0) {
+        fclose(stream);
+        return NULL;
+    }
+    char *image = malloc(len);
+    size_t read = fread(image, 1, len, stream);
+    fclose(stream);
+    if (read != (size_t) len) {
+        free(image);
+        return NULL;
+    }
+    *size = len;
+    return image;
+#endif /* GTKML_ENABLE_POSIX */
+}
+
+void gtk_ml_unmap_image(GtkMl_Program *program) {
+#ifdef GTKML_ENABLE_POSIX
+    munmap(program->image, program->n_image);
+#else
+    free(program->image);
+#endif /* GTKML_ENABLE_POSIX */
+}
+
+// whether `n` things of `size` bytes each fit in the image at `at`
+GTKML_PRIVATE gboolean image_section(const GtkMl_ImageHeader *header, uint64_t at, uint64_t n, size_t size) {
+    return at % 16 == 0 && at <= header->size && n <= (header->size - at) / size;
+}
+
+// pointers are only ever fixed up from the statics on
+GTKML_PRIVATE gboolean image_slot(const GtkMl_ImageHeader *header, uint64_t at) {
+    return at % sizeof(GtkMl_SObj) == 0 && at >= header->statics && image_section(header, at - at % 16, 1, at % 16 + sizeof(GtkMl_SObj));
+}
+
+GTKML_PRIVATE GtkMl_SObj image_slot_value(const char *image, uint64_t at) {
+    GtkMl_SObj value;
+    memcpy(&value, image + at, sizeof(GtkMl_SObj));
+    return value;
+}
+
+GTKML_PRIVATE GtkMl_SObj map_heap(GtkMl_Context *ctx, const char *image, const GtkMl_ImageHeader *header, const GtkMl_ImageHeap *heap) {
+    if (heap->kind == GTKML_S_SYMBOL || heap->kind == GTKML_S_KEYWORD) {
+        if (!image_section(header, heap->items, heap->len, 1)) {
+            return NULL;
+        }
+        const char *name = image + heap->items;
+        if (heap->kind == GTKML_S_SYMBOL) {
+            return gtk_ml_new_symbol(ctx, NULL, 0, name, heap->len);
+        } else {
+            return gtk_ml_new_keyword(ctx, NULL, 0, name, heap->len);
+        }
+    }
+
+    uint64_t n;
+    switch (heap->kind) {
+    case GTKML_S_VAR:
+        n = 1;
+        break;
+    case GTKML_S_ARRAY:
+    case GTKML_S_SET:
+        n = heap->len;
+        break;
+    case GTKML_S_MAP:
+        if (heap->len > UINT64_MAX / 2 - 1) {
+            return NULL;
+        }
+        n = heap->len * 2 + 1;
+        break;
+    default:
+        return NULL;
+    }
+    if (n && (heap->items < header->statics || !image_section(header, heap->items, n, sizeof(GtkMl_SObj)))) {
+        return NULL;
+    }
+    // the value of a var may not be made yet, it is filled in after the other heap statics
+    for (uint64_t i = 0; heap->kind != GTKML_S_VAR && i < heap->len * (heap->kind == GTKML_S_MAP? 2 : 1); i++) {
+        if (!image_slot_value(image, heap->items + i * sizeof(GtkMl_SObj))) {
+            return NULL;
+        }
+    }
+
+    GtkMl_SObj result;
+    switch (heap->kind) {
+    case GTKML_S_VAR:
+        result = gtk_ml_new_var(ctx, NULL, gtk_ml_new_nil(ctx, NULL));
+        break;
+    case GTKML_S_ARRAY:
+        result = gtk_ml_new_array(ctx, NULL);
+        for (uint64_t i = 0; i < n; i++) {
+            GtkMl_SObj value = image_slot_value(image, heap->items + i * sizeof(GtkMl_SObj));
+            gtk_ml_array_trie_transient_push(&result->value.s_array.array, gtk_ml_value_sobject(value));
+        }
+        break;
+    case GTKML_S_SET:
+        result = gtk_ml_new_set(ctx, NULL);
+        for (uint64_t i = 0; i < n; i++) {
+            GtkMl_SObj key = image_slot_value(image, heap->items + i * sizeof(GtkMl_SObj));
+            gtk_ml_hash_set_transient_insert(&result->value.s_set.set, gtk_ml_value_sobject(key));
+        }
+        break;
+    default: // GTKML_S_MAP
+        result = gtk_ml_new_map(ctx, NULL, image_slot_value(image, heap->items + 2 * heap->len * sizeof(GtkMl_SObj)));
+        for (uint64_t i = 0; i < heap->len; i++) {
+            GtkMl_SObj key = image_slot_value(image, heap->items + 2 * i * sizeof(GtkMl_SObj));
+            GtkMl_SObj value = image_slot_value(image, heap->items + (2 * i + 1) * sizeof(GtkMl_SObj));
+            gtk_ml_hash_trie_transient_insert(&result->value.s_map.map, gtk_ml_value_sobject(key), gtk_ml_value_sobject(value));
+        }
+        break;
+    }
+    return result;
+}
+
+// drops an image that could not be mapped, it is always the last program made
+GTKML_PRIVATE GtkMl_Program *map_image_error(GtkMl_Context *ctx, GtkMl_SObj *err) {
+    gtk_ml_del_program(ctx->gc->programs[--ctx->gc->program_len]);
+    *err = gtk_ml_error(ctx, "deser-error", GTKML_ERR_DESER_ERROR, 0, 0, 0, 0);
+    return NULL;
+}
+
+GtkMl_Program *gtk_ml_map_image(GtkMl_Context *ctx, GtkMl_SObj *err, const char *file) {
+    size_t size;
+    char *image = map_file(file, &size);
+    if (!image) {
+        *err = gtk_ml_error(ctx, "io-error", GTKML_ERR_IO_ERROR, 0, 0, 0, 0);
+        return NULL;
+    }
+
+    if (ctx->gc->program_len == ctx->gc->program_cap) {
+        ctx->gc->program_cap *= 2;
+        ctx->gc->programs = realloc(ctx->gc->programs, sizeof(GtkMl_Program *) * ctx->gc->program_cap);
+    }
+    ctx->gc->programs[ctx->gc->program_len] = calloc(1, sizeof(GtkMl_Program));
+    GtkMl_Program *program = ctx->gc->programs[ctx->gc->program_len++];
+    gtk_ml_new_hash_table(&program->exports, &GTKML_C_STR_HASHER);
+    program->image = image;
+    program->n_image = size;
+
+    GtkMl_ImageHeader header;
+    if (size < sizeof(GtkMl_ImageHeader)) {
+        return map_image_error(ctx, err);
+    }
+    memcpy(&header, image, sizeof(GtkMl_ImageHeader));
+
+    uint32_t layout[5];
+    image_layout(layout);
+    if (memcmp(header.magic, GTKML_IMAGE_MAGIC, sizeof(GTKML_IMAGE_MAGIC)) != 0
+            || header.version != GTKML_IMAGE_VERSION
+            || memcmp(header.layout, layout, sizeof(layout)) != 0
+            || header.size != size
+            || !image_section(&header, header.start, 1, 1)
+            || !memchr(image + header.start, 0, size - header.start)
+            || !image_section(&header, header.text, header.n_text, sizeof(GtkMl_Instruction))
+            || !image_section(&header, header.data, header.n_data, sizeof(GtkMl_TaggedValue))
+            || !image_section(&header, header.statics, header.n_static, sizeof(GtkMl_SObj))
+            || !image_section(&header, header.heap, header.n_heap, sizeof(GtkMl_ImageHeap))
+            || !image_section(&header, header.relocs, header.n_relocs, sizeof(uint64_t))
+            || !image_section(&header, header.heap_relocs, header.n_heap_relocs, sizeof(GtkMl_ImageHeapReloc))) {
+        return map_image_error(ctx, err);
+    }
+
+#ifdef GTKML_ENABLE_POSIX
+    // text and data stay read-only and shared with every other process using the image
+    // an image written with smaller pages would have its text made writable along with the statics
+    size_t page = image_page();
+    if (header.statics % page != 0 || mprotect(image + header.statics, size - header.statics, PROT_READ | PROT_WRITE) != 0) {
+        return map_image_error(ctx, err);
+    }
+#endif /* GTKML_ENABLE_POSIX */
+
+    const uint64_t *relocs = (const uint64_t *) (image + header.relocs);
+    for (size_t i = 0; i < header.n_relocs; i++) {
+        uint64_t at = relocs[i];
+        if (!image_slot(&header, at)) {
+            return map_image_error(ctx, err);
+        }
+        uintptr_t offset;
+        memcpy(&offset, image + at, sizeof(uintptr_t));
+        if (offset >= size) {
+            return map_image_error(ctx, err);
+        }
+        char *ptr = image + offset;
+        memcpy(image + at, &ptr, sizeof(char *));
+    }
+
+    // the relocations of a heap static come right after it, in time for the statics made from it
+    const GtkMl_ImageHeap *heap = (const GtkMl_ImageHeap *) (image + header.heap);
+    const GtkMl_ImageHeapReloc *heap_relocs = (const GtkMl_ImageHeapReloc *) (image + header.heap_relocs);
+    program->pinned = malloc(sizeof(GtkMl_SObj) * header.n_heap);
+    size_t r = 0;
+    for (size_t i = 0; i < header.n_heap; i++) {
+        GtkMl_SObj value = map_heap(ctx, image, &header, &heap[i]);
+        if (!value) {
+            return map_image_error(ctx, err);
+        }
+        program->pinned[i] = value;
+        program->n_pinned = i + 1;
+        for (; r < header.n_heap_relocs && heap_relocs[r].heap == i; r++) {
+            if (!image_slot(&header, heap_relocs[r].at)) {
+                return map_image_error(ctx, err);
+            }
+            memcpy(image + heap_relocs[r].at, &value, sizeof(GtkMl_SObj));
+        }
+    }
+    if (r != header.n_heap_relocs) {
+        return map_image_error(ctx, err);
+    }
+    for (size_t i = 0; i < header.n_heap; i++) {
+        if (heap[i].kind == GTKML_S_VAR) {
+            GtkMl_SObj expr = image_slot_value(image, heap[i].items);
+            if (!expr) {
+                return map_image_error(ctx, err);
+            }
+            program->pinned[i]->value.s_var.expr = expr;
+        }
+    }
+
+    program->start = image + header.start;
+    program->text = (GtkMl_Instruction *) (image + header.text);
+    program->n_text = header.n_text;
+    program->data = (GtkMl_TaggedValue *) (image + header.data);
+    program->n_data = header.n_data;
+    program->statics = (GtkMl_SObj *) (image + header.statics);
+    program->n_static = header.n_static;
+
+    gtk_ml_index_exports(program);
+
     return program;
 }
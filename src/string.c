@@ -0,0 +1,990 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#define GTKML_INCLUDE_INTERNAL
+#include "gtk-ml.h"
+#include "gtk-ml-internal.h"
+
+// pieces with non-ascii characters hold at most this many bytes, so finding a character in one stays cheap
+// ascii pieces are indexed directly and may be any length
+#define GTKML_STR_CHUNK 512
+// no balanced rope of `size_t` bytes is deeper than this
+#define GTKML_STR_DEPTH 128
+// the nodes and buffers of a program image start with more references than are ever given up
+#define GTKML_STR_IMAGE_RC (INT_MAX / 2)
+
+// the bytes of one or more pieces
+// bytes up to `fill` are never changed, the first piece to end at `fill` may append more
+typedef struct GtkMl_StringBuffer {
+    int rc;
+    size_t fill;
+    size_t cap;
+    char *bytes;
+} GtkMl_StringBuffer;
+
+typedef enum GtkMl_StringNodeKind {
+    GTKML_STR_PIECE,
+    GTKML_STR_CONCAT,
+} GtkMl_StringNodeKind;
+
+typedef struct GtkMl_StringPiece {
+    GtkMl_StringBuffer *buffer;
+    size_t offset;
+} GtkMl_StringPiece;
+
+typedef struct GtkMl_StringConcat {
+    GtkMl_StringNode *left;
+    GtkMl_StringNode *right;
+} GtkMl_StringConcat;
+
+typedef union GtkMl_StrUnion {
+    GtkMl_StringPiece piece;
+    GtkMl_StringConcat concat;
+} GtkMl_StrUnion;
+
+// pieces are leaves of valid utf-8, concatenations are kept balanced like an avl tree
+// a piece is ascii exactly if `len == bytes`
+struct GtkMl_StringNode {
+    int rc;
+    GtkMl_StringNodeKind kind;
+    // 0 for pieces
+    uint32_t depth;
+    // the number of characters
+    size_t len;
+    size_t bytes;
+    GtkMl_StrUnion value;
+};
+
+// walks the pieces of a rope in order
+typedef struct GtkMl_StringCursor {
+    GtkMl_StringNode *stack[GTKML_STR_DEPTH];
+    size_t top;
+    const char *ptr;
+    size_t left;
+} GtkMl_StringCursor;
+
+GTKML_PRIVATE GtkMl_StringBuffer *new_buffer(const char *ptr, size_t len);
+GTKML_PRIVATE void reserve(GtkMl_StringBuffer *buffer, size_t len);
+GTKML_PRIVATE void del_buffer(GtkMl_StringBuffer *buffer);
+GTKML_PRIVATE GtkMl_StringNode *new_piece(GtkMl_StringBuffer *buffer, size_t offset, size_t bytes, size_t len);
+GTKML_PRIVATE GtkMl_StringNode *new_concat(GtkMl_StringNode *left, GtkMl_StringNode *right);
+GTKML_PRIVATE GtkMl_StringNode *copy_node(GtkMl_StringNode *node);
+GTKML_PRIVATE void del_node(GtkMl_StringNode *node);
+GTKML_PRIVATE uint64_t image_node(GtkMl_ImageWriter *w, GtkMl_StringNode *node);
+GTKML_PRIVATE void unwrap(GtkMl_StringNode *node, GtkMl_StringNode **left, GtkMl_StringNode **right);
+GTKML_PRIVATE const char *piece_bytes(GtkMl_StringNode *piece);
+GTKML_PRIVATE GtkMl_StringNode *merge(GtkMl_StringNode *left, GtkMl_StringNode *right);
+GTKML_PRIVATE GtkMl_StringNode *rotate_left(GtkMl_StringNode *node);
+GTKML_PRIVATE GtkMl_StringNode *rotate_right(GtkMl_StringNode *node);
+GTKML_PRIVATE GtkMl_StringNode *join_right(GtkMl_StringNode *left, GtkMl_StringNode *right);
+GTKML_PRIVATE GtkMl_StringNode *join_left(GtkMl_StringNode *left, GtkMl_StringNode *right);
+GTKML_PRIVATE GtkMl_StringNode *join(GtkMl_StringNode *left, GtkMl_StringNode *right);
+GTKML_PRIVATE GtkMl_StringNode *slice(GtkMl_StringNode *node, size_t start, size_t end);
+GTKML_PRIVATE GtkMl_StringNode *find_piece(GtkMl_StringNode *node, size_t *index);
+GTKML_PRIVATE size_t byte_offset(const char *ptr, size_t bytes, size_t len, size_t index);
+GTKML_PRIVATE gboolean extend(GtkMl_Array *array, const char *ptr, size_t bytes, size_t len);
+GTKML_PRIVATE void append_valid(GtkMl_Array *array, const char *ptr, size_t bytes);
+GTKML_PRIVATE size_t valid_char(const unsigned char *ptr, size_t len);
+GTKML_PRIVATE size_t count_chars(const char *ptr, size_t bytes);
+GTKML_PRIVATE uint32_t decode(const unsigned char *ptr, size_t *bytes);
+GTKML_PRIVATE size_t encode(char *out, uint32_t c);
+GTKML_PRIVATE void cursor_init(GtkMl_StringCursor *cursor, GtkMl_StringNode *root);
+GTKML_PRIVATE gboolean cursor_next(GtkMl_StringCursor *cursor);
+GTKML_PRIVATE gboolean foreach_chunk(GtkMl_Array *array, GtkMl_StringNode *node, GtkMl_StringFn fn, GtkMl_TaggedValue data);
+GTKML_PRIVATE gboolean foreach(GtkMl_Array *array, GtkMl_StringNode *node, size_t *index, GtkMl_ArrayFn fn, GtkMl_TaggedValue data);
+GTKML_PRIVATE gboolean foreach_rev(GtkMl_Array *array, GtkMl_StringNode *node, size_t *index, GtkMl_ArrayFn fn, GtkMl_TaggedValue data);
+
+void gtk_ml_string_append(GtkMl_Array *array, const char *ptr, size_t len) {
+    const unsigned char *bytes = (const unsigned char *) ptr;
+    size_t i = 0;
+    while (i < len) {
+        size_t start = i;
+        size_t n;
+        while (i < len && (n = valid_char(bytes + i, len - i))) {
+            i += n;
+        }
+        append_valid(array, ptr + start, i - start);
+
+        if (i < len) {
+            // one replacement character per malformed byte
+            append_valid(array, "\xEF\xBF\xBD", 3);
+            ++i;
+        }
+    }
+}
+
+size_t gtk_ml_string_bytes(GtkMl_Array *array) {
+    return array->rope? array->rope->bytes : 0;
+}
+
+GTKML_PRIVATE GtkMl_VisitResult fn_write(GtkMl_Array *array, const char *ptr, size_t len, GtkMl_TaggedValue data) {
+    (void) array;
+
+    char **out = data.value.userdata;
+    memcpy(*out, ptr, len);
+    *out += len;
+
+    return GTKML_VISIT_RECURSE;
+}
+
+void gtk_ml_string_write(GtkMl_Array *array, char *out) {
+    gtk_ml_string_foreach_chunk(array, fn_write, gtk_ml_value_userdata(&out));
+}
+
+void gtk_ml_string_foreach_chunk(GtkMl_Array *array, GtkMl_StringFn fn, GtkMl_TaggedValue data) {
+    if (array->rope) {
+        (void) foreach_chunk(array, array->rope, fn, data);
+    }
+}
+
+void gtk_ml_string_del(GtkMl_Array *array) {
+    del_node(array->rope);
+    array->rope = NULL;
+    array->hash = 0;
+    array->len = 0;
+}
+
+void gtk_ml_string_copy(GtkMl_Array *out, GtkMl_Array *array) {
+    out->rope = copy_node(array->rope);
+    out->hash = array->hash;
+    out->len = array->len;
+    out->string = 1;
+}
+
+void gtk_ml_string_concat(GtkMl_Array *out, GtkMl_Array *lhs, GtkMl_Array *rhs) {
+    out->rope = join(copy_node(lhs->rope), copy_node(rhs->rope));
+    out->hash = 0;
+    out->len = lhs->len + rhs->len;
+    out->string = 1;
+}
+
+void gtk_ml_string_slice(GtkMl_Array *out, GtkMl_Array *array, size_t start, size_t end) {
+    if (end > array->len) {
+        end = array->len;
+    }
+    if (start > end) {
+        start = end;
+    }
+
+    out->rope = start < end? slice(array->rope, start, end) : NULL;
+    out->hash = start == 0 && end == array->len? array->hash : 0;
+    out->len = end - start;
+    out->string = 1;
+}
+
+void gtk_ml_string_push(GtkMl_Array *array, GtkMl_TaggedValue value) {
+    uint32_t c = 0xFFFD;
+    if (value.tag == GTKML_TAG_CHAR) {
+        c = value.value.unicode;
+    } else if (gtk_ml_is_sobject(value) && value.value.sobj->kind == GTKML_S_CHAR) {
+        c = value.value.sobj->value.s_char.value;
+    }
+
+    char bytes[4];
+    append_valid(array, bytes, encode(bytes, c));
+}
+
+GtkMl_TaggedValue gtk_ml_string_pop(GtkMl_Array *array) {
+    if (!array->len) {
+        return gtk_ml_value_none();
+    }
+
+    GtkMl_TaggedValue result = gtk_ml_string_get(array, array->len - 1);
+
+    GtkMl_StringNode *rope = array->rope;
+    --array->len;
+    array->rope = array->len? slice(rope, 0, array->len) : NULL;
+    array->hash = 0;
+    del_node(rope);
+
+    return result;
+}
+
+GtkMl_TaggedValue gtk_ml_string_get(GtkMl_Array *array, size_t index) {
+    if (index >= array->len) {
+        return gtk_ml_value_none();
+    }
+
+    GtkMl_StringNode *piece = find_piece(array->rope, &index);
+    const char *ptr = piece_bytes(piece);
+    size_t offset = byte_offset(ptr, piece->bytes, piece->len, index);
+    size_t bytes;
+    return gtk_ml_value_char(decode((const unsigned char *) ptr + offset, &bytes));
+}
+
+void gtk_ml_string_foreach(GtkMl_Array *array, GtkMl_ArrayFn fn, GtkMl_TaggedValue data) {
+    size_t index = 0;
+    if (array->rope) {
+        (void) foreach(array, array->rope, &index, fn, data);
+    }
+}
+
+void gtk_ml_string_foreach_rev(GtkMl_Array *array, GtkMl_ArrayFn fn, GtkMl_TaggedValue data) {
+    size_t index = array->len;
+    if (array->rope) {
+        (void) foreach_rev(array, array->rope, &index, fn, data);
+    }
+}
+
+gboolean gtk_ml_string_equal(GtkMl_Array *lhs, GtkMl_Array *rhs) {
+    if (lhs->len != rhs->len || gtk_ml_string_bytes(lhs) != gtk_ml_string_bytes(rhs)) {
+        return 0;
+    }
+
+    if (lhs->rope == rhs->rope) {
+        return 1;
+    }
+
+    if (lhs->hash && rhs->hash && lhs->hash != rhs->hash) {
+        return 0;
+    }
+
+    GtkMl_StringCursor l;
+    GtkMl_StringCursor r;
+    cursor_init(&l, lhs->rope);
+    cursor_init(&r, rhs->rope);
+    while (cursor_next(&l) && cursor_next(&r)) {
+        size_t n = l.left < r.left? l.left : r.left;
+        if (l.ptr != r.ptr && memcmp(l.ptr, r.ptr, n) != 0) {
+            return 0;
+        }
+        l.ptr += n;
+        l.left -= n;
+        r.ptr += n;
+        r.left -= n;
+    }
+    return 1;
+}
+
+uint64_t gtk_ml_string_image(GtkMl_ImageWriter *w, GtkMl_Array *array) {
+    if (!array->rope) {
+        return 0;
+    }
+    return image_node(w, array->rope);
+}
+
+// every piece gets a buffer of its own, which is full so nothing is ever appended to it
+uint64_t image_node(GtkMl_ImageWriter *w, GtkMl_StringNode *node) {
+    GtkMl_StringNode copy = *node;
+    copy.rc = GTKML_STR_IMAGE_RC;
+
+    switch (node->kind) {
+    case GTKML_STR_PIECE: {
+        uint64_t bytes = gtk_ml_image_alloc(w, node->bytes);
+        memcpy(w->bytes + bytes, piece_bytes(node), node->bytes);
+
+        GtkMl_StringBuffer buffer = { GTKML_STR_IMAGE_RC, SIZE_MAX, SIZE_MAX, NULL };
+        uint64_t at_buffer = gtk_ml_image_alloc(w, sizeof(GtkMl_StringBuffer));
+        memcpy(w->bytes + at_buffer, &buffer, sizeof(GtkMl_StringBuffer));
+        gtk_ml_image_pointer(w, at_buffer + offsetof(GtkMl_StringBuffer, bytes), bytes);
+
+        copy.value.piece.buffer = NULL;
+        copy.value.piece.offset = 0;
+        uint64_t at = gtk_ml_image_alloc(w, sizeof(GtkMl_StringNode));
+        memcpy(w->bytes + at, &copy, sizeof(GtkMl_StringNode));
+        gtk_ml_image_pointer(w, at + offsetof(GtkMl_StringNode, value.piece.buffer), at_buffer);
+        return at;
+    }
+    case GTKML_STR_CONCAT: {
+        uint64_t left = image_node(w, node->value.concat.left);
+        uint64_t right = image_node(w, node->value.concat.right);
+
+        copy.value.concat.left = NULL;
+        copy.value.concat.right = NULL;
+        uint64_t at = gtk_ml_image_alloc(w, sizeof(GtkMl_StringNode));
+        memcpy(w->bytes + at, &copy, sizeof(GtkMl_StringNode));
+        gtk_ml_image_pointer(w, at + offsetof(GtkMl_StringNode, value.concat.left), left);
+        gtk_ml_image_pointer(w, at + offsetof(GtkMl_StringNode, value.concat.right), right);
+        return at;
+    }
+    }
+
+    return 0;
+}
+
+GtkMl_StringBuffer *new_buffer(const char *ptr, size_t len) {
+    GtkMl_StringBuffer *buffer = malloc(sizeof(GtkMl_StringBuffer));
+    buffer->rc = 1;
+    buffer->fill = len;
+    buffer->cap = len < 16? 16 : len;
+    buffer->bytes = malloc(buffer->cap);
+    memcpy(buffer->bytes, ptr, len);
+    return buffer;
+}
+
+// makes room for `len` more bytes past `fill`
+void reserve(GtkMl_StringBuffer *buffer, size_t len) {
+    if (buffer->fill + len > buffer->cap) {
+        buffer->cap *= 2;
+        if (buffer->fill + len > buffer->cap) {
+            buffer->cap = buffer->fill + len;
+        }
+        buffer->bytes = realloc(buffer->bytes, buffer->cap);
+    }
+}
+
+void del_buffer(GtkMl_StringBuffer *buffer) {
+    --buffer->rc;
+    if (!buffer->rc) {
+        free(buffer->bytes);
+        free(buffer);
+    }
+}
+
+GtkMl_StringNode *new_piece(GtkMl_StringBuffer *buffer, size_t offset, size_t bytes, size_t len) {
+    GtkMl_StringNode *node = malloc(sizeof(GtkMl_StringNode));
+    node->rc = 1;
+    node->kind = GTKML_STR_PIECE;
+    node->depth = 0;
+    node->len = len;
+    node->bytes = bytes;
+    node->value.piece.buffer = buffer;
+    node->value.piece.offset = offset;
+    ++buffer->rc;
+    return node;
+}
+
+// takes over the references to `left` and `right`
+GtkMl_StringNode *new_concat(GtkMl_StringNode *left, GtkMl_StringNode *right) {
+    GtkMl_StringNode *node = malloc(sizeof(GtkMl_StringNode));
+    node->rc = 1;
+    node->kind = GTKML_STR_CONCAT;
+    node->depth = (left->depth > right->depth? left->depth : right->depth) + 1;
+    node->len = left->len + right->len;
+    node->bytes = left->bytes + right->bytes;
+    node->value.concat.left = left;
+    node->value.concat.right = right;
+    return node;
+}
+
+GtkMl_StringNode *copy_node(GtkMl_StringNode *node) {
+    if (!node) {
+        return NULL;
+    }
+
+    ++node->rc;
+
+    return node;
+}
+
+void del_node(GtkMl_StringNode *node) {
+    if (!node) {
+        return;
+    }
+
+    --node->rc;
+    if (!node->rc) {
+        switch (node->kind) {
+        case GTKML_STR_PIECE:
+            del_buffer(node->value.piece.buffer);
+            break;
+        case GTKML_STR_CONCAT:
+            del_node(node->value.concat.left);
+            del_node(node->value.concat.right);
+            break;
+        }
+        free(node);
+    }
+}
+
+// gives up the reference to the concatenation `node` in exchange for references to its children
+void unwrap(GtkMl_StringNode *node, GtkMl_StringNode **left, GtkMl_StringNode **right) {
+    *left = node->value.concat.left;
+    *right = node->value.concat.right;
+    if (node->rc == 1) {
+        free(node);
+    } else {
+        --node->rc;
+        ++(*left)->rc;
+        ++(*right)->rc;
+    }
+}
+
+const char *piece_bytes(GtkMl_StringNode *piece) {
+    return piece->value.piece.buffer->bytes + piece->value.piece.offset;
+}
+
+// the two pieces as one, or NULL if that would mean copying too much
+// takes over the references to `left` and `right` unless it returns NULL
+GtkMl_StringNode *merge(GtkMl_StringNode *left, GtkMl_StringNode *right) {
+    GtkMl_StringBuffer *lbuf = left->value.piece.buffer;
+    GtkMl_StringBuffer *rbuf = right->value.piece.buffer;
+    size_t bytes = left->bytes + right->bytes;
+    size_t len = left->len + right->len;
+    if (len != bytes && bytes > GTKML_STR_CHUNK) {
+        return NULL;
+    }
+
+    GtkMl_StringNode *result;
+    if (lbuf == rbuf && left->value.piece.offset + left->bytes == right->value.piece.offset) {
+        // the two halves of an earlier slice
+        result = new_piece(lbuf, left->value.piece.offset, bytes, len);
+    } else if (right->bytes <= GTKML_STR_CHUNK && lbuf->fill == left->value.piece.offset + left->bytes) {
+        // nobody has appended to `left` yet
+        // `right` may live in the same buffer, so only look at its bytes once there's room
+        reserve(lbuf, right->bytes);
+        memcpy(lbuf->bytes + lbuf->fill, piece_bytes(right), right->bytes);
+        lbuf->fill += right->bytes;
+        result = new_piece(lbuf, left->value.piece.offset, bytes, len);
+    } else if (bytes <= GTKML_STR_CHUNK) {
+        GtkMl_StringBuffer *buffer = new_buffer(piece_bytes(left), left->bytes);
+        reserve(buffer, right->bytes);
+        memcpy(buffer->bytes + buffer->fill, piece_bytes(right), right->bytes);
+        buffer->fill += right->bytes;
+        result = new_piece(buffer, 0, bytes, len);
+        del_buffer(buffer);
+    } else {
+        return NULL;
+    }
+
+    del_node(left);
+    del_node(right);
+    return result;
+}
+
+// (a (b c)) -> ((a b) c)
+GtkMl_StringNode *rotate_left(GtkMl_StringNode *node) {
+    GtkMl_StringNode *a;
+    GtkMl_StringNode *bc;
+    GtkMl_StringNode *b;
+    GtkMl_StringNode *c;
+    unwrap(node, &a, &bc);
+    unwrap(bc, &b, &c);
+    return new_concat(new_concat(a, b), c);
+}
+
+// ((a b) c) -> (a (b c))
+GtkMl_StringNode *rotate_right(GtkMl_StringNode *node) {
+    GtkMl_StringNode *ab;
+    GtkMl_StringNode *a;
+    GtkMl_StringNode *b;
+    GtkMl_StringNode *c;
+    unwrap(node, &ab, &c);
+    unwrap(ab, &a, &b);
+    return new_concat(a, new_concat(b, c));
+}
+
+// joins a `right` at least two levels shallower than `left` along the right spine of `left`
+GtkMl_StringNode *join_right(GtkMl_StringNode *left, GtkMl_StringNode *right) {
+    GtkMl_StringNode *l;
+    GtkMl_StringNode *c;
+    unwrap(left, &l, &c);
+
+    GtkMl_StringNode *t;
+    if (c->depth <= right->depth + 1) {
+        t = NULL;
+        if (c->kind == GTKML_STR_PIECE && right->kind == GTKML_STR_PIECE) {
+            t = merge(c, right);
+        }
+        if (!t) {
+            t = new_concat(c, right);
+        }
+        if (t->depth <= l->depth + 1) {
+            return new_concat(l, t);
+        }
+        return rotate_left(new_concat(l, rotate_right(t)));
+    }
+
+    t = join_right(c, right);
+    if (t->depth <= l->depth + 1) {
+        return new_concat(l, t);
+    }
+    return rotate_left(new_concat(l, t));
+}
+
+// same as `join_right`, but the other way around
+GtkMl_StringNode *join_left(GtkMl_StringNode *left, GtkMl_StringNode *right) {
+    GtkMl_StringNode *c;
+    GtkMl_StringNode *r;
+    unwrap(right, &c, &r);
+
+    GtkMl_StringNode *t;
+    if (c->depth <= left->depth + 1) {
+        t = NULL;
+        if (c->kind == GTKML_STR_PIECE && left->kind == GTKML_STR_PIECE) {
+            t = merge(left, c);
+        }
+        if (!t) {
+            t = new_concat(left, c);
+        }
+        if (t->depth <= r->depth + 1) {
+            return new_concat(t, r);
+        }
+        return rotate_right(new_concat(rotate_left(t), r));
+    }
+
+    t = join_left(left, c);
+    if (t->depth <= r->depth + 1) {
+        return new_concat(t, r);
+    }
+    return rotate_right(new_concat(t, r));
+}
+
+// takes over both references, either side may be NULL
+GtkMl_StringNode *join(GtkMl_StringNode *left, GtkMl_StringNode *right) {
+    if (!left) {
+        return right;
+    }
+    if (!right) {
+        return left;
+    }
+
+    if (left->depth > right->depth + 1) {
+        return join_right(left, right);
+    }
+    if (right->depth > left->depth + 1) {
+        return join_left(left, right);
+    }
+
+    // still try to merge the two pieces meeting at the seam, so pushes don't leave tiny pieces behind
+    if (right->kind == GTKML_STR_PIECE) {
+        if (left->kind == GTKML_STR_PIECE) {
+            GtkMl_StringNode *merged = merge(left, right);
+            if (merged) {
+                return merged;
+            }
+        } else if (left->value.concat.right->kind == GTKML_STR_PIECE) {
+            GtkMl_StringNode *l;
+            GtkMl_StringNode *c;
+            unwrap(left, &l, &c);
+            GtkMl_StringNode *merged = merge(c, right);
+            if (merged) {
+                return new_concat(l, merged);
+            }
+            left = new_concat(l, c);
+        }
+    } else if (left->kind == GTKML_STR_PIECE && right->value.concat.left->kind == GTKML_STR_PIECE) {
+        GtkMl_StringNode *c;
+        GtkMl_StringNode *r;
+        unwrap(right, &c, &r);
+        GtkMl_StringNode *merged = merge(left, c);
+        if (merged) {
+            return new_concat(merged, r);
+        }
+        right = new_concat(c, r);
+    }
+
+    return new_concat(left, right);
+}
+
+// a new reference to the characters `start` to `end - 1` of `node`, with `start < end <= node->len`
+GtkMl_StringNode *slice(GtkMl_StringNode *node, size_t start, size_t end) {
+    if (start == 0 && end == node->len) {
+        return copy_node(node);
+    }
+
+    switch (node->kind) {
+    case GTKML_STR_PIECE: {
+        const char *ptr = piece_bytes(node);
+        size_t from = byte_offset(ptr, node->bytes, node->len, start);
+        size_t to = end == node->len? node->bytes : from + byte_offset(ptr + from, node->bytes - from, node->len - start, end - start);
+        return new_piece(node->value.piece.buffer, node->value.piece.offset + from, to - from, end - start);
+    }
+    case GTKML_STR_CONCAT: {
+        GtkMl_StringNode *left = node->value.concat.left;
+        GtkMl_StringNode *right = node->value.concat.right;
+        if (end <= left->len) {
+            return slice(left, start, end);
+        }
+        if (start >= left->len) {
+            return slice(right, start - left->len, end - left->len);
+        }
+        return join(slice(left, start, left->len), slice(right, 0, end - left->len));
+    }
+    }
+
+    return NULL;
+}
+
+// the piece holding character `*index`, which becomes the index into that piece
+GtkMl_StringNode *find_piece(GtkMl_StringNode *node, size_t *index) {
+    while (node->kind == GTKML_STR_CONCAT) {
+        GtkMl_StringNode *left = node->value.concat.left;
+        if (*index < left->len) {
+            node = left;
+        } else {
+            *index -= left->len;
+            node = node->value.concat.right;
+        }
+    }
+    return node;
+}
+
+// the offset of character `index` in `len` characters taking up `bytes` bytes
+size_t byte_offset(const char *ptr, size_t bytes, size_t len, size_t index) {
+    if (len == bytes) {
+        return index;
+    }
+
+    // the offset of the `index + 1`th lead byte
+    const unsigned char *data = (const unsigned char *) ptr;
+    size_t offset = 0;
+    for (;; offset++) {
+        if ((data[offset] & 0xC0) != 0x80 && !index--) {
+            return offset;
+        }
+    }
+}
+
+// appends to the last piece in place if nobody else can see it
+gboolean extend(GtkMl_Array *array, const char *ptr, size_t bytes, size_t len) {
+    GtkMl_StringNode *node = array->rope;
+    if (!node) {
+        return 0;
+    }
+    while (node->rc == 1 && node->kind == GTKML_STR_CONCAT) {
+        node = node->value.concat.right;
+    }
+    if (node->rc != 1 || node->kind != GTKML_STR_PIECE) {
+        return 0;
+    }
+
+    GtkMl_StringBuffer *buffer = node->value.piece.buffer;
+    if (buffer->fill != node->value.piece.offset + node->bytes) {
+        return 0;
+    }
+    if ((node->len != node->bytes || len != bytes) && node->bytes + bytes > GTKML_STR_CHUNK) {
+        return 0;
+    }
+
+    reserve(buffer, bytes);
+    memcpy(buffer->bytes + buffer->fill, ptr, bytes);
+    buffer->fill += bytes;
+
+    for (node = array->rope;; node = node->value.concat.right) {
+        node->len += len;
+        node->bytes += bytes;
+        if (node->kind == GTKML_STR_PIECE) {
+            break;
+        }
+    }
+    return 1;
+}
+
+// appends `bytes` bytes of valid utf-8
+void append_valid(GtkMl_Array *array, const char *ptr, size_t bytes) {
+    if (!bytes) {
+        return;
+    }
+
+    size_t len = count_chars(ptr, bytes);
+    array->len += len;
+    array->hash = 0;
+
+    if (extend(array, ptr, bytes, len)) {
+        return;
+    }
+
+    // long runs of ascii become one piece, everything else gets split into chunks sharing one buffer
+    GtkMl_StringBuffer *buffer = new_buffer(ptr, bytes);
+    const unsigned char *data = (const unsigned char *) ptr;
+    size_t offset = 0;
+    while (offset < bytes) {
+        size_t end = offset;
+        size_t chars = 0;
+        gboolean ascii = 1;
+        while (end < bytes) {
+            size_t n = valid_char(data + end, bytes - end);
+            if (ascii && n > 1 && end - offset >= GTKML_STR_CHUNK) {
+                break;
+            }
+            if ((!ascii || n > 1) && end + n - offset > GTKML_STR_CHUNK) {
+                break;
+            }
+            ascii = ascii && n == 1;
+            end += n;
+            ++chars;
+        }
+        array->rope = join(array->rope, new_piece(buffer, offset, end - offset, chars));
+        offset = end;
+    }
+    del_buffer(buffer);
+}
+
+// the length of the well-formed utf-8 character at `ptr`, 0 if there is none
+size_t valid_char(const unsigned char *ptr, size_t len) {
+    unsigned char c = ptr[0];
+    if (c < 0x80) {
+        return 1;
+    }
+
+    size_t n;
+    unsigned char lo = 0x80;
+    unsigned char hi = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) {
+        n = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        n = 3;
+        if (c == 0xE0) {
+            lo = 0xA0;
+        } else if (c == 0xED) {
+            // surrogates
+            hi = 0x9F;
+        }
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        n = 4;
+        if (c == 0xF0) {
+            lo = 0x90;
+        } else if (c == 0xF4) {
+            hi = 0x8F;
+        }
+    } else {
+        return 0;
+    }
+
+    if (len < n || ptr[1] < lo || ptr[1] > hi) {
+        return 0;
+    }
+    for (size_t i = 2; i < n; i++) {
+        if ((ptr[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+    }
+    return n;
+}
+
+size_t count_chars(const char *ptr, size_t bytes) {
+    const unsigned char *data = (const unsigned char *) ptr;
+    size_t len = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        // everything but continuation bytes starts a character
+        if ((data[i] & 0xC0) != 0x80) {
+            ++len;
+        }
+    }
+    return len;
+}
+
+// decodes a character of valid utf-8
+uint32_t decode(const unsigned char *ptr, size_t *bytes) {
+    unsigned char c = ptr[0];
+    if (c < 0x80) {
+        *bytes = 1;
+        return c;
+    } else if (c < 0xE0) {
+        *bytes = 2;
+        return ((uint32_t) (c & 0x1F) << 6) | (ptr[1] & 0x3F);
+    } else if (c < 0xF0) {
+        *bytes = 3;
+        return ((uint32_t) (c & 0x0F) << 12) | ((uint32_t) (ptr[1] & 0x3F) << 6) | (ptr[2] & 0x3F);
+    } else {
+        *bytes = 4;
+        return ((uint32_t) (c & 0x07) << 18) | ((uint32_t) (ptr[1] & 0x3F) << 12) | ((uint32_t) (ptr[2] & 0x3F) << 6) | (ptr[3] & 0x3F);
+    }
+}
+
+// encodes `c` as utf-8, or U+FFFD if it isn't a unicode scalar value
+size_t encode(char *out, uint32_t c) {
+    if ((c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF) {
+        c = 0xFFFD;
+    }
+
+    if (c < 0x80) {
+        out[0] = c;
+        return 1;
+    } else if (c < 0x800) {
+        out[0] = 0xC0 | (c >> 6);
+        out[1] = 0x80 | (c & 0x3F);
+        return 2;
+    } else if (c < 0x10000) {
+        out[0] = 0xE0 | (c >> 12);
+        out[1] = 0x80 | ((c >> 6) & 0x3F);
+        out[2] = 0x80 | (c & 0x3F);
+        return 3;
+    } else {
+        out[0] = 0xF0 | (c >> 18);
+        out[1] = 0x80 | ((c >> 12) & 0x3F);
+        out[2] = 0x80 | ((c >> 6) & 0x3F);
+        out[3] = 0x80 | (c & 0x3F);
+        return 4;
+    }
+}
+
+void cursor_init(GtkMl_StringCursor *cursor, GtkMl_StringNode *root) {
+    cursor->top = 0;
+    cursor->ptr = NULL;
+    cursor->left = 0;
+    if (root) {
+        cursor->stack[cursor->top++] = root;
+    }
+}
+
+// moves on to the next piece once the current one is used up, 0 at the end
+gboolean cursor_next(GtkMl_StringCursor *cursor) {
+    while (!cursor->left) {
+        if (!cursor->top) {
+            return 0;
+        }
+        GtkMl_StringNode *node = cursor->stack[--cursor->top];
+        while (node->kind == GTKML_STR_CONCAT) {
+            cursor->stack[cursor->top++] = node->value.concat.right;
+            node = node->value.concat.left;
+        }
+        cursor->ptr = piece_bytes(node);
+        cursor->left = node->bytes;
+    }
+    return 1;
+}
+
+gboolean foreach_chunk(GtkMl_Array *array, GtkMl_StringNode *node, GtkMl_StringFn fn, GtkMl_TaggedValue data) {
+    switch (node->kind) {
+    case GTKML_STR_PIECE:
+        return fn(array, piece_bytes(node), node->bytes, data) != GTKML_VISIT_BREAK;
+    case GTKML_STR_CONCAT:
+        return foreach_chunk(array, node->value.concat.left, fn, data)
+            && foreach_chunk(array, node->value.concat.right, fn, data);
+    }
+    return 0;
+}
+
+gboolean foreach(GtkMl_Array *array, GtkMl_StringNode *node, size_t *index, GtkMl_ArrayFn fn, GtkMl_TaggedValue data) {
+    switch (node->kind) {
+    case GTKML_STR_PIECE: {
+        const unsigned char *ptr = (const unsigned char *) piece_bytes(node);
+        for (size_t i = 0; i < node->bytes;) {
+            size_t n;
+            uint32_t c = decode(ptr + i, &n);
+            i += n;
+            if (fn(array, (*index)++, gtk_ml_value_char(c), data) == GTKML_VISIT_BREAK) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    case GTKML_STR_CONCAT:
+        return foreach(array, node->value.concat.left, index, fn, data)
+            && foreach(array, node->value.concat.right, index, fn, data);
+    }
+    return 0;
+}
+
+gboolean foreach_rev(GtkMl_Array *array, GtkMl_StringNode *node, size_t *index, GtkMl_ArrayFn fn, GtkMl_TaggedValue data) {
+    switch (node->kind) {
+    case GTKML_STR_PIECE: {
+        const unsigned char *ptr = (const unsigned char *) piece_bytes(node);
+        for (size_t i = node->bytes; i > 0;) {
+            // back up to the lead byte of the character
+            do {
+                --i;
+            } while ((ptr[i] & 0xC0) == 0x80);
+            size_t n;
+            uint32_t c = decode(ptr + i, &n);
+            if (fn(array, --*index, gtk_ml_value_char(c), data) == GTKML_VISIT_BREAK) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    case GTKML_STR_CONCAT:
+        return foreach_rev(array, node->value.concat.right, index, fn, data)
+            && foreach_rev(array, node->value.concat.left, index, fn, data);
+    }
+    return 0;
+}
+
+#ifdef GTKML_ENABLE_POSIX
+/* debug stuff */
+
+GTKML_PRIVATE gboolean foreach_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, GtkMl_StringNode *node, size_t *index, GtkMl_ArrayDebugFn fn, GtkMl_TaggedValue data);
+GTKML_PRIVATE uint32_t decode_debug(GtkMl_Context *ctx, GtkMl_SObj *err, const unsigned char *ptr, size_t *bytes);
+
+GtkMl_TaggedValue gtk_ml_string_get_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, size_t index) {
+    *err = NULL;
+    if (index >= array->len) {
+        return gtk_ml_value_none();
+    }
+
+    GtkMl_StringNode *node = array->rope;
+    while (gtk_ml_dbg_read_u32(ctx, err, &node->kind) == GTKML_STR_CONCAT) {
+        if (*err) {
+            return gtk_ml_value_none();
+        }
+        GtkMl_StringNode *left = gtk_ml_dbg_read_ptr(ctx, err, &node->value.concat.left);
+        size_t len = gtk_ml_dbg_read_u64(ctx, err, &left->len);
+        if (*err) {
+            return gtk_ml_value_none();
+        }
+        if (index < len) {
+            node = left;
+        } else {
+            index -= len;
+            node = gtk_ml_dbg_read_ptr(ctx, err, &node->value.concat.right);
+        }
+    }
+
+    GtkMl_StringBuffer *buffer = gtk_ml_dbg_read_ptr(ctx, err, &node->value.piece.buffer);
+    const unsigned char *ptr = gtk_ml_dbg_read_ptr(ctx, err, &buffer->bytes);
+    ptr += gtk_ml_dbg_read_u64(ctx, err, &node->value.piece.offset);
+    size_t bytes;
+    uint32_t c = 0;
+    for (size_t i = 0; i <= index && !*err; i++) {
+        c = decode_debug(ctx, err, ptr, &bytes);
+        ptr += bytes;
+    }
+    if (*err) {
+        return gtk_ml_value_none();
+    }
+    return gtk_ml_value_char(c);
+}
+
+gboolean gtk_ml_string_foreach_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, GtkMl_ArrayDebugFn fn, GtkMl_TaggedValue data) {
+    *err = NULL;
+    size_t index = 0;
+    if (array->rope) {
+        (void) foreach_debug(ctx, err, array, array->rope, &index, fn, data);
+    }
+    return *err == NULL;
+}
+
+gboolean foreach_debug(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Array *array, GtkMl_StringNode *node, size_t *index, GtkMl_ArrayDebugFn fn, GtkMl_TaggedValue data) {
+    GtkMl_StringNodeKind kind = gtk_ml_dbg_read_u32(ctx, err, &node->kind);
+    if (*err) {
+        return 0;
+    }
+
+    switch (kind) {
+    case GTKML_STR_PIECE: {
+        GtkMl_StringBuffer *buffer = gtk_ml_dbg_read_ptr(ctx, err, &node->value.piece.buffer);
+        const unsigned char *ptr = gtk_ml_dbg_read_ptr(ctx, err, &buffer->bytes);
+        ptr += gtk_ml_dbg_read_u64(ctx, err, &node->value.piece.offset);
+        size_t bytes = gtk_ml_dbg_read_u64(ctx, err, &node->bytes);
+        if (*err) {
+            return 0;
+        }
+        for (size_t i = 0; i < bytes;) {
+            size_t n;
+            uint32_t c = decode_debug(ctx, err, ptr + i, &n);
+            if (*err) {
+                return 0;
+            }
+            i += n;
+            if (fn(ctx, err, array, (*index)++, gtk_ml_value_char(c), data) == GTKML_VISIT_BREAK) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    case GTKML_STR_CONCAT: {
+        GtkMl_StringNode *left = gtk_ml_dbg_read_ptr(ctx, err, &node->value.concat.left);
+        GtkMl_StringNode *right = gtk_ml_dbg_read_ptr(ctx, err, &node->value.concat.right);
+        if (*err) {
+            return 0;
+        }
+        return foreach_debug(ctx, err, array, left, index, fn, data)
+            && foreach_debug(ctx, err, array, right, index, fn, data);
+    }
+    }
+    return 0;
+}
+
+uint32_t decode_debug(GtkMl_Context *ctx, GtkMl_SObj *err, const unsigned char *ptr, size_t *bytes) {
+    unsigned char c[4];
+    c[0] = gtk_ml_dbg_read_u8(ctx, err, ptr);
+    size_t n = c[0] < 0x80? 1 : c[0] < 0xE0? 2 : c[0] < 0xF0? 3 : 4;
+    for (size_t i = 1; i < n; i++) {
+        c[i] = gtk_ml_dbg_read_u8(ctx, err, ptr + i);
+    }
+    return decode(c, bytes);
+}
+#endif /* GTKML_ENABLE_POSIX */
@@ -86,11 +86,9 @@ GtkMl_TaggedValue gtk_ml_value_userdata(void *data) {
 GtkMl_SObj gtk_ml_new_sobject(GtkMl_Context *ctx, GtkMl_Span *span, GtkMl_SKind kind) {
     ++ctx->gc->n_values;
 
-    GtkMl_SObj s = malloc(sizeof(GtkMl_S));
-    s->next = ctx->gc->first;
-    ctx->gc->first = s;
+    GtkMl_SObj s = gtk_ml_gc_alloc(ctx->gc);
+    s->next = NULL;
 
-    s->flags = GTKML_FLAG_NONE;
     s->kind = kind;
     if (span) {
         s->span = *span;
@@ -137,32 +135,40 @@ GtkMl_SObj gtk_ml_new_char(GtkMl_Context *ctx, GtkMl_Span *span, uint32_t value)
 GtkMl_SObj gtk_ml_new_string(GtkMl_Context *ctx, GtkMl_Span *span, const char *ptr, size_t len) {
     GtkMl_SObj s = gtk_ml_new_sobject(ctx, span, GTKML_S_ARRAY);
     GtkMl_Array array;
-    gtk_ml_new_array_trie(&array);
-    for (size_t i = 0; i < len; i++) {
-        GtkMl_Array new;
-        // TODO: unicode codepoints
-        gtk_ml_array_trie_push(&new, &array, gtk_ml_value_char(ptr[i]));
-        gtk_ml_del_array_trie(ctx, &array, gtk_ml_delete_value);
-        array = new;
-    }
-    array.string = 1;
+    gtk_ml_new_string_trie(&array);
+    gtk_ml_string_append(&array, ptr, len);
     s->value.s_array.array = array;
     return s;
 }
 
 GtkMl_SObj gtk_ml_new_symbol(GtkMl_Context *ctx, GtkMl_Span *span, gboolean owned, const char *ptr, size_t len) {
+    GtkMl_SObj interned = gtk_ml_intern(ctx, GTKML_S_SYMBOL, owned, ptr, len);
+    if (!span || !span->ptr) {
+        return interned;
+    }
+
+    // parsed ones get their own object to keep the span, it shares the name of the interned one
     GtkMl_SObj s = gtk_ml_new_sobject(ctx, span, GTKML_S_SYMBOL);
-    s->value.s_symbol.owned = owned;
-    s->value.s_symbol.ptr = ptr;
+    s->value.s_symbol.owned = 0;
+    s->value.s_symbol.ptr = interned->value.s_symbol.ptr;
     s->value.s_symbol.len = len;
+    s->value.s_symbol.hash = interned->value.s_symbol.hash;
+    s->value.s_symbol.interned = interned;
     return s;
 }
 
 GtkMl_SObj gtk_ml_new_keyword(GtkMl_Context *ctx, GtkMl_Span *span, gboolean owned, const char *ptr, size_t len) {
+    GtkMl_SObj interned = gtk_ml_intern(ctx, GTKML_S_KEYWORD, owned, ptr, len);
+    if (!span || !span->ptr) {
+        return interned;
+    }
+
     GtkMl_SObj s = gtk_ml_new_sobject(ctx, span, GTKML_S_KEYWORD);
-    s->value.s_keyword.owned = owned;
-    s->value.s_keyword.ptr = ptr;
+    s->value.s_keyword.owned = 0;
+    s->value.s_keyword.ptr = interned->value.s_keyword.ptr;
     s->value.s_keyword.len = len;
+    s->value.s_keyword.hash = interned->value.s_keyword.hash;
+    s->value.s_keyword.interned = interned;
     return s;
 }
 
@@ -170,6 +176,7 @@ GtkMl_SObj gtk_ml_new_list(GtkMl_Context *ctx, GtkMl_Span *span, GtkMl_SObj car,
     GtkMl_SObj s = gtk_ml_new_sobject(ctx, span, GTKML_S_LIST);
     s->value.s_list.car = car;
     s->value.s_list.cdr = cdr;
+    s->value.s_list.len = 1 + gtk_ml_list_len(cdr);
     return s;
 }
 
@@ -192,6 +199,12 @@ GtkMl_SObj gtk_ml_new_array(GtkMl_Context *ctx, GtkMl_Span *span) {
     return s;
 }
 
+GtkMl_SObj gtk_ml_new_table(GtkMl_Context *ctx, GtkMl_Span *span) {
+    GtkMl_SObj s = gtk_ml_new_sobject(ctx, span, GTKML_S_TABLE);
+    gtk_ml_new_hash_table(&s->value.s_table.table, &GTKML_DEFAULT_HASHER);
+    return s;
+}
+
 GtkMl_SObj gtk_ml_new_var(GtkMl_Context *ctx, GtkMl_Span *span, GtkMl_SObj expr) {
     GtkMl_SObj s = gtk_ml_new_sobject(ctx, span, GTKML_S_VAR);
     s->value.s_var.expr = expr;
@@ -238,9 +251,20 @@ GtkMl_SObj gtk_ml_new_program(GtkMl_Context *ctx, GtkMl_Span *span, const char *
     s->value.s_program.body = body;
     s->value.s_program.capture = capture;
     s->value.s_program.kind = kind;
+    s->value.s_program.variadic = gtk_ml_params_variadic(args);
     return s;
 }
 
+gboolean gtk_ml_params_variadic(GtkMl_SObj params) {
+    if (params->kind != GTKML_S_LIST) {
+        return 0;
+    }
+    while (gtk_ml_list_len(params) > 1) {
+        params = gtk_ml_cdr(params);
+    }
+    return gtk_ml_car(params)->kind == GTKML_S_VARARG;
+}
+
 GtkMl_SObj gtk_ml_new_address(GtkMl_Context *ctx, GtkMl_Span *span, const char *linkage_name, uint64_t addr) {
     GtkMl_SObj s = gtk_ml_new_sobject(ctx, span, GTKML_S_ADDRESS);
     s->value.s_address.linkage_name = gtk_ml_new_string(ctx, span, linkage_name, strlen(linkage_name));
@@ -12,69 +12,30 @@
 #include "gtk-ml.h"
 #include "gtk-ml-internal.h"
 
-GTKML_PRIVATE gboolean (*OPCODES[])(GtkMl_Vm *, GtkMl_SObj *, GtkMl_Data) = {
-    [GTKML_I_NOP] = gtk_ml_i_nop,
-    [GTKML_I_HALT] = gtk_ml_i_halt,
-    [GTKML_I_ADD] = gtk_ml_i_signed_add,
-    [GTKML_I_SUBTRACT] = gtk_ml_i_signed_subtract,
-    [GTKML_I_SIGNED_MULTIPLY] = gtk_ml_i_signed_multiply,
-    [GTKML_I_UNSIGNED_MULTIPLY] = gtk_ml_i_unsigned_multiply,
-    [GTKML_I_SIGNED_DIVIDE] = gtk_ml_i_signed_divide,
-    [GTKML_I_UNSIGNED_DIVIDE] = gtk_ml_i_unsigned_divide,
-    [GTKML_I_SIGNED_MODULO] = gtk_ml_i_signed_modulo,
-    [GTKML_I_UNSIGNED_MODULO] = gtk_ml_i_unsigned_modulo,
-    [GTKML_I_BIT_AND] = gtk_ml_i_bit_and,
-    [GTKML_I_BIT_OR] = gtk_ml_i_bit_or,
-    [GTKML_I_BIT_XOR] = gtk_ml_i_bit_xor,
-    [GTKML_I_BIT_NAND] = gtk_ml_i_bit_nand,
-    [GTKML_I_BIT_NOR] = gtk_ml_i_bit_nor,
-    [GTKML_I_BIT_XNOR] = gtk_ml_i_bit_xnor,
-    [GTKML_I_CMP_IMM] = gtk_ml_i_cmp_imm,
-    [GTKML_I_CAR] = gtk_ml_i_car,
-    [GTKML_I_CDR] = gtk_ml_i_cdr,
-    [GTKML_I_DEFINE] = gtk_ml_i_define,
-    [GTKML_I_LIST] = gtk_ml_i_list,
-    [GTKML_I_BIND] = gtk_ml_i_bind,
-    [GTKML_I_ENTER_BIND_ARGS] = gtk_ml_i_enter_bind_args,
-    [GTKML_I_LOCAL_IMM] = gtk_ml_i_local_imm,
-    [GTKML_I_ENTER] = gtk_ml_i_enter,
-    [GTKML_I_LEAVE] = gtk_ml_i_leave,
-    [GTKML_I_UNWRAP] = gtk_ml_i_unwrap,
-    [GTKML_I_TYPEOF] = gtk_ml_i_typeof,
-    [GTKML_I_TO_SOBJ] = gtk_ml_i_to_sobj,
-    [GTKML_I_TO_PRIM] = gtk_ml_i_to_prim,
-    [GTKML_I_PUSH_IMM] = gtk_ml_i_push_imm,
-    [GTKML_I_POP] = gtk_ml_i_pop,
-    [GTKML_I_SETF_IMM] = gtk_ml_i_setf_imm,
-    [GTKML_I_POPF] = gtk_ml_i_popf,
-    [GTKML_I_GET_IMM] = gtk_ml_i_get_imm,
-    [GTKML_I_LIST_IMM] = gtk_ml_i_list_imm,
-    [GTKML_I_MAP_IMM] = gtk_ml_i_map_imm,
-    [GTKML_I_SET_IMM] = gtk_ml_i_set_imm,
-    [GTKML_I_ARRAY_IMM] = gtk_ml_i_array_imm,
-    [GTKML_I_SETMM_IMM] = gtk_ml_i_setmm_imm,
-    [GTKML_I_GETMM_IMM] = gtk_ml_i_getmm_imm,
-    [GTKML_I_VAR] = gtk_ml_i_var,
-    [GTKML_I_GETVAR] = gtk_ml_i_getvar,
-    [GTKML_I_ASSIGNVAR] = gtk_ml_i_assignvar,
-    [GTKML_I_LEN] = gtk_ml_i_len,
-    [GTKML_I_ARRAY_INDEX] = gtk_ml_i_array_index,
-    [GTKML_I_ARRAY_PUSH] = gtk_ml_i_array_push,
-    [GTKML_I_ARRAY_POP] = gtk_ml_i_array_pop,
-    [GTKML_I_ARRAY_CONCAT] = gtk_ml_i_array_concat,
-    [GTKML_I_MAP_GET] = gtk_ml_i_map_get,
-    [GTKML_I_MAP_INSERT] = gtk_ml_i_map_insert,
-    [GTKML_I_MAP_DELETE] = gtk_ml_i_map_delete,
-    [GTKML_I_SET_CONTAINS] = gtk_ml_i_set_contains,
-    [GTKML_I_SET_INSERT] = gtk_ml_i_set_insert,
-    [GTKML_I_SET_DELETE] = gtk_ml_i_set_delete,
-    [GTKML_I_CALL] = gtk_ml_i_call,
-    [GTKML_I_LEAVE_RET] = gtk_ml_i_leave_ret,
-    [GTKML_I_CALL_CORE] = gtk_ml_i_call_core,
-    [GTKML_I_BRANCH_ABSOLUTE] = gtk_ml_i_branch_absolute,
-    [GTKML_I_BRANCH_RELATIVE] = gtk_ml_i_branch_relative,
-    [255] = (gboolean (*)(GtkMl_Vm *, GtkMl_SObj *, GtkMl_Data)) NULL,
+#define GTKML_OPCODE_ENTRY(opcode, handler) [opcode] = handler,
+GTKML_PRIVATE GtkMl_Handler OPCODES[] = {
+    GTKML_OPCODE_LIST(GTKML_OPCODE_ENTRY)
+    [255] = (GtkMl_Handler) NULL,
 };
+#undef GTKML_OPCODE_ENTRY
+
+typedef struct GtkMl_Quickened {
+    GtkMl_Handler handler;
+    uint16_t generic;
+} GtkMl_Quickened;
+
+#define GTKML_QUICKENED_ENTRY(slot, handler, generic, kind) [slot] = { handler, generic },
+GTKML_PRIVATE const GtkMl_Quickened QUICKENED[256] = {
+    GTKML_QUICKENED_LIST(GTKML_QUICKENED_ENTRY)
+};
+#undef GTKML_QUICKENED_ENTRY
+
+// the quickened slot of every generic opcode for every kind of operands, 0 if it has none
+#define GTKML_QUICKEN_ENTRY(slot, handler, generic, kind) [generic][kind] = slot,
+GTKML_PRIVATE const uint16_t QUICKEN[256][GTKML_N_QUICKEN] = {
+    GTKML_QUICKENED_LIST(GTKML_QUICKEN_ENTRY)
+};
+#undef GTKML_QUICKEN_ENTRY
 
 #ifdef GTKML_ENABLE_GTK
 GTKML_PRIVATE GtkMl_TaggedValue vm_core_application(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_TaggedValue expr);
@@ -128,6 +89,7 @@ void gtk_ml_bind(GtkMl_Context *ctx, GtkMl_SObj key, GtkMl_TaggedValue value) {
     GtkMl_SObj new_scope = gtk_ml_new_map(ctx, NULL, NULL);
     gtk_ml_hash_trie_insert(&new_scope->value.s_map.map, &ctx->bindings->value.s_var.expr->value.s_map.map, gtk_ml_value_sobject(key), value);
     ctx->bindings->value.s_var.expr = new_scope;
+    gtk_ml_write_barrier(ctx->bindings);
 }
 
 GtkMl_TaggedValue gtk_ml_get(GtkMl_Context *ctx, GtkMl_SObj key) {
@@ -151,6 +113,7 @@ GTKML_PRIVATE void activate_program(GtkApplication* app, gpointer userdata) {
     if (gtk_ml_run_program_internal(ctx, &err, program_expr, gtk_ml_new_list(ctx, NULL, app_expr, gtk_ml_new_nil(ctx, NULL)), 0)) {
         GtkMl_SObj result = gtk_ml_pop(ctx).value.sobj;
         app_expr->value.s_userdata.keep = gtk_ml_new_list(ctx, NULL, result, app_expr->value.s_userdata.keep);
+        gtk_ml_write_barrier(app_expr);
     } else {
         (void) gtk_ml_dumpf(ctx, stderr, NULL, err);
     }
@@ -186,6 +149,7 @@ GtkMl_TaggedValue vm_core_application(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl
         GtkMl_SObj ctx_expr = gtk_ml_new_lightdata(ctx, NULL, ctx);
         GtkMl_SObj userdata = gtk_ml_new_list(ctx, NULL, ctx_expr, gtk_ml_new_list(ctx, NULL, app_expr, gtk_ml_new_list(ctx, NULL, activate.value.sobj, gtk_ml_new_nil(ctx, NULL))));
         app_expr->value.s_userdata.keep = gtk_ml_new_list(ctx, &app_expr->span, userdata, app_expr->value.s_userdata.keep);
+        gtk_ml_write_barrier(app_expr);
         g_signal_connect(app, "activate", G_CALLBACK(activate_program), userdata);
     }
 
@@ -337,6 +301,7 @@ GtkMl_TaggedValue vm_core_compile_expr(GtkMl_Context *ctx, GtkMl_SObj *err, GtkM
 
     if (_bb != arg_basic_block) {
         arg_bb_var->value.s_var.expr = gtk_ml_new_lightdata(ctx, NULL, _bb);
+        gtk_ml_write_barrier(arg_bb_var);
     }
 
     return gtk_ml_value_true();
@@ -502,6 +467,8 @@ GtkMl_TaggedValue vm_core_emit_bytecode(GtkMl_Context *ctx, GtkMl_SObj *err, Gtk
         return gtk_ml_build_array_pop(arg_ctx, arg_b, arg_basic_block, err)? gtk_ml_value_true() : gtk_ml_value_none();
     } else if (strlen(GTKML_SI_ARRAY_CONCAT) == len && strncmp(ptr, GTKML_SI_ARRAY_CONCAT, len) == 0) {
         return gtk_ml_build_array_concat(arg_ctx, arg_b, arg_basic_block, err)? gtk_ml_value_true() : gtk_ml_value_none();
+    } else if (strlen(GTKML_SI_ARRAY_SLICE) == len && strncmp(ptr, GTKML_SI_ARRAY_SLICE, len) == 0) {
+        return gtk_ml_build_array_slice(arg_ctx, arg_b, arg_basic_block, err)? gtk_ml_value_true() : gtk_ml_value_none();
     } else if (strlen(GTKML_SI_MAP_GET) == len && strncmp(ptr, GTKML_SI_MAP_GET, len) == 0) {
         return gtk_ml_build_map_get(arg_ctx, arg_b, arg_basic_block, err)? gtk_ml_value_true() : gtk_ml_value_none();
     } else if (strlen(GTKML_SI_MAP_INSERT) == len && strncmp(ptr, GTKML_SI_MAP_INSERT, len) == 0) {
@@ -514,6 +481,16 @@ GtkMl_TaggedValue vm_core_emit_bytecode(GtkMl_Context *ctx, GtkMl_SObj *err, Gtk
         return gtk_ml_build_set_insert(arg_ctx, arg_b, arg_basic_block, err)? gtk_ml_value_true() : gtk_ml_value_none();
     } else if (strlen(GTKML_SI_SET_DELETE) == len && strncmp(ptr, GTKML_SI_SET_DELETE, len) == 0) {
         return gtk_ml_build_set_delete(arg_ctx, arg_b, arg_basic_block, err)? gtk_ml_value_true() : gtk_ml_value_none();
+    } else if (strlen(GTKML_SI_MAP_TO_TABLE) == len && strncmp(ptr, GTKML_SI_MAP_TO_TABLE, len) == 0) {
+        return gtk_ml_build_map_to_table(arg_ctx, arg_b, arg_basic_block, err)? gtk_ml_value_true() : gtk_ml_value_none();
+    } else if (strlen(GTKML_SI_TABLE_TO_MAP) == len && strncmp(ptr, GTKML_SI_TABLE_TO_MAP, len) == 0) {
+        return gtk_ml_build_table_to_map(arg_ctx, arg_b, arg_basic_block, err)? gtk_ml_value_true() : gtk_ml_value_none();
+    } else if (strlen(GTKML_SI_TABLE_GET) == len && strncmp(ptr, GTKML_SI_TABLE_GET, len) == 0) {
+        return gtk_ml_build_table_get(arg_ctx, arg_b, arg_basic_block, err)? gtk_ml_value_true() : gtk_ml_value_none();
+    } else if (strlen(GTKML_SI_TABLE_INSERT) == len && strncmp(ptr, GTKML_SI_TABLE_INSERT, len) == 0) {
+        return gtk_ml_build_table_insert(arg_ctx, arg_b, arg_basic_block, err)? gtk_ml_value_true() : gtk_ml_value_none();
+    } else if (strlen(GTKML_SI_TABLE_DELETE) == len && strncmp(ptr, GTKML_SI_TABLE_DELETE, len) == 0) {
+        return gtk_ml_build_table_delete(arg_ctx, arg_b, arg_basic_block, err)? gtk_ml_value_true() : gtk_ml_value_none();
     } else if (strlen(GTKML_SI_CALL_CORE) == len && strncmp(ptr, GTKML_SI_CALL_CORE, len) == 0) {
         if (!gtk_ml_has_value(data)) {
             *err = gtk_ml_error(ctx, "arity-error", GTKML_ERR_ARITY_ERROR, 0, 0, 0, 0);
@@ -884,17 +861,27 @@ GtkMl_Vm *gtk_ml_new_vm(GtkMl_Context *ctx) {
     vm->call_stack_cap = GTKML_VM_CALL_STACK;
 
     vm->program = NULL;
+    vm->decoded = NULL;
+    vm->n_decoded = 0;
 
     vm->flags = GTKML_F_NONE;
 
     vm->core = CORE;
 
+#ifdef GTKML_ENABLE_THREADED
+    vm->dispatch = GTKML_DISPATCH_THREADED;
+#else
+    vm->dispatch = GTKML_DISPATCH_TABLE;
+#endif /* GTKML_ENABLE_THREADED */
+    vm->n_executed = 0;
+
     vm->ctx = ctx;
 
     return vm;
 }
 
 void gtk_ml_del_vm(GtkMl_Vm *vm) {
+    free(vm->decoded);
     free(vm);
 }
 
@@ -910,42 +897,243 @@ GtkMl_TaggedValue gtk_ml_vm_pop(GtkMl_Vm *vm) {
     return vm->stack[--vm->stack_len];
 }
 
-GTKML_PRIVATE gboolean gtk_ml_vm_step(GtkMl_Vm *vm, GtkMl_SObj *err, size_t pc, GtkMl_Instruction instr) {
-#ifdef GTKML_ENABLE_ASM
-    gtk_ml_breakpoint(vm->ctx);
-#endif /* GTKML_ENABLE_ASM */
+GTKML_PRIVATE gboolean gtk_ml_i_skip(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
+    (void) err;
+    (void) data;
+
+    vm->pc += 8;
+    return 1;
+}
+
+GTKML_PRIVATE gboolean gtk_ml_i_category_error(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
+    (void) data;
+
+    *err = gtk_ml_error(vm->ctx, "category-error", GTKML_ERR_CATEGORY_ERROR, 0, 0, 0, 1, gtk_ml_new_keyword(vm->ctx, NULL, 0, "pc", strlen("pc")), gtk_ml_new_int(vm->ctx, NULL, vm->pc));
+    return 0;
+}
+
+GTKML_PRIVATE gboolean gtk_ml_i_opcode_error(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
+    (void) data;
+
+    *err = gtk_ml_error(vm->ctx, "opcode-error", GTKML_ERR_OPCODE_ERROR, 0, 0, 0, 1, gtk_ml_new_keyword(vm->ctx, NULL, 0, "pc", strlen("pc")), gtk_ml_new_int(vm->ctx, NULL, vm->pc));
+    return 0;
+}
+
+GTKML_PRIVATE GtkMl_TaggedValue gtk_ml_get_data(GtkMl_Program *program, GtkMl_Data data) {
+    if (data >= program->n_data) {
+        return gtk_ml_value_none();
+    }
+    GtkMl_TaggedValue value = program->data[data];
+    if (!gtk_ml_has_value(value)) {
+        return gtk_ml_value_none();
+    } else if (gtk_ml_is_primitive(value)) {
+        return value;
+    } else {
+        return gtk_ml_value_sobject(program->statics[value.value.u64]);
+    }
+}
+
+void gtk_ml_vm_load_program(GtkMl_Vm *vm, GtkMl_Program *program) {
+    vm->program = program;
+
+    if (vm->n_decoded < program->n_text) {
+        vm->decoded = realloc(vm->decoded, sizeof(GtkMl_Decoded) * program->n_text);
+    }
+    vm->n_decoded = program->n_text;
+
+    for (size_t i = 0; i < program->n_text; i++) {
+        GtkMl_Instruction instr = program->text[i];
+        GtkMl_Decoded *decoded = &vm->decoded[i];
+
+        decoded->cond = instr.cond;
+        decoded->operand = gtk_ml_value_none();
+        decoded->opcode = GTKML_I_INDIRECT;
+        decoded->deopts = 0;
 
-    if (!instr.cond || (instr.cond && (vm->flags & instr.cond))) {
-        if (instr.cond) {
-            vm->flags &= GTKML_F_TOPCALL;
-        }
         if (instr.category == GTKML_I_GENERIC) {
-            gboolean (*function)(GtkMl_Vm *, GtkMl_SObj *, GtkMl_Data) = OPCODES[instr.opcode];
-            if (function) {
-                return function(vm, err, instr.data);
+            if (OPCODES[instr.opcode]) {
+                decoded->handler = OPCODES[instr.opcode];
+                decoded->operand = gtk_ml_get_data(program, instr.data);
+                decoded->opcode = instr.opcode;
             } else {
-                *err = gtk_ml_error(vm->ctx, "opcode-error", GTKML_ERR_OPCODE_ERROR, 0, 0, 0, 1, gtk_ml_new_keyword(vm->ctx, NULL, 0, "pc", strlen("pc")), gtk_ml_new_int(vm->ctx, NULL, pc));
-                return 0;
+                decoded->handler = gtk_ml_i_opcode_error;
             }
-        } else if (instr.category == GTKML_I_RESERVED) {
-            *err = gtk_ml_error(vm->ctx, "category-error", GTKML_ERR_CATEGORY_ERROR, 0, 0, 0, 1, gtk_ml_new_keyword(vm->ctx, NULL, 0, "pc", strlen("pc")), gtk_ml_new_int(vm->ctx, NULL, pc));
-            return 0;
-        } else if (instr.category == GTKML_I_EXTERN) {
-            *err = gtk_ml_error(vm->ctx, "category-error", GTKML_ERR_CATEGORY_ERROR, 0, 0, 0, 1, gtk_ml_new_keyword(vm->ctx, NULL, 0, "pc", strlen("pc")), gtk_ml_new_int(vm->ctx, NULL, pc));
-            return 0;
+        } else if (instr.category == GTKML_I_RESERVED || instr.category == GTKML_I_EXTERN) {
+            decoded->handler = gtk_ml_i_category_error;
         } else { // exports are ignored
-            vm->pc += 8;
-            return 1;
+            decoded->handler = gtk_ml_i_skip;
         }
-    } else {
-        vm->pc += 8;
-        return 1;
     }
 }
 
+void gtk_ml_vm_quicken(GtkMl_Vm *vm, GtkMl_Quicken kind) {
+    if ((vm->pc >> 3) >= vm->n_decoded) {
+        return;
+    }
+    GtkMl_Decoded *decoded = &vm->decoded[vm->pc >> 3];
+    if (decoded->opcode == GTKML_I_INDIRECT || decoded->deopts >= GTKML_QUICKEN_LIMIT) {
+        return;
+    }
+    uint16_t slot = QUICKEN[decoded->opcode][kind];
+    if (slot) {
+        decoded->handler = QUICKENED[slot].handler;
+        decoded->opcode = slot;
+    }
+}
+
+gboolean gtk_ml_vm_deoptimize(GtkMl_Vm *vm, GtkMl_SObj *err, GtkMl_TaggedValue data) {
+    GtkMl_Decoded *decoded = &vm->decoded[vm->pc >> 3];
+    decoded->opcode = QUICKENED[decoded->opcode].generic;
+    decoded->handler = OPCODES[decoded->opcode];
+    ++decoded->deopts;
+    return decoded->handler(vm, err, data);
+}
+
+// the table loop, `hook` runs after every fetch
+#define GTKML_TABLE_LOOP(hook) \
+    do { \
+        size_t gc_counter = 0; \
+        while (!(vm->flags & GTKML_F_HALT)) { \
+            if ((vm->pc >> 3) >= vm->n_decoded) { \
+                *err = gtk_ml_error(vm->ctx, "index-out-of-bounds", GTKML_ERR_INDEX_ERROR, 0, 0, 0, 1, \
+                    gtk_ml_new_keyword(vm->ctx, NULL, 0, "pc", strlen("pc")), gtk_ml_new_int(vm->ctx, NULL, vm->pc)); \
+                return 0; \
+            } \
+            GtkMl_Decoded *instr = &vm->decoded[vm->pc >> 3]; \
+            hook; \
+            if (instr->cond && !(vm->flags & instr->cond)) { \
+                vm->pc += 8; \
+            } else { \
+                if (instr->cond) { \
+                    vm->flags &= GTKML_F_TOPCALL; \
+                } \
+                if (!instr->handler(vm, err, instr->operand)) { \
+                    return 0; \
+                } \
+            } \
+            if (gc_counter++ == GTKML_GC_STEP_THRESHOLD) { \
+                if (gtk_ml_collect(vm->ctx)) { \
+                    vm->n_executed += gc_counter; \
+                    gc_counter = 0; \
+                } \
+            } \
+        } \
+        vm->n_executed += gc_counter; \
+        return 1; \
+    } while (0)
+
+GTKML_PRIVATE gboolean gtk_ml_vm_run_table(GtkMl_Vm *vm, GtkMl_SObj *err) {
+    GTKML_TABLE_LOOP((void) 0);
+}
+
+#ifdef GTKML_ENABLE_ASM
+// the table loop, but it traps into the debugger before every instruction
+// only used once a debugger has attached, so the other loops carry no cost for it
+GTKML_PRIVATE gboolean gtk_ml_vm_run_debug(GtkMl_Vm *vm, GtkMl_SObj *err) {
+    GTKML_TABLE_LOOP(gtk_ml_breakpoint(vm->ctx));
+}
+#endif /* GTKML_ENABLE_ASM */
+
+#undef GTKML_TABLE_LOOP
+
+#ifdef GTKML_ENABLE_THREADED
+// labels as values are a GNU extension, the rest of the vm stays ISO C
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+// bookkeeping after every executed instruction, mirrors the table loop
+#define GTKML_THREADED_RETIRE() \
+    do { \
+        if (gc_counter++ == GTKML_GC_STEP_THRESHOLD) { \
+            if (gtk_ml_collect(vm->ctx)) { \
+                vm->n_executed += gc_counter; \
+                gc_counter = 0; \
+            } \
+        } \
+        if (vm->flags & GTKML_F_HALT) { \
+            vm->n_executed += gc_counter; \
+            return 1; \
+        } \
+    } while (0)
+
+// fetches the next instruction and jumps straight to its handler
+// every handler gets its own copy, so the branch predictor sees one indirect
+// jump per opcode instead of a single shared one
+#define GTKML_THREADED_FETCH() \
+    do { \
+        if ((vm->pc >> 3) >= vm->n_decoded) { \
+            goto out_of_bounds; \
+        } \
+        instr = &vm->decoded[vm->pc >> 3]; \
+        if (instr->cond) { \
+            if (!(vm->flags & instr->cond)) { \
+                vm->pc += 8; \
+                goto retire; \
+            } \
+            vm->flags &= GTKML_F_TOPCALL; \
+        } \
+        goto *DISPATCH[instr->opcode]; \
+    } while (0)
+
+#define GTKML_THREADED_LABEL(opcode, handler) [opcode] = &&threaded_##opcode,
+#define GTKML_THREADED_QUICKENED_LABEL(slot, handler, generic, kind) GTKML_THREADED_LABEL(slot, handler)
+
+#define GTKML_THREADED_HANDLER(opcode, handler) \
+    threaded_##opcode: \
+        if (!handler(vm, err, instr->operand)) { \
+            return 0; \
+        } \
+        GTKML_THREADED_RETIRE(); \
+        GTKML_THREADED_FETCH();
+
+#define GTKML_THREADED_QUICKENED_HANDLER(slot, handler, generic, kind) GTKML_THREADED_HANDLER(slot, handler)
+
+GTKML_PRIVATE gboolean gtk_ml_vm_run_threaded(GtkMl_Vm *vm, GtkMl_SObj *err) {
+    static const void *DISPATCH[256] = {
+        GTKML_OPCODE_LIST(GTKML_THREADED_LABEL)
+        GTKML_QUICKENED_LIST(GTKML_THREADED_QUICKENED_LABEL)
+        [GTKML_I_INDIRECT] = &&threaded_indirect,
+    };
+
+    size_t gc_counter = 0;
+    GtkMl_Decoded *instr;
+
+    goto fetch;
+
+retire:
+    GTKML_THREADED_RETIRE();
+fetch:
+    GTKML_THREADED_FETCH();
+
+    GTKML_OPCODE_LIST(GTKML_THREADED_HANDLER)
+    GTKML_QUICKENED_LIST(GTKML_THREADED_QUICKENED_HANDLER)
+
+threaded_indirect:
+    if (!instr->handler(vm, err, instr->operand)) {
+        return 0;
+    }
+    goto retire;
+
+out_of_bounds:
+    *err = gtk_ml_error(vm->ctx, "index-out-of-bounds", GTKML_ERR_INDEX_ERROR, 0, 0, 0, 1,
+        gtk_ml_new_keyword(vm->ctx, NULL, 0, "pc", strlen("pc")), gtk_ml_new_int(vm->ctx, NULL, vm->pc));
+    return 0;
+}
+
+#undef GTKML_THREADED_QUICKENED_HANDLER
+#undef GTKML_THREADED_HANDLER
+#undef GTKML_THREADED_QUICKENED_LABEL
+#undef GTKML_THREADED_LABEL
+#undef GTKML_THREADED_FETCH
+#undef GTKML_THREADED_RETIRE
+
+#pragma GCC diagnostic pop
+#endif /* GTKML_ENABLE_THREADED */
+
 gboolean gtk_ml_vm_run(GtkMl_Vm *vm, GtkMl_SObj *err, gboolean brk) {
 #ifdef GTKML_ENABLE_ASM
     if (brk && getenv("GTKML_ENABLE_DEBUG") && strcmp(getenv("GTKML_ENABLE_DEBUG"), "0") != 0) {
+        // gtkml-dbg picks up the context here and marks it as a debuggee through `gtk_ml_set_debug`
         gtk_ml_breakpoint_internal(vm->ctx, !vm->ctx->dbg_done);
         vm->ctx->dbg_done = 1;
     }
@@ -955,21 +1143,16 @@ gboolean gtk_ml_vm_run(GtkMl_Vm *vm, GtkMl_SObj *err, gboolean brk) {
 
     vm->flags |= GTKML_F_TOPCALL;
     vm->flags &= ~GTKML_F_HALT;
-    size_t gc_counter = 0;
-    while (!(vm->flags & GTKML_F_HALT)) {
-        if ((vm->pc >> 3) >= vm->program->n_text) {
-            *err = gtk_ml_error(vm->ctx, "index-out-of-bounds", GTKML_ERR_INDEX_ERROR, 0, 0, 0, 1,
-                gtk_ml_new_keyword(vm->ctx, NULL, 0, "pc", strlen("pc")), gtk_ml_new_int(vm->ctx, NULL, vm->pc));
-            return 0;
-        }
-        if (!gtk_ml_vm_step(vm, err, vm->pc, vm->program->text[vm->pc >> 3])) {
-            return 0;
-        }
-        if (gc_counter++ == GTKML_GC_STEP_THRESHOLD) {
-            if (gtk_ml_collect(vm->ctx)) {
-                gc_counter = 0;
-            }
-        }
+
+#ifdef GTKML_ENABLE_ASM
+    if (vm->ctx->is_debuggee) {
+        return gtk_ml_vm_run_debug(vm, err);
     }
-    return 1;
+#endif /* GTKML_ENABLE_ASM */
+#ifdef GTKML_ENABLE_THREADED
+    if (vm->dispatch == GTKML_DISPATCH_THREADED) {
+        return gtk_ml_vm_run_threaded(vm, err);
+    }
+#endif /* GTKML_ENABLE_THREADED */
+    return gtk_ml_vm_run_table(vm, err);
 }
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "gtk-ml.h"
+
+// piece lengths that leave partial leaves and branches on both sides of every seam
+#define N_PIECES 8
+GTKML_PRIVATE const size_t PIECES[N_PIECES] = { 1, 31, 33, 1000, 5, 1057, 1031, 64 };
+
+// `n` ints counting up from `first`
+GTKML_PRIVATE void range(GtkMl_Array *out, int64_t first, size_t n) {
+    gtk_ml_new_array_trie(out);
+    for (size_t i = 0; i < n; i++) {
+        gtk_ml_array_trie_transient_push(out, gtk_ml_value_int(first + (int64_t) i));
+    }
+}
+
+GTKML_PRIVATE int check(const char *name, GtkMl_Array *array, const int64_t *expected, size_t len) {
+    if (gtk_ml_array_trie_len(array) != len) {
+        fprintf(stderr, "%s: expected %zu elements, got %zu\n", name, len, gtk_ml_array_trie_len(array));
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        GtkMl_TaggedValue value = gtk_ml_array_trie_get(array, i);
+        if (!gtk_ml_has_value(value) || value.value.s64 != expected[i]) {
+            fprintf(stderr, "%s: expected %lld at %zu, got %lld\n", name, (long long) expected[i], i, (long long) value.value.s64);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// joins slices taken at odd offsets, so the seams never line up with a leaf
+GTKML_PRIVATE int concat(GtkMl_Array *out, int64_t *expected, size_t *len) {
+    gtk_ml_new_array_trie(out);
+    *len = 0;
+
+    for (size_t p = 0; p < N_PIECES; p++) {
+        GtkMl_Array full;
+        range(&full, (int64_t) p * 100000, PIECES[p] + 7);
+        GtkMl_Array piece;
+        gtk_ml_array_trie_slice(&piece, &full, 3, PIECES[p] + 3);
+        gtk_ml_del_array_trie(NULL, &full, gtk_ml_delete_value);
+
+        GtkMl_Array joined;
+        gtk_ml_array_trie_concat(&joined, out, &piece);
+        for (size_t i = 0; i < PIECES[p]; i++) {
+            expected[(*len)++] = (int64_t) p * 100000 + 3 + (int64_t) i;
+        }
+
+        // both sides are persistent, joining them changes neither
+        if (!check("concat", &piece, expected + *len - PIECES[p], PIECES[p])
+                || !check("concat", out, expected, *len - PIECES[p])
+                || !check("concat", &joined, expected, *len)) {
+            gtk_ml_del_array_trie(NULL, &piece, gtk_ml_delete_value);
+            gtk_ml_del_array_trie(NULL, &joined, gtk_ml_delete_value);
+            return 0;
+        }
+
+        gtk_ml_del_array_trie(NULL, &piece, gtk_ml_delete_value);
+        gtk_ml_del_array_trie(NULL, out, gtk_ml_delete_value);
+        *out = joined;
+    }
+
+    return 1;
+}
+
+// cuts the joined array across piece, leaf and branch boundaries
+GTKML_PRIVATE int slice(GtkMl_Array *array, const int64_t *expected, size_t len) {
+    size_t cuts[2 * N_PIECES + 8];
+    size_t n_cuts = 0;
+    size_t at = 0;
+    for (size_t p = 0; p < N_PIECES; p++) {
+        at += PIECES[p];
+        cuts[n_cuts++] = at - 1;
+        cuts[n_cuts++] = at + 1 < len? at + 1 : len;
+    }
+    cuts[n_cuts++] = 0;
+    cuts[n_cuts++] = 31;
+    cuts[n_cuts++] = 32;
+    cuts[n_cuts++] = 1023;
+    cuts[n_cuts++] = 1025;
+    cuts[n_cuts++] = 2048;
+    cuts[n_cuts++] = len - 1;
+    cuts[n_cuts++] = len;
+
+    for (size_t i = 0; i < n_cuts; i++) {
+        for (size_t j = i; j < n_cuts; j++) {
+            size_t start = cuts[i] < cuts[j]? cuts[i] : cuts[j];
+            size_t end = cuts[i] < cuts[j]? cuts[j] : cuts[i];
+
+            GtkMl_Array part;
+            gtk_ml_array_trie_slice(&part, array, start, end);
+            int ok = check("slice", &part, expected + start, end - start);
+
+            // a slice grows like any other array
+            if (ok) {
+                GtkMl_Array pushed;
+                gtk_ml_array_trie_push(&pushed, &part, gtk_ml_value_int(-1));
+                GtkMl_TaggedValue last = gtk_ml_array_trie_get(&pushed, end - start);
+                if (!check("slice", &part, expected + start, end - start) || last.value.s64 != -1) {
+                    fprintf(stderr, "slice: pushing onto %zu..%zu went wrong\n", start, end);
+                    ok = 0;
+                }
+                gtk_ml_del_array_trie(NULL, &pushed, gtk_ml_delete_value);
+            }
+
+            gtk_ml_del_array_trie(NULL, &part, gtk_ml_delete_value);
+            if (!ok) {
+                fprintf(stderr, "slice: %zu..%zu of %zu\n", start, end, len);
+                return 0;
+            }
+        }
+
+        // splitting and joining again gives back the same array
+        GtkMl_Array lhs;
+        GtkMl_Array rhs;
+        gtk_ml_array_trie_split(&lhs, &rhs, array, cuts[i]);
+        GtkMl_Array joined;
+        gtk_ml_array_trie_concat(&joined, &lhs, &rhs);
+        int ok = check("split", &lhs, expected, cuts[i])
+            && check("split", &rhs, expected + cuts[i], len - cuts[i])
+            && check("split", &joined, expected, len);
+        if (ok && !gtk_ml_array_trie_equal(&joined, array)) {
+            fprintf(stderr, "split: joined halves are not equal to the array\n");
+            ok = 0;
+        }
+        gtk_ml_del_array_trie(NULL, &lhs, gtk_ml_delete_value);
+        gtk_ml_del_array_trie(NULL, &rhs, gtk_ml_delete_value);
+        gtk_ml_del_array_trie(NULL, &joined, gtk_ml_delete_value);
+        if (!ok) {
+            fprintf(stderr, "split: at %zu of %zu\n", cuts[i], len);
+            return 0;
+        }
+    }
+
+    return check("slice", array, expected, len);
+}
+
+int main() {
+    size_t cap = 0;
+    for (size_t p = 0; p < N_PIECES; p++) {
+        cap += PIECES[p];
+    }
+    int64_t *expected = malloc(sizeof(int64_t) * cap);
+
+    GtkMl_Array array;
+    size_t len;
+    int ok = concat(&array, expected, &len) && slice(&array, expected, len);
+
+    gtk_ml_del_array_trie(NULL, &array, gtk_ml_delete_value);
+    free(expected);
+
+    return !ok;
+}
@@ -0,0 +1,119 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include "gtk-ml.h"
+
+#define SRC_A "(define (f x) (+ x 1))\n(f 41)\n"
+#define SRC_B "(define (f x) (+ x 2))\n(f 41)\n"
+
+GTKML_PRIVATE char dir[] = "/tmp/gtkml-cache-XXXXXX";
+GTKML_PRIVATE char source[sizeof(dir) + 16];
+
+GTKML_PRIVATE gboolean write_file(const char *path, const char *contents) {
+    FILE *stream = fopen(path, "wb");
+    if (!stream) {
+        return 0;
+    }
+    size_t len = strlen(contents);
+    gboolean written = fwrite(contents, 1, len, stream) == len;
+    return fclose(stream) == 0 && written;
+}
+
+// how many entries the cache holds, the name of the last one is left in `entry`
+GTKML_PRIVATE size_t entries(char *entry, size_t size) {
+    DIR *d = opendir(dir);
+    size_t n = 0;
+    struct dirent *e;
+    while (d && (e = readdir(d))) {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0 || strcmp(e->d_name, "source.gtkml") == 0) {
+            continue;
+        }
+        snprintf(entry, size, "%s/%s", dir, e->d_name);
+        ++n;
+    }
+    if (d) {
+        closedir(d);
+    }
+    return n;
+}
+
+// loads `source` through the cache in a new context, and runs it
+// `hit` tells whether the program came from the cache
+GTKML_PRIVATE int run(const char *name, int64_t expected, gboolean hit, size_t n_entries) {
+    GtkMl_SObj err = NULL;
+    GtkMl_Context *ctx = gtk_ml_new_context();
+    char *src = NULL;
+
+    int ok = 1;
+    GtkMl_Program *program = gtk_ml_load_cached(ctx, &src, &err, source, dir);
+    GtkMl_SObj start = NULL;
+    if (!program) {
+        ok = 0;
+    } else {
+        gtk_ml_load_program(ctx, program);
+        start = gtk_ml_get_export(ctx, &err, program->start);
+    }
+    if (!start || !gtk_ml_run_program(ctx, &err, start, NULL)) {
+        if (!gtk_ml_dumpf(ctx, stderr, NULL, err)) {
+            fprintf(stderr, "<unprintable error>");
+        }
+        fprintf(stderr, "\n%s: the program did not run\n", name);
+        ok = 0;
+    } else {
+        GtkMl_SObj result = gtk_ml_peek(ctx).value.sobj;
+        if (!result || result->kind != GTKML_S_INT || result->value.s_int.value != expected) {
+            fprintf(stderr, "%s: expected %lld\n", name, (long long) expected);
+            ok = 0;
+        }
+        if ((program->image != NULL) != hit) {
+            fprintf(stderr, "%s: expected a cache %s\n", name, hit? "hit" : "miss");
+            ok = 0;
+        }
+    }
+
+    gtk_ml_del_context(ctx);
+    free(src);
+
+    char entry[sizeof(dir) + 256];
+    size_t n = entries(entry, sizeof(entry));
+    if (n != n_entries) {
+        fprintf(stderr, "%s: expected %zu cache entries, got %zu\n", name, n_entries, n);
+        ok = 0;
+    }
+
+    return ok;
+}
+
+int main() {
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(source, sizeof(source), "%s/source.gtkml", dir);
+
+    char first[sizeof(dir) + 256];
+    int ok = write_file(source, SRC_A)
+        && run("cold", 42, 0, 1)
+        && entries(first, sizeof(first)) == 1
+        && run("warm", 42, 1, 1)
+        // a changed source is a different entry, the old one stays for whoever still has that source
+        && write_file(source, SRC_B)
+        && run("changed", 43, 0, 2)
+        && run("changed again", 43, 1, 2)
+        && write_file(source, SRC_A)
+        && run("restored", 42, 1, 2)
+        // an entry that can't be mapped is compiled again and replaced
+        && write_file(first, "not an image")
+        && run("corrupt", 42, 0, 2)
+        && run("replaced", 42, 1, 2);
+
+    char entry[sizeof(dir) + 256];
+    while (entries(entry, sizeof(entry)) && remove(entry) == 0) {
+    }
+    remove(source);
+    remove(dir);
+
+    return !ok;
+}
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "gtk-ml.h"
+
+#define N_SMALL 2000
+#define N_LARGE 32000
+
+GTKML_PRIVATE double now() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+GTKML_PRIVATE void report(GtkMl_Context *ctx, GtkMl_SObj err) {
+    if (!gtk_ml_dumpf(ctx, stderr, NULL, err)) {
+        fprintf(stderr, "<unprintable error>");
+    }
+    fprintf(stderr, "\n");
+}
+
+// an array of n distinct integer, float and string literals, every one of them a new constant
+GTKML_PRIVATE char *synthesize(size_t n) {
+    size_t cap = 64 + n * 32;
+    char *src = malloc(cap);
+    size_t len = (size_t) snprintf(src, cap, "(define (constants) [");
+    for (size_t i = 0; i < n; i++) {
+        switch (i % 3) {
+        case 0:
+            len += (size_t) snprintf(src + len, cap - len, " %zu", i);
+            break;
+        case 1:
+            len += (size_t) snprintf(src + len, cap - len, " %zu.5", i);
+            break;
+        case 2:
+            len += (size_t) snprintf(src + len, cap - len, " \"s%zu\"", i);
+            break;
+        }
+    }
+    snprintf(src + len, cap - len, " ])\n");
+    return src;
+}
+
+GTKML_PRIVATE int bench(size_t n) {
+    GtkMl_SObj err = NULL;
+
+    char *src = synthesize(n);
+
+    GtkMl_Context *ctx = gtk_ml_new_context();
+
+    double start = now();
+    GtkMl_SObj lambda = gtk_ml_loads(ctx, &err, src);
+    free(src);
+    if (!lambda) {
+        report(ctx, err);
+        gtk_ml_del_context(ctx);
+        return 0;
+    }
+    double loaded = now();
+
+    gtk_ml_push(ctx, gtk_ml_value_sobject(lambda));
+
+    GtkMl_Builder *builder = gtk_ml_new_builder(ctx);
+
+    if (!gtk_ml_compile_program(ctx, builder, &err, lambda)) {
+        report(ctx, err);
+        gtk_ml_del_context(ctx);
+        return 0;
+    }
+
+    GtkMl_Program *linked = gtk_ml_build(ctx, &err, builder);
+    if (!linked) {
+        report(ctx, err);
+        gtk_ml_del_context(ctx);
+        return 0;
+    }
+    double built = now();
+
+    printf("%8zu literals load %8.3f s compile %8.3f s %8.2f us/literal %8zu data %8zu statics\n", n,
+        loaded - start, built - loaded, (built - loaded) / (double) n * 1e6, linked->n_data, linked->n_static);
+
+    gtk_ml_del_context(ctx);
+
+    return 1;
+}
+
+int main() {
+    if (!bench(N_SMALL)) {
+        return 1;
+    }
+    if (!bench(N_LARGE)) {
+        return 1;
+    }
+    return 0;
+}
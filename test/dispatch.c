@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <time.h>
+#include "gtk-ml.h"
+
+#define BENCH \
+    "(define (= a b) (cmp 0 a b))\n" \
+    "(define (fib n)\n" \
+    "  (cond\n" \
+    "    (= n 0) 0\n" \
+    "    (= n 1) 1\n" \
+    "    :else   (+ (fib (- n 1)) (fib (- n 2)))))\n" \
+    "(fib 22)\n"
+
+GTKML_PRIVATE double now() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+GTKML_PRIVATE void report(GtkMl_Context *ctx, GtkMl_SObj err) {
+    if (!gtk_ml_dumpf(ctx, stderr, NULL, err)) {
+        fprintf(stderr, "<unprintable error>");
+    }
+    fprintf(stderr, "\n");
+}
+
+GTKML_PRIVATE int bench(const char *name, GtkMl_Dispatch dispatch) {
+    GtkMl_SObj err = NULL;
+
+    GtkMl_Context *ctx = gtk_ml_new_context();
+    gtk_ml_set_dispatch(ctx, dispatch);
+
+    GtkMl_SObj lambda = gtk_ml_loads(ctx, &err, BENCH);
+    if (!lambda) {
+        report(ctx, err);
+        gtk_ml_del_context(ctx);
+        return 0;
+    }
+
+    gtk_ml_push(ctx, gtk_ml_value_sobject(lambda));
+
+    GtkMl_Builder *builder = gtk_ml_new_builder(ctx);
+
+    if (!gtk_ml_compile_program(ctx, builder, &err, lambda)) {
+        report(ctx, err);
+        gtk_ml_del_context(ctx);
+        return 0;
+    }
+
+    GtkMl_Program *linked = gtk_ml_build(ctx, &err, builder);
+    if (!linked) {
+        report(ctx, err);
+        gtk_ml_del_context(ctx);
+        return 0;
+    }
+
+    gtk_ml_load_program(ctx, linked);
+
+    GtkMl_SObj program = gtk_ml_get_export(ctx, &err, linked->start);
+    if (!program) {
+        report(ctx, err);
+        gtk_ml_del_context(ctx);
+        return 0;
+    }
+
+    uint64_t before = gtk_ml_executed(ctx);
+    double start = now();
+    if (!gtk_ml_run_program(ctx, &err, program, NULL)) {
+        report(ctx, err);
+        gtk_ml_del_context(ctx);
+        return 0;
+    }
+    double elapsed = now() - start;
+    uint64_t executed = gtk_ml_executed(ctx) - before;
+
+    printf("%-8s %12llu instructions %8.3f s %8.2f Minstr/s result ", name, (unsigned long long) executed, elapsed, (double) executed / elapsed * 1e-6);
+    if (!gtk_ml_dumpf(ctx, stdout, NULL, gtk_ml_peek(ctx).value.sobj)) {
+        printf("<unprintable>");
+    }
+    printf("\n");
+
+    gtk_ml_del_context(ctx);
+
+    return 1;
+}
+
+int main() {
+    if (!bench("table", GTKML_DISPATCH_TABLE)) {
+        return 1;
+    }
+    if (!bench("threaded", GTKML_DISPATCH_THREADED)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gtk-ml.h"
+
+#define SRC "(define (f x) x)\n(define (g) (f 2))\n"
+
+GTKML_PRIVATE void report(GtkMl_Context *ctx, GtkMl_SObj err) {
+    if (!gtk_ml_dumpf(ctx, stderr, NULL, err)) {
+        fprintf(stderr, "<unprintable error>");
+    }
+    fprintf(stderr, "\n");
+}
+
+// the value of `:key` in the error `err`, or NULL
+GTKML_PRIVATE GtkMl_SObj field(GtkMl_Context *ctx, GtkMl_SObj err, const char *key) {
+    GtkMl_TaggedValue value = gtk_ml_hash_trie_get(&err->value.s_map.map, gtk_ml_value_sobject(gtk_ml_new_keyword(ctx, NULL, 0, key, strlen(key))));
+    return gtk_ml_has_value(value)? value.value.sobj : NULL;
+}
+
+GTKML_PRIVATE gboolean is_string(GtkMl_SObj s, const char *expected) {
+    if (!s || s->kind != GTKML_S_ARRAY || !gtk_ml_array_trie_is_string(&s->value.s_array.array)) {
+        return 0;
+    }
+    char *str = gtk_ml_to_c_str(s);
+    gboolean result = strcmp(str, expected) == 0;
+    free(str);
+    return result;
+}
+
+// compiles `SRC`, and when `extern_name` is set a block that calls it
+GTKML_PRIVATE GtkMl_Program *build(GtkMl_Context *ctx, GtkMl_SObj *err, const char *extern_name) {
+    GtkMl_SObj lambda = gtk_ml_loads(ctx, err, SRC);
+    if (!lambda) {
+        return NULL;
+    }
+    gtk_ml_push(ctx, gtk_ml_value_sobject(lambda));
+
+    GtkMl_Builder *builder = gtk_ml_new_builder(ctx);
+    if (!gtk_ml_compile_program(ctx, builder, err, lambda)) {
+        return NULL;
+    }
+
+    if (extern_name) {
+        GtkMl_BasicBlock *bb = gtk_ml_append_basic_block(builder, "caller");
+        GtkMl_Data name = gtk_ml_append_static_data(builder, gtk_ml_new_string(ctx, NULL, extern_name, strlen(extern_name)));
+        if (!gtk_ml_build_push_addr(ctx, builder, bb, err, name)) {
+            return NULL;
+        }
+    }
+
+    return gtk_ml_build(ctx, err, builder);
+}
+
+// names are found by their contents and give the same export every time, missing ones give NULL
+GTKML_PRIVATE int lookup(GtkMl_Program *program, const char *where) {
+    char *name = malloc(2);
+    strcpy(name, "f");
+    GtkMl_SObj f = gtk_ml_program_export(program, "f");
+    GtkMl_SObj again = gtk_ml_program_export(program, name);
+    free(name);
+
+    int ok = 1;
+    if (!f || f->kind != GTKML_S_PROGRAM || !is_string(f->value.s_program.linkage_name, "f")) {
+        fprintf(stderr, "%s: f is not exported\n", where);
+        ok = 0;
+    } else if (again != f) {
+        fprintf(stderr, "%s: f was looked up as two different exports\n", where);
+        ok = 0;
+    }
+    if (!gtk_ml_program_export(program, "g")) {
+        fprintf(stderr, "%s: g is not exported\n", where);
+        ok = 0;
+    }
+
+    const char *missing[] = { "h", "", "ff", "F", "f ", "caller" };
+    for (size_t i = 0; i < sizeof(missing) / sizeof(missing[0]); i++) {
+        if (gtk_ml_program_export(program, missing[i])) {
+            fprintf(stderr, "%s: \"%s\" was found without being exported\n", where, missing[i]);
+            ok = 0;
+        }
+    }
+
+    return ok;
+}
+
+GTKML_PRIVATE int missing_export() {
+    GtkMl_SObj err = NULL;
+    GtkMl_Context *ctx = gtk_ml_new_context();
+
+    GtkMl_Program *linked = build(ctx, &err, NULL);
+    if (!linked) {
+        report(ctx, err);
+        gtk_ml_del_context(ctx);
+        return 0;
+    }
+
+    int ok = lookup(linked, "linked");
+
+    // a serialized program gets its table back when it is loaded
+    FILE *file = tmpfile();
+    GtkMl_Serializer serf;
+    gtk_ml_new_serializer(&serf);
+    GtkMl_Program *loaded = NULL;
+    if (file && gtk_ml_serf_program(&serf, ctx, file, &err, linked)) {
+        rewind(file);
+        GtkMl_Deserializer deserf;
+        gtk_ml_new_deserializer(&deserf);
+        loaded = gtk_ml_deserf_program(&deserf, ctx, file, &err);
+    }
+    if (file) {
+        fclose(file);
+    }
+    if (!loaded) {
+        if (err) {
+            report(ctx, err);
+        }
+        fprintf(stderr, "loaded: the program did not round trip\n");
+        gtk_ml_del_context(ctx);
+        return 0;
+    }
+    ok = ok && lookup(loaded, "loaded");
+
+    // through the context, a missing name is a binding error naming it
+    gtk_ml_load_program(ctx, loaded);
+    err = NULL;
+    if (gtk_ml_get_export(ctx, &err, "f") != gtk_ml_program_export(loaded, "f") || err) {
+        fprintf(stderr, "context: f is not exported\n");
+        ok = 0;
+    }
+    if (gtk_ml_get_export(ctx, &err, "h")) {
+        fprintf(stderr, "context: h was found without being exported\n");
+        ok = 0;
+    } else if (!err || !gtk_ml_equal(field(ctx, err, "err"), gtk_ml_new_symbol(ctx, NULL, 0, "binding-error", strlen("binding-error")))
+            || !gtk_ml_equal(field(ctx, err, "binding"), gtk_ml_new_symbol(ctx, NULL, 0, "h", 1))) {
+        fprintf(stderr, "context: looking up h gave the wrong error\n");
+        ok = 0;
+    }
+
+    gtk_ml_del_context(ctx);
+
+    return ok;
+}
+
+// an extern nobody exports fails the link and lists what is exported instead
+GTKML_PRIVATE int missing_extern() {
+    GtkMl_SObj err = NULL;
+    GtkMl_Context *ctx = gtk_ml_new_context();
+
+    int ok = 1;
+    if (!build(ctx, &err, "f")) {
+        report(ctx, err);
+        fprintf(stderr, "extern: calling f did not link\n");
+        ok = 0;
+    }
+
+    err = NULL;
+    if (build(ctx, &err, "h")) {
+        fprintf(stderr, "extern: calling h linked without h being exported\n");
+        ok = 0;
+    } else if (!err || !gtk_ml_equal(field(ctx, err, "err"), gtk_ml_new_symbol(ctx, NULL, 0, "linkage-error", strlen("linkage-error")))
+            || !is_string(field(ctx, err, "linkage-name"), "h")) {
+        fprintf(stderr, "extern: calling h gave the wrong error\n");
+        ok = 0;
+    } else {
+        GtkMl_SObj exports = field(ctx, err, "all-exports");
+        gboolean has_f = 0;
+        gboolean has_g = 0;
+        size_t len = exports && exports->kind == GTKML_S_ARRAY? gtk_ml_array_trie_len(&exports->value.s_array.array) : 0;
+        for (size_t i = 0; i < len; i++) {
+            GtkMl_SObj name = gtk_ml_array_trie_get(&exports->value.s_array.array, i).value.sobj;
+            has_f = has_f || is_string(name, "f");
+            has_g = has_g || is_string(name, "g");
+        }
+        if (!has_f || !has_g) {
+            fprintf(stderr, "extern: the linkage error doesn't list f and g\n");
+            ok = 0;
+        }
+    }
+
+    gtk_ml_del_context(ctx);
+
+    return ok;
+}
+
+int main() {
+    if (!missing_export()) {
+        return 1;
+    }
+    if (!missing_extern()) {
+        return 1;
+    }
+    return 0;
+}
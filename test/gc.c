@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdint.h>
+#define GTKML_INCLUDE_INTERNAL
+#include "gtk-ml.h"
+#include "gtk-ml-internal.h"
+
+GTKML_PRIVATE GtkMl_Slab *slab_of(GtkMl_SObj s) {
+    return (GtkMl_Slab *) ((uintptr_t) s & ~(uintptr_t) (GTKML_SLAB_SIZE - 1));
+}
+
+// fills the nursery with garbage, so the next step is a minor collection
+GTKML_PRIVATE gboolean minor_collection(GtkMl_Context *ctx) {
+    ctx->gc->m_values = SIZE_MAX;
+    while (ctx->gc->nursery_len < GTKML_GC_NURSERY_THRESHOLD && gtk_ml_new_int(ctx, NULL, 0)) {
+    }
+    return gtk_ml_collect(ctx);
+}
+
+// an old var pointing at a young list, written through the barrier
+GTKML_PRIVATE int old_to_young() {
+    GtkMl_Context *ctx = gtk_ml_new_context();
+
+    GtkMl_SObj v = gtk_ml_new_var(ctx, NULL, gtk_ml_new_nil(ctx, NULL));
+    gtk_ml_push(ctx, gtk_ml_value_sobject(v));
+
+    int ok = 1;
+    if (!minor_collection(ctx) || !(v->flags & GTKML_FLAG_OLD)) {
+        fprintf(stderr, "barrier: the var was not promoted\n");
+        ok = 0;
+    }
+
+    GtkMl_SObj y = gtk_ml_new_list(ctx, NULL, gtk_ml_new_int(ctx, NULL, 42), gtk_ml_new_nil(ctx, NULL));
+    v->value.s_var.expr = y;
+    gtk_ml_write_barrier(v);
+    if (!(v->flags & GTKML_FLAG_REMEMBERED)) {
+        fprintf(stderr, "barrier: the var was not remembered\n");
+        ok = 0;
+    }
+
+    if (!minor_collection(ctx)) {
+        fprintf(stderr, "barrier: no minor collection ran\n");
+        ok = 0;
+    }
+    if ((y->flags & GTKML_FLAG_FREE) || (gtk_ml_car(y)->flags & GTKML_FLAG_FREE) || gtk_ml_car(y)->value.s_int.value != 42) {
+        fprintf(stderr, "barrier: a young value held by an old var was freed\n");
+        ok = 0;
+    }
+    if (!(y->flags & GTKML_FLAG_OLD) || !(gtk_ml_car(y)->flags & GTKML_FLAG_OLD)) {
+        fprintf(stderr, "barrier: a young value held by an old var was not promoted\n");
+        ok = 0;
+    }
+    if (v->flags & GTKML_FLAG_REMEMBERED) {
+        fprintf(stderr, "barrier: the var was still remembered after the minor collection\n");
+        ok = 0;
+    }
+
+    gtk_ml_del_context(ctx);
+
+    return ok;
+}
+
+// a young var that survives marking and is written while its page waits to be swept
+GTKML_PRIVATE int written_during_sweep() {
+    GtkMl_Context *ctx = gtk_ml_new_context();
+    GtkMl_Gc *gc = ctx->gc;
+    gtk_ml_set_gc_budget(ctx, 1);
+
+    GtkMl_SObj v = gtk_ml_new_var(ctx, NULL, gtk_ml_new_nil(ctx, NULL));
+    gtk_ml_push(ctx, gtk_ml_value_sobject(v));
+
+    // the page cells come from is swept as soon as marking ends
+    while (gc->slab == slab_of(v) && gtk_ml_new_int(ctx, NULL, 0)) {
+    }
+
+    gc->m_values = 0;
+    while (!gc->sweeping && gtk_ml_collect(ctx)) {
+    }
+    if (!slab_of(v)->unswept || (v->flags & GTKML_FLAG_OLD)) {
+        fprintf(stderr, "sweep: the var was swept too early\n");
+        gtk_ml_del_context(ctx);
+        return 0;
+    }
+
+    GtkMl_SObj y = gtk_ml_new_int(ctx, NULL, 42);
+    v->value.s_var.expr = y;
+    gtk_ml_write_barrier(v);
+
+    while (gc->sweeping && gtk_ml_collect(ctx)) {
+    }
+
+    int ok = 1;
+    if (!minor_collection(ctx)) {
+        fprintf(stderr, "sweep: no minor collection ran\n");
+        ok = 0;
+    }
+    if (!(v->flags & GTKML_FLAG_OLD)) {
+        fprintf(stderr, "sweep: the var was not promoted\n");
+        ok = 0;
+    }
+    if ((y->flags & GTKML_FLAG_FREE) || y->value.s_int.value != 42) {
+        fprintf(stderr, "sweep: a value held by a var written during the sweep was freed\n");
+        ok = 0;
+    }
+
+    gtk_ml_del_context(ctx);
+
+    return ok;
+}
+
+// a young value stored into an old var that is never named, the way macro expansions are written into the ast
+GTKML_PRIVATE int stored_without_owner() {
+    GtkMl_Context *ctx = gtk_ml_new_context();
+
+    GtkMl_SObj v = gtk_ml_new_var(ctx, NULL, gtk_ml_new_nil(ctx, NULL));
+    gtk_ml_push(ctx, gtk_ml_value_sobject(v));
+
+    int ok = 1;
+    if (!minor_collection(ctx) || !(v->flags & GTKML_FLAG_OLD)) {
+        fprintf(stderr, "owner: the var was not promoted\n");
+        ok = 0;
+    }
+
+    GtkMl_SObj y = gtk_ml_new_list(ctx, NULL, gtk_ml_new_int(ctx, NULL, 42), gtk_ml_new_nil(ctx, NULL));
+    v->value.s_var.expr = y;
+    gtk_ml_write_barrier_value(y);
+
+    if (!minor_collection(ctx)) {
+        fprintf(stderr, "owner: no minor collection ran\n");
+        ok = 0;
+    }
+    if ((y->flags & GTKML_FLAG_FREE) || (gtk_ml_car(y)->flags & GTKML_FLAG_FREE) || gtk_ml_car(y)->value.s_int.value != 42) {
+        fprintf(stderr, "owner: a value stored without naming its owner was freed\n");
+        ok = 0;
+    }
+
+    gtk_ml_del_context(ctx);
+
+    return ok;
+}
+
+// allocating through a whole incremental cycle doesn't grow the nursery
+GTKML_PRIVATE int nursery_during_cycle() {
+    GtkMl_Context *ctx = gtk_ml_new_context();
+    GtkMl_Gc *gc = ctx->gc;
+    gtk_ml_set_gc_budget(ctx, 1);
+
+    GtkMl_SObj v = gtk_ml_new_var(ctx, NULL, gtk_ml_new_nil(ctx, NULL));
+    gtk_ml_push(ctx, gtk_ml_value_sobject(v));
+
+    int ok = 1;
+
+    gc->m_values = 0;
+    if (!gtk_ml_collect(ctx) || !gc->marking) {
+        fprintf(stderr, "nursery: no full collection started\n");
+        gtk_ml_del_context(ctx);
+        return 0;
+    }
+    size_t len = gc->nursery_len;
+    for (size_t i = 0; i < 4 * GTKML_GC_NURSERY_THRESHOLD; i++) {
+        if (!gtk_ml_new_int(ctx, NULL, 0)) {
+            ok = 0;
+        }
+    }
+    if (gc->nursery_len != len) {
+        fprintf(stderr, "nursery: grew from %zu to %zu while marking\n", len, gc->nursery_len);
+        ok = 0;
+    }
+
+    while (!gc->sweeping && gtk_ml_collect(ctx)) {
+    }
+    len = gc->nursery_len;
+    for (size_t i = 0; i < 4 * GTKML_GC_NURSERY_THRESHOLD; i++) {
+        if (!gtk_ml_new_int(ctx, NULL, 0)) {
+            ok = 0;
+        }
+    }
+    if (gc->nursery_len != len) {
+        fprintf(stderr, "nursery: grew from %zu to %zu while sweeping\n", len, gc->nursery_len);
+        ok = 0;
+    }
+
+    // a cell handed out while sweeping, kept by an old var
+    GtkMl_SObj y = gtk_ml_new_int(ctx, NULL, 42);
+    v->value.s_var.expr = y;
+    gtk_ml_write_barrier(v);
+
+    while (gc->sweeping && gtk_ml_collect(ctx)) {
+    }
+    if (!minor_collection(ctx)) {
+        fprintf(stderr, "nursery: no minor collection ran\n");
+        ok = 0;
+    }
+    if ((y->flags & GTKML_FLAG_FREE) || y->value.s_int.value != 42) {
+        fprintf(stderr, "nursery: a value allocated while sweeping was freed\n");
+        ok = 0;
+    }
+
+    gtk_ml_del_context(ctx);
+
+    return ok;
+}
+
+int main() {
+    if (!old_to_young()) {
+        return 1;
+    }
+    if (!written_during_sweep()) {
+        return 1;
+    }
+    if (!stored_without_owner()) {
+        return 1;
+    }
+    if (!nursery_during_cycle()) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <time.h>
+#include "gtk-ml.h"
+
+#define N_KEYS 2000000
+#define N_COLLIDING 20000
+#define N_HASHES 64
+
+GTKML_PRIVATE double now() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// only ever produces N_HASHES different hashes, so almost every key ends up in a collision node
+GTKML_PRIVATE void colliding_start(GtkMl_Hash *hash) {
+    *hash = 0;
+}
+
+GTKML_PRIVATE gboolean colliding_update(GtkMl_Hash *hash, GtkMl_TaggedValue value) {
+    *hash = (GtkMl_Hash) (value.value.s64 % N_HASHES) * 0x9e3779b1u;
+    return 1;
+}
+
+GTKML_PRIVATE void colliding_finish(GtkMl_Hash *hash) {
+    (void) hash;
+}
+
+GTKML_PRIVATE int bench(const char *name, GtkMl_Hasher *hasher, int64_t n) {
+    GtkMl_HashTrie ht;
+    gtk_ml_new_hash_trie(&ht, hasher);
+
+    double start = now();
+    for (int64_t i = 0; i < n; i++) {
+        GtkMl_HashTrie new;
+        (void) gtk_ml_hash_trie_insert(&new, &ht, gtk_ml_value_int(i), gtk_ml_value_int(i * 2));
+        gtk_ml_del_hash_trie(NULL, &ht, gtk_ml_delete_value);
+        ht = new;
+    }
+    double inserted = now() - start;
+
+    start = now();
+    for (int64_t i = 0; i < n; i++) {
+        GtkMl_TaggedValue value = gtk_ml_hash_trie_get(&ht, gtk_ml_value_int(i));
+        if (!gtk_ml_has_value(value) || value.value.s64 != i * 2) {
+            fprintf(stderr, "%s: lost key %lld\n", name, (long long) i);
+            return 0;
+        }
+    }
+    double found = now() - start;
+
+    start = now();
+    for (int64_t i = 0; i < n; i += 2) {
+        GtkMl_HashTrie new;
+        (void) gtk_ml_hash_trie_delete(&new, &ht, gtk_ml_value_int(i));
+        gtk_ml_del_hash_trie(NULL, &ht, gtk_ml_delete_value);
+        ht = new;
+    }
+    double deleted = now() - start;
+
+    if (gtk_ml_hash_trie_len(&ht) != (size_t) (n / 2)) {
+        fprintf(stderr, "%s: expected %lld keys, got %zu\n", name, (long long) (n / 2), gtk_ml_hash_trie_len(&ht));
+        return 0;
+    }
+
+    printf("%-10s %8lld keys insert %8.1f ns get %8.1f ns delete %8.1f ns\n", name, (long long) n,
+        inserted / n * 1e9, found / n * 1e9, deleted / (n / 2) * 1e9);
+
+    gtk_ml_del_hash_trie(NULL, &ht, gtk_ml_delete_value);
+
+    return 1;
+}
+
+// the same as `bench`, but on a mutable table that is changed in place
+GTKML_PRIVATE int bench_table(const char *name, GtkMl_Hasher *hasher, int64_t n) {
+    GtkMl_HashTable table;
+    gtk_ml_new_hash_table(&table, hasher);
+
+    double start = now();
+    for (int64_t i = 0; i < n; i++) {
+        (void) gtk_ml_hash_table_insert(&table, gtk_ml_value_int(i), gtk_ml_value_int(i * 2));
+    }
+    double inserted = now() - start;
+
+    start = now();
+    for (int64_t i = 0; i < n; i++) {
+        GtkMl_TaggedValue value = gtk_ml_hash_table_get(&table, gtk_ml_value_int(i));
+        if (!gtk_ml_has_value(value) || value.value.s64 != i * 2) {
+            fprintf(stderr, "%s: lost key %lld\n", name, (long long) i);
+            return 0;
+        }
+    }
+    double found = now() - start;
+
+    start = now();
+    for (int64_t i = 0; i < n; i += 2) {
+        (void) gtk_ml_hash_table_delete(&table, gtk_ml_value_int(i));
+    }
+    double deleted = now() - start;
+
+    if (gtk_ml_hash_table_len(&table) != (size_t) (n / 2)) {
+        fprintf(stderr, "%s: expected %lld keys, got %zu\n", name, (long long) (n / 2), gtk_ml_hash_table_len(&table));
+        return 0;
+    }
+    for (int64_t i = 0; i < n; i++) {
+        if (gtk_ml_hash_table_contains(&table, gtk_ml_value_int(i)) != (i % 2 == 1)) {
+            fprintf(stderr, "%s: key %lld is wrong after deleting\n", name, (long long) i);
+            return 0;
+        }
+    }
+
+    printf("%-10s %8lld keys insert %8.1f ns get %8.1f ns delete %8.1f ns\n", name, (long long) n,
+        inserted / n * 1e9, found / n * 1e9, deleted / (n / 2) * 1e9);
+
+    gtk_ml_del_hash_table(NULL, &table, gtk_ml_delete_value);
+
+    return 1;
+}
+
+// builds {:k v}
+GTKML_PRIVATE GtkMl_SObj singleton_map(GtkMl_Context *ctx, GtkMl_SObj v) {
+    GtkMl_SObj empty = gtk_ml_new_map(ctx, NULL, NULL);
+    GtkMl_SObj map = gtk_ml_new_map(ctx, NULL, NULL);
+    gtk_ml_hash_trie_insert(&map->value.s_map.map, &empty->value.s_map.map, gtk_ml_value_sobject(gtk_ml_new_keyword(ctx, NULL, 0, "k", 1)), gtk_ml_value_sobject(v));
+    return map;
+}
+
+// builds #{m}, which hashes m
+GTKML_PRIVATE GtkMl_SObj singleton_set(GtkMl_Context *ctx, GtkMl_SObj m) {
+    GtkMl_SObj empty = gtk_ml_new_set(ctx, NULL);
+    GtkMl_SObj set = gtk_ml_new_set(ctx, NULL);
+    gtk_ml_hash_set_insert(&set->value.s_set.set, &empty->value.s_set.set, gtk_ml_value_sobject(m));
+    return set;
+}
+
+// a map that holds a var must still equal its structural twin after the var is assigned
+GTKML_PRIVATE int assigned_var() {
+    GtkMl_Context *ctx = gtk_ml_new_context();
+
+    GtkMl_SObj v = gtk_ml_new_var(ctx, NULL, gtk_ml_new_int(ctx, NULL, 1));
+    GtkMl_SObj m = singleton_map(ctx, v);
+    GtkMl_SObj s = singleton_set(ctx, m);
+
+    v->value.s_var.expr = gtk_ml_new_int(ctx, NULL, 2);
+    gtk_ml_write_barrier(v);
+
+    GtkMl_SObj m2 = singleton_map(ctx, gtk_ml_new_var(ctx, NULL, gtk_ml_new_int(ctx, NULL, 2)));
+    GtkMl_SObj s2 = singleton_set(ctx, m2);
+
+    int ok = 1;
+    if (!gtk_ml_equal(m, m2) || !gtk_ml_equal(m2, m)) {
+        fprintf(stderr, "var: maps are not equal after assign\n");
+        ok = 0;
+    }
+    if (!gtk_ml_hash_set_contains(&s2->value.s_set.set, gtk_ml_value_sobject(m))
+            || !gtk_ml_hash_set_contains(&s->value.s_set.set, gtk_ml_value_sobject(m2))) {
+        fprintf(stderr, "var: set lookup fails after assign\n");
+        ok = 0;
+    }
+
+    gtk_ml_del_context(ctx);
+
+    return ok;
+}
+
+int main() {
+    GtkMl_Hasher colliding = GTKML_VALUE_HASHER;
+    colliding.start = colliding_start;
+    colliding.update = colliding_update;
+    colliding.finish = colliding_finish;
+
+    if (!bench("value", &GTKML_VALUE_HASHER, N_KEYS)) {
+        return 1;
+    }
+    if (!bench("colliding", &colliding, N_COLLIDING)) {
+        return 1;
+    }
+    if (!bench_table("table", &GTKML_VALUE_HASHER, N_KEYS)) {
+        return 1;
+    }
+    if (!bench_table("table-col", &colliding, N_COLLIDING)) {
+        return 1;
+    }
+    if (!assigned_var()) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gtk-ml.h"
+
+#define SRC "(define (f x) (+ x 1))\n(f 41)\n"
+
+GTKML_PRIVATE char path[] = "/tmp/gtkml-image-XXXXXX";
+
+GTKML_PRIVATE void report(GtkMl_Context *ctx, GtkMl_SObj err) {
+    if (!gtk_ml_dumpf(ctx, stderr, NULL, err)) {
+        fprintf(stderr, "<unprintable error>");
+    }
+    fprintf(stderr, "\n");
+}
+
+// compiles `SRC` with two vars among the statics, one holding itself and one holding a list holding itself
+GTKML_PRIVATE GtkMl_Program *build(GtkMl_Context *ctx, GtkMl_SObj *err, GtkMl_Static *cycles) {
+    GtkMl_SObj lambda = gtk_ml_loads(ctx, err, SRC);
+    if (!lambda) {
+        return NULL;
+    }
+    gtk_ml_push(ctx, gtk_ml_value_sobject(lambda));
+
+    GtkMl_SObj self = gtk_ml_new_var(ctx, NULL, gtk_ml_new_nil(ctx, NULL));
+    self->value.s_var.expr = self;
+    gtk_ml_push(ctx, gtk_ml_value_sobject(self));
+    GtkMl_SObj in_list = gtk_ml_new_var(ctx, NULL, gtk_ml_new_nil(ctx, NULL));
+    in_list->value.s_var.expr = gtk_ml_new_list(ctx, NULL, in_list, gtk_ml_new_nil(ctx, NULL));
+    gtk_ml_push(ctx, gtk_ml_value_sobject(in_list));
+
+    GtkMl_Builder *builder = gtk_ml_new_builder(ctx);
+    if (!gtk_ml_compile_program(ctx, builder, err, lambda)) {
+        return NULL;
+    }
+    cycles[0] = gtk_ml_append_static(builder, self);
+    cycles[1] = gtk_ml_append_static(builder, in_list);
+
+    return gtk_ml_build(ctx, err, builder);
+}
+
+// runs the start of `program` and checks what it leaves on the stack
+GTKML_PRIVATE int run(GtkMl_Context *ctx, GtkMl_Program *program, const char *name) {
+    GtkMl_SObj err = NULL;
+    gtk_ml_load_program(ctx, program);
+    GtkMl_SObj start = gtk_ml_get_export(ctx, &err, program->start);
+    if (!start || !gtk_ml_run_program(ctx, &err, start, NULL)) {
+        report(ctx, err);
+        fprintf(stderr, "%s: the program did not run\n", name);
+        return 0;
+    }
+    GtkMl_SObj result = gtk_ml_peek(ctx).value.sobj;
+    if (!result || result->kind != GTKML_S_INT || result->value.s_int.value != 42) {
+        fprintf(stderr, "%s: expected 42\n", name);
+        return 0;
+    }
+    return 1;
+}
+
+GTKML_PRIVATE GtkMl_SObj get_var(GtkMl_Program *program, GtkMl_Static handle) {
+    GtkMl_SObj var = handle < program->n_static? program->statics[handle] : NULL;
+    return var && var->kind == GTKML_S_VAR? var : NULL;
+}
+
+// both vars still point back at themselves, and not at a copy
+GTKML_PRIVATE int check_cycles(GtkMl_Program *program, const GtkMl_Static *cycles, const char *name) {
+    GtkMl_SObj self = get_var(program, cycles[0]);
+    if (!self || self->value.s_var.expr != self) {
+        fprintf(stderr, "%s: the var holding itself lost its value\n", name);
+        return 0;
+    }
+    GtkMl_SObj in_list = get_var(program, cycles[1]);
+    GtkMl_SObj list = in_list? in_list->value.s_var.expr : NULL;
+    if (!list || list->kind != GTKML_S_LIST || gtk_ml_car(list) != in_list || gtk_ml_cdr(list)->kind != GTKML_S_NIL) {
+        fprintf(stderr, "%s: the var holding a list of itself lost its value\n", name);
+        return 0;
+    }
+    return 1;
+}
+
+int main() {
+    GtkMl_SObj err = NULL;
+    GtkMl_Context *ctx = gtk_ml_new_context();
+
+    int fd = mkstemp(path);
+    FILE *stream = fd < 0? NULL : fdopen(fd, "wb");
+    if (!stream) {
+        perror("mkstemp");
+        return 1;
+    }
+
+    GtkMl_Static cycles[2] = { 0, 0 };
+    GtkMl_Program *built = build(ctx, &err, cycles);
+    gboolean written = built && gtk_ml_serf_image(ctx, stream, &err, built);
+    if (fclose(stream) != 0) {
+        written = 0;
+    }
+    if (!written) {
+        if (err) {
+            report(ctx, err);
+        }
+        fprintf(stderr, "built: the program was not written\n");
+        remove(path);
+        return 1;
+    }
+
+    int ok = check_cycles(built, cycles, "built") && run(ctx, built, "built");
+
+    // mapped in a context of its own, so nothing is shared with the program it was written from
+    GtkMl_Context *mapped_ctx = gtk_ml_new_context();
+    GtkMl_Program *mapped = gtk_ml_map_image(mapped_ctx, &err, path);
+    if (!mapped) {
+        report(mapped_ctx, err);
+        fprintf(stderr, "mapped: the image was not mapped\n");
+        ok = 0;
+    } else {
+        if (mapped->n_text != built->n_text || memcmp(mapped->text, built->text, sizeof(GtkMl_Instruction) * built->n_text) != 0
+                || mapped->n_static != built->n_static || strcmp(mapped->start, built->start) != 0) {
+            fprintf(stderr, "mapped: the program differs from the one written\n");
+            ok = 0;
+        }
+        ok = check_cycles(mapped, cycles, "mapped") && run(mapped_ctx, mapped, "mapped") && ok;
+    }
+
+    gtk_ml_del_context(mapped_ctx);
+    gtk_ml_del_context(ctx);
+    remove(path);
+
+    return !ok;
+}
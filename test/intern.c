@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#define GTKML_INCLUDE_INTERNAL
+#include "gtk-ml.h"
+#include "gtk-ml-internal.h"
+
+// more than the table starts out with, so it grows while the names are held
+#define N_NAMES 2000
+
+// a fresh heap copy of name `i`, so no two lookups share the bytes they pass in
+GTKML_PRIVATE char *name(int i, size_t *len) {
+    char buf[32];
+    *len = (size_t) snprintf(buf, sizeof(buf), "name-%d", i);
+    char *ptr = malloc(*len);
+    memcpy(ptr, buf, *len);
+    return ptr;
+}
+
+GTKML_PRIVATE GtkMl_Slab *slab_of(GtkMl_SObj s) {
+    return (GtkMl_Slab *) ((uintptr_t) s & ~(uintptr_t) (GTKML_SLAB_SIZE - 1));
+}
+
+// runs a whole full collection in one go
+GTKML_PRIVATE gboolean full_collection(GtkMl_Context *ctx) {
+    gtk_ml_set_gc_budget(ctx, 0);
+    ctx->gc->m_values = 0;
+    return gtk_ml_collect(ctx) && gtk_ml_collect(ctx);
+}
+
+// the same name always gives the same object, and symbols and keywords never share one
+GTKML_PRIVATE int same_name() {
+    GtkMl_Context *ctx = gtk_ml_new_context();
+    GtkMl_SObj *symbols = malloc(sizeof(GtkMl_SObj) * N_NAMES);
+    GtkMl_SObj *keywords = malloc(sizeof(GtkMl_SObj) * N_NAMES);
+    size_t before = ctx->gc->interned_len;
+
+    int ok = 1;
+    for (int i = 0; i < N_NAMES; i++) {
+        size_t len;
+        char *ptr = name(i, &len);
+        symbols[i] = gtk_ml_new_symbol(ctx, NULL, 0, ptr, len);
+        keywords[i] = gtk_ml_new_keyword(ctx, NULL, 0, ptr, len);
+        gtk_ml_push(ctx, gtk_ml_value_sobject(symbols[i]));
+        gtk_ml_push(ctx, gtk_ml_value_sobject(keywords[i]));
+        // borrowed names are copied, so this may go away
+        memset(ptr, 0, len);
+        free(ptr);
+    }
+
+    for (int i = 0; i < N_NAMES && ok; i++) {
+        size_t len;
+        char *ptr = name(i, &len);
+        GtkMl_SObj keyword = gtk_ml_new_keyword(ctx, NULL, 0, ptr, len);
+        // an owned name is taken over, or freed if the name is interned already
+        GtkMl_SObj symbol = gtk_ml_new_symbol(ctx, NULL, 1, ptr, len);
+        if (symbol != symbols[i] || keyword != keywords[i]) {
+            fprintf(stderr, "same: name-%d was interned twice\n", i);
+            ok = 0;
+        } else if (symbols[i] == keywords[i] || gtk_ml_equal(symbols[i], keywords[i])) {
+            fprintf(stderr, "same: the symbol and the keyword name-%d are the same\n", i);
+            ok = 0;
+        }
+    }
+
+    if (ok && ctx->gc->interned_len != before + 2 * N_NAMES) {
+        fprintf(stderr, "same: expected %zu interned names, got %zu\n", before + 2 * N_NAMES, ctx->gc->interned_len);
+        ok = 0;
+    }
+
+    free(symbols);
+    free(keywords);
+    gtk_ml_del_context(ctx);
+
+    return ok;
+}
+
+// parsed symbols keep their own span, but point at the interned one and compare equal to it
+GTKML_PRIVATE int with_span() {
+    GtkMl_Context *ctx = gtk_ml_new_context();
+
+    const char *src = "(foo foo)";
+    GtkMl_Span first = { src + 1, 3, 1, 1 };
+    GtkMl_Span second = { src + 5, 3, 1, 5 };
+    GtkMl_SObj plain = gtk_ml_new_symbol(ctx, NULL, 0, "foo", 3);
+    GtkMl_SObj a = gtk_ml_new_symbol(ctx, &first, 0, src + 1, 3);
+    GtkMl_SObj b = gtk_ml_new_symbol(ctx, &second, 0, src + 5, 3);
+
+    int ok = 1;
+    if (a == b || a->span.col != 1 || b->span.col != 5) {
+        fprintf(stderr, "span: parsed symbols lost their spans\n");
+        ok = 0;
+    }
+    if (a->value.s_symbol.interned != plain || b->value.s_symbol.interned != plain) {
+        fprintf(stderr, "span: parsed symbols don't point at the interned one\n");
+        ok = 0;
+    }
+    if (!gtk_ml_equal(a, b) || !gtk_ml_equal(a, plain)) {
+        fprintf(stderr, "span: parsed symbols don't compare equal to the interned one\n");
+        ok = 0;
+    }
+
+    gtk_ml_del_context(ctx);
+
+    return ok;
+}
+
+// names nobody holds leave the table, the ones still held stay where they are
+GTKML_PRIVATE int weak() {
+    GtkMl_Context *ctx = gtk_ml_new_context();
+
+    GtkMl_SObj held = gtk_ml_new_keyword(ctx, NULL, 0, "held", 4);
+    gtk_ml_push(ctx, gtk_ml_value_sobject(held));
+    size_t before = ctx->gc->interned_len;
+    int ok = 1;
+    for (int i = 0; i < N_NAMES; i++) {
+        size_t len;
+        char *ptr = name(i, &len);
+        if (!gtk_ml_new_symbol(ctx, NULL, 1, ptr, len)) {
+            ok = 0;
+        }
+    }
+
+    if (!full_collection(ctx)) {
+        fprintf(stderr, "weak: no full collection ran\n");
+        ok = 0;
+    }
+    if (ctx->gc->interned_len != before) {
+        fprintf(stderr, "weak: expected %zu interned names after the collection, got %zu\n", before, ctx->gc->interned_len);
+        ok = 0;
+    }
+    if ((held->flags & GTKML_FLAG_FREE) || gtk_ml_new_keyword(ctx, NULL, 0, "held", 4) != held) {
+        fprintf(stderr, "weak: a held keyword was interned again\n");
+        ok = 0;
+    }
+
+    // the freed names can be interned again
+    for (int i = 0; i < N_NAMES && ok; i++) {
+        size_t len;
+        char *ptr = name(i, &len);
+        GtkMl_SObj s = gtk_ml_new_symbol(ctx, NULL, 1, ptr, len);
+        char buf[32];
+        int n = snprintf(buf, sizeof(buf), "name-%d", i);
+        if (s->value.s_symbol.len != (size_t) n || memcmp(s->value.s_symbol.ptr, buf, (size_t) n) != 0) {
+            fprintf(stderr, "weak: name-%d came back wrong\n", i);
+            ok = 0;
+        }
+    }
+
+    gtk_ml_del_context(ctx);
+
+    return ok;
+}
+
+// a name that was garbage when marking ended is picked up again before its page is swept
+GTKML_PRIVATE int during_sweep() {
+    GtkMl_Context *ctx = gtk_ml_new_context();
+    GtkMl_Gc *gc = ctx->gc;
+    gtk_ml_set_gc_budget(ctx, 1);
+
+    GtkMl_SObj s = gtk_ml_new_symbol(ctx, NULL, 0, "revived", 7);
+
+    // the page cells come from is swept as soon as marking ends
+    while (gc->slab == slab_of(s) && gtk_ml_new_int(ctx, NULL, 0)) {
+    }
+
+    gc->m_values = 0;
+    while (!gc->sweeping && gtk_ml_collect(ctx)) {
+    }
+
+    int ok = 1;
+    if (gtk_ml_new_symbol(ctx, NULL, 0, "revived", 7) != s) {
+        fprintf(stderr, "sweep: an unswept name was interned again\n");
+        ok = 0;
+    }
+    gtk_ml_push(ctx, gtk_ml_value_sobject(s));
+
+    while (gc->sweeping && gtk_ml_collect(ctx)) {
+    }
+    if ((s->flags & GTKML_FLAG_FREE) || s->value.s_symbol.len != 7 || memcmp(s->value.s_symbol.ptr, "revived", 7) != 0) {
+        fprintf(stderr, "sweep: a name picked up during the sweep was freed\n");
+        ok = 0;
+    }
+    if (gtk_ml_new_symbol(ctx, NULL, 0, "revived", 7) != s) {
+        fprintf(stderr, "sweep: a name picked up during the sweep left the table\n");
+        ok = 0;
+    }
+
+    gtk_ml_del_context(ctx);
+
+    return ok;
+}
+
+int main() {
+    if (!same_name()) {
+        return 1;
+    }
+    if (!with_span()) {
+        return 1;
+    }
+    if (!weak()) {
+        return 1;
+    }
+    if (!during_sweep()) {
+        return 1;
+    }
+    return 0;
+}
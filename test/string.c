@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gtk-ml.h"
+
+#define N_CHARS 4000
+
+// one character of every utf-8 length, so pieces and slices end inside every kind of sequence
+#define N_ALPHABET 5
+GTKML_PRIVATE const uint32_t ALPHABET[N_ALPHABET] = { 'a', 0xE9, 0x20AC, 0x1F600, 'z' };
+
+GTKML_PRIVATE size_t encode(char *out, uint32_t c) {
+    if (c < 0x80) {
+        out[0] = (char) c;
+        return 1;
+    } else if (c < 0x800) {
+        out[0] = (char) (0xC0 | (c >> 6));
+        out[1] = (char) (0x80 | (c & 0x3F));
+        return 2;
+    } else if (c < 0x10000) {
+        out[0] = (char) (0xE0 | (c >> 12));
+        out[1] = (char) (0x80 | ((c >> 6) & 0x3F));
+        out[2] = (char) (0x80 | (c & 0x3F));
+        return 3;
+    } else {
+        out[0] = (char) (0xF0 | (c >> 18));
+        out[1] = (char) (0x80 | ((c >> 12) & 0x3F));
+        out[2] = (char) (0x80 | ((c >> 6) & 0x3F));
+        out[3] = (char) (0x80 | (c & 0x3F));
+        return 4;
+    }
+}
+
+// the utf-8 of `expected[start..end]`, which `out` must have room for
+GTKML_PRIVATE size_t encode_all(char *out, const uint32_t *expected, size_t start, size_t end) {
+    size_t bytes = 0;
+    for (size_t i = start; i < end; i++) {
+        bytes += encode(out + bytes, expected[i]);
+    }
+    return bytes;
+}
+
+GTKML_PRIVATE int check(const char *name, GtkMl_Array *string, const uint32_t *expected, size_t len) {
+    if (gtk_ml_array_trie_len(string) != len) {
+        fprintf(stderr, "%s: expected %zu characters, got %zu\n", name, len, gtk_ml_array_trie_len(string));
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        GtkMl_TaggedValue c = gtk_ml_array_trie_get(string, i);
+        if (!gtk_ml_has_value(c) || c.value.unicode != expected[i]) {
+            fprintf(stderr, "%s: expected U+%04X at %zu, got U+%04X\n", name, (unsigned) expected[i], i, (unsigned) c.value.unicode);
+            return 0;
+        }
+    }
+
+    char *want = malloc(4 * len + 1);
+    char *got = malloc(4 * len + 1);
+    size_t bytes = encode_all(want, expected, 0, len);
+    int ok = 1;
+    if (gtk_ml_string_bytes(string) != bytes) {
+        fprintf(stderr, "%s: expected %zu bytes, got %zu\n", name, bytes, gtk_ml_string_bytes(string));
+        ok = 0;
+    } else {
+        gtk_ml_string_write(string, got);
+        if (memcmp(want, got, bytes) != 0) {
+            fprintf(stderr, "%s: the bytes differ\n", name);
+            ok = 0;
+        }
+    }
+    free(want);
+    free(got);
+    return ok;
+}
+
+// appended a few characters at a time, long enough to span many pieces
+GTKML_PRIVATE int build(GtkMl_Array *out, uint32_t *expected) {
+    char bytes[4 * 13];
+    size_t len = 0;
+    gtk_ml_new_string_trie(out);
+    while (len < N_CHARS) {
+        size_t n = 1 + len % 13;
+        if (len + n > N_CHARS) {
+            n = N_CHARS - len;
+        }
+        for (size_t i = 0; i < n; i++) {
+            expected[len + i] = ALPHABET[(len + i) * 7 / 3 % N_ALPHABET];
+        }
+        gtk_ml_string_append(out, bytes, encode_all(bytes, expected, len, len + n));
+        len += n;
+    }
+    return check("append", out, expected, N_CHARS);
+}
+
+// substrings at every offset into the first and last few pieces, and at strides through the middle
+GTKML_PRIVATE int substring(GtkMl_Array *string, const uint32_t *expected) {
+    for (size_t start = 0; start < N_CHARS; start += start < 300 || start > N_CHARS - 300? 1 : 97) {
+        size_t ends[] = { start, start + 1, start + 2, start + 131, start + 700, N_CHARS - 1, N_CHARS };
+        for (size_t i = 0; i < sizeof(ends) / sizeof(ends[0]); i++) {
+            size_t end = ends[i] > N_CHARS? N_CHARS : ends[i];
+            if (end < start) {
+                continue;
+            }
+
+            GtkMl_Array part;
+            gtk_ml_array_trie_slice(&part, string, start, end);
+            int ok = check("substring", &part, expected + start, end - start);
+
+            // the two sides of a cut join back into the whole string
+            if (ok && end == start + 131) {
+                GtkMl_Array lhs;
+                GtkMl_Array rhs;
+                GtkMl_Array joined;
+                gtk_ml_array_trie_split(&lhs, &rhs, string, start);
+                gtk_ml_array_trie_concat(&joined, &lhs, &rhs);
+                ok = check("split", &lhs, expected, start)
+                    && check("split", &rhs, expected + start, N_CHARS - start)
+                    && check("split", &joined, expected, N_CHARS);
+                if (ok && !gtk_ml_array_trie_equal(&joined, string)) {
+                    fprintf(stderr, "split: joined halves are not equal to the string\n");
+                    ok = 0;
+                }
+                gtk_ml_del_array_trie(NULL, &lhs, gtk_ml_delete_value);
+                gtk_ml_del_array_trie(NULL, &rhs, gtk_ml_delete_value);
+                gtk_ml_del_array_trie(NULL, &joined, gtk_ml_delete_value);
+            }
+
+            gtk_ml_del_array_trie(NULL, &part, gtk_ml_delete_value);
+            if (!ok) {
+                fprintf(stderr, "substring: %zu..%zu of %d\n", start, end, N_CHARS);
+                return 0;
+            }
+        }
+    }
+    return check("substring", string, expected, N_CHARS);
+}
+
+// pushing and popping a wide character doesn't touch what the string shares
+GTKML_PRIVATE int push_pop(GtkMl_Array *string, const uint32_t *expected) {
+    GtkMl_Array pushed;
+    gtk_ml_array_trie_push(&pushed, string, gtk_ml_value_char(0x1F600));
+    GtkMl_TaggedValue last = gtk_ml_array_trie_get(&pushed, N_CHARS);
+    int ok = gtk_ml_array_trie_len(&pushed) == N_CHARS + 1 && last.value.unicode == 0x1F600;
+
+    GtkMl_Array popped;
+    GtkMl_TaggedValue c = gtk_ml_array_trie_pop(&popped, &pushed);
+    ok = ok && c.value.unicode == 0x1F600 && gtk_ml_array_trie_equal(&popped, string);
+    if (!ok) {
+        fprintf(stderr, "push: a pushed U+1F600 did not come back\n");
+    }
+    gtk_ml_del_array_trie(NULL, &pushed, gtk_ml_delete_value);
+    gtk_ml_del_array_trie(NULL, &popped, gtk_ml_delete_value);
+
+    return ok && check("push", string, expected, N_CHARS);
+}
+
+// every malformed byte becomes one U+FFFD and the characters around it stay intact
+GTKML_PRIVATE int malformed() {
+    GtkMl_Array string;
+    gtk_ml_new_string_trie(&string);
+    gtk_ml_string_append(&string, "a\xFF\xC3" "b\xE2\x82\xAC\xE2\x82", 9);
+    const uint32_t expected[] = { 'a', 0xFFFD, 0xFFFD, 'b', 0x20AC, 0xFFFD, 0xFFFD };
+    int ok = check("malformed", &string, expected, sizeof(expected) / sizeof(expected[0]));
+    gtk_ml_del_array_trie(NULL, &string, gtk_ml_delete_value);
+    return ok;
+}
+
+int main() {
+    uint32_t *expected = malloc(sizeof(uint32_t) * N_CHARS);
+
+    GtkMl_Array string;
+    int ok = build(&string, expected)
+        && substring(&string, expected)
+        && push_pop(&string, expected)
+        && malformed();
+
+    gtk_ml_del_array_trie(NULL, &string, gtk_ml_delete_value);
+    free(expected);
+
+    return !ok;
+}